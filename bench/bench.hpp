@@ -0,0 +1,97 @@
+#ifndef MV_BENCH_HPP
+#define MV_BENCH_HPP
+
+#include <cstdint>
+#include <cstdio>
+
+#include "microvisor/benchmark.hpp"
+#include "mv_host.h"
+#include "mv_syscalls.h"
+
+/**
+ *  Support for the `MV_BENCHMARK()` cases in `bench`, which drive the host
+ *  stand-ins and run under `microvisor-sdk-bench`.
+ */
+namespace bench {
+
+/**
+ *  Nanoseconds of CPU time used by the process. Time spent blocked, in
+ *  `mvHostWaitForInterrupt` for example, is not counted.
+ */
+uint64_t cpuNs();
+
+/**
+ *  CPU time and NSC calls summed over the spans between `start()` and
+ *  `stop()`, for cases whose setup between operations must not count.
+ */
+class Stopwatch {
+public:
+    void start() {
+        calls_at_ = mvHostGetCallCount();
+        cpu_at_ = cpuNs();
+    }
+
+    void stop() {
+        cpu_ns_ += cpuNs() - cpu_at_;
+        calls_ += mvHostGetCallCount() - calls_at_;
+    }
+
+    uint64_t totalCpuNs() const {
+        return cpu_ns_;
+    }
+
+    /**
+     *  Report the CPU time per operation as `<metric>_cpu_ns` and the NSC
+     *  calls per thousand operations as `<metric>_calls`. Call counts do
+     *  not depend on the machine, so the baseline check allows them no
+     *  slack.
+     */
+    void report(mv::Benchmark &bench, const char *metric, uint32_t operations) const {
+        char name[40];
+        std::snprintf(name, sizeof(name), "%s_cpu_ns", metric);
+        bench.report(name, cpu_ns_ / operations, "ns");
+        std::snprintf(name, sizeof(name), "%s_calls", metric);
+        bench.report(name, calls_ * 1000 / operations, "calls/1k");
+    }
+
+private:
+    uint64_t cpu_at_ = 0;
+    uint64_t calls_at_ = 0;
+    uint64_t cpu_ns_ = 0;
+    uint64_t calls_ = 0;
+};
+
+/**
+ *  Run `body`, which performs `operations` operations, and report its CPU
+ *  time and NSC calls as `Stopwatch::report()` does.
+ */
+template <typename Body>
+void measure(mv::Benchmark &bench, const char *metric, uint32_t operations, Body &&body) {
+    Stopwatch watch;
+    watch.start();
+    body();
+    watch.stop();
+    watch.report(bench, metric, operations);
+}
+
+/**
+ *  Shared setup for cases that use channels: a notification buffer, which
+ *  is never drained, and a network handle.
+ */
+struct Network {
+    Network();
+
+    MvNotificationHandle notifications = 0;
+    MvNetworkHandle network = 0;
+    MvNotification buffer[16] = {};
+
+    /**
+     *  Open a channel, waiting out the channel-open rate limit.
+     */
+    MvStatus open(MvChannelType type, uint8_t *receive, uint32_t receive_len, uint8_t *send, uint32_t send_len,
+                  MvChannelHandle *handle);
+};
+
+}
+
+#endif
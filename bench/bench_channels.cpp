@@ -0,0 +1,94 @@
+#include <cstdint>
+#include <cstdio>
+
+#include "bench.hpp"
+#include "microvisor/channel_reader.hpp"
+#include "microvisor/channel_writer.hpp"
+
+namespace {
+
+constexpr uint32_t kFrames = 8192;
+constexpr uint32_t kFrameSize = 32;
+
+// Frames are a length byte followed by that many payload bytes.
+struct FrameParser {
+    uint32_t frames = 0;
+
+    uint32_t operator()(const mv::RingRegion &region) {
+        uint8_t size;
+        if (!region.copy(0, &size, 1) || region.size() < 1u + size) return 0;
+        frames++;
+        return 1u + size;
+    }
+};
+
+// Write and then read `kFrames` frames on a channel whose buffers are
+// each `BufferSize` bytes.
+template <uint32_t BufferSize>
+void runFrames(bench::Network &network, mv::Benchmark &bench) {
+    alignas(512) static uint8_t receive_buffer[BufferSize];
+    alignas(512) static uint8_t send_buffer[BufferSize];
+    static uint8_t drained[BufferSize];
+    static uint8_t frame[kFrameSize] = {kFrameSize - 1};
+    MvChannelHandle handle;
+    if (network.open(MV_CHANNELTYPE_OPAQUEBYTES, receive_buffer, sizeof(receive_buffer), send_buffer,
+                     sizeof(send_buffer), &handle) != MV_STATUS_OKAY) {
+        bench.fail();
+        return;
+    }
+    mvHostChannelSetPeer(handle, MV_HOSTPEERMODE_HOLD);
+
+    char metric[32];
+    std::snprintf(metric, sizeof(metric), "writer_frame_buf%u", static_cast<unsigned>(BufferSize));
+    mv::ChannelWriter<512> writer(handle);
+    bench::measure(bench, metric, kFrames, [&] {
+        for (uint32_t sent = 0; sent < kFrames;) {
+            MvStatus status = writer.writeFrame(mv::ByteSpan(frame, sizeof(frame)));
+            if (status == MV_STATUS_OKAY) {
+                sent++;
+            } else if (status == MV_STATUS_INVALIDBUFFERSIZE) {
+                uint32_t length;
+                mvHostChannelDrain(handle, drained, sizeof(drained), &length);
+            } else {
+                bench.fail();
+                return;
+            }
+        }
+        writer.flush();
+    });
+
+    static uint8_t input[kFrames * kFrameSize];
+    for (uint32_t i = 0; i < kFrames; ++i) input[i * kFrameSize] = kFrameSize - 1;
+    std::snprintf(metric, sizeof(metric), "reader_frame_buf%u", static_cast<unsigned>(BufferSize));
+    mv::ChannelReader reader(handle, receive_buffer, sizeof(receive_buffer));
+    FrameParser parser;
+    bench::measure(bench, metric, kFrames, [&] {
+        uint32_t injected = 0;
+        while (parser.frames < kFrames) {
+            uint32_t accepted = 0;
+            mvHostChannelInject(handle, input + injected, sizeof(input) - injected, &accepted);
+            injected += accepted;
+            if (reader.process(parser) != MV_STATUS_OKAY) {
+                bench.fail();
+                return;
+            }
+        }
+        reader.commit();
+    });
+    mvCloseChannel(&handle);
+}
+
+}
+
+/**
+ *  Small frames through `mv::ChannelWriter` and `mv::ChannelReader`, with
+ *  the stand-ins adding no latency: the CPU time and NSC calls per frame
+ *  against the channel's buffer size. The far end is held, and drained or
+ *  fed with the `mvHost` controls, which are not counted.
+ */
+MV_BENCHMARK(channel, 0) {
+    bench::Network network;
+    runFrames<512>(network, bench);
+    runFrames<2048>(network, bench);
+    runFrames<8192>(network, bench);
+}
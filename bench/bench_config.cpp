@@ -0,0 +1,71 @@
+#include <cstdint>
+#include <cstdio>
+
+#include "bench.hpp"
+#include "microvisor/config_cache.hpp"
+#include "microvisor/notification_ring.hpp"
+
+namespace {
+
+constexpr uint32_t kIrq = 20;
+constexpr uint32_t kTag = 8;
+constexpr uint32_t kKeys = 64;
+constexpr uint32_t kLookups = 100000;
+
+using Cache = mv::ConfigCache<kKeys, 16, 64>;
+
+mv::NotificationRing<32> *irq_ring;
+
+void drainFromIrq() {
+    irq_ring->drain();
+}
+
+void onValue(void *context, MvStatus, MvConfigKeyFetchResult, mv::ByteSpan) {
+    ++*static_cast<uint32_t *>(context);
+}
+
+char names[kKeys][16];
+
+mv::ConfigKey configKey(uint32_t index) {
+    return {MV_CONFIGKEYFETCHSCOPE_DEVICE, MV_CONFIGKEYFETCHSTORE_CONFIG, mv::ByteSpan(names[index])};
+}
+
+}
+
+/**
+ *  `mv::ConfigCache` with the stand-ins adding no latency: the CPU time and
+ *  NSC calls per key for keys requested together, which share fetches, and
+ *  for requests answered from the cache.
+ */
+MV_BENCHMARK(config, 0) {
+    static const char kValue[] = "a config value of moderate length";
+    for (uint32_t i = 0; i < kKeys; ++i) {
+        std::snprintf(names[i], sizeof(names[i]), "bench-key-%u", static_cast<unsigned>(i));
+        mvHostConfigSet(MV_CONFIGKEYFETCHSCOPE_DEVICE, MV_CONFIGKEYFETCHSTORE_CONFIG, configKey(i).key.sized(),
+                        {reinterpret_cast<const uint8_t *>(kValue), sizeof(kValue) - 1});
+    }
+
+    bench::Network network;
+    // A ring left from an earlier run is stale after the reset.
+    mv::NotificationRing<32> ring;
+    MvNotificationHandle notifications;
+    if (ring.open(kIrq, &notifications) != MV_STATUS_OKAY) return;
+    irq_ring = &ring;
+    mvHostSetInterruptHandler(kIrq, drainFromIrq);
+    Cache cache(notifications, network.network, kTag, 60000000);
+    ring.on(kTag, Cache::onNotification, &cache);
+
+    uint32_t done = 0;
+    bench::measure(bench, "fetch_key", kKeys, [&] {
+        for (uint32_t i = 0; i < kKeys; ++i) cache.request(configKey(i), onValue, &done);
+        for (uint32_t wait = 0; done < kKeys && wait < 1000; ++wait) {
+            mvHostWaitForInterrupt(0);
+            cache.poll();
+        }
+    });
+
+    bench::measure(bench, "cached_key", kLookups, [&] {
+        for (uint32_t i = 0; i < kLookups; ++i) cache.request(configKey(i % kKeys), onValue, &done);
+    });
+    if (done != kKeys + kLookups) bench.fail();
+}
@@ -0,0 +1,102 @@
+#include <cstdint>
+#include <cstdio>
+
+#include "bench.hpp"
+#include "microvisor/flash_page_cache.hpp"
+
+namespace {
+
+constexpr uint32_t kRegion = 256 * 1024;
+constexpr uint32_t kRecord = 64;
+constexpr uint32_t kHits = 100000;
+constexpr uint32_t kSectors = 256;
+
+// Report `watch` as per-sector CPU time and calls, and as the bandwidth
+// that CPU time allows.
+void reportSectors(mv::Benchmark &bench, const bench::Stopwatch &watch, const char *metric) {
+    watch.report(bench, metric, kSectors);
+    uint64_t ns = watch.totalCpuNs();
+    if (ns == 0) return;
+    char name[40];
+    std::snprintf(name, sizeof(name), "%s_kib_s", metric);
+    bench.report(name, uint64_t(kSectors) * mv::kFlashSectorSize * 1000000000ull / 1024 / ns, "KiB/s",
+                 mv::BenchmarkGoal::Higher);
+}
+
+}
+
+/**
+ *  Small records through `mv::FlashPageCache`, with the stand-in charging
+ *  no flash timing: the CPU time and NSC calls per record for a
+ *  sequential scan, which reads ahead, for reads of a cached page, and
+ *  for appends flushed as one program per run of pages.
+ */
+MV_BENCHMARK(flash, 0) {
+    static uint8_t record[kRecord];
+    MvExternalFlashHandle handle;
+    if (mvExternalFlashOpen(&handle) != MV_STATUS_OKAY) return;
+
+    {
+        mv::FlashPageCache<4, 2> cache(handle, MV_HOST_FLASH_DEFAULT_SIZE);
+        bench::measure(bench, "scan_record", kRegion / kRecord, [&] {
+            for (uint32_t address = 0; address < kRegion; address += kRecord) cache.read(address, kRecord, record);
+        });
+        bench::measure(bench, "cached_record", kHits, [&] {
+            for (uint32_t i = 0; i < kHits; ++i) cache.read(i * kRecord % mv::kFlashSectorSize, kRecord, record);
+        });
+    }
+
+    {
+        mv::FlashPageCache<4, 1> cache(handle, MV_HOST_FLASH_DEFAULT_SIZE);
+        for (uint32_t i = 0; i < kRecord; ++i) record[i] = static_cast<uint8_t>(i);
+        bench::measure(bench, "append_record", kRegion / kRecord, [&] {
+            for (uint32_t address = kRegion; address < 2 * kRegion; address += kRecord) {
+                cache.write(address, mv::ByteSpan(record, kRecord));
+            }
+            cache.flush();
+        });
+    }
+    mvExternalFlashClose(&handle);
+}
+
+/**
+ *  Whole sectors through the blocking external flash calls, with the
+ *  stand-in charging no flash timing: the CPU time and NSC calls per
+ *  sector erased, written and read, and the bandwidth each allows.
+ */
+MV_BENCHMARK(external_flash, 0) {
+    static uint8_t sector[mv::kFlashSectorSize];
+    MvExternalFlashHandle handle;
+    if (mvExternalFlashOpen(&handle) != MV_STATUS_OKAY) return;
+    for (uint32_t i = 0; i < sizeof(sector); ++i) sector[i] = static_cast<uint8_t>(i * 13);
+
+    const struct {
+        const char *metric;
+        MvStatus (*run)(MvExternalFlashHandle handle, uint32_t address);
+    } kOperations[] = {
+        {"erase_sector",
+         [](MvExternalFlashHandle flash, uint32_t address) {
+             return mvExternalFlashEraseBlocking(flash, address, mv::kFlashSectorSize);
+         }},
+        {"write_sector",
+         [](MvExternalFlashHandle flash, uint32_t address) {
+             return mvExternalFlashWriteBlocking(flash, address, mv::kFlashSectorSize, sector);
+         }},
+        {"read_sector",
+         [](MvExternalFlashHandle flash, uint32_t address) {
+             return mvExternalFlashReadBlocking(flash, address, mv::kFlashSectorSize, sector);
+         }},
+    };
+    for (const auto &operation : kOperations) {
+        bench::Stopwatch watch;
+        watch.start();
+        MvStatus status = MV_STATUS_OKAY;
+        for (uint32_t i = 0; i < kSectors && status == MV_STATUS_OKAY; ++i) {
+            status = operation.run(handle, i * mv::kFlashSectorSize);
+        }
+        watch.stop();
+        if (status != MV_STATUS_OKAY) bench.fail();
+        reportSectors(bench, watch, operation.metric);
+    }
+    mvExternalFlashClose(&handle);
+}
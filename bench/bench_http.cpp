@@ -0,0 +1,122 @@
+#include <cstdint>
+#include <cstdio>
+
+#include "bench.hpp"
+#include "microvisor/http_body_reader.hpp"
+
+namespace {
+
+constexpr uint32_t kBodySize = 16 * 1024;
+constexpr uint32_t kReads = 256;
+// Microvisor takes one request per channel, and the stand-in allows eight
+// opens a second.
+constexpr uint32_t kRoundTrips = 8;
+
+uint8_t body[kBodySize];
+
+MvHttpRequest getRequest() {
+    static const char kMethod[] = "GET";
+    static const char kUrl[] = "https://bench.example.com/body";
+    return {{reinterpret_cast<const uint8_t *>(kMethod), sizeof(kMethod) - 1},
+            {reinterpret_cast<const uint8_t *>(kUrl), sizeof(kUrl) - 1},
+            0,
+            nullptr,
+            {nullptr, 0},
+            10000};
+}
+
+void respond(void *, const MvHttpRequest *, MvHostHttpResponse *response) {
+    response->result = MV_HTTPRESULT_OK;
+    response->status_code = 200;
+    response->body = MvSizedString{body, sizeof(body)};
+}
+
+void respondSmall(void *, const MvHttpRequest *, MvHostHttpResponse *response) {
+    static const uint8_t kBody[] = "{\"ok\":true}";
+    response->result = MV_HTTPRESULT_OK;
+    response->status_code = 200;
+    response->body = MvSizedString{kBody, sizeof(kBody) - 1};
+}
+
+template <uint32_t ChunkSize>
+void readBody(MvChannelHandle handle, mv::Benchmark &bench) {
+    static mv::HttpBodyReader<ChunkSize> reader;
+    char metric[32];
+    std::snprintf(metric, sizeof(metric), "body_16k_chunk_%u", static_cast<unsigned>(ChunkSize));
+    volatile uint32_t sum = 0;
+    bench::measure(bench, metric, kReads, [&] {
+        for (uint32_t i = 0; i < kReads; ++i) {
+            if (reader.begin(handle) != MV_STATUS_OKAY) {
+                bench.fail();
+                return;
+            }
+            reader.forEach([&](mv::ByteSpan chunk, uint32_t) {
+                sum = sum + chunk.data[chunk.length - 1];
+                return MV_STATUS_OKAY;
+            });
+        }
+    });
+}
+
+}
+
+/**
+ *  A 16 KiB response body read whole through `mv::HttpBodyReader`, with
+ *  the stand-ins adding no latency: the CPU time and NSC calls per body,
+ *  by chunk size. The same response is read each time.
+ */
+MV_BENCHMARK(http, 0) {
+    alignas(512) static uint8_t receive[kBodySize + 1024];
+    alignas(512) static uint8_t send[1024];
+    for (uint32_t i = 0; i < kBodySize; ++i) body[i] = static_cast<uint8_t>(i * 7);
+    mvHostSetHttpHandler(respond, nullptr);
+
+    bench::Network network;
+    MvChannelHandle handle;
+    if (network.open(MV_CHANNELTYPE_HTTP, receive, sizeof(receive), send, sizeof(send), &handle) != MV_STATUS_OKAY) return;
+    MvHttpRequest request = getRequest();
+    if (mvSendHttpRequest(handle, &request) != MV_STATUS_OKAY) return;
+    MvHttpResponseData response;
+    while (mvReadHttpResponseData(handle, &response) == MV_STATUS_RESPONSENOTPRESENT) mvHostWaitForInterrupt(0);
+
+    readBody<512>(handle, bench);
+    readBody<2048>(handle, bench);
+    mvCloseChannel(&handle);
+}
+
+/**
+ *  HTTP requests with the stand-ins adding no latency: the CPU time and
+ *  NSC calls from `mvSendHttpRequest` to reading the response, one
+ *  request per channel. Opening and closing channels is not counted.
+ */
+MV_BENCHMARK(http_request, 0) {
+    alignas(512) static uint8_t receive[1024];
+    alignas(512) static uint8_t send[1024];
+    mvHostSetHttpHandler(respondSmall, nullptr);
+
+    bench::Network network;
+    MvHttpRequest request = getRequest();
+    bench::Stopwatch watch;
+    for (uint32_t i = 0; i < kRoundTrips; ++i) {
+        MvChannelHandle handle;
+        if (network.open(MV_CHANNELTYPE_HTTP, receive, sizeof(receive), send, sizeof(send), &handle) != MV_STATUS_OKAY) {
+            bench.fail();
+            return;
+        }
+        watch.start();
+        MvStatus status = mvSendHttpRequest(handle, &request);
+        MvHttpResponseData response = {};
+        while (status == MV_STATUS_OKAY &&
+               (status = mvReadHttpResponseData(handle, &response)) == MV_STATUS_RESPONSENOTPRESENT) {
+            mvHostWaitForInterrupt(0);
+            status = MV_STATUS_OKAY;
+        }
+        watch.stop();
+        mvCloseChannel(&handle);
+        if (status != MV_STATUS_OKAY || response.status_code != 200) {
+            bench.fail();
+            return;
+        }
+    }
+    watch.report(bench, "round_trip", kRoundTrips);
+}
@@ -0,0 +1,269 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include "bench.hpp"
+
+/**
+ *  Runs every registered benchmark against the host stand-ins and writes
+ *  the results as JSON, one metric per line:
+ *
+ *      microvisor-sdk-bench [--output FILE] [--baseline FILE] [--threshold PERCENT] [--filter TEXT]
+ *                           [--repeat COUNT]
+ *
+ *  Every case runs once per pass, for `--repeat` passes (3 by default),
+ *  and the best value of each metric is kept, which filters out most
+ *  scheduling noise.
+ *
+ *  With `--baseline`, each metric is compared with the same metric in an
+ *  earlier output, and the run fails if any CPU time is worse by more than
+ *  the threshold (25% by default) or any NSC call count is higher at all.
+ *  Other metrics, such as the wall-clock times of the device cases, vary
+ *  too much between runs on a shared machine and are only reported.
+ *  Refresh the checked-in baseline by running with
+ *  `--output bench/baseline.json`.
+ */
+
+namespace bench {
+
+uint64_t cpuNs() {
+    timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000u + static_cast<uint64_t>(now.tv_nsec);
+}
+
+Network::Network() {
+    MvNotificationSetup setup = {0, buffer, sizeof(buffer)};
+    mvSetupNotifications(&setup, &notifications);
+    MvRequestNetworkParams params = {};
+    params.version = 1;
+    params.v1.notification_handle = notifications;
+    mvRequestNetwork(&params, &network);
+}
+
+MvStatus Network::open(MvChannelType type, uint8_t *receive, uint32_t receive_len, uint8_t *send, uint32_t send_len,
+                       MvChannelHandle *handle) {
+    MvOpenChannelParams params = {};
+    params.version = 1;
+    params.v1.notification_handle = notifications;
+    params.v1.network_handle = network;
+    params.v1.receive_buffer = receive;
+    params.v1.receive_buffer_len = receive_len;
+    params.v1.send_buffer = send;
+    params.v1.send_buffer_len = send_len;
+    params.v1.channel_type = type;
+    MvStatus status;
+    while ((status = mvOpenChannel(&params, handle)) == MV_STATUS_RATELIMITED) mvHostWaitForInterrupt(50000);
+    return status;
+}
+
+}
+
+namespace {
+
+struct Metric {
+    char name[48];
+    double value;
+    const char *unit;
+    mv::BenchmarkGoal goal;
+};
+
+// The results of every case in a run, named `<case>.<metric>`.
+class Results {
+public:
+    static constexpr uint32_t kMaxMetrics = 128;
+
+    // Adding a metric again, from a repeated run, keeps the better value.
+    void add(const char *name, double value, const char *unit, mv::BenchmarkGoal goal) {
+        for (uint32_t i = 0; i < count_; ++i) {
+            Metric &existing = metrics_[i];
+            if (std::strcmp(existing.name, name) != 0) continue;
+            bool improved = goal == mv::BenchmarkGoal::Higher ? value > existing.value : value < existing.value;
+            if (improved) existing.value = value;
+            return;
+        }
+        if (count_ == kMaxMetrics) {
+            std::fprintf(stderr, "too many metrics, dropped %s\n", name);
+            return;
+        }
+        Metric &entry = metrics_[count_++];
+        std::snprintf(entry.name, sizeof(entry.name), "%s", name);
+        entry.value = value;
+        entry.unit = unit;
+        entry.goal = goal;
+    }
+
+    // A `mv::BenchmarkSink` for `mv::Benchmark`.
+    static void onResult(void *context, const mv::BenchmarkCase &current, const char *metric, uint64_t value,
+                         const char *unit, mv::BenchmarkGoal goal) {
+        char name[sizeof(Metric::name)];
+        std::snprintf(name, sizeof(name), "%s.%s", current.name, metric);
+        static_cast<Results *>(context)->add(name, static_cast<double>(value), unit, goal);
+    }
+
+    uint32_t count() const {
+        return count_;
+    }
+
+    const Metric &operator[](uint32_t index) const {
+        return metrics_[index];
+    }
+
+    const Metric *find(const char *name) const {
+        for (uint32_t i = 0; i < count_; ++i) {
+            if (std::strcmp(metrics_[i].name, name) == 0) return &metrics_[i];
+        }
+        return nullptr;
+    }
+
+private:
+    Metric metrics_[kMaxMetrics];
+    uint32_t count_ = 0;
+};
+
+struct Options {
+    const char *output = nullptr;
+    const char *baseline = nullptr;
+    const char *filter = nullptr;
+    double threshold = 25.0;
+    int repeat = 3;
+};
+
+bool parseOptions(int argc, char **argv, Options *options) {
+    for (int i = 1; i < argc; ++i) {
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (value == nullptr) return false;
+        if (std::strcmp(argv[i], "--output") == 0) {
+            options->output = value;
+        } else if (std::strcmp(argv[i], "--baseline") == 0) {
+            options->baseline = value;
+        } else if (std::strcmp(argv[i], "--filter") == 0) {
+            options->filter = value;
+        } else if (std::strcmp(argv[i], "--threshold") == 0) {
+            options->threshold = std::atof(value);
+        } else if (std::strcmp(argv[i], "--repeat") == 0) {
+            options->repeat = std::atoi(value);
+        } else {
+            return false;
+        }
+        ++i;
+    }
+    return true;
+}
+
+void writeResults(std::FILE *out, const Results &results) {
+    std::fprintf(out, "{\n  \"results\": [\n");
+    for (uint32_t i = 0; i < results.count(); ++i) {
+        const Metric &metric = results[i];
+        std::fprintf(out, "    {\"name\": \"%s\", \"value\": %.0f, \"unit\": \"%s\", \"better\": \"%s\"}%s\n", metric.name,
+                     metric.value, metric.unit, metric.goal == mv::BenchmarkGoal::Higher ? "higher" : "lower",
+                     i + 1 == results.count() ? "" : ",");
+    }
+    std::fprintf(out, "  ]\n}\n");
+}
+
+// Reads a file written by `writeResults()`, which puts each metric on its
+// own line, so a full JSON parser is not needed.
+bool readBaseline(const char *path, Results *baseline) {
+    std::FILE *in = std::fopen(path, "r");
+    if (in == nullptr) return false;
+    char line[256];
+    while (std::fgets(line, sizeof(line), in) != nullptr) {
+        const char *name = std::strstr(line, "\"name\": \"");
+        const char *value = std::strstr(line, "\"value\": ");
+        if (name == nullptr || value == nullptr) continue;
+        name += 9;
+        const char *end = std::strchr(name, '"');
+        if (end == nullptr || end - name >= 48) continue;
+        char metric[48];
+        std::memcpy(metric, name, end - name);
+        metric[end - name] = '\0';
+        bool lower = std::strstr(line, "\"better\": \"lower\"") != nullptr;
+        baseline->add(metric, std::strtod(value + 9, nullptr), "", lower ? mv::BenchmarkGoal::Lower : mv::BenchmarkGoal::Higher);
+    }
+    std::fclose(in);
+    return true;
+}
+
+bool endsWith(const char *name, const char *suffix) {
+    size_t length = std::strlen(name);
+    size_t suffix_length = std::strlen(suffix);
+    return length >= suffix_length && std::strcmp(name + length - suffix_length, suffix) == 0;
+}
+
+// Returns the number of regressions. Call counts are exact, so any rise
+// is one. Only CPU times and call counts are gated.
+uint32_t compare(const Results &baseline, const Results &results, double threshold, const char *filter) {
+    uint32_t regressions = 0;
+    for (uint32_t i = 0; i < baseline.count(); ++i) {
+        const Metric &before = baseline[i];
+        const Metric *after = results.find(before.name);
+        if (after == nullptr) {
+            if (filter == nullptr) std::fprintf(stderr, "%-40s missing\n", before.name);
+            continue;
+        }
+        double change = before.value == 0 ? 0 : (after->value - before.value) * 100.0 / before.value;
+        double worse = before.goal == mv::BenchmarkGoal::Higher ? -change : change;
+        bool calls = endsWith(before.name, "_calls");
+        bool gated = calls || endsWith(before.name, "_cpu_ns");
+        bool regressed = gated && (calls ? after->value > before.value : worse > threshold);
+        regressions += regressed ? 1 : 0;
+        std::fprintf(stderr, "%-40s %12.0f %12.0f %+7.1f%%%s\n", before.name, before.value, after->value, change,
+                     regressed ? "  REGRESSED" : gated ? "" : "  (not gated)");
+    }
+    return regressions;
+}
+
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, &options)) {
+        std::fprintf(stderr, "usage: %s [--output FILE] [--baseline FILE] [--threshold PERCENT] [--filter TEXT] "
+                     "[--repeat COUNT]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    static Results results;
+    uint32_t failed = 0;
+    // Each pass runs every case once, so a slow spell on the machine costs
+    // each case one sample rather than all of one case's.
+    for (int run = 0; run < options.repeat; ++run) {
+        for (mv::BenchmarkCase *entry = mv::BenchmarkCase::first(); entry != nullptr; entry = entry->next) {
+            if (options.filter != nullptr && std::strstr(entry->name, options.filter) == nullptr) continue;
+            std::fprintf(stderr, "running %s\n", entry->name);
+            mvHostReset();
+            mv::Benchmark bench(*entry, Results::onResult, &results);
+            entry->run(bench);
+            bench.finish();
+            if (!bench.passed()) {
+                std::fprintf(stderr, "%s failed or ran over its limit\n", entry->name);
+                failed++;
+            }
+        }
+    }
+    mvHostReset();
+
+    std::FILE *out = options.output != nullptr ? std::fopen(options.output, "w") : stdout;
+    if (out == nullptr) {
+        std::fprintf(stderr, "cannot write %s\n", options.output);
+        return 2;
+    }
+    writeResults(out, results);
+    if (out != stdout) std::fclose(out);
+
+    if (options.baseline == nullptr) return failed == 0 ? 0 : 1;
+    static Results baseline;
+    if (!readBaseline(options.baseline, &baseline)) {
+        std::fprintf(stderr, "cannot read %s\n", options.baseline);
+        return 2;
+    }
+    uint32_t regressions = compare(baseline, results, options.threshold, options.filter);
+    if (regressions != 0) {
+        std::fprintf(stderr, "%u metrics regressed by more than %.0f%%\n", regressions, options.threshold);
+        return 1;
+    }
+    return failed == 0 ? 0 : 1;
+}
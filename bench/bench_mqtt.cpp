@@ -0,0 +1,73 @@
+#include <cstdint>
+#include <cstdio>
+
+#include "bench.hpp"
+#include "microvisor/mqtt_publisher.hpp"
+
+namespace {
+
+constexpr uint32_t kPublishes = 1024;
+
+MvStatus connect(MvChannelHandle handle) {
+    MvMqttConnectRequest request = {};
+    request.host = {reinterpret_cast<const uint8_t *>("broker"), 6};
+    request.clientid = {reinterpret_cast<const uint8_t *>("bench"), 5};
+    MvStatus status = mvMqttRequestConnect(handle, &request);
+    if (status != MV_STATUS_OKAY) return status;
+
+    MvMqttReadableDataType type = MV_MQTTREADABLEDATATYPE_NONE;
+    while (mvMqttGetNextReadableDataType(handle, &type) == MV_STATUS_OKAY &&
+           type != MV_MQTTREADABLEDATATYPE_CONNECTRESPONSE) {
+        mvHostWaitForInterrupt(0);
+    }
+    MvMqttConnectResponse response;
+    return mvMqttReadConnectResponse(handle, &response);
+}
+
+template <uint32_t Window>
+void publish(MvChannelHandle handle, mv::Benchmark &bench) {
+    static const uint8_t kPayload[128] = {};
+    mv::MqttPublisher<Window> publisher(handle);
+
+    char metric[32];
+    std::snprintf(metric, sizeof(metric), "publish_w%u", static_cast<unsigned>(Window));
+    bench::measure(bench, metric, kPublishes, [&] {
+        uint32_t sent = 0;
+        while (publisher.completed() + publisher.failed() < kPublishes) {
+            while (sent < kPublishes && publisher.publish("bench/telemetry", mv::ByteSpan(kPayload, sizeof(kPayload)), 1,
+                                                          false) == MV_STATUS_OKAY) {
+                sent++;
+            }
+            mvHostWaitForInterrupt(0);
+            MvMqttReadableDataType type;
+            while (mvMqttGetNextReadableDataType(handle, &type) == MV_STATUS_OKAY &&
+                   type == MV_MQTTREADABLEDATATYPE_PUBLISHRESPONSE) {
+                publisher.handleResponse();
+            }
+        }
+    });
+}
+
+}
+
+/**
+ *  QoS 1 publishes through `mv::MqttPublisher`, with the simulated broker
+ *  answering at once: the CPU time and NSC calls per message against the
+ *  publish window.
+ */
+MV_BENCHMARK(mqtt, 0) {
+    alignas(512) static uint8_t receive[4096];
+    alignas(512) static uint8_t send[4096];
+
+    bench::Network network;
+    MvChannelHandle handle;
+    if (network.open(MV_CHANNELTYPE_MQTT, receive, sizeof(receive), send, sizeof(send), &handle) != MV_STATUS_OKAY) {
+        return;
+    }
+    if (connect(handle) != MV_STATUS_OKAY) return;
+
+    publish<1>(handle, bench);
+    publish<4>(handle, bench);
+    publish<16>(handle, bench);
+    mvCloseChannel(&handle);
+}
@@ -0,0 +1,71 @@
+#include <cstdint>
+
+#include "microvisor/benchmark.hpp"
+#include "microvisor/external_flash.hpp"
+#include "microvisor/flash_page_cache.hpp"
+#include "microvisor/mqtt_topic_router.hpp"
+
+namespace {
+
+void onMessage(void *context, mv::ByteSpan, mv::ByteSpan, uint32_t) {
+    ++*static_cast<uint32_t *>(context);
+}
+
+}
+
+MV_BENCHMARK(crc32_4k, 2000000) {
+    static uint8_t data[4096];
+    for (uint32_t i = 0; i < sizeof(data); ++i) data[i] = static_cast<uint8_t>(i * 31);
+    volatile uint32_t sink = 0;
+    for (uint32_t batch = 0; batch < 3; ++batch) {
+        bench.measure(128, [&] { sink = mv::crc32(mv::ByteSpan(data, sizeof(data))); });
+    }
+}
+
+/**
+ *  Dispatch through a router holding a typical set of filters, with and
+ *  without wildcards.
+ */
+MV_BENCHMARK(mqtt_topic_dispatch, 20000) {
+    static mv::MqttTopicRouter<64, 32> router;
+    static uint32_t delivered = 0;
+    static const char *const kFilters[] = {
+        "device/+/command", "device/abc123/config/#", "fleet/announce", "device/abc123/ota/+", "$SYS/#",
+    };
+    for (const char *filter : kFilters) router.add(filter, onMessage, &delivered);
+
+    for (uint32_t batch = 0; batch < 3; ++batch) {
+        bench.measure(5000, [] {
+            router.dispatch("device/abc123/config/network/wifi", mv::ByteSpan(nullptr, 0), 1);
+        });
+    }
+    if (delivered == 0) bench.fail();
+}
+
+/**
+ *  Reads served from a cached page, after the first miss.
+ */
+MV_BENCHMARK(flash_page_cache_hit, 50000) {
+    static uint8_t out[256];
+    MvExternalFlashHandle flash;
+    if (mvExternalFlashOpen(&flash) != MV_STATUS_OKAY) {
+        bench.fail();
+        return;
+    }
+    MvExternalFlashInfo info = {};
+    info.version = 1;
+    if (mvExternalFlashGetInfo(flash, &info) != MV_STATUS_OKAY) bench.fail();
+
+    {
+        mv::FlashPageCache<4> cache(flash, info.v1.size);
+        MvStatus status = MV_STATUS_OKAY;
+        for (uint32_t batch = 0; batch < 3; ++batch) {
+            bench.measure(20000, [&] {
+                MvStatus result = cache.read(512, sizeof(out), out);
+                if (result != MV_STATUS_OKAY) status = result;
+            });
+        }
+        if (status != MV_STATUS_OKAY || cache.misses() != 1) bench.fail();
+    }
+    mvExternalFlashClose(&flash);
+}
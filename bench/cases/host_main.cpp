@@ -0,0 +1,16 @@
+#include "microvisor/benchmark.hpp"
+#include "mv_host.h"
+
+/**
+ *  Runs the cases that `mv::benchmarkMain()` runs on a device, against the
+ *  host stand-ins, with the same output on stdout:
+ *
+ *      microvisor-sdk-benchmarks-host [FILTER]
+ *
+ *  The process exits with `mvTestingComplete`'s status.
+ */
+int main(int argc, char **argv) {
+    mvHostSetTestingMode(1);
+    mv::benchmarkMain(argc > 1 ? argv[1] : nullptr);
+    return 1;
+}
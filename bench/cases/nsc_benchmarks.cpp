@@ -0,0 +1,38 @@
+#include <cstdint>
+
+#include "microvisor/benchmark.hpp"
+#include "mv_syscalls.h"
+
+/**
+ *  The cost of the secure-world transition, through the cheapest NSC call.
+ */
+MV_BENCHMARK(nsc_get_microseconds, 20000) {
+    bench.measure(10000, [] {
+        uint64_t us;
+        mvGetMicroseconds(&us);
+    });
+}
+
+/**
+ *  Sector-sized external flash reads, which do not change its contents.
+ */
+MV_BENCHMARK(flash_read_4k, 5000000) {
+    static uint8_t buffer[4096];
+    MvExternalFlashHandle flash;
+    if (mvExternalFlashOpen(&flash) != MV_STATUS_OKAY) {
+        bench.fail();
+        return;
+    }
+
+    MvStatus status = MV_STATUS_OKAY;
+    for (uint32_t batch = 0; batch < 3; ++batch) {
+        bench.measure(64, [&] {
+            MvStatus result = mvExternalFlashReadBlocking(flash, 0, sizeof(buffer), buffer);
+            if (result != MV_STATUS_OKAY) status = result;
+        });
+    }
+    if (status != MV_STATUS_OKAY) bench.fail();
+    uint64_t ns = bench.nsPerIteration();
+    if (ns != 0) bench.report("bandwidth", sizeof(buffer) * 1000000000ull / 1024 / ns, "KiB/s", mv::BenchmarkGoal::Higher);
+    mvExternalFlashClose(&flash);
+}
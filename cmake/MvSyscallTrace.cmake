@@ -0,0 +1,56 @@
+# Generates a timing wrapper, __wrap_<name>(), for every function declared
+# in mv_syscalls.h, and links them in with -Wl,--wrap so calls from the
+# application reach Microvisor through them.
+
+function(mv_enable_syscall_trace target header)
+    file(STRINGS "${header}" declarations REGEX "^enum MvStatus mv[A-Za-z0-9]+\\(.*\\);$")
+
+    set(source "${CMAKE_CURRENT_BINARY_DIR}/mv_syscall_wrappers.c")
+    set(wrappers "")
+    set(table "")
+    set(index 0)
+    foreach(declaration IN LISTS declarations)
+        if(NOT declaration MATCHES "^enum MvStatus (mv[A-Za-z0-9]+)\\((.*)\\);$")
+            continue()
+        endif()
+        set(name "${CMAKE_MATCH_1}")
+        set(parameters "${CMAKE_MATCH_2}")
+
+        # Forward each parameter by the last identifier of its declaration.
+        set(arguments "")
+        if(NOT parameters STREQUAL "void")
+            string(REPLACE "," ";" parameter_list "${parameters}")
+            foreach(parameter IN LISTS parameter_list)
+                string(REGEX MATCH "[A-Za-z_][A-Za-z0-9_]*[ ]*$" argument "${parameter}")
+                string(STRIP "${argument}" argument)
+                list(APPEND arguments "${argument}")
+            endforeach()
+        endif()
+        string(REPLACE ";" ", " arguments "${arguments}")
+
+        string(APPEND wrappers
+            "enum MvStatus __real_${name}(${parameters});\n"
+            "enum MvStatus __wrap_${name}(${parameters}) {\n"
+            "    uint64_t trace_start;\n"
+            "    __real_mvGetMicroseconds(&trace_start);\n"
+            "    enum MvStatus trace_status = __real_${name}(${arguments});\n"
+            "    mvSyscallTraceRecord(${index}, trace_status, trace_start);\n"
+            "    return trace_status;\n"
+            "}\n\n")
+        string(APPEND table "    {.name = \"${name}\"},\n")
+        target_link_libraries(${target} INTERFACE "-Wl,--wrap=${name}")
+        math(EXPR index "${index} + 1")
+    endforeach()
+
+    set(content "/* Generated by cmake/MvSyscallTrace.cmake from mv_syscalls.h. */\n\n")
+    string(APPEND content "#include \"microvisor/syscall_trace.h\"\n\n")
+    string(APPEND content "enum MvStatus __real_mvGetMicroseconds(uint64_t *us);\n\n")
+    string(APPEND content "${wrappers}")
+    string(APPEND content "struct MvSyscallStats mv_syscall_trace_stats[${index}] = {\n${table}};\n\n")
+    string(APPEND content "const uint32_t mv_syscall_trace_count = ${index};\n")
+    file(GENERATE OUTPUT "${source}" CONTENT "${content}")
+
+    target_sources(${target} PRIVATE "${source}" "${CMAKE_CURRENT_SOURCE_DIR}/trace/mv_syscall_trace.c"
+        "${CMAKE_CURRENT_SOURCE_DIR}/trace/mv_trace_ring.c")
+    target_compile_definitions(${target} PUBLIC MV_SYSCALL_TRACE=1)
+endfunction()
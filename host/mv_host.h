@@ -0,0 +1,248 @@
+#ifndef MV_HOST_H
+#define MV_HOST_H
+
+#include <stdint.h>
+
+#include "mv_syscalls.h"
+
+/**
+ *  Limits enforced by the host stand-ins, as documented for the NSC
+ *  functions in `mv_syscalls.h`.
+ */
+#define MV_HOST_MAX_NOTIFICATION_BUFFERS    32
+#define MV_HOST_MAX_CHANNELS                4
+#define MV_HOST_CHANNEL_OPEN_LIMIT          8
+#define MV_HOST_CHANNEL_OPEN_WINDOW_US      1000000
+#define MV_HOST_MAX_FLASH_HANDLES           32
+#define MV_HOST_FLASH_SECTOR_SIZE           4096
+
+/**
+ *  Limits and sizes that `mv_syscalls.h` does not give. The stand-ins need
+ *  some value for each, so these are estimates rather than Microvisor
+ *  guarantees: leave headroom instead of sizing buffers to them exactly.
+ *
+ *  A request's size in a channel's send buffer is modelled as a fixed
+ *  overhead plus its method, URL and body, and a per-header overhead plus
+ *  each header's length. An MQTT item is modelled the same way in the
+ *  receive buffer, as a fixed overhead plus its topic and payload, and a
+ *  config fetch as fixed overheads for the request and response plus
+ *  per-key and per-item overheads.
+ */
+#define MV_HOST_MAX_NETWORKS                16
+#define MV_HOST_CHANNEL_BUFFER_ALIGNMENT    512
+#define MV_HOST_MAX_HTTP_HEADERS            32
+#define MV_HOST_HTTP_REQUEST_OVERHEAD       24
+#define MV_HOST_HTTP_HEADER_OVERHEAD        4
+#define MV_HOST_MAX_CONFIG_KEYS             16
+#define MV_HOST_CONFIG_REQUEST_OVERHEAD     8
+#define MV_HOST_CONFIG_KEY_OVERHEAD         12
+#define MV_HOST_CONFIG_RESPONSE_OVERHEAD    8
+#define MV_HOST_CONFIG_ITEM_OVERHEAD        8
+#define MV_HOST_MAX_MQTT_TOPICS             8
+#define MV_HOST_MAX_MQTT_CERTIFICATES       8
+#define MV_HOST_MAX_MQTT_INFLIGHT           16
+#define MV_HOST_MQTT_ITEM_OVERHEAD          16
+#define MV_HOST_LOG_BUFFER_ALIGNMENT        512
+#define MV_HOST_LOG_MAX_MESSAGE             1024
+#define MV_HOST_MAX_SYSTEM_NOTIFICATIONS    8
+
+/**
+ *  Properties of the simulated device.
+ */
+#define MV_HOST_FLASH_DEFAULT_SIZE          (8u * 1024u * 1024u)
+#define MV_HOST_NUM_IRQS                    128
+#define MV_HOST_CLOCK_HZ                    160000000u
+
+/**
+ *  How the simulated server treats bytes written to an `MV_CHANNELTYPE_OPAQUEBYTES` channel.
+ */
+enum MvHostPeerMode {
+    MV_HOSTPEERMODE_SINK           = 0x0, //< Written bytes are consumed and discarded (default).
+    MV_HOSTPEERMODE_LOOPBACK       = 0x1, //< Written bytes are echoed back into the channel's receive buffer.
+    MV_HOSTPEERMODE_HOLD           = 0x2, //< Written bytes stay in the send buffer until `mvHostChannelDrain` is called.
+};
+
+struct MvHostHttpResponse {
+    /// The request outcome reported to the application.
+    enum MvHttpResult result;
+    /// Status code reported by the endpoint.
+    uint32_t status_code;
+    /// Number of entries in `headers`, each in `Name: value` form.
+    uint32_t num_headers;
+    /// Response headers.
+    const struct MvSizedString *headers;
+    /// Response body.
+    struct MvSizedString body;
+};
+
+/**
+ *  Simulated HTTP endpoint. Called when `mvSendHttpRequest` accepts a request;
+ *  `response` is pre-populated with a 200 response echoing the request body.
+ *  Any data referenced by `response` is copied once the handler returns.
+ */
+typedef void (*MvHostHttpHandler)(void *context, const struct MvHttpRequest *request, struct MvHostHttpResponse *response);
+
+/**
+ *  Receives messages passed to `mvServerLog` or `mvTestLog`.
+ */
+typedef void (*MvHostLogSink)(void *context, const uint8_t *message, uint16_t length_bytes);
+
+/**
+ *  Invoked by `mvTestingComplete`, `mvDeepSleep` and `mvRestart`, which never
+ *  return on a device. Without a hook the host process exits.
+ */
+typedef void (*MvHostExitHook)(void *context, uint32_t status);
+
+struct MvHostFlashStats {
+    uint32_t read_ops;
+    uint32_t write_ops;
+    uint32_t erase_ops;
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+    uint64_t erase_bytes;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  Returns every stand-in to its initial state: handles are invalidated,
+ *  flash is erased and all hooks and settings revert to their defaults.
+ */
+void mvHostReset(void);
+
+/**
+ *  Install the handler run when `irq` is pended by a notification. Handlers
+ *  run on the thread that raised the notification, never nested, and with
+ *  NSC functions that are unavailable from interrupts returning
+ *  `MV_STATUS_UNAVAILABLE`. Passing NULL removes the handler; pended IRQs
+ *  without a handler stay pended.
+ */
+enum MvStatus mvHostSetInterruptHandler(uint32_t irq, void (*handler)(void));
+
+/**
+ *  Run any pended interrupt handlers and deliver server events that are due.
+ */
+void mvHostDispatchInterrupts(void);
+
+/**
+ *  The equivalent of `__WFI()`: block until the next scheduled server event
+ *  (or at most `timeout_us`), then deliver it.
+ */
+void mvHostWaitForInterrupt(uint32_t timeout_us);
+
+/**
+ *  Busy-wait for `nanoseconds` on every NSC call to model the cost of the
+ *  secure-world transition. Zero (the default) disables the overhead.
+ */
+void mvHostSetCallOverhead(uint32_t nanoseconds);
+
+/**
+ *  NSC calls made since the last reset. The `mvHost` controls are not
+ *  counted.
+ */
+uint64_t mvHostGetCallCount(void);
+
+/**
+ *  Delay every server response by `base_us` plus a pseudo-random amount up to
+ *  `jitter_us`. Jitter lets MQTT responses arrive out of order.
+ */
+void mvHostSetNetworkLatency(uint32_t base_us, uint32_t jitter_us);
+
+/**
+ *  Set the wall clock, in microseconds since the Unix epoch, as if the server
+ *  had synchronised time. Clearing it makes `mvGetWallTime` report
+ *  `MV_STATUS_TIMENOTSET`.
+ */
+void mvHostSetWallTime(uint64_t usec);
+void mvHostClearWallTime(void);
+
+/**
+ *  Change the simulated connection state. Notifies every network handle and
+ *  closes all channels with `MV_CLOSUREREASON_NETWORKDISCONNECTED` when the
+ *  device goes offline.
+ */
+void mvHostSetNetworkStatus(enum MvNetworkStatus status);
+
+void mvHostSetWakeReason(enum MvWakeReason reason);
+
+/**
+ *  Raise an `MV_EVENTTYPE_UPDATEDOWNLOADED` event on every system
+ *  notification opened for `MV_SYSTEMNOTIFICATIONSOURCE_UPDATE`.
+ */
+void mvHostTriggerUpdateDownloaded(void);
+
+void mvHostSetExitHook(MvHostExitHook hook, void *context);
+
+/**
+ *  Server-side controls for `MV_CHANNELTYPE_OPAQUEBYTES` channels.
+ *
+ *  Data in the receive buffer is kept as a ring. `mvReadChannel` reports all
+ *  unread bytes; when they run past the end of the receive buffer the
+ *  remainder continues at its start.
+ */
+enum MvStatus mvHostChannelSetPeer(MvChannelHandle handle, enum MvHostPeerMode mode);
+enum MvStatus mvHostChannelInject(MvChannelHandle handle, const uint8_t *data, uint32_t len, uint32_t *accepted);
+enum MvStatus mvHostChannelDrain(MvChannelHandle handle, uint8_t *buf, uint32_t size, uint32_t *len);
+
+/**
+ *  Close a channel from the server side, as if by network or server action.
+ */
+enum MvStatus mvHostChannelClose(MvChannelHandle handle, enum MvClosureReason reason);
+
+void mvHostSetHttpHandler(MvHostHttpHandler handler, void *context);
+
+/**
+ *  Populate the simulated config and secrets stores.
+ */
+void mvHostConfigSet(enum MvConfigKeyFetchScope scope, enum MvConfigKeyFetchStore store,
+                     struct MvSizedString key, struct MvSizedString value);
+void mvHostConfigErase(enum MvConfigKeyFetchScope scope, enum MvConfigKeyFetchStore store, struct MvSizedString key);
+
+/**
+ *  The simulated broker accepts connections with this state and reason code.
+ */
+void mvHostMqttSetConnectResult(enum MvMqttRequestState state, uint32_t reason_code);
+
+/**
+ *  Publish a message from the broker side. It is delivered to every connected
+ *  MQTT channel with a matching subscription. Publishes made by the
+ *  application are routed the same way.
+ */
+void mvHostMqttInjectMessage(struct MvSizedString topic, struct MvSizedString payload, uint32_t qos, uint8_t retain);
+
+/**
+ *  Resize the simulated external flash and erase it.
+ */
+void mvHostExternalFlashConfigure(uint32_t size_bytes, uint32_t chip_id);
+
+/**
+ *  Time charged to each external flash call. The caller blocks for
+ *  `op_us` plus the per-byte or per-sector cost.
+ */
+void mvHostExternalFlashSetTiming(uint32_t op_us, uint32_t read_ns_per_byte, uint32_t write_ns_per_byte,
+                                  uint32_t erase_us_per_sector);
+void mvHostExternalFlashGetStats(struct MvHostFlashStats *stats);
+
+/**
+ *  Server logging controls. `bytes_per_second` limits how quickly the
+ *  `mvServerLoggingInit` buffer drains; zero drains it immediately. The
+ *  default sink writes to stderr.
+ */
+void mvHostServerLogSetSink(MvHostLogSink sink, void *context);
+void mvHostServerLogSetDrainRate(uint32_t bytes_per_second);
+void mvHostServerLogSetDisabled(uint32_t disabled);
+
+/**
+ *  Enter application testing mode, enabling `mvTestLoggingInit`, `mvTestLog`
+ *  and `mvTestingComplete`. The default test log sink writes to stdout.
+ */
+void mvHostSetTestingMode(uint32_t enabled);
+void mvHostTestLogSetSink(MvHostLogSink sink, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,326 @@
+#include <algorithm>
+#include <cstring>
+
+#include "mv_host_internal.h"
+
+namespace mvhost {
+
+Channel channels[MV_HOST_MAX_CHANNELS];
+
+namespace {
+
+std::deque<uint64_t> recent_opens;
+
+uint32_t ringWrite(uint8_t *ring, uint32_t ring_len, uint32_t read, uint32_t &used, const uint8_t *data, uint32_t len) {
+    len = std::min(len, ring_len - used);
+    uint32_t pos = (read + used) % ring_len;
+    uint32_t first = std::min(len, ring_len - pos);
+    std::memcpy(ring + pos, data, first);
+    std::memcpy(ring, data + first, len - first);
+    used += len;
+    return len;
+}
+
+uint32_t ringRead(const uint8_t *ring, uint32_t ring_len, uint32_t &read, uint32_t &used, uint8_t *buf, uint32_t len) {
+    len = std::min(len, used);
+    uint32_t first = std::min(len, ring_len - read);
+    if (buf != nullptr) {
+        std::memcpy(buf, ring + read, first);
+        std::memcpy(buf + first, ring, len - first);
+    }
+    read = (read + len) % ring_len;
+    used -= len;
+    return len;
+}
+
+void notifyWriteSpace(Channel &channel) {
+    if (!channel.write_blocked || channel.tx_used == channel.tx_len) return;
+    channel.write_blocked = false;
+    notify(channel.notification_handle, MV_EVENTTYPE_CHANNELDATAWRITESPACE, channel.notification_tag);
+}
+
+// The simulated server consumes whatever the application has written.
+void pumpChannel(Channel &channel) {
+    switch (channel.peer) {
+    case MV_HOSTPEERMODE_SINK:
+        txRead(channel, nullptr, channel.tx_used);
+        break;
+    case MV_HOSTPEERMODE_LOOPBACK: {
+        uint32_t moved = 0;
+        while (channel.tx_used != 0 && channel.rx_used != channel.rx_len) {
+            uint32_t first = std::min(channel.tx_used, channel.tx_len - channel.tx_read);
+            uint32_t written = rxWrite(channel, channel.tx + channel.tx_read, first);
+            txRead(channel, nullptr, written);
+            moved += written;
+        }
+        if (moved != 0) notifyReadable(channel);
+        break;
+    }
+    default:
+        break;
+    }
+    notifyWriteSpace(channel);
+}
+
+void schedulePump(Channel &channel) {
+    if (channel.type == MV_CHANNELTYPE_OPAQUEBYTES && channel.peer != MV_HOSTPEERMODE_HOLD) {
+        scheduleOnChannel(channel, pumpChannel);
+    }
+}
+
+bool sizedStringValid(const MvSizedString &string) {
+    return string.data != nullptr || string.length == 0;
+}
+
+}
+
+Channel *findChannel(MvChannelHandle handle, MvChannelType type, MvStatus *status) {
+    uint32_t index;
+    uint16_t generation;
+    if (!decodeHandle(handle, Kind::Channel, MV_HOST_MAX_CHANNELS, &index, &generation)) {
+        *status = MV_STATUS_INVALIDHANDLE;
+        return nullptr;
+    }
+    Channel &channel = channels[index];
+    if (!channel.in_use || channel.generation != generation || (type != MV_CHANNELTYPE__MAX && channel.type != type)) {
+        *status = MV_STATUS_INVALIDHANDLE;
+        return nullptr;
+    }
+    if (channel.closed) {
+        *status = MV_STATUS_CHANNELCLOSED;
+        return nullptr;
+    }
+    *status = MV_STATUS_OKAY;
+    return &channel;
+}
+
+MvChannelHandle channelHandle(const Channel &channel) {
+    return makeHandle<MvChannelHandle>(Kind::Channel, &channel - channels, channel.generation);
+}
+
+void scheduleOnChannel(Channel &channel, std::function<void(Channel &)> fn) {
+    uint32_t index = &channel - channels;
+    uint16_t generation = channel.generation;
+    scheduleResponse([index, generation, fn = std::move(fn)]() {
+        Channel &target = channels[index];
+        if (target.in_use && target.generation == generation && !target.closed) fn(target);
+    });
+}
+
+void closeChannel(Channel &channel, MvClosureReason reason) {
+    channel.closed = true;
+    channel.closure_reason = reason;
+    channel.mqtt.connected = false;
+    notify(channel.notification_handle, MV_EVENTTYPE_CHANNELNOTCONNECTED, channel.notification_tag);
+}
+
+void notifyReadable(Channel &channel) {
+    notify(channel.notification_handle, MV_EVENTTYPE_CHANNELDATAREADABLE, channel.notification_tag);
+}
+
+uint32_t rxWrite(Channel &channel, const uint8_t *data, uint32_t len) {
+    return ringWrite(channel.rx, channel.rx_len, channel.rx_read, channel.rx_used, data, len);
+}
+
+uint32_t txWrite(Channel &channel, const uint8_t *data, uint32_t len) {
+    return ringWrite(channel.tx, channel.tx_len, channel.tx_read, channel.tx_used, data, len);
+}
+
+uint32_t txRead(Channel &channel, uint8_t *buf, uint32_t len) {
+    return ringRead(channel.tx, channel.tx_len, channel.tx_read, channel.tx_used, buf, len);
+}
+
+void resetChannels() {
+    for (Channel &channel : channels) {
+        uint16_t generation = channel.generation;
+        channel = Channel();
+        channel.generation = generation;
+    }
+    recent_opens.clear();
+}
+
+}
+
+using namespace mvhost;
+
+extern "C" {
+
+enum MvStatus mvOpenChannel(const struct MvOpenChannelParams *params, MvChannelHandle *handle) {
+    Call call;
+    if (params == nullptr || handle == nullptr) return MV_STATUS_PARAMETERFAULT;
+    if (params->version != 1) return MV_STATUS_UNSUPPORTEDSTRUCTUREVERSION;
+
+    const auto &v1 = params->v1;
+    if (v1.receive_buffer == nullptr || v1.send_buffer == nullptr || !sizedStringValid(v1.endpoint)) {
+        return MV_STATUS_PARAMETERFAULT;
+    }
+    if (!notificationHandleValid(v1.notification_handle) || !networkHandleValid(v1.network_handle)) {
+        return MV_STATUS_INVALIDHANDLE;
+    }
+    if (reinterpret_cast<uintptr_t>(v1.send_buffer) % MV_HOST_CHANNEL_BUFFER_ALIGNMENT != 0) {
+        return MV_STATUS_INVALIDBUFFERALIGNMENT;
+    }
+    if (v1.send_buffer_len == 0 || v1.send_buffer_len % MV_HOST_CHANNEL_BUFFER_ALIGNMENT != 0 ||
+        v1.receive_buffer_len == 0 || v1.receive_buffer_len % MV_HOST_CHANNEL_BUFFER_ALIGNMENT != 0) {
+        return MV_STATUS_INVALIDBUFFERSIZE;
+    }
+    if (v1.channel_type > MV_CHANNELTYPE_CONFIGFETCH) return MV_STATUS_UNKNOWNCHANNELTYPE;
+
+    uint64_t now = nowUs();
+    while (!recent_opens.empty() && now - recent_opens.front() >= MV_HOST_CHANNEL_OPEN_WINDOW_US) {
+        recent_opens.pop_front();
+    }
+    if (recent_opens.size() >= MV_HOST_CHANNEL_OPEN_LIMIT) return MV_STATUS_RATELIMITED;
+    recent_opens.push_back(now);
+
+    if (!networkConnected()) return MV_STATUS_NETWORKNOTCONNECTED;
+
+    for (Channel &channel : channels) {
+        if (channel.in_use) continue;
+        uint16_t generation = channel.generation + 1;
+        channel = Channel();
+        channel.in_use = true;
+        channel.generation = generation;
+        channel.type = v1.channel_type;
+        channel.notification_handle = v1.notification_handle;
+        channel.notification_tag = v1.notification_tag;
+        channel.rx = v1.receive_buffer;
+        channel.rx_len = v1.receive_buffer_len;
+        channel.tx = v1.send_buffer;
+        channel.tx_len = v1.send_buffer_len;
+        *handle = channelHandle(channel);
+        return MV_STATUS_OKAY;
+    }
+    return MV_STATUS_TOOMANYCHANNELS;
+}
+
+enum MvStatus mvReadChannel(MvChannelHandle handle, uint8_t **read_pointer_out, uint32_t *length_out) {
+    Call call;
+    MvStatus status;
+    Channel *channel = findChannel(handle, MV_CHANNELTYPE__MAX, &status);
+    if (channel == nullptr) return status;
+    if (read_pointer_out == nullptr || length_out == nullptr) return MV_STATUS_PARAMETERFAULT;
+    *read_pointer_out = channel->rx + channel->rx_read;
+    *length_out = channel->type == MV_CHANNELTYPE_OPAQUEBYTES ? channel->rx_used : 0;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvReadChannelComplete(MvChannelHandle handle, uint32_t consumed) {
+    Call call;
+    MvStatus status;
+    Channel *channel = findChannel(handle, MV_CHANNELTYPE__MAX, &status);
+    if (channel == nullptr) return status;
+    if (channel->type != MV_CHANNELTYPE_OPAQUEBYTES) return MV_STATUS_OKAY;
+    consumed = std::min(consumed, channel->rx_used);
+    channel->rx_read = (channel->rx_read + consumed) % channel->rx_len;
+    channel->rx_used -= consumed;
+    if (consumed != 0 && channel->peer == MV_HOSTPEERMODE_LOOPBACK) schedulePump(*channel);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvWriteChannelStream(MvChannelHandle handle, const uint8_t *data, uint32_t len, uint32_t *written) {
+    Call call;
+    MvStatus status;
+    Channel *channel = findChannel(handle, MV_CHANNELTYPE_OPAQUEBYTES, &status);
+    if (channel == nullptr) return status;
+    if ((data == nullptr && len != 0) || written == nullptr) return MV_STATUS_PARAMETERFAULT;
+    *written = txWrite(*channel, data, len);
+    if (*written < len) channel->write_blocked = true;
+    if (*written != 0) schedulePump(*channel);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvWriteChannel(MvChannelHandle handle, const uint8_t *data, uint32_t len, uint32_t *available) {
+    Call call;
+    MvStatus status;
+    Channel *channel = findChannel(handle, MV_CHANNELTYPE_OPAQUEBYTES, &status);
+    if (channel == nullptr) return status;
+    if ((data == nullptr && len != 0) || available == nullptr) return MV_STATUS_PARAMETERFAULT;
+    if (len > channel->tx_len - channel->tx_used) {
+        channel->write_blocked = true;
+        *available = channel->tx_len - channel->tx_used;
+        return MV_STATUS_INVALIDBUFFERSIZE;
+    }
+    txWrite(*channel, data, len);
+    *available = channel->tx_len - channel->tx_used;
+    if (len != 0) schedulePump(*channel);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvCloseChannel(MvChannelHandle *handle) {
+    Call call;
+    if (handle == nullptr) return MV_STATUS_PARAMETERFAULT;
+    MvStatus status;
+    Channel *channel = findChannel(*handle, MV_CHANNELTYPE__MAX, &status);
+    if (channel == nullptr && status != MV_STATUS_CHANNELCLOSED) return status;
+    uint32_t index;
+    uint16_t generation;
+    decodeHandle(*handle, Kind::Channel, MV_HOST_MAX_CHANNELS, &index, &generation);
+    channels[index].in_use = false;
+    channels[index].closed = true;
+    channels[index].closure_reason = MV_CLOSUREREASON_CLOSEDBYAPPLICATION;
+    *handle = nullptr;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvGetChannelClosureReason(MvChannelHandle handle, enum MvClosureReason *reason_out) {
+    Call call;
+    if (reason_out == nullptr) return MV_STATUS_PARAMETERFAULT;
+    MvStatus status;
+    Channel *channel = findChannel(handle, MV_CHANNELTYPE__MAX, &status);
+    if (channel != nullptr) {
+        *reason_out = MV_CLOSUREREASON_NONE;
+        return MV_STATUS_OKAY;
+    }
+    if (status != MV_STATUS_CHANNELCLOSED) return status;
+    uint32_t index;
+    uint16_t generation;
+    decodeHandle(handle, Kind::Channel, MV_HOST_MAX_CHANNELS, &index, &generation);
+    *reason_out = channels[index].closure_reason;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvHostChannelSetPeer(MvChannelHandle handle, enum MvHostPeerMode mode) {
+    Call call(Call::Control);
+    MvStatus status;
+    Channel *channel = findChannel(handle, MV_CHANNELTYPE_OPAQUEBYTES, &status);
+    if (channel == nullptr) return status;
+    channel->peer = mode;
+    schedulePump(*channel);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvHostChannelInject(MvChannelHandle handle, const uint8_t *data, uint32_t len, uint32_t *accepted) {
+    Call call(Call::Control);
+    MvStatus status;
+    Channel *channel = findChannel(handle, MV_CHANNELTYPE_OPAQUEBYTES, &status);
+    if (channel == nullptr) return status;
+    if (data == nullptr && len != 0) return MV_STATUS_PARAMETERFAULT;
+    uint32_t written = rxWrite(*channel, data, len);
+    if (accepted != nullptr) *accepted = written;
+    if (written != 0) notifyReadable(*channel);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvHostChannelDrain(MvChannelHandle handle, uint8_t *buf, uint32_t size, uint32_t *len) {
+    Call call(Call::Control);
+    MvStatus status;
+    Channel *channel = findChannel(handle, MV_CHANNELTYPE_OPAQUEBYTES, &status);
+    if (channel == nullptr) return status;
+    if (buf == nullptr && size != 0) return MV_STATUS_PARAMETERFAULT;
+    uint32_t read = txRead(*channel, buf, size);
+    if (len != nullptr) *len = read;
+    notifyWriteSpace(*channel);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvHostChannelClose(MvChannelHandle handle, enum MvClosureReason reason) {
+    Call call(Call::Control);
+    MvStatus status;
+    Channel *channel = findChannel(handle, MV_CHANNELTYPE__MAX, &status);
+    if (channel == nullptr) return status;
+    closeChannel(*channel, reason);
+    return MV_STATUS_OKAY;
+}
+
+}
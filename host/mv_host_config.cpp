@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cstring>
+
+#include "mv_host_internal.h"
+
+namespace mvhost {
+
+namespace {
+
+using ConfigKey = std::tuple<MvConfigKeyFetchScope, MvConfigKeyFetchStore, std::string>;
+
+std::map<ConfigKey, std::string> config_store;
+
+std::string toString(const MvSizedString &string) {
+    return std::string(reinterpret_cast<const char *>(string.data), string.length);
+}
+
+bool validKey(const MvSizedString &key) {
+    if (key.length == 0) return false;
+    return std::all_of(key.data, key.data + key.length, [](uint8_t c) { return c > 0x20 && c < 0x7f; });
+}
+
+MvStatus findResponse(MvChannelHandle handle, Channel **channel) {
+    MvStatus status;
+    *channel = findChannel(handle, MV_CHANNELTYPE_CONFIGFETCH, &status);
+    if (*channel == nullptr) return status;
+    if (!(*channel)->config.response_ready) return MV_STATUS_RESPONSENOTPRESENT;
+    return MV_STATUS_OKAY;
+}
+
+}
+
+void resetConfig() {
+    config_store.clear();
+}
+
+}
+
+using namespace mvhost;
+
+extern "C" {
+
+enum MvStatus mvSendConfigFetchRequest(MvChannelHandle handle, const struct MvConfigKeyFetchParams *request) {
+    Call call;
+    MvStatus status;
+    Channel *channel = findChannel(handle, MV_CHANNELTYPE_CONFIGFETCH, &status);
+    if (channel == nullptr) return status;
+    if (request == nullptr) return MV_STATUS_PARAMETERFAULT;
+    if (channel->config.request_sent) return MV_STATUS_REQUESTALREADYSENT;
+    if (request->num_items > MV_HOST_MAX_CONFIG_KEYS) return MV_STATUS_TOOMANYCONFIGKEYS;
+    if (request->keys_to_fetch == nullptr && request->num_items != 0) {
+        channel->config.request_sent = true;
+        return MV_STATUS_LATEFAULT;
+    }
+
+    uint32_t wire_size = MV_HOST_CONFIG_REQUEST_OVERHEAD;
+    for (uint32_t i = 0; i < request->num_items; ++i) {
+        const MvConfigKeyToFetch &key = request->keys_to_fetch[i];
+        if (key.key.data == nullptr && key.key.length != 0) {
+            channel->config.request_sent = true;
+            return MV_STATUS_LATEFAULT;
+        }
+        if (key.scope > MV_CONFIGKEYFETCHSCOPE_DEVICE) return MV_STATUS_UNKNOWNCONFIGSCOPE;
+        if (key.store > MV_CONFIGKEYFETCHSTORE_CONFIG) return MV_STATUS_UNKNOWNCONFIGSTORE;
+        if (!validKey(key.key)) return MV_STATUS_INVALIDCONFIGKEY;
+        wire_size += MV_HOST_CONFIG_KEY_OVERHEAD + key.key.length;
+    }
+    if (wire_size > channel->tx_len) return MV_STATUS_INVALIDBUFFERSIZE;
+
+    ConfigExchange exchange;
+    exchange.request_sent = true;
+    uint32_t response_size = MV_HOST_CONFIG_RESPONSE_OVERHEAD;
+    for (uint32_t i = 0; i < request->num_items; ++i) {
+        const MvConfigKeyToFetch &key = request->keys_to_fetch[i];
+        auto it = config_store.find(ConfigKey(key.scope, key.store, toString(key.key)));
+        if (it == config_store.end()) {
+            exchange.items.emplace_back(MV_CONFIGKEYFETCHRESULT_KEYNOTFOUND, std::string());
+        } else {
+            exchange.items.emplace_back(MV_CONFIGKEYFETCHRESULT_OK, it->second);
+        }
+        response_size += MV_HOST_CONFIG_ITEM_OVERHEAD + static_cast<uint32_t>(exchange.items.back().second.size());
+    }
+    if (response_size > channel->rx_len) {
+        exchange.result = MV_CONFIGFETCHRESULT_RESPONSETOOLARGE;
+        exchange.items.clear();
+    }
+
+    channel->config = std::move(exchange);
+    scheduleOnChannel(*channel, [](Channel &target) {
+        target.config.response_ready = true;
+        notifyReadable(target);
+    });
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvReadConfigFetchResponseData(MvChannelHandle handle, struct MvConfigResponseData *response_data) {
+    Call call;
+    Channel *channel;
+    MvStatus status = findResponse(handle, &channel);
+    if (status != MV_STATUS_OKAY) return status;
+    if (response_data == nullptr) return MV_STATUS_PARAMETERFAULT;
+    response_data->result = channel->config.result;
+    response_data->num_items = static_cast<uint32_t>(channel->config.items.size());
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvReadConfigResponseItem(MvChannelHandle handle, const struct MvConfigResponseReadItemParams *params) {
+    Call call;
+    Channel *channel;
+    MvStatus status = findResponse(handle, &channel);
+    if (status != MV_STATUS_OKAY) return status;
+    if (params == nullptr || params->result == nullptr || params->buf.length == nullptr ||
+        (params->buf.data == nullptr && params->buf.size != 0)) {
+        return MV_STATUS_PARAMETERFAULT;
+    }
+    if (params->item_index >= channel->config.items.size()) return MV_STATUS_INDEXINVALID;
+
+    const auto &item = channel->config.items[params->item_index];
+    *params->result = item.first;
+    if (item.second.size() > params->buf.size) {
+        *params->buf.length = 0;
+        return MV_STATUS_INVALIDBUFFERSIZE;
+    }
+    std::memcpy(params->buf.data, item.second.data(), item.second.size());
+    *params->buf.length = static_cast<uint32_t>(item.second.size());
+    return MV_STATUS_OKAY;
+}
+
+void mvHostConfigSet(enum MvConfigKeyFetchScope scope, enum MvConfigKeyFetchStore store,
+                     struct MvSizedString key, struct MvSizedString value) {
+    Call call(Call::Control);
+    config_store[ConfigKey(scope, store, toString(key))] = toString(value);
+}
+
+void mvHostConfigErase(enum MvConfigKeyFetchScope scope, enum MvConfigKeyFetchStore store, struct MvSizedString key) {
+    Call call(Call::Control);
+    config_store.erase(ConfigKey(scope, store, toString(key)));
+}
+
+}
@@ -0,0 +1,723 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+
+#include "mv_host_internal.h"
+
+namespace mvhost {
+
+namespace {
+
+std::mutex state_mutex;
+
+const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+std::atomic<uint32_t> call_overhead_ns{0};
+std::atomic<uint64_t> nsc_calls{0};
+uint32_t latency_base_us = 0;
+uint32_t latency_jitter_us = 0;
+uint64_t jitter_state = 0x9e3779b97f4a7c15ull;
+
+std::multimap<uint64_t, std::function<void()>> timers;
+
+std::array<std::atomic<bool>, MV_HOST_NUM_IRQS> irq_pending;
+std::array<std::atomic<void (*)(void)>, MV_HOST_NUM_IRQS> irq_handlers;
+std::mutex irq_mutex;
+thread_local bool irq_active = false;
+
+struct NotificationCenter {
+    bool in_use = false;
+    uint16_t generation = 0;
+    uint32_t irq = 0;
+    MvNotification *buffer = nullptr;
+    uint32_t count = 0;
+    uint32_t next = 0;
+};
+NotificationCenter centers[MV_HOST_MAX_NOTIFICATION_BUFFERS];
+
+struct Network {
+    bool in_use = false;
+    uint16_t generation = 0;
+    MvNotificationHandle notification_handle = nullptr;
+    uint32_t notification_tag = 0;
+};
+Network networks[MV_HOST_MAX_NETWORKS];
+MvNetworkStatus network_status = MV_NETWORKSTATUS_CONNECTED;
+bool network_api_used = false;
+
+struct SystemEvent {
+    bool in_use = false;
+    uint16_t generation = 0;
+    MvOpenSystemNotificationParams params = {};
+};
+SystemEvent system_events[MV_HOST_MAX_SYSTEM_NOTIFICATIONS];
+
+// Until the application sets it, wall time follows the host's clock.
+bool wall_time_set = true;
+bool wall_time_from_host = true;
+int64_t wall_time_offset = 0;
+
+bool fast_interrupt[MV_HOST_NUM_IRQS];
+bool fast_interrupt_enabled[MV_HOST_NUM_IRQS];
+bool fast_interrupts_globally_disabled = false;
+
+std::unordered_map<uint32_t, uint32_t> peripheral_registers;
+
+MvWakeReason wake_reason = MV_WAKEREASON_COLDBOOT;
+uint32_t system_led = 1;
+std::string wifi_ssid;
+std::string wifi_password;
+
+MvHostExitHook exit_hook = nullptr;
+void *exit_hook_context = nullptr;
+
+void runDueTimers() {
+    uint64_t now = nowUs();
+    while (!timers.empty() && timers.begin()->first <= now) {
+        std::function<void()> fn = std::move(timers.begin()->second);
+        timers.erase(timers.begin());
+        fn();
+    }
+}
+
+void dispatchInterrupts() {
+    if (irq_active) return;
+
+    for (;;) {
+        std::unique_lock<std::mutex> lock(irq_mutex, std::try_to_lock);
+        if (!lock.owns_lock()) return;
+
+        bool ran;
+        do {
+            ran = false;
+            for (uint32_t irq = 0; irq < MV_HOST_NUM_IRQS; ++irq) {
+                void (*handler)(void) = irq_handlers[irq].load(std::memory_order_acquire);
+                if (handler == nullptr || !irq_pending[irq].exchange(false, std::memory_order_acq_rel)) continue;
+                irq_active = true;
+                handler();
+                irq_active = false;
+                ran = true;
+            }
+        } while (ran);
+        lock.unlock();
+
+        // An IRQ pended by another thread between the last scan and the
+        // unlock would otherwise wait for the next call.
+        bool more = false;
+        for (uint32_t irq = 0; irq < MV_HOST_NUM_IRQS && !more; ++irq) {
+            more = irq_pending[irq].load(std::memory_order_acquire) &&
+                   irq_handlers[irq].load(std::memory_order_acquire) != nullptr;
+        }
+        if (!more) return;
+    }
+}
+
+NotificationCenter *findCenter(MvNotificationHandle handle) {
+    uint32_t index;
+    uint16_t generation;
+    if (!decodeHandle(handle, Kind::Notification, MV_HOST_MAX_NOTIFICATION_BUFFERS, &index, &generation)) return nullptr;
+    NotificationCenter &center = centers[index];
+    return center.in_use && center.generation == generation ? &center : nullptr;
+}
+
+Network *findNetwork(MvNetworkHandle handle) {
+    uint32_t index;
+    uint16_t generation;
+    if (!decodeHandle(handle, Kind::Network, MV_HOST_MAX_NETWORKS, &index, &generation)) return nullptr;
+    Network &network = networks[index];
+    return network.in_use && network.generation == generation ? &network : nullptr;
+}
+
+SystemEvent *findSystemEvent(MvSystemEventHandle handle) {
+    uint32_t index;
+    uint16_t generation;
+    if (!decodeHandle(handle, Kind::SystemEvent, MV_HOST_MAX_SYSTEM_NOTIFICATIONS, &index, &generation)) return nullptr;
+    SystemEvent &event = system_events[index];
+    return event.in_use && event.generation == generation ? &event : nullptr;
+}
+
+void notifySystemEvents(MvSystemNotificationSource source, MvEventType type) {
+    for (SystemEvent &event : system_events) {
+        if (event.in_use && event.params.notification_source == source) {
+            notify(event.params.notification_handle, type, event.params.notification_tag);
+        }
+    }
+}
+
+bool validIrq(uint32_t irq) {
+    return irq < MV_HOST_NUM_IRQS;
+}
+
+}
+
+Call::Call(Kind kind) {
+    if (kind == Nsc) chargeCallOverhead();
+    lock_ = std::unique_lock<std::mutex>(state_mutex);
+    runDueTimers();
+}
+
+Call::~Call() {
+    runDueTimers();
+    lock_.unlock();
+    dispatchInterrupts();
+}
+
+uint64_t nowUs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count());
+}
+
+void chargeCallOverhead() {
+    nsc_calls.fetch_add(1, std::memory_order_relaxed);
+    uint32_t ns = call_overhead_ns.load(std::memory_order_relaxed);
+    if (ns == 0) return;
+    auto until = std::chrono::steady_clock::now() + std::chrono::nanoseconds(ns);
+    while (std::chrono::steady_clock::now() < until) {
+    }
+}
+
+void delayUs(uint64_t us) {
+    if (us == 0) return;
+    auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+    if (us > 2000) std::this_thread::sleep_until(until - std::chrono::microseconds(1000));
+    while (std::chrono::steady_clock::now() < until) {
+    }
+}
+
+bool inInterrupt() {
+    return irq_active;
+}
+
+void leaveApplication(uint32_t status) {
+    MvHostExitHook hook;
+    void *context;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        hook = exit_hook;
+        context = exit_hook_context;
+    }
+    if (hook != nullptr) {
+        hook(context, status);
+        return;
+    }
+    std::fflush(stdout);
+    std::fflush(stderr);
+    std::exit(status == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+void schedule(uint64_t delay_us, std::function<void()> fn) {
+    timers.emplace(nowUs() + delay_us, std::move(fn));
+}
+
+void scheduleResponse(std::function<void()> fn) {
+    uint64_t delay = latency_base_us;
+    if (latency_jitter_us != 0) {
+        jitter_state ^= jitter_state << 13;
+        jitter_state ^= jitter_state >> 7;
+        jitter_state ^= jitter_state << 17;
+        delay += jitter_state % (static_cast<uint64_t>(latency_jitter_us) + 1);
+    }
+    schedule(delay, std::move(fn));
+}
+
+bool notify(MvNotificationHandle handle, MvEventType type, uint32_t tag) {
+    NotificationCenter *center = findCenter(handle);
+    if (center == nullptr) return false;
+
+    // Slots are owned by the application until it zeroes `event_type`, so a
+    // full buffer drops the notification rather than overwriting one.
+    MvNotification &slot = center->buffer[center->next];
+    bool delivered = __atomic_load_n(&slot.event_type, __ATOMIC_ACQUIRE) == MV_EVENTTYPE_NOEVENT;
+    if (delivered) {
+        slot.microseconds = nowUs();
+        slot.tag = tag;
+        __atomic_store_n(&slot.event_type, type, __ATOMIC_RELEASE);
+        center->next = (center->next + 1) % center->count;
+    }
+    pendInterrupt(center->irq);
+    return delivered;
+}
+
+void pendInterrupt(uint32_t irq) {
+    if (validIrq(irq)) irq_pending[irq].store(true, std::memory_order_release);
+}
+
+bool networkHandleValid(MvNetworkHandle handle) {
+    return findNetwork(handle) != nullptr;
+}
+
+bool networkConnected() {
+    return network_status == MV_NETWORKSTATUS_CONNECTED;
+}
+
+bool networkInUse() {
+    for (const Network &network : networks) {
+        if (network.in_use) return true;
+    }
+    return false;
+}
+
+bool notificationHandleValid(MvNotificationHandle handle) {
+    return findCenter(handle) != nullptr;
+}
+
+void resetCore() {
+    timers.clear();
+    call_overhead_ns = 0;
+    nsc_calls = 0;
+    latency_base_us = 0;
+    latency_jitter_us = 0;
+    for (uint32_t irq = 0; irq < MV_HOST_NUM_IRQS; ++irq) {
+        irq_pending[irq] = false;
+        irq_handlers[irq] = nullptr;
+        fast_interrupt[irq] = false;
+        fast_interrupt_enabled[irq] = false;
+    }
+    fast_interrupts_globally_disabled = false;
+    for (NotificationCenter &center : centers) center.in_use = false;
+    for (Network &network : networks) network.in_use = false;
+    for (SystemEvent &event : system_events) event.in_use = false;
+    network_status = MV_NETWORKSTATUS_CONNECTED;
+    network_api_used = false;
+    wall_time_set = true;
+    wall_time_from_host = true;
+    wall_time_offset = 0;
+    peripheral_registers.clear();
+    wake_reason = MV_WAKEREASON_COLDBOOT;
+    system_led = 1;
+    wifi_ssid.clear();
+    wifi_password.clear();
+    exit_hook = nullptr;
+    exit_hook_context = nullptr;
+}
+
+}
+
+using namespace mvhost;
+
+extern "C" {
+
+enum MvStatus mvNoOp(void) {
+    chargeCallOverhead();
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvGetMicroseconds(uint64_t *ms) {
+    chargeCallOverhead();
+    if (ms == nullptr) return MV_STATUS_PARAMETERFAULT;
+    *ms = nowUs();
+    return MV_STATUS_OKAY;
+}
+
+static enum MvStatus getClock(uint32_t *hz) {
+    chargeCallOverhead();
+    if (hz == nullptr) return MV_STATUS_PARAMETERFAULT;
+    *hz = MV_HOST_CLOCK_HZ;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvGetSysClk(uint32_t *hz) {
+    return getClock(hz);
+}
+
+enum MvStatus mvGetHClk(uint32_t *hz) {
+    return getClock(hz);
+}
+
+enum MvStatus mvGetPClk1(uint32_t *hz) {
+    return getClock(hz);
+}
+
+enum MvStatus mvGetPClk2(uint32_t *hz) {
+    return getClock(hz);
+}
+
+enum MvStatus mvGetWallTime(uint64_t *usec) {
+    Call call;
+    if (usec == nullptr) return MV_STATUS_PARAMETERFAULT;
+    if (!wall_time_set) return MV_STATUS_TIMENOTSET;
+    if (wall_time_from_host) {
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        wall_time_offset = std::chrono::duration_cast<std::chrono::microseconds>(now).count() -
+                           static_cast<int64_t>(nowUs());
+    }
+    *usec = static_cast<uint64_t>(static_cast<int64_t>(nowUs()) + wall_time_offset);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvGetDeviceId(uint8_t *buf, uint32_t len) {
+    static const char device_id[] = "UV00000000000000000000000000000000";
+    chargeCallOverhead();
+    if (buf == nullptr) return MV_STATUS_PARAMETERFAULT;
+    if (len != sizeof(device_id) - 1) return MV_STATUS_INVALIDBUFFERSIZE;
+    std::memcpy(buf, device_id, len);
+    return MV_STATUS_OKAY;
+}
+
+static bool validPeripheral(uint32_t reg) {
+    return (reg & 3) == 0 && reg >= 0x40000000 && reg < 0x60000000;
+}
+
+enum MvStatus mvPeriphPeek32(uint32_t reg, uint32_t *output) {
+    Call call;
+    if (!validPeripheral(reg)) return MV_STATUS_PERIPHERALACCESSFAULT;
+    if (output == nullptr) return MV_STATUS_PARAMETERFAULT;
+    auto it = peripheral_registers.find(reg);
+    *output = it == peripheral_registers.end() ? 0 : it->second;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvPeriphPoke32(uint32_t reg, uint32_t mask, uint32_t xorvalue) {
+    Call call;
+    if (!validPeripheral(reg)) return MV_STATUS_PERIPHERALACCESSFAULT;
+    uint32_t &value = peripheral_registers[reg];
+    value = (value & ~mask) ^ xorvalue;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvSetupNotifications(const struct MvNotificationSetup *notifications, MvNotificationHandle *handle_out) {
+    Call call;
+    if (notifications == nullptr || handle_out == nullptr || notifications->buffer == nullptr) {
+        return MV_STATUS_PARAMETERFAULT;
+    }
+    if (notifications->buffer_size < 2 * sizeof(MvNotification) ||
+        notifications->buffer_size % sizeof(MvNotification) != 0) {
+        return MV_STATUS_INVALIDBUFFERSIZE;
+    }
+    if (!validIrq(notifications->irq)) return MV_STATUS_INVALIDINTERRUPT;
+
+    NotificationCenter *free_center = nullptr;
+    for (NotificationCenter &center : centers) {
+        if (!center.in_use) {
+            if (free_center == nullptr) free_center = &center;
+            continue;
+        }
+        if (center.buffer == notifications->buffer) return MV_STATUS_BUFFERALREADYINUSE;
+        if (center.irq == notifications->irq) return MV_STATUS_INVALIDINTERRUPT;
+    }
+    if (free_center == nullptr) return MV_STATUS_TOOMANYNOTIFICATIONBUFFERS;
+
+    free_center->in_use = true;
+    free_center->generation++;
+    free_center->irq = notifications->irq;
+    free_center->buffer = notifications->buffer;
+    free_center->count = notifications->buffer_size / sizeof(MvNotification);
+    free_center->next = 0;
+    *handle_out = makeHandle<MvNotificationHandle>(Kind::Notification, free_center - centers, free_center->generation);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvCloseNotifications(MvNotificationHandle *handle_in_out) {
+    Call call;
+    if (handle_in_out == nullptr) return MV_STATUS_PARAMETERFAULT;
+    NotificationCenter *center = findCenter(*handle_in_out);
+    if (center == nullptr) return MV_STATUS_INVALIDHANDLE;
+    center->in_use = false;
+    *handle_in_out = nullptr;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvTempTriggerNotification(MvNotificationHandle handle, enum MvEventType type, uint32_t tag) {
+    Call call;
+    if (findCenter(handle) == nullptr) return MV_STATUS_INVALIDHANDLE;
+    notify(handle, type, tag);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvSetFastInterrupt(uint32_t irqn) {
+    Call call;
+    if (!validIrq(irqn)) return MV_STATUS_INVALIDINTERRUPT;
+    fast_interrupt[irqn] = true;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvClearFastInterrupt(uint32_t irqn) {
+    Call call;
+    if (!validIrq(irqn)) return MV_STATUS_INVALIDINTERRUPT;
+    fast_interrupt[irqn] = false;
+    fast_interrupt_enabled[irqn] = false;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvEnableFastInterrupt(uint32_t irqn) {
+    Call call;
+    if (!validIrq(irqn) || !fast_interrupt[irqn]) return MV_STATUS_INVALIDINTERRUPT;
+    fast_interrupt_enabled[irqn] = true;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvDisableFastInterrupt(uint32_t irqn) {
+    Call call;
+    if (!validIrq(irqn) || !fast_interrupt[irqn]) return MV_STATUS_INVALIDINTERRUPT;
+    fast_interrupt_enabled[irqn] = false;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvDisableAllFastInterrupts(void) {
+    Call call;
+    fast_interrupts_globally_disabled = true;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvEnableAllFastInterrupts(void) {
+    Call call;
+    fast_interrupts_globally_disabled = false;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvRequestNetwork(const struct MvRequestNetworkParams *params, MvNetworkHandle *handle) {
+    Call call;
+    if (params == nullptr || handle == nullptr) return MV_STATUS_PARAMETERFAULT;
+    if (params->version != 1) return MV_STATUS_UNSUPPORTEDSTRUCTUREVERSION;
+
+    for (Network &network : networks) {
+        if (network.in_use) continue;
+        network.in_use = true;
+        network.generation++;
+        network.notification_handle = params->v1.notification_handle;
+        network.notification_tag = params->v1.notification_tag;
+        network_api_used = true;
+        *handle = makeHandle<MvNetworkHandle>(Kind::Network, &network - networks, network.generation);
+        return MV_STATUS_OKAY;
+    }
+    return MV_STATUS_UNAVAILABLE;
+}
+
+enum MvStatus mvReleaseNetwork(MvNetworkHandle *handle) {
+    Call call;
+    if (handle == nullptr) return MV_STATUS_PARAMETERFAULT;
+    Network *network = findNetwork(*handle);
+    if (network == nullptr) return MV_STATUS_INVALIDHANDLE;
+    network->in_use = false;
+    *handle = nullptr;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvGetNetworkStatus(MvNetworkHandle handle, enum MvNetworkStatus *status) {
+    Call call;
+    if (status == nullptr) return MV_STATUS_PARAMETERFAULT;
+    if (findNetwork(handle) == nullptr) return MV_STATUS_INVALIDHANDLE;
+    *status = network_status;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvGetNetworkReasons(enum MvNetworkReason *reasons, uint32_t *request_ref_count) {
+    Call call;
+    if (reasons == nullptr || request_ref_count == nullptr) return MV_STATUS_PARAMETERFAULT;
+    uint32_t count = 0;
+    for (const Network &network : networks) count += network.in_use ? 1 : 0;
+    uint32_t bits = 0;
+    if (count != 0) bits |= MV_NETWORKREASON_USINGNETWORK;
+    if (!network_api_used) bits |= MV_NETWORKREASON_NEVERUSEDNETWORKAPI;
+    if (!wall_time_set) bits |= MV_NETWORKREASON_RTCNOTSET;
+    *reasons = static_cast<MvNetworkReason>(bits);
+    *request_ref_count = count;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvPowerSave(enum MvPowerSavingMode mode) {
+    Call call;
+    if (inInterrupt()) return MV_STATUS_UNAVAILABLE;
+    if (mode > MV_POWERSAVINGMODE_STOP3) return MV_STATUS_PARAMETERFAULT;
+    if (mode != MV_POWERSAVINGMODE_SLEEP && networkInUse()) return MV_STATUS_MICROVISORBUSY;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvSystemLedEnable(uint32_t enable) {
+    Call call;
+    if (inInterrupt()) return MV_STATUS_UNAVAILABLE;
+    system_led = enable;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvOpenSystemNotification(const struct MvOpenSystemNotificationParams *params, MvSystemEventHandle *handle) {
+    Call call;
+    if (inInterrupt()) return MV_STATUS_UNAVAILABLE;
+    if (params == nullptr || handle == nullptr) return MV_STATUS_PARAMETERFAULT;
+    if (findCenter(params->notification_handle) == nullptr ||
+        params->notification_source > MV_SYSTEMNOTIFICATIONSOURCE_UPDATE) {
+        return MV_STATUS_INVALIDHANDLE;
+    }
+    for (SystemEvent &event : system_events) {
+        if (event.in_use) continue;
+        event.in_use = true;
+        event.generation++;
+        event.params = *params;
+        *handle = makeHandle<MvSystemEventHandle>(Kind::SystemEvent, &event - system_events, event.generation);
+        return MV_STATUS_OKAY;
+    }
+    return MV_STATUS_UNAVAILABLE;
+}
+
+enum MvStatus mvCloseSystemNotification(MvSystemEventHandle *handle) {
+    Call call;
+    if (inInterrupt()) return MV_STATUS_UNAVAILABLE;
+    if (handle == nullptr) return MV_STATUS_PARAMETERFAULT;
+    SystemEvent *event = findSystemEvent(*handle);
+    if (event == nullptr) return MV_STATUS_INVALIDHANDLE;
+    event->in_use = false;
+    *handle = nullptr;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvDeepSleep(enum MvDeepSleepMode mode) {
+    {
+        Call call;
+        if (inInterrupt()) return MV_STATUS_UNAVAILABLE;
+        if (mode > MV_DEEPSLEEPMODE_SHUTDOWN) return MV_STATUS_PARAMETERFAULT;
+        if (networkInUse()) return MV_STATUS_MICROVISORBUSY;
+    }
+    leaveApplication(0);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvGetWakeReason(enum MvWakeReason *mode) {
+    Call call;
+    if (inInterrupt()) return MV_STATUS_UNAVAILABLE;
+    if (mode == nullptr) return MV_STATUS_PARAMETERFAULT;
+    *mode = wake_reason;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvRestart(enum MvRestartMode mode) {
+    {
+        Call call;
+        if (inInterrupt()) return MV_STATUS_UNAVAILABLE;
+        if (mode != MV_RESTARTMODE_AUTOAPPLYUPDATE) return MV_STATUS_PARAMETERFAULT;
+    }
+    leaveApplication(0);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvSetWifiConfig(const struct MvWifiConfig *params) {
+    Call call;
+    if (params == nullptr) return MV_STATUS_PARAMETERFAULT;
+    if (params->version != 1) return MV_STATUS_UNSUPPORTEDSTRUCTUREVERSION;
+    if (params->v1.config_mode == MV_WIFICONFIGMODE_CLEARNOW) {
+        wifi_ssid.clear();
+        wifi_password.clear();
+        return MV_STATUS_OKAY;
+    }
+    if (params->v1.config_mode != MV_WIFICONFIGMODE_APPLYNOW) return MV_STATUS_PARAMETERFAULT;
+    const MvSizedString &ssid = params->v1.wifi_ssid;
+    const MvSizedString &password = params->v1.wifi_password;
+    if ((ssid.data == nullptr && ssid.length != 0) || (password.data == nullptr && password.length != 0)) {
+        return MV_STATUS_PARAMETERFAULT;
+    }
+    wifi_ssid.assign(reinterpret_cast<const char *>(ssid.data), ssid.length);
+    wifi_password.assign(reinterpret_cast<const char *>(password.data), password.length);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvGetWifiConfig(const struct MvWifiConfigOut *params) {
+    Call call;
+    if (params == nullptr) return MV_STATUS_PARAMETERFAULT;
+    if (params->version != 1) return MV_STATUS_UNSUPPORTEDSTRUCTUREVERSION;
+    const MvSizedStringBuffer &ssid = params->v1.ssid;
+    if (ssid.data == nullptr || ssid.length == nullptr || params->v1.has_encryption == nullptr) {
+        return MV_STATUS_PARAMETERFAULT;
+    }
+    if (ssid.size < wifi_ssid.size()) return MV_STATUS_INVALIDBUFFERSIZE;
+    std::memcpy(ssid.data, wifi_ssid.data(), wifi_ssid.size());
+    *ssid.length = static_cast<uint32_t>(wifi_ssid.size());
+    *params->v1.has_encryption = wifi_password.empty() ? 0 : 1;
+    return MV_STATUS_OKAY;
+}
+
+void mvHostReset(void) {
+    Call call(Call::Control);
+    resetCore();
+    resetChannels();
+    resetHttp();
+    resetConfig();
+    resetMqtt();
+    resetFlash();
+    resetLogging();
+}
+
+enum MvStatus mvHostSetInterruptHandler(uint32_t irq, void (*handler)(void)) {
+    if (!validIrq(irq)) return MV_STATUS_INVALIDINTERRUPT;
+    irq_handlers[irq].store(handler, std::memory_order_release);
+    dispatchInterrupts();
+    return MV_STATUS_OKAY;
+}
+
+void mvHostDispatchInterrupts(void) {
+    Call call(Call::Control);
+}
+
+void mvHostWaitForInterrupt(uint32_t timeout_us) {
+    uint64_t until = nowUs() + timeout_us;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        if (!timers.empty() && timers.begin()->first < until) until = timers.begin()->first;
+    }
+    uint64_t now = nowUs();
+    if (until > now) delayUs(until - now);
+    Call call(Call::Control);
+}
+
+void mvHostSetCallOverhead(uint32_t nanoseconds) {
+    call_overhead_ns.store(nanoseconds, std::memory_order_relaxed);
+}
+
+uint64_t mvHostGetCallCount(void) {
+    return nsc_calls.load(std::memory_order_relaxed);
+}
+
+void mvHostSetNetworkLatency(uint32_t base_us, uint32_t jitter_us) {
+    Call call(Call::Control);
+    latency_base_us = base_us;
+    latency_jitter_us = jitter_us;
+}
+
+void mvHostSetWallTime(uint64_t usec) {
+    Call call(Call::Control);
+    wall_time_set = true;
+    wall_time_from_host = false;
+    wall_time_offset = static_cast<int64_t>(usec) - static_cast<int64_t>(nowUs());
+}
+
+void mvHostClearWallTime(void) {
+    Call call(Call::Control);
+    wall_time_set = false;
+    wall_time_from_host = false;
+}
+
+void mvHostSetNetworkStatus(enum MvNetworkStatus status) {
+    Call call(Call::Control);
+    if (status == network_status) return;
+    network_status = status;
+    for (const Network &network : networks) {
+        if (network.in_use) notify(network.notification_handle, MV_EVENTTYPE_NETWORKSTATUSCHANGED, network.notification_tag);
+    }
+    notifySystemEvents(MV_SYSTEMNOTIFICATIONSOURCE_NETWORK, MV_EVENTTYPE_NETWORKSTATUSCHANGED);
+    if (status != MV_NETWORKSTATUS_CONNECTED) {
+        for (Channel &channel : channels) {
+            if (channel.in_use && !channel.closed) closeChannel(channel, MV_CLOSUREREASON_NETWORKDISCONNECTED);
+        }
+    }
+}
+
+void mvHostSetWakeReason(enum MvWakeReason reason) {
+    Call call(Call::Control);
+    wake_reason = reason;
+}
+
+void mvHostTriggerUpdateDownloaded(void) {
+    Call call(Call::Control);
+    notifySystemEvents(MV_SYSTEMNOTIFICATIONSOURCE_UPDATE, MV_EVENTTYPE_UPDATEDOWNLOADED);
+}
+
+void mvHostSetExitHook(MvHostExitHook hook, void *context) {
+    Call call(Call::Control);
+    exit_hook = hook;
+    exit_hook_context = context;
+}
+
+}
@@ -0,0 +1,172 @@
+#include <cstring>
+
+#include "mv_host_internal.h"
+
+namespace mvhost {
+
+namespace {
+
+struct FlashHandle {
+    bool in_use = false;
+    uint16_t generation = 0;
+};
+
+FlashHandle flash_handles[MV_HOST_MAX_FLASH_HANDLES];
+std::vector<uint8_t> flash(MV_HOST_FLASH_DEFAULT_SIZE, 0xff);
+uint32_t flash_chip_id = 0xc2853a;
+MvHostFlashStats flash_stats = {};
+
+uint32_t op_us = 0;
+uint32_t read_ns_per_byte = 0;
+uint32_t write_ns_per_byte = 0;
+uint32_t erase_us_per_sector = 0;
+
+FlashHandle *findFlash(MvExternalFlashHandle handle) {
+    uint32_t index;
+    uint16_t generation;
+    if (!decodeHandle(handle, Kind::Flash, MV_HOST_MAX_FLASH_HANDLES, &index, &generation)) return nullptr;
+    FlashHandle &flash_handle = flash_handles[index];
+    return flash_handle.in_use && flash_handle.generation == generation ? &flash_handle : nullptr;
+}
+
+bool inRange(uint32_t address, uint32_t length) {
+    return static_cast<uint64_t>(address) + length <= flash.size();
+}
+
+// Checks shared by the blocking read, write and erase calls.
+MvStatus checkAccess(MvExternalFlashHandle handle, uint32_t address, uint32_t length) {
+    if (inInterrupt()) return MV_STATUS_UNAVAILABLE;
+    if (findFlash(handle) == nullptr) return MV_STATUS_INVALIDHANDLE;
+    if (!inRange(address, length)) return MV_STATUS_ADDRESSOUTOFRANGE;
+    return MV_STATUS_OKAY;
+}
+
+}
+
+void resetFlash() {
+    for (FlashHandle &flash_handle : flash_handles) flash_handle.in_use = false;
+    flash.assign(MV_HOST_FLASH_DEFAULT_SIZE, 0xff);
+    flash_chip_id = 0xc2853a;
+    flash_stats = {};
+    op_us = 0;
+    read_ns_per_byte = 0;
+    write_ns_per_byte = 0;
+    erase_us_per_sector = 0;
+}
+
+}
+
+using namespace mvhost;
+
+extern "C" {
+
+enum MvStatus mvExternalFlashOpen(MvExternalFlashHandle *handle) {
+    Call call;
+    if (inInterrupt()) return MV_STATUS_UNAVAILABLE;
+    if (handle == nullptr) return MV_STATUS_PARAMETERFAULT;
+    for (FlashHandle &flash_handle : flash_handles) {
+        if (flash_handle.in_use) continue;
+        flash_handle.in_use = true;
+        flash_handle.generation++;
+        *handle = makeHandle<MvExternalFlashHandle>(Kind::Flash, &flash_handle - flash_handles, flash_handle.generation);
+        return MV_STATUS_OKAY;
+    }
+    return MV_STATUS_TOOMANYCHANNELS;
+}
+
+enum MvStatus mvExternalFlashClose(MvExternalFlashHandle *handle) {
+    Call call;
+    if (inInterrupt()) return MV_STATUS_UNAVAILABLE;
+    if (handle == nullptr) return MV_STATUS_PARAMETERFAULT;
+    FlashHandle *flash_handle = findFlash(*handle);
+    if (flash_handle == nullptr) return MV_STATUS_INVALIDHANDLE;
+    flash_handle->in_use = false;
+    *handle = nullptr;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvExternalFlashReadBlocking(MvExternalFlashHandle handle, uint32_t address, uint32_t length, uint8_t *buffer) {
+    uint64_t delay_us;
+    {
+        Call call;
+        MvStatus status = checkAccess(handle, address, length);
+        if (status != MV_STATUS_OKAY) return status;
+        if (buffer == nullptr) return MV_STATUS_PARAMETERFAULT;
+        std::memcpy(buffer, flash.data() + address, length);
+        flash_stats.read_ops++;
+        flash_stats.read_bytes += length;
+        delay_us = op_us + static_cast<uint64_t>(length) * read_ns_per_byte / 1000;
+    }
+    delayUs(delay_us);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvExternalFlashEraseBlocking(MvExternalFlashHandle handle, uint32_t address, uint32_t length) {
+    uint64_t delay_us;
+    {
+        Call call;
+        MvStatus status = checkAccess(handle, address, length);
+        if (status != MV_STATUS_OKAY) return status;
+        if (address % MV_HOST_FLASH_SECTOR_SIZE != 0 || length % MV_HOST_FLASH_SECTOR_SIZE != 0) {
+            return MV_STATUS_INVALIDBUFFERALIGNMENT;
+        }
+        std::memset(flash.data() + address, 0xff, length);
+        flash_stats.erase_ops++;
+        flash_stats.erase_bytes += length;
+        delay_us = op_us + static_cast<uint64_t>(length / MV_HOST_FLASH_SECTOR_SIZE) * erase_us_per_sector;
+    }
+    delayUs(delay_us);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvExternalFlashWriteBlocking(MvExternalFlashHandle handle, uint32_t address, uint32_t length, const uint8_t *buffer) {
+    uint64_t delay_us;
+    {
+        Call call;
+        MvStatus status = checkAccess(handle, address, length);
+        if (status != MV_STATUS_OKAY) return status;
+        if (buffer == nullptr) return MV_STATUS_PARAMETERFAULT;
+        // NOR flash programming can only clear bits; erasing sets them again.
+        for (uint32_t i = 0; i < length; ++i) flash[address + i] &= buffer[i];
+        flash_stats.write_ops++;
+        flash_stats.write_bytes += length;
+        delay_us = op_us + static_cast<uint64_t>(length) * write_ns_per_byte / 1000;
+    }
+    delayUs(delay_us);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvExternalFlashGetInfo(MvExternalFlashHandle handle, struct MvExternalFlashInfo *info) {
+    Call call;
+    if (inInterrupt()) return MV_STATUS_UNAVAILABLE;
+    if (info == nullptr) return MV_STATUS_PARAMETERFAULT;
+    if (findFlash(handle) == nullptr) return MV_STATUS_INVALIDHANDLE;
+    if (info->version != 1) return MV_STATUS_UNSUPPORTEDSTRUCTUREVERSION;
+    uint32_t num_handles = 0;
+    for (const FlashHandle &flash_handle : flash_handles) num_handles += flash_handle.in_use ? 1 : 0;
+    info->v1.chip_id = flash_chip_id;
+    info->v1.size = static_cast<uint32_t>(flash.size());
+    info->v1.num_handles = num_handles;
+    return MV_STATUS_OKAY;
+}
+
+void mvHostExternalFlashConfigure(uint32_t size_bytes, uint32_t chip_id) {
+    Call call(Call::Control);
+    flash.assign(size_bytes, 0xff);
+    flash_chip_id = chip_id;
+}
+
+void mvHostExternalFlashSetTiming(uint32_t op, uint32_t read_ns, uint32_t write_ns, uint32_t erase_us) {
+    Call call(Call::Control);
+    op_us = op;
+    read_ns_per_byte = read_ns;
+    write_ns_per_byte = write_ns;
+    erase_us_per_sector = erase_us;
+}
+
+void mvHostExternalFlashGetStats(struct MvHostFlashStats *stats) {
+    Call call(Call::Control);
+    if (stats != nullptr) *stats = flash_stats;
+}
+
+}
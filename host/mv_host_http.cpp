@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cstring>
+
+#include "mv_host_internal.h"
+
+namespace mvhost {
+
+namespace {
+
+MvHostHttpHandler http_handler = nullptr;
+void *http_handler_context = nullptr;
+
+bool matches(const MvSizedString &string, const char *literal) {
+    size_t len = std::strlen(literal);
+    return string.length == len && std::memcmp(string.data, literal, len) == 0;
+}
+
+bool startsWith(const MvSizedString &string, const char *literal) {
+    size_t len = std::strlen(literal);
+    return string.length >= len && std::memcmp(string.data, literal, len) == 0;
+}
+
+bool validMethod(const MvSizedString &method) {
+    static const char *const methods[] = {"GET", "HEAD", "POST", "PUT", "DELETE", "PATCH", "OPTIONS"};
+    return std::any_of(std::begin(methods), std::end(methods), [&](const char *m) { return matches(method, m); });
+}
+
+bool validHeader(const MvHttpHeader &header) {
+    if (header.length == 0) return false;
+    const uint8_t *colon = static_cast<const uint8_t *>(std::memchr(header.data, ':', header.length));
+    if (colon == nullptr || colon == header.data) return false;
+    return std::all_of(header.data, header.data + header.length, [](uint8_t c) { return c >= 0x20 && c < 0x7f; });
+}
+
+MvHttpResult validate(const MvHttpRequest &request) {
+    if (!startsWith(request.url, "https://")) return MV_HTTPRESULT_UNSUPPORTEDURISCHEME;
+    if (!validMethod(request.method)) return MV_HTTPRESULT_UNSUPPORTEDMETHOD;
+    for (uint32_t i = 0; i < request.num_headers; ++i) {
+        if (!validHeader(request.headers[i])) return MV_HTTPRESULT_INVALIDHEADERS;
+    }
+    if (request.timeout_ms < 5000 || request.timeout_ms > 10000) return MV_HTTPRESULT_INVALIDTIMEOUT;
+    return MV_HTTPRESULT_OK;
+}
+
+uint32_t wireSize(const MvHttpRequest &request) {
+    uint32_t size = MV_HOST_HTTP_REQUEST_OVERHEAD + request.method.length + request.url.length + request.body.length;
+    for (uint32_t i = 0; i < request.num_headers; ++i) size += MV_HOST_HTTP_HEADER_OVERHEAD + request.headers[i].length;
+    return size;
+}
+
+bool pointersValid(const MvHttpRequest &request) {
+    auto valid = [](const void *data, uint32_t length) { return data != nullptr || length == 0; };
+    if (!valid(request.method.data, request.method.length) || !valid(request.url.data, request.url.length) ||
+        !valid(request.body.data, request.body.length) || !valid(request.headers, request.num_headers)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < request.num_headers; ++i) {
+        if (!valid(request.headers[i].data, request.headers[i].length)) return false;
+    }
+    return true;
+}
+
+HttpExchange respond(const MvHttpRequest &request, uint32_t rx_len) {
+    static const char content_type[] = "Content-Type: application/octet-stream";
+    MvSizedString default_headers[] = {
+        {reinterpret_cast<const uint8_t *>(content_type), sizeof(content_type) - 1},
+    };
+    MvHostHttpResponse response = {MV_HTTPRESULT_OK, 200, 1, default_headers, request.body};
+
+    HttpExchange exchange;
+    response.result = validate(request);
+    if (response.result == MV_HTTPRESULT_OK && http_handler != nullptr) {
+        http_handler(http_handler_context, &request, &response);
+    }
+
+    exchange.request_sent = true;
+    exchange.data.result = response.result;
+    if (response.result != MV_HTTPRESULT_OK) return exchange;
+
+    uint32_t size = 16 + response.body.length;
+    for (uint32_t i = 0; i < response.num_headers; ++i) size += 4 + response.headers[i].length;
+    if (size > rx_len) {
+        exchange.data.result = MV_HTTPRESULT_RESPONSETOOLARGE;
+        return exchange;
+    }
+
+    exchange.data.status_code = response.status_code;
+    exchange.data.num_headers = response.num_headers;
+    exchange.data.body_length = response.body.length;
+    for (uint32_t i = 0; i < response.num_headers; ++i) {
+        exchange.headers.emplace_back(reinterpret_cast<const char *>(response.headers[i].data), response.headers[i].length);
+    }
+    exchange.body.assign(reinterpret_cast<const char *>(response.body.data), response.body.length);
+    return exchange;
+}
+
+MvStatus findResponse(MvChannelHandle handle, Channel **channel) {
+    MvStatus status;
+    *channel = findChannel(handle, MV_CHANNELTYPE_HTTP, &status);
+    if (*channel == nullptr) return status;
+    if (!(*channel)->http.response_ready) return MV_STATUS_RESPONSENOTPRESENT;
+    return MV_STATUS_OKAY;
+}
+
+}
+
+void resetHttp() {
+    http_handler = nullptr;
+    http_handler_context = nullptr;
+}
+
+}
+
+using namespace mvhost;
+
+extern "C" {
+
+enum MvStatus mvSendHttpRequest(MvChannelHandle handle, const struct MvHttpRequest *request) {
+    Call call;
+    MvStatus status;
+    Channel *channel = findChannel(handle, MV_CHANNELTYPE_HTTP, &status);
+    if (channel == nullptr) return status;
+    if (request == nullptr) return MV_STATUS_PARAMETERFAULT;
+    if (channel->http.request_sent) return MV_STATUS_REQUESTALREADYSENT;
+    if (request->num_headers > MV_HOST_MAX_HTTP_HEADERS) return MV_STATUS_TOOMANYELEMENTS;
+    if (!pointersValid(*request)) {
+        channel->http.request_sent = true;
+        return MV_STATUS_LATEFAULT;
+    }
+    if (wireSize(*request) > channel->tx_len) return MV_STATUS_INVALIDBUFFERSIZE;
+
+    channel->http = respond(*request, channel->rx_len);
+    scheduleOnChannel(*channel, [](Channel &target) {
+        target.http.response_ready = true;
+        notifyReadable(target);
+    });
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvReadHttpResponseData(MvChannelHandle handle, struct MvHttpResponseData *response_data) {
+    Call call;
+    Channel *channel;
+    MvStatus status = findResponse(handle, &channel);
+    if (status != MV_STATUS_OKAY) return status;
+    if (response_data == nullptr) return MV_STATUS_PARAMETERFAULT;
+    *response_data = channel->http.data;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvReadHttpResponseHeader(MvChannelHandle handle, uint32_t header_index, uint8_t *buf, uint32_t size) {
+    Call call;
+    Channel *channel;
+    MvStatus status = findResponse(handle, &channel);
+    if (status != MV_STATUS_OKAY) return status;
+    if (buf == nullptr) return MV_STATUS_PARAMETERFAULT;
+    if (channel->http.data.result != MV_HTTPRESULT_OK) return MV_STATUS_REQUESTUNSUCCESSFUL;
+    if (header_index >= channel->http.headers.size()) return MV_STATUS_INDEXINVALID;
+    const std::string &header = channel->http.headers[header_index];
+    std::memcpy(buf, header.data(), std::min<size_t>(size, header.size()));
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvReadHttpResponseBody(MvChannelHandle handle, uint32_t offset, uint8_t *buf, uint32_t size) {
+    Call call;
+    Channel *channel;
+    MvStatus status = findResponse(handle, &channel);
+    if (status != MV_STATUS_OKAY) return status;
+    if (buf == nullptr) return MV_STATUS_PARAMETERFAULT;
+    if (channel->http.data.result != MV_HTTPRESULT_OK) return MV_STATUS_REQUESTUNSUCCESSFUL;
+    const std::string &body = channel->http.body;
+    if (offset > body.size()) return MV_STATUS_OFFSETINVALID;
+    std::memcpy(buf, body.data() + offset, std::min<size_t>(size, body.size() - offset));
+    return MV_STATUS_OKAY;
+}
+
+void mvHostSetHttpHandler(MvHostHttpHandler handler, void *context) {
+    Call call(Call::Control);
+    http_handler = handler;
+    http_handler_context = context;
+}
+
+}
@@ -0,0 +1,224 @@
+#ifndef MV_HOST_INTERNAL_H
+#define MV_HOST_INTERNAL_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "mv_host.h"
+
+namespace mvhost {
+
+/**
+ *  Handles are 32-bit values as on the device: a type byte, a generation
+ *  counter and a 1-based slot index, so stale and mistyped handles are
+ *  rejected and zero is never valid.
+ */
+enum class Kind : uint32_t {
+    Notification = 0x4e,
+    Network = 0x57,
+    Channel = 0x43,
+    Flash = 0x46,
+    SystemEvent = 0x53,
+};
+
+inline uint32_t encodeHandle(Kind kind, uint32_t index, uint16_t generation) {
+    return (static_cast<uint32_t>(kind) << 24) | (static_cast<uint32_t>(generation) << 8) | (index + 1);
+}
+
+template <typename Handle>
+Handle makeHandle(Kind kind, uint32_t index, uint16_t generation) {
+    return reinterpret_cast<Handle>(static_cast<uintptr_t>(encodeHandle(kind, index, generation)));
+}
+
+/**
+ *  Returns false unless `handle` is of `kind`, indexes a slot below `limit`
+ *  and carries that slot's current generation.
+ */
+template <typename Handle>
+bool decodeHandle(Handle handle, Kind kind, uint32_t limit, uint32_t *index, uint16_t *generation) {
+    uintptr_t raw = reinterpret_cast<uintptr_t>(handle);
+    if (raw > UINT32_MAX || (raw >> 24) != static_cast<uint32_t>(kind)) return false;
+    uint32_t slot = raw & 0xff;
+    if (slot == 0 || slot > limit) return false;
+    *index = slot - 1;
+    *generation = static_cast<uint16_t>(raw >> 8);
+    return true;
+}
+
+/**
+ *  Every stateful NSC function holds one of these for its duration. It
+ *  charges and counts the configured call overhead, serialises access to
+ *  the stand-ins and delivers server events that have fallen due.
+ *  Interrupts raised during the call are dispatched once the lock is
+ *  released, as an IRQ pended by Microvisor fires on return to non-secure
+ *  code. The `mvHost` controls hold a `Call(Call::Control)`, which is
+ *  neither charged nor counted.
+ */
+class Call {
+public:
+    enum Kind { Nsc, Control };
+
+    explicit Call(Kind kind = Nsc);
+    ~Call();
+    Call(const Call &) = delete;
+    Call &operator=(const Call &) = delete;
+
+private:
+    std::unique_lock<std::mutex> lock_;
+};
+
+uint64_t nowUs();
+void chargeCallOverhead();
+void delayUs(uint64_t us);
+bool inInterrupt();
+
+/**
+ *  Leave the application as `mvRestart` does on a device: run the exit hook,
+ *  or exit the process if none is installed. Called without the state lock.
+ */
+void leaveApplication(uint32_t status);
+
+/**
+ *  Run `fn` under the state lock `delay_us` from now. A zero delay runs
+ *  before the current call returns.
+ */
+void schedule(uint64_t delay_us, std::function<void()> fn);
+
+/**
+ *  As `schedule`, using the configured network latency.
+ */
+void scheduleResponse(std::function<void()> fn);
+
+/**
+ *  Post a notification; must be called with the state lock held.
+ */
+bool notify(MvNotificationHandle handle, MvEventType type, uint32_t tag);
+void pendInterrupt(uint32_t irq);
+
+/**
+ *  Queries of the network stand-in, called with the state lock held.
+ */
+bool networkHandleValid(MvNetworkHandle handle);
+bool networkConnected();
+bool networkInUse();
+
+/**
+ *  Queries of the notification stand-in, called with the state lock held.
+ */
+bool notificationHandleValid(MvNotificationHandle handle);
+
+struct HttpExchange {
+    bool request_sent = false;
+    bool response_ready = false;
+    MvHttpResponseData data = {};
+    std::vector<std::string> headers;
+    std::string body;
+};
+
+struct ConfigExchange {
+    bool request_sent = false;
+    bool response_ready = false;
+    MvConfigFetchResult result = MV_CONFIGFETCHRESULT_OK;
+    std::vector<std::pair<MvConfigKeyFetchResult, std::string>> items;
+};
+
+struct MqttReadable {
+    MvMqttReadableDataType type;
+    uint32_t rx_bytes;
+    uint32_t correlation_id;
+    MvMqttRequestState request_state;
+    uint32_t reason_code;
+    std::vector<uint32_t> reason_codes;
+    std::string topic;
+    std::string payload;
+    uint32_t qos;
+    uint8_t retain;
+    uint32_t message_len;
+};
+
+struct MqttSession {
+    bool connect_sent = false;
+    bool connected = false;
+    bool subscribe_pending = false;
+    bool unsubscribe_pending = false;
+    bool disconnect_pending = false;
+    MvMqttProtocolVersion version = MV_MQTTPROTOCOLVERSION_V3_1_1;
+    std::vector<std::pair<std::string, uint32_t>> subscriptions;
+    std::deque<MqttReadable> readable;
+    uint32_t inflight = 0;
+    uint32_t next_message_id = 1;
+    std::vector<uint32_t> unacknowledged;
+};
+
+struct Channel {
+    bool in_use = false;
+    uint16_t generation = 0;
+    bool closed = false;
+    MvClosureReason closure_reason = MV_CLOSUREREASON_NONE;
+    MvChannelType type = MV_CHANNELTYPE_OPAQUEBYTES;
+    MvNotificationHandle notification_handle = nullptr;
+    uint32_t notification_tag = 0;
+    uint8_t *rx = nullptr;
+    uint32_t rx_len = 0;
+    uint32_t rx_read = 0;
+    uint32_t rx_used = 0;
+    uint8_t *tx = nullptr;
+    uint32_t tx_len = 0;
+    uint32_t tx_read = 0;
+    uint32_t tx_used = 0;
+    bool write_blocked = false;
+    MvHostPeerMode peer = MV_HOSTPEERMODE_SINK;
+    HttpExchange http;
+    ConfigExchange config;
+    MqttSession mqtt;
+};
+
+extern Channel channels[MV_HOST_MAX_CHANNELS];
+
+/**
+ *  Look up an open channel of the given type (any type if `type` is
+ *  `MV_CHANNELTYPE__MAX`). On failure `status` receives
+ *  `MV_STATUS_INVALIDHANDLE` or `MV_STATUS_CHANNELCLOSED`.
+ */
+Channel *findChannel(MvChannelHandle handle, MvChannelType type, MvStatus *status);
+MvChannelHandle channelHandle(const Channel &channel);
+
+/**
+ *  Schedule `fn` against `channel` using the network latency, dropping it
+ *  if the channel has been closed or reused in the meantime.
+ */
+void scheduleOnChannel(Channel &channel, std::function<void(Channel &)> fn);
+
+void closeChannel(Channel &channel, MvClosureReason reason);
+void notifyReadable(Channel &channel);
+
+/**
+ *  Server-side ring operations on a channel's buffers.
+ */
+uint32_t rxWrite(Channel &channel, const uint8_t *data, uint32_t len);
+uint32_t txWrite(Channel &channel, const uint8_t *data, uint32_t len);
+uint32_t txRead(Channel &channel, uint8_t *buf, uint32_t len);
+
+bool mqttTopicMatches(const std::string &filter, const std::string &topic);
+void mqttRoute(const std::string &topic, const std::string &payload, uint32_t qos, uint8_t retain);
+
+/**
+ *  Per-subsystem resets, called from `mvHostReset` with the state lock held.
+ */
+void resetCore();
+void resetChannels();
+void resetHttp();
+void resetConfig();
+void resetMqtt();
+void resetFlash();
+void resetLogging();
+
+}
+
+#endif
@@ -0,0 +1,150 @@
+#include <cstdio>
+
+#include "mv_host_internal.h"
+
+namespace mvhost {
+
+namespace {
+
+// Each message occupies its length plus a header in the logging buffer,
+// rounded up to a whole word.
+constexpr uint32_t kMessageHeader = 4;
+
+struct LogBuffer {
+    bool initialised = false;
+    uint32_t size = 0;
+    uint32_t used = 0;
+    uint64_t drained_at = 0;
+    uint32_t drain_rate = 0;
+    MvHostLogSink sink = nullptr;
+    void *sink_context = nullptr;
+};
+
+void writeToStream(void *context, const uint8_t *message, uint16_t length_bytes) {
+    std::FILE *stream = static_cast<std::FILE *>(context);
+    std::fwrite(message, 1, length_bytes, stream);
+    std::fputc('\n', stream);
+}
+
+LogBuffer streamBuffer(std::FILE *stream) {
+    LogBuffer log;
+    log.sink = writeToStream;
+    log.sink_context = stream;
+    return log;
+}
+
+LogBuffer server_log = streamBuffer(stderr);
+LogBuffer test_log = streamBuffer(stdout);
+bool server_logging_disabled = false;
+bool testing_mode = false;
+
+MvStatus init(LogBuffer &log, uint8_t *buffer, uint32_t length_bytes) {
+    if (buffer == nullptr) return MV_STATUS_PARAMETERFAULT;
+    if (reinterpret_cast<uintptr_t>(buffer) % MV_HOST_LOG_BUFFER_ALIGNMENT != 0) return MV_STATUS_INVALIDBUFFERALIGNMENT;
+    if (length_bytes == 0 || length_bytes % MV_HOST_LOG_BUFFER_ALIGNMENT != 0) return MV_STATUS_INVALIDBUFFERSIZE;
+    log.initialised = true;
+    log.size = length_bytes;
+    log.used = 0;
+    log.drained_at = nowUs();
+    return MV_STATUS_OKAY;
+}
+
+MvStatus append(LogBuffer &log, const uint8_t *message, uint16_t length_bytes) {
+    if (message == nullptr && length_bytes != 0) return MV_STATUS_PARAMETERFAULT;
+    if (length_bytes > MV_HOST_LOG_MAX_MESSAGE) return MV_STATUS_LOGMESSAGETOOLONG;
+
+    uint64_t now = nowUs();
+    if (log.drain_rate == 0) {
+        log.used = 0;
+    } else {
+        uint64_t drained = (now - log.drained_at) * log.drain_rate / 1000000;
+        if (drained != 0) {
+            log.used = drained >= log.used ? 0 : log.used - static_cast<uint32_t>(drained);
+            log.drained_at = now;
+        }
+    }
+    if (log.used == 0) log.drained_at = now;
+
+    uint32_t cost = (kMessageHeader + length_bytes + 3) & ~3u;
+    if (cost > log.size - log.used) return MV_STATUS_INVALIDBUFFERSIZE;
+    log.used += cost;
+    if (log.sink != nullptr) log.sink(log.sink_context, message, length_bytes);
+    return MV_STATUS_OKAY;
+}
+
+}
+
+void resetLogging() {
+    server_log = streamBuffer(stderr);
+    test_log = streamBuffer(stdout);
+    server_logging_disabled = false;
+    testing_mode = false;
+}
+
+}
+
+using namespace mvhost;
+
+extern "C" {
+
+enum MvStatus mvServerLoggingInit(uint8_t *buffer, uint32_t length_bytes) {
+    Call call;
+    return init(server_log, buffer, length_bytes);
+}
+
+enum MvStatus mvServerLog(const uint8_t *message, uint16_t length_bytes) {
+    Call call;
+    if (!server_log.initialised) return MV_STATUS_UNAVAILABLE;
+    if (server_logging_disabled) return MV_STATUS_LOGGINGDISABLEDBYSERVER;
+    return append(server_log, message, length_bytes);
+}
+
+enum MvStatus mvTestingComplete(uint32_t status) {
+    {
+        Call call;
+        if (!testing_mode) return MV_STATUS_UNAVAILABLE;
+    }
+    leaveApplication(status);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvTestLoggingInit(uint8_t *buffer, uint32_t length_bytes) {
+    Call call;
+    if (!testing_mode) return MV_STATUS_UNAVAILABLE;
+    return init(test_log, buffer, length_bytes);
+}
+
+enum MvStatus mvTestLog(const uint8_t *message, uint16_t length_bytes) {
+    Call call;
+    if (!test_log.initialised) return MV_STATUS_UNAVAILABLE;
+    return append(test_log, message, length_bytes);
+}
+
+void mvHostServerLogSetSink(MvHostLogSink sink, void *context) {
+    Call call(Call::Control);
+    server_log.sink = sink;
+    server_log.sink_context = context;
+}
+
+void mvHostServerLogSetDrainRate(uint32_t bytes_per_second) {
+    Call call(Call::Control);
+    server_log.drain_rate = bytes_per_second;
+}
+
+void mvHostServerLogSetDisabled(uint32_t disabled) {
+    Call call(Call::Control);
+    server_logging_disabled = disabled != 0;
+}
+
+void mvHostSetTestingMode(uint32_t enabled) {
+    Call call(Call::Control);
+    testing_mode = enabled != 0;
+}
+
+void mvHostTestLogSetSink(MvHostLogSink sink, void *context) {
+    Call call(Call::Control);
+    test_log.sink = sink;
+    test_log.sink_context = context;
+}
+
+}
@@ -0,0 +1,472 @@
+#include <algorithm>
+#include <cstring>
+
+#include "mv_host_internal.h"
+
+namespace mvhost {
+
+namespace {
+
+// Fixed cost of framing any MQTT item in the channel's buffers.
+constexpr uint32_t kItemOverhead = MV_HOST_MQTT_ITEM_OVERHEAD;
+
+MvMqttRequestState connect_state = MV_MQTTREQUESTSTATE_REQUESTCOMPLETED;
+uint32_t connect_reason_code = 0;
+
+std::string toString(const MvSizedString &string) {
+    return std::string(reinterpret_cast<const char *>(string.data), string.length);
+}
+
+bool sizedStringValid(const MvSizedString &string) {
+    return string.data != nullptr || string.length == 0;
+}
+
+std::vector<std::string> split(const std::string &topic) {
+    std::vector<std::string> levels;
+    size_t start = 0;
+    for (;;) {
+        size_t slash = topic.find('/', start);
+        levels.push_back(topic.substr(start, slash - start));
+        if (slash == std::string::npos) return levels;
+        start = slash + 1;
+    }
+}
+
+void queue(Channel &channel, MqttReadable item) {
+    channel.rx_used += item.rx_bytes;
+    channel.mqtt.readable.push_back(std::move(item));
+    notifyReadable(channel);
+}
+
+MqttReadable response(MvMqttReadableDataType type, MvMqttRequestState state, uint32_t correlation_id) {
+    MqttReadable item = {};
+    item.type = type;
+    item.rx_bytes = kItemOverhead;
+    item.request_state = state;
+    item.correlation_id = correlation_id;
+    return item;
+}
+
+void deliver(Channel &channel, const std::string &topic, const std::string &payload, uint32_t qos, uint8_t retain) {
+    MqttReadable item = {};
+    item.topic = topic;
+    uint32_t size = kItemOverhead + static_cast<uint32_t>(topic.size() + payload.size());
+    if (size > channel.rx_len - channel.rx_used) {
+        item.type = MV_MQTTREADABLEDATATYPE_MESSAGELOST;
+        item.rx_bytes = kItemOverhead + static_cast<uint32_t>(topic.size());
+        item.message_len = static_cast<uint32_t>(payload.size());
+        if (item.rx_bytes > channel.rx_len - channel.rx_used) return;
+    } else {
+        item.type = MV_MQTTREADABLEDATATYPE_MESSAGERECEIVED;
+        item.rx_bytes = size;
+        item.payload = payload;
+        item.qos = qos;
+        item.retain = retain;
+        item.correlation_id = channel.mqtt.next_message_id++;
+    }
+    queue(channel, std::move(item));
+}
+
+MqttReadable *head(MvChannelHandle handle, MvMqttReadableDataType type, Channel **channel, MvStatus *status) {
+    *channel = findChannel(handle, MV_CHANNELTYPE_MQTT, status);
+    if (*channel == nullptr) return nullptr;
+    std::deque<MqttReadable> &readable = (*channel)->mqtt.readable;
+    if (readable.empty() || readable.front().type != type) {
+        *status = MV_STATUS_WRONGDATAREQUESTED;
+        return nullptr;
+    }
+    return &readable.front();
+}
+
+void pop(Channel &channel) {
+    channel.rx_used -= channel.mqtt.readable.front().rx_bytes;
+    channel.mqtt.readable.pop_front();
+}
+
+void releaseSendSpace(Channel &channel, uint32_t bytes) {
+    channel.tx_used -= bytes;
+    if (channel.write_blocked) {
+        channel.write_blocked = false;
+        notify(channel.notification_handle, MV_EVENTTYPE_CHANNELDATAWRITESPACE, channel.notification_tag);
+    }
+}
+
+MvStatus readReasonCodes(const std::vector<uint32_t> &codes, uint32_t *out, uint32_t out_size, uint32_t *out_len) {
+    if (out_size < codes.size() * sizeof(uint32_t)) return MV_STATUS_INVALIDBUFFERSIZE;
+    std::copy(codes.begin(), codes.end(), out);
+    *out_len = static_cast<uint32_t>(codes.size());
+    return MV_STATUS_OKAY;
+}
+
+}
+
+bool mqttTopicMatches(const std::string &filter, const std::string &topic) {
+    std::vector<std::string> f = split(filter);
+    std::vector<std::string> t = split(topic);
+    if (!topic.empty() && topic[0] == '$' && (f[0] == "+" || f[0] == "#")) return false;
+    for (size_t i = 0; i < f.size(); ++i) {
+        if (f[i] == "#") return true;
+        if (i >= t.size()) return false;
+        if (f[i] != "+" && f[i] != t[i]) return false;
+    }
+    return f.size() == t.size();
+}
+
+void mqttRoute(const std::string &topic, const std::string &payload, uint32_t qos, uint8_t retain) {
+    for (Channel &channel : channels) {
+        if (!channel.in_use || channel.closed || channel.type != MV_CHANNELTYPE_MQTT || !channel.mqtt.connected) continue;
+        bool matched = false;
+        uint32_t granted = 0;
+        for (const auto &subscription : channel.mqtt.subscriptions) {
+            if (!mqttTopicMatches(subscription.first, topic)) continue;
+            matched = true;
+            granted = std::max(granted, subscription.second);
+        }
+        if (matched) deliver(channel, topic, payload, std::min(qos, granted), retain);
+    }
+}
+
+void resetMqtt() {
+    connect_state = MV_MQTTREQUESTSTATE_REQUESTCOMPLETED;
+    connect_reason_code = 0;
+}
+
+}
+
+using namespace mvhost;
+
+extern "C" {
+
+enum MvStatus mvMqttGetNextReadableDataType(MvChannelHandle handle, enum MvMqttReadableDataType *data_type) {
+    Call call;
+    MvStatus status;
+    Channel *channel = findChannel(handle, MV_CHANNELTYPE_MQTT, &status);
+    if (channel == nullptr) return status;
+    if (data_type == nullptr) return MV_STATUS_PARAMETERFAULT;
+    *data_type = channel->mqtt.readable.empty() ? MV_MQTTREADABLEDATATYPE_NONE : channel->mqtt.readable.front().type;
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvMqttRequestConnect(MvChannelHandle handle, const struct MvMqttConnectRequest *request) {
+    Call call;
+    MvStatus status;
+    Channel *channel = findChannel(handle, MV_CHANNELTYPE_MQTT, &status);
+    if (channel == nullptr) return status;
+    if (request == nullptr) return MV_STATUS_PARAMETERFAULT;
+    if (channel->mqtt.connect_sent) return MV_STATUS_REQUESTALREADYSENT;
+    if (!sizedStringValid(request->host) || !sizedStringValid(request->clientid)) {
+        channel->mqtt.connect_sent = true;
+        return MV_STATUS_LATEFAULT;
+    }
+    if (request->host.length == 0 || request->clientid.length == 0) return MV_STATUS_REQUIREDELEMENTMISSING;
+
+    const MvTlsCredentials *tls = request->tls_credentials;
+    if (tls != nullptr) {
+        if (tls->cacert.num_certs > MV_HOST_MAX_MQTT_CERTIFICATES ||
+            tls->clientcert.chain.num_certs > MV_HOST_MAX_MQTT_CERTIFICATES) {
+            return MV_STATUS_TOOMANYELEMENTS;
+        }
+        if (tls->clientcert.chain.num_certs != 0) {
+            if (tls->clientcert.key.length == 0) return MV_STATUS_REQUIREDELEMENTMISSING;
+            if (request->authentication.method == MV_MQTTAUTHENTICATIONMETHOD_USERNAMEPASSWORD) {
+                return MV_STATUS_INVALIDAUTHENTICATION;
+            }
+        }
+    }
+
+    channel->mqtt.connect_sent = true;
+    channel->mqtt.version = request->protocol_version;
+    MvMqttRequestState state = connect_state;
+    uint32_t reason_code = connect_reason_code;
+    scheduleOnChannel(*channel, [state, reason_code](Channel &target) {
+        target.mqtt.connected = state == MV_MQTTREQUESTSTATE_REQUESTCOMPLETED;
+        MqttReadable item = response(MV_MQTTREADABLEDATATYPE_CONNECTRESPONSE, state, 0);
+        item.reason_code = reason_code;
+        queue(target, std::move(item));
+    });
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvMqttReadConnectResponse(MvChannelHandle handle, struct MvMqttConnectResponse *response_data) {
+    Call call;
+    Channel *channel;
+    MvStatus status;
+    MqttReadable *item = head(handle, MV_MQTTREADABLEDATATYPE_CONNECTRESPONSE, &channel, &status);
+    if (item == nullptr) return status;
+    if (response_data == nullptr) return MV_STATUS_PARAMETERFAULT;
+    response_data->request_state = item->request_state;
+    response_data->reason_code = item->reason_code;
+    pop(*channel);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvMqttRequestSubscribe(MvChannelHandle handle, const struct MvMqttSubscribeRequest *request) {
+    Call call;
+    MvStatus status;
+    Channel *channel = findChannel(handle, MV_CHANNELTYPE_MQTT, &status);
+    if (channel == nullptr) return status;
+    if (request == nullptr || (request->subscriptions == nullptr && request->num_subscriptions != 0)) {
+        return MV_STATUS_PARAMETERFAULT;
+    }
+    for (uint32_t i = 0; i < request->num_subscriptions; ++i) {
+        if (!sizedStringValid(request->subscriptions[i].topic)) return MV_STATUS_PARAMETERFAULT;
+    }
+    if (request->num_subscriptions > MV_HOST_MAX_MQTT_TOPICS) return MV_STATUS_TOOMANYELEMENTS;
+    if (channel->mqtt.subscribe_pending) return MV_STATUS_RATELIMITED;
+
+    std::vector<std::pair<std::string, uint32_t>> subscriptions;
+    for (uint32_t i = 0; i < request->num_subscriptions; ++i) {
+        subscriptions.emplace_back(toString(request->subscriptions[i].topic),
+                                   std::min<uint32_t>(request->subscriptions[i].desired_qos, 2));
+    }
+    channel->mqtt.subscribe_pending = true;
+    bool connected = channel->mqtt.connected;
+    uint32_t correlation_id = request->correlation_id;
+    scheduleOnChannel(*channel, [connected, correlation_id, subscriptions](Channel &target) {
+        target.mqtt.subscribe_pending = false;
+        MqttReadable item = response(MV_MQTTREADABLEDATATYPE_SUBSCRIBERESPONSE,
+                                     connected ? MV_MQTTREQUESTSTATE_REQUESTCOMPLETED : MV_MQTTREQUESTSTATE_NOTCONNECTED,
+                                     correlation_id);
+        if (connected) {
+            for (const auto &subscription : subscriptions) {
+                auto &existing = target.mqtt.subscriptions;
+                auto it = std::find_if(existing.begin(), existing.end(),
+                                       [&](const auto &s) { return s.first == subscription.first; });
+                if (it == existing.end()) {
+                    existing.push_back(subscription);
+                } else {
+                    it->second = subscription.second;
+                }
+                item.reason_codes.push_back(subscription.second);
+            }
+        }
+        queue(target, std::move(item));
+    });
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvMqttReadSubscribeResponse(MvChannelHandle handle, const struct MvMqttSubscribeResponse *response_data) {
+    Call call;
+    Channel *channel;
+    MvStatus status;
+    MqttReadable *item = head(handle, MV_MQTTREADABLEDATATYPE_SUBSCRIBERESPONSE, &channel, &status);
+    if (item == nullptr) return status;
+    if (response_data == nullptr) return MV_STATUS_PARAMETERFAULT;
+    if (response_data->request_state == nullptr || response_data->correlation_id == nullptr ||
+        response_data->reason_codes == nullptr || response_data->reason_codes_len == nullptr) {
+        return MV_STATUS_LATEFAULT;
+    }
+    status = readReasonCodes(item->reason_codes, response_data->reason_codes, response_data->reason_codes_size,
+                             response_data->reason_codes_len);
+    if (status != MV_STATUS_OKAY) return status;
+    *response_data->request_state = item->request_state;
+    *response_data->correlation_id = item->correlation_id;
+    pop(*channel);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvMqttRequestUnsubscribe(MvChannelHandle handle, const struct MvMqttUnsubscribeRequest *request) {
+    Call call;
+    MvStatus status;
+    Channel *channel = findChannel(handle, MV_CHANNELTYPE_MQTT, &status);
+    if (channel == nullptr) return status;
+    if (request == nullptr || (request->topics == nullptr && request->num_topics != 0)) return MV_STATUS_PARAMETERFAULT;
+    for (uint32_t i = 0; i < request->num_topics; ++i) {
+        if (!sizedStringValid(request->topics[i])) return MV_STATUS_PARAMETERFAULT;
+    }
+    if (request->num_topics > MV_HOST_MAX_MQTT_TOPICS) return MV_STATUS_TOOMANYELEMENTS;
+    if (channel->mqtt.unsubscribe_pending) return MV_STATUS_RATELIMITED;
+
+    std::vector<std::string> topics;
+    for (uint32_t i = 0; i < request->num_topics; ++i) topics.push_back(toString(request->topics[i]));
+    channel->mqtt.unsubscribe_pending = true;
+    bool connected = channel->mqtt.connected;
+    uint32_t correlation_id = request->correlation_id;
+    scheduleOnChannel(*channel, [connected, correlation_id, topics](Channel &target) {
+        target.mqtt.unsubscribe_pending = false;
+        MqttReadable item = response(MV_MQTTREADABLEDATATYPE_UNSUBSCRIBERESPONSE,
+                                     connected ? MV_MQTTREQUESTSTATE_REQUESTCOMPLETED : MV_MQTTREQUESTSTATE_NOTCONNECTED,
+                                     correlation_id);
+        if (connected) {
+            auto &existing = target.mqtt.subscriptions;
+            for (const std::string &topic : topics) {
+                auto it = std::find_if(existing.begin(), existing.end(), [&](const auto &s) { return s.first == topic; });
+                // 0x11: "No subscription existed", per the MQTT v5 specification.
+                item.reason_codes.push_back(it == existing.end() ? 0x11 : 0);
+                if (it != existing.end()) existing.erase(it);
+            }
+        }
+        queue(target, std::move(item));
+    });
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvMqttReadUnsubscribeResponse(MvChannelHandle handle, const struct MvMqttUnsubscribeResponse *response_data) {
+    Call call;
+    Channel *channel;
+    MvStatus status;
+    MqttReadable *item = head(handle, MV_MQTTREADABLEDATATYPE_UNSUBSCRIBERESPONSE, &channel, &status);
+    if (item == nullptr) return status;
+    if (response_data == nullptr) return MV_STATUS_PARAMETERFAULT;
+    if (response_data->request_state == nullptr || response_data->correlation_id == nullptr ||
+        response_data->reason_codes == nullptr || response_data->reason_codes_len == nullptr) {
+        return MV_STATUS_LATEFAULT;
+    }
+    status = readReasonCodes(item->reason_codes, response_data->reason_codes, response_data->reason_codes_size,
+                             response_data->reason_codes_len);
+    if (status != MV_STATUS_OKAY) return status;
+    *response_data->request_state = item->request_state;
+    *response_data->correlation_id = item->correlation_id;
+    pop(*channel);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvMqttRequestPublish(MvChannelHandle handle, const struct MvMqttPublishRequest *request) {
+    Call call;
+    MvStatus status;
+    Channel *channel = findChannel(handle, MV_CHANNELTYPE_MQTT, &status);
+    if (channel == nullptr) return status;
+    if (request == nullptr) return MV_STATUS_PARAMETERFAULT;
+    if (!sizedStringValid(request->topic) || !sizedStringValid(request->payload)) return MV_STATUS_LATEFAULT;
+
+    uint32_t wire_size = kItemOverhead + request->topic.length + request->payload.length;
+    if (channel->mqtt.inflight >= MV_HOST_MAX_MQTT_INFLIGHT || wire_size > channel->tx_len - channel->tx_used) {
+        channel->write_blocked = true;
+        return MV_STATUS_RATELIMITED;
+    }
+    channel->mqtt.inflight++;
+    channel->tx_used += wire_size;
+
+    bool connected = channel->mqtt.connected;
+    uint32_t correlation_id = request->correlation_id;
+    std::string topic = toString(request->topic);
+    std::string payload = toString(request->payload);
+    uint32_t qos = request->desired_qos;
+    uint8_t retain = request->retain != 0;
+    scheduleOnChannel(*channel, [=](Channel &target) {
+        target.mqtt.inflight--;
+        releaseSendSpace(target, wire_size);
+        bool delivered = connected && target.mqtt.connected;
+        queue(target, response(MV_MQTTREADABLEDATATYPE_PUBLISHRESPONSE,
+                               delivered ? MV_MQTTREQUESTSTATE_REQUESTCOMPLETED : MV_MQTTREQUESTSTATE_NOTCONNECTED,
+                               correlation_id));
+        if (delivered) mqttRoute(topic, payload, qos, retain);
+    });
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvMqttReadPublishResponse(MvChannelHandle handle, struct MvMqttPublishResponse *response_data) {
+    Call call;
+    Channel *channel;
+    MvStatus status;
+    MqttReadable *item = head(handle, MV_MQTTREADABLEDATATYPE_PUBLISHRESPONSE, &channel, &status);
+    if (item == nullptr) return status;
+    if (response_data == nullptr) return MV_STATUS_PARAMETERFAULT;
+    response_data->request_state = item->request_state;
+    response_data->correlation_id = item->correlation_id;
+    response_data->reason_code = item->reason_code;
+    pop(*channel);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvMqttReceiveMessage(MvChannelHandle handle, const struct MvMqttMessage *message_data) {
+    Call call;
+    Channel *channel;
+    MvStatus status;
+    MqttReadable *item = head(handle, MV_MQTTREADABLEDATATYPE_MESSAGERECEIVED, &channel, &status);
+    if (item == nullptr) return status;
+    if (message_data == nullptr) return MV_STATUS_PARAMETERFAULT;
+    const MvMqttMessage &m = *message_data;
+    if (m.correlation_id == nullptr || m.topic.data == nullptr || m.topic.length == nullptr ||
+        m.payload.length == nullptr || (m.payload.data == nullptr && m.payload.size != 0) || m.qos == nullptr ||
+        m.retain == nullptr) {
+        return MV_STATUS_LATEFAULT;
+    }
+    if (m.topic.size < item->topic.size() || m.payload.size < item->payload.size()) return MV_STATUS_INVALIDBUFFERSIZE;
+
+    std::memcpy(m.topic.data, item->topic.data(), item->topic.size());
+    *m.topic.length = static_cast<uint32_t>(item->topic.size());
+    if (!item->payload.empty()) std::memcpy(m.payload.data, item->payload.data(), item->payload.size());
+    *m.payload.length = static_cast<uint32_t>(item->payload.size());
+    *m.correlation_id = item->correlation_id;
+    *m.qos = item->qos;
+    *m.retain = item->retain;
+    if (item->qos != 0) channel->mqtt.unacknowledged.push_back(item->correlation_id);
+    pop(*channel);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvMqttReceiveLostMessageInfo(MvChannelHandle handle, const struct MvMqttLostMessageInfo *lost_message_info) {
+    Call call;
+    Channel *channel;
+    MvStatus status;
+    MqttReadable *item = head(handle, MV_MQTTREADABLEDATATYPE_MESSAGELOST, &channel, &status);
+    if (item == nullptr) return status;
+    if (lost_message_info == nullptr) return MV_STATUS_PARAMETERFAULT;
+    const MvMqttLostMessageInfo &info = *lost_message_info;
+    if (info.reason == nullptr || info.topic.data == nullptr || info.topic.length == nullptr ||
+        info.message_len == nullptr) {
+        return MV_STATUS_LATEFAULT;
+    }
+    if (info.topic.size < item->topic.size()) return MV_STATUS_INVALIDBUFFERSIZE;
+
+    *info.reason = MV_MQTTLOSTMESSAGEREASON_DEVICERECEIVEBUFFERTOOSMALL;
+    std::memcpy(info.topic.data, item->topic.data(), item->topic.size());
+    *info.topic.length = static_cast<uint32_t>(item->topic.size());
+    *info.message_len = item->message_len;
+    pop(*channel);
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvMqttAcknowledgeMessage(MvChannelHandle handle, uint32_t correlation_id) {
+    Call call;
+    MvStatus status;
+    Channel *channel = findChannel(handle, MV_CHANNELTYPE_MQTT, &status);
+    if (channel == nullptr) return status;
+    std::vector<uint32_t> &pending = channel->mqtt.unacknowledged;
+    pending.erase(std::remove(pending.begin(), pending.end(), correlation_id), pending.end());
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvMqttRequestDisconnect(MvChannelHandle handle) {
+    Call call;
+    MvStatus status;
+    Channel *channel = findChannel(handle, MV_CHANNELTYPE_MQTT, &status);
+    if (channel == nullptr) return status;
+    if (channel->mqtt.disconnect_pending) return MV_STATUS_RATELIMITED;
+    channel->mqtt.disconnect_pending = true;
+    bool connected = channel->mqtt.connected;
+    scheduleOnChannel(*channel, [connected](Channel &target) {
+        target.mqtt.disconnect_pending = false;
+        target.mqtt.connected = false;
+        queue(target, response(MV_MQTTREADABLEDATATYPE_DISCONNECTRESPONSE,
+                               connected ? MV_MQTTREQUESTSTATE_REQUESTCOMPLETED : MV_MQTTREQUESTSTATE_NOTCONNECTED, 0));
+    });
+    return MV_STATUS_OKAY;
+}
+
+enum MvStatus mvMqttReadDisconnectResponse(MvChannelHandle handle, struct MvMqttDisconnectResponse *response_data) {
+    Call call;
+    Channel *channel;
+    MvStatus status;
+    MqttReadable *item = head(handle, MV_MQTTREADABLEDATATYPE_DISCONNECTRESPONSE, &channel, &status);
+    if (item == nullptr) return status;
+    if (response_data == nullptr) return MV_STATUS_PARAMETERFAULT;
+    response_data->request_state = item->request_state;
+    response_data->disconnect_code = 0;
+    pop(*channel);
+    return MV_STATUS_OKAY;
+}
+
+void mvHostMqttSetConnectResult(enum MvMqttRequestState state, uint32_t reason_code) {
+    Call call(Call::Control);
+    connect_state = state;
+    connect_reason_code = reason_code;
+}
+
+void mvHostMqttInjectMessage(struct MvSizedString topic, struct MvSizedString payload, uint32_t qos, uint8_t retain) {
+    Call call(Call::Control);
+    mqttRoute(toString(topic), toString(payload), qos, retain);
+}
+
+}
@@ -0,0 +1,11 @@
+#ifndef MV_HOST_SYSCALLS_H
+#define MV_HOST_SYSCALLS_H
+
+/**
+ *  The host target implements exactly the NSC API of the device, so the
+ *  declarations are shared with the STM32U5 header. Host-only controls for
+ *  driving the in-process stand-ins live in `mv_host.h`.
+ */
+#include "../stm32u5/mv_syscalls.h"
+
+#endif
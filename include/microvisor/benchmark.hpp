@@ -0,0 +1,263 @@
+#ifndef MV_BENCHMARK_HPP
+#define MV_BENCHMARK_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#include "decimal.h"
+#include "mv_syscalls.h"
+
+namespace mv {
+
+class Benchmark;
+struct BenchmarkCase;
+
+using BenchmarkFunction = void (*)(Benchmark &bench);
+
+/**
+ *  Whether a lower or a higher value of a result is better.
+ */
+enum class BenchmarkGoal : uint8_t { Lower, Higher };
+
+/**
+ *  Receives each result of a case in place of its `mvTestLog` line, for a
+ *  runner that collects results itself. A case's timing arrives as the
+ *  metric `ns`.
+ */
+using BenchmarkSink = void (*)(void *context, const BenchmarkCase &current, const char *metric, uint64_t value,
+                               const char *unit, BenchmarkGoal goal);
+
+/**
+ *  A registered benchmark. Define cases with `MV_BENCHMARK()` rather than
+ *  constructing these directly.
+ */
+struct BenchmarkCase {
+    BenchmarkCase(const char *case_name, BenchmarkFunction function, uint32_t case_limit_ns)
+        : name(case_name), run(function), limit_ns(case_limit_ns) {
+        // Append, so cases run in link order.
+        BenchmarkCase **tail = &first();
+        while (*tail != nullptr) tail = &(*tail)->next;
+        *tail = this;
+    }
+
+    BenchmarkCase(const BenchmarkCase &) = delete;
+    BenchmarkCase &operator=(const BenchmarkCase &) = delete;
+
+    static BenchmarkCase *&first() {
+        static BenchmarkCase *head = nullptr;
+        return head;
+    }
+
+    const char *name;
+    BenchmarkFunction run;
+    uint32_t limit_ns;
+    BenchmarkCase *next = nullptr;
+};
+
+/**
+ *  One line of benchmark output, sent with `mvTestLog`.
+ */
+class BenchmarkLine {
+public:
+    static constexpr uint32_t kMaxLine = 128;
+
+    BenchmarkLine &append(const char *text) {
+        while (*text != '\0' && length_ < sizeof(line_)) line_[length_++] = static_cast<uint8_t>(*text++);
+        return *this;
+    }
+
+    BenchmarkLine &append(uint64_t value) {
+        length_ = mvAppendDecimal(reinterpret_cast<char *>(line_), length_, sizeof(line_), value);
+        return *this;
+    }
+
+    /**
+     *  Log the line, waiting up to a second for room in the test log
+     *  buffer.
+     */
+    void send() const {
+        uint64_t start = now();
+        while (mvTestLog(line_, static_cast<uint16_t>(length_)) == MV_STATUS_INVALIDBUFFERSIZE &&
+               now() - start < 1000000) {
+        }
+    }
+
+    static uint64_t now() {
+        uint64_t us;
+        mvGetMicroseconds(&us);
+        return us;
+    }
+
+private:
+    uint8_t line_[kMaxLine];
+    uint32_t length_ = 0;
+};
+
+/**
+ *  Passed to each case to time its work and report its results, to a
+ *  `BenchmarkSink` if one is given and otherwise through `mvTestLog`, one
+ *  line per result:
+ *
+ *      start clock=<Hz>
+ *      bench <case> iterations=<n> ns=<per iteration> cycles=<per iteration> limit=<ns> ok|FAIL
+ *      metric <case> <name> <value> <unit>
+ *      done passed=<n> failed=<n>
+ *
+ *  Cycles are derived from the `mvGetMicroseconds` time and the
+ *  `mvGetSysClk` frequency, so the same cases give comparable numbers on a
+ *  device and on the host stand-ins.
+ */
+class Benchmark {
+public:
+    explicit Benchmark(const BenchmarkCase &current, BenchmarkSink sink = nullptr, void *sink_context = nullptr)
+        : case_(current), sink_(sink), sink_context_(sink_context) {
+        mvGetSysClk(&clock_hz_);
+    }
+
+    Benchmark(const Benchmark &) = delete;
+    Benchmark &operator=(const Benchmark &) = delete;
+
+    /**
+     *  Time one batch of `iterations` calls of `body`, after one untimed
+     *  call to warm caches. A case may measure several batches; its result
+     *  is the fastest. The clock counts microseconds, so size batches to
+     *  take a few milliseconds at least.
+     */
+    template <typename Body>
+    void measure(uint32_t iterations, Body &&body) {
+        if (iterations == 0) return;
+        body();
+        uint64_t start = BenchmarkLine::now();
+        for (uint32_t i = 0; i < iterations; ++i) body();
+        uint64_t elapsed = BenchmarkLine::now() - start;
+
+        if (iterations_ == 0 || elapsed * iterations_ < best_us_ * iterations) {
+            iterations_ = iterations;
+            best_us_ = elapsed;
+        }
+    }
+
+    /**
+     *  Report an additional result, such as bytes per second.
+     */
+    void report(const char *metric, uint64_t value, const char *unit, BenchmarkGoal goal = BenchmarkGoal::Lower) {
+        reported_ = true;
+        if (sink_ != nullptr) {
+            sink_(sink_context_, case_, metric, value, unit, goal);
+            return;
+        }
+        BenchmarkLine line;
+        line.append("metric ").append(case_.name).append(" ").append(metric).append(" ").append(value);
+        line.append(" ").append(unit).send();
+    }
+
+    /**
+     *  Fail the case whatever its timing, for example after an NSC error.
+     */
+    void fail() {
+        failed_ = true;
+    }
+
+    /**
+     *  Nanoseconds per iteration of the fastest batch, or zero if none ran.
+     */
+    uint64_t nsPerIteration() const {
+        return iterations_ == 0 ? 0 : best_us_ * 1000 / iterations_;
+    }
+
+    uint64_t cyclesPerIteration() const {
+        return iterations_ == 0 ? 0 : best_us_ * clock_hz_ / iterations_ / 1000000;
+    }
+
+    /**
+     *  True unless the case failed, neither measured nor reported anything,
+     *  or ran slower than its limit.
+     */
+    bool passed() const {
+        return !failed_ && (iterations_ != 0 || reported_) && (case_.limit_ns == 0 || nsPerIteration() <= case_.limit_ns);
+    }
+
+    /**
+     *  Report the case's timing, if it measured any, or log its result line.
+     */
+    void finish() {
+        if (sink_ != nullptr) {
+            if (iterations_ != 0) sink_(sink_context_, case_, "ns", nsPerIteration(), "ns", BenchmarkGoal::Lower);
+            return;
+        }
+        BenchmarkLine line;
+        line.append("bench ").append(case_.name).append(" iterations=").append(iterations_);
+        line.append(" ns=").append(nsPerIteration()).append(" cycles=").append(cyclesPerIteration());
+        line.append(" limit=").append(case_.limit_ns).append(passed() ? " ok" : " FAIL").send();
+    }
+
+private:
+    const BenchmarkCase &case_;
+    BenchmarkSink sink_;
+    void *sink_context_;
+    uint32_t clock_hz_ = 0;
+    uint32_t iterations_ = 0;
+    uint64_t best_us_ = 0;
+    bool reported_ = false;
+    bool failed_ = false;
+};
+
+/**
+ *  Run every registered case whose name contains `filter`, or all of them,
+ *  logging the results. Returns the number that failed.
+ */
+inline uint32_t runBenchmarks(const char *filter = nullptr) {
+    uint32_t hz = 0;
+    mvGetSysClk(&hz);
+    BenchmarkLine().append("start clock=").append(hz).send();
+
+    uint32_t passed = 0;
+    uint32_t failed = 0;
+    for (BenchmarkCase *entry = BenchmarkCase::first(); entry != nullptr; entry = entry->next) {
+        if (filter != nullptr && std::strstr(entry->name, filter) == nullptr) continue;
+        Benchmark bench(*entry);
+        entry->run(bench);
+        bench.finish();
+        if (bench.passed()) {
+            passed++;
+        } else {
+            failed++;
+        }
+    }
+
+    BenchmarkLine().append("done passed=").append(passed).append(" failed=").append(failed).send();
+    return failed;
+}
+
+/**
+ *  The whole of an application testing image: enable test logging, run
+ *  every case and report the result with `mvTestingComplete`, which does
+ *  not return on a device.
+ */
+inline void benchmarkMain(const char *filter = nullptr) {
+    alignas(512) static uint8_t log_buffer[4096];
+    mvTestLoggingInit(log_buffer, sizeof(log_buffer));
+    uint32_t failed = runBenchmarks(filter);
+    mvTestingComplete(failed);
+}
+
+}
+
+#define MV_BENCHMARK_CONCAT_(a, b) a##b
+#define MV_BENCHMARK_CONCAT(a, b) MV_BENCHMARK_CONCAT_(a, b)
+
+/**
+ *  Define and register a benchmark, failing if its fastest batch takes
+ *  longer than `limit_ns` per iteration (zero for no limit):
+ *
+ *      MV_BENCHMARK(crc32_4k, 2000000) {
+ *          bench.measure(16, [] { mv::crc32(mv::ByteSpan(data, sizeof(data))); });
+ *      }
+ */
+#define MV_BENCHMARK(name, limit_ns)                                                                              \
+    static void MV_BENCHMARK_CONCAT(mv_benchmark_, name)(mv::Benchmark & bench);                                  \
+    static mv::BenchmarkCase MV_BENCHMARK_CONCAT(mv_benchmark_case_, name)(#name, MV_BENCHMARK_CONCAT(mv_benchmark_, name), \
+                                                                           limit_ns);                             \
+    static void MV_BENCHMARK_CONCAT(mv_benchmark_, name)(mv::Benchmark & bench)
+
+#endif
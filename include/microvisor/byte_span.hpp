@@ -0,0 +1,108 @@
+#ifndef MV_BYTE_SPAN_HPP
+#define MV_BYTE_SPAN_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#include "mv_syscalls.h"
+
+namespace mv {
+
+/**
+ *  A non-owning view of bytes. Converts to and from `MvSizedString`.
+ */
+struct ByteSpan {
+    const uint8_t *data = nullptr;
+    uint32_t length = 0;
+
+    constexpr ByteSpan() = default;
+    constexpr ByteSpan(const uint8_t *data_in, uint32_t length_in) : data(data_in), length(length_in) {}
+    ByteSpan(const char *string) : data(reinterpret_cast<const uint8_t *>(string)), length(static_cast<uint32_t>(std::strlen(string))) {}
+    constexpr ByteSpan(const MvSizedString &string) : data(string.data), length(string.length) {}
+
+    constexpr bool empty() const {
+        return length == 0;
+    }
+
+    constexpr ByteSpan subspan(uint32_t offset, uint32_t count = UINT32_MAX) const {
+        return offset >= length ? ByteSpan(data + length, 0)
+                                : ByteSpan(data + offset, count < length - offset ? count : length - offset);
+    }
+
+    constexpr MvSizedString sized() const {
+        return MvSizedString{data, length};
+    }
+
+    bool operator==(const ByteSpan &other) const {
+        return length == other.length && (length == 0 || std::memcmp(data, other.data, length) == 0);
+    }
+
+    bool operator!=(const ByteSpan &other) const {
+        return !(*this == other);
+    }
+};
+
+constexpr uint8_t asciiLower(uint8_t c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<uint8_t>(c + ('a' - 'A')) : c;
+}
+
+/**
+ *  Compare two spans ignoring ASCII case, as HTTP header names are compared.
+ */
+inline bool equalsIgnoreCase(ByteSpan a, ByteSpan b) {
+    if (a.length != b.length) return false;
+    for (uint32_t i = 0; i < a.length; ++i) {
+        if (asciiLower(a.data[i]) != asciiLower(b.data[i])) return false;
+    }
+    return true;
+}
+
+/**
+ *  Bytes that may wrap around the end of a ring buffer: `first` runs up to
+ *  the end of the buffer and `second`, if not empty, continues from its start.
+ */
+struct RingRegion {
+    ByteSpan first;
+    ByteSpan second;
+
+    constexpr uint32_t size() const {
+        return first.length + second.length;
+    }
+
+    constexpr bool empty() const {
+        return size() == 0;
+    }
+
+    /**
+     *  Copy `count` bytes starting `offset` bytes into the region.
+     *  Returns false, copying nothing, if the region is too short.
+     */
+    bool copy(uint32_t offset, uint8_t *out, uint32_t count) const {
+        if (offset > size() || count > size() - offset) return false;
+        if (offset < first.length) {
+            uint32_t head = count < first.length - offset ? count : first.length - offset;
+            std::memcpy(out, first.data + offset, head);
+            std::memcpy(out + head, second.data, count - head);
+        } else {
+            std::memcpy(out, second.data + (offset - first.length), count);
+        }
+        return true;
+    }
+
+    /**
+     *  A pointer to `count` bytes at `offset`, in place when they are
+     *  contiguous and otherwise stitched into `scratch`, which must hold
+     *  `count` bytes. Returns nullptr if the region is too short.
+     */
+    const uint8_t *contiguous(uint32_t offset, uint32_t count, uint8_t *scratch) const {
+        if (offset > size() || count > size() - offset) return nullptr;
+        if (offset + count <= first.length) return first.data + offset;
+        if (offset >= first.length) return second.data + (offset - first.length);
+        copy(offset, scratch, count);
+        return scratch;
+    }
+};
+
+}
+
+#endif
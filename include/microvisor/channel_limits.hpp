@@ -0,0 +1,107 @@
+#ifndef MV_CHANNEL_LIMITS_HPP
+#define MV_CHANNEL_LIMITS_HPP
+
+#include <cstdint>
+
+#include "mv_syscalls.h"
+
+namespace mv {
+
+/// Channels Microvisor allows open at once, of all types.
+constexpr uint32_t kMaxChannels = 4;
+/// Channel opens Microvisor allows per `kChannelOpenWindowUs`.
+constexpr uint32_t kChannelOpenLimit = 8;
+constexpr uint64_t kChannelOpenWindowUs = 1000000;
+/// How long to hold off opening after Microvisor refuses with
+/// `MV_STATUS_TOOMANYCHANNELS` or `MV_STATUS_NETWORKNOTCONNECTED`.
+constexpr uint64_t kChannelRetryUs = 100000;
+/// Granularity of channel buffer sizes. Microvisor does not document it;
+/// this is an estimate, which the host stand-ins also use.
+constexpr uint32_t kChannelBufferAlignment = 512;
+
+/**
+ *  Smallest valid buffer length for `bytes` of channel data.
+ */
+constexpr uint32_t channelBufferSizeFor(uint32_t bytes) {
+    return (bytes + kChannelBufferAlignment - 1) / kChannelBufferAlignment * kChannelBufferAlignment;
+}
+
+/**
+ *  Paces one component's `mvOpenChannel` calls.
+ *
+ *  Opens are paced by a token bucket matching Microvisor's limit: each of
+ *  `kChannelOpenLimit` tokens returns `kChannelOpenWindowUs` after it is
+ *  spent, so `mvOpenChannel` is not refused with `MV_STATUS_RATELIMITED`
+ *  unless other code is opening channels too. If it is, the bucket is
+ *  emptied and refilled by the same rule. A refusal because every channel
+ *  is in use or the network is down holds opens off for `kChannelRetryUs`.
+ */
+class ChannelOpenPacer {
+public:
+    /**
+     *  True if an open may be attempted at `at`.
+     */
+    bool ready(uint64_t at) const {
+        return at >= retry_at_ && tokenAvailable(at);
+    }
+
+    /**
+     *  Record the status of an `mvOpenChannel` call that returned at `at`.
+     *  Taking the time after the call keeps each token from returning
+     *  before Microvisor's own window for that open has passed. Returns
+     *  true if the refusal was transient and the open should be retried
+     *  once `nextAt()` arrives.
+     */
+    bool opened(uint64_t at, MvStatus status) {
+        spendToken(at);
+        if (status == MV_STATUS_RATELIMITED) {
+            // Someone else is opening channels: assume the whole window is used.
+            rate_limited_++;
+            for (uint32_t i = 0; i < kChannelOpenLimit; ++i) spendToken(at);
+            return true;
+        }
+        if (status == MV_STATUS_TOOMANYCHANNELS || status == MV_STATUS_NETWORKNOTCONNECTED) {
+            retry_at_ = at + kChannelRetryUs;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     *  When the next open may be attempted, in `mvGetMicroseconds` time. A
+     *  time already past, such as zero, means now.
+     */
+    uint64_t nextAt() const {
+        uint64_t token = opens_spent_ < kChannelOpenLimit ? 0 : opens_[open_index_] + kChannelOpenWindowUs;
+        return token > retry_at_ ? token : retry_at_;
+    }
+
+    /**
+     *  Opens refused with `MV_STATUS_RATELIMITED` despite the token bucket.
+     */
+    uint32_t rateLimited() const {
+        return rate_limited_;
+    }
+
+private:
+    void spendToken(uint64_t at) {
+        opens_[open_index_] = at;
+        open_index_ = (open_index_ + 1) % kChannelOpenLimit;
+        if (opens_spent_ < kChannelOpenLimit) opens_spent_++;
+    }
+
+    // `opens_[open_index_]` is the oldest of the last `kChannelOpenLimit` opens.
+    bool tokenAvailable(uint64_t at) const {
+        return opens_spent_ < kChannelOpenLimit || at - opens_[open_index_] >= kChannelOpenWindowUs;
+    }
+
+    uint64_t opens_[kChannelOpenLimit] = {};
+    uint32_t open_index_ = 0;
+    uint32_t opens_spent_ = 0;
+    uint64_t retry_at_ = 0;
+    uint32_t rate_limited_ = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef MV_CHANNEL_READER_HPP
+#define MV_CHANNEL_READER_HPP
+
+#include <cstdint>
+
+#include "byte_span.hpp"
+#include "mv_syscalls.h"
+
+namespace mv {
+
+/**
+ *  Zero-copy reader for an `MV_CHANNELTYPE_OPAQUEBYTES` channel.
+ *
+ *  Parsers see unread data in place in the channel's receive buffer as a
+ *  `RingRegion`: one span, or two when the data wraps past the end of the
+ *  buffer. Consumption is tracked locally and handed to
+ *  `mvReadChannelComplete` only once `commit_threshold` bytes have built
+ *  up, or when `commit()` is called, so a burst of small frames costs one
+ *  NSC call rather than one per frame. Consumed bytes are not returned to
+ *  Microvisor until committed, so a large threshold reduces the space
+ *  available for incoming data.
+ */
+class ChannelReader {
+public:
+    /**
+     *  @param handle            An open opaque-bytes channel.
+     *  @param receive_buffer    The `receive_buffer` the channel was opened with.
+     *  @param receive_buffer_len    The `receive_buffer_len` the channel was opened with.
+     *  @param commit_threshold  Consumed bytes to accumulate before committing; zero means half the buffer.
+     */
+    ChannelReader(MvChannelHandle handle, const uint8_t *receive_buffer, uint32_t receive_buffer_len,
+                  uint32_t commit_threshold = 0)
+        : handle_(handle),
+          buffer_(receive_buffer),
+          buffer_len_(receive_buffer_len),
+          commit_threshold_(commit_threshold != 0 ? commit_threshold : receive_buffer_len / 2) {}
+
+    /**
+     *  Ask Microvisor how much data is unread. Call after a
+     *  `MV_EVENTTYPE_CHANNELDATAREADABLE` notification or when `peek()`
+     *  holds too little for the parser to progress.
+     */
+    MvStatus refresh() {
+        uint8_t *pointer;
+        uint32_t length;
+        MvStatus status = mvReadChannel(handle_, &pointer, &length);
+        if (status != MV_STATUS_OKAY) return status;
+        read_offset_ = static_cast<uint32_t>(pointer - buffer_);
+        unread_ = length;
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  The data fetched by the last `refresh()` that has not been consumed.
+     */
+    RingRegion peek() const {
+        RingRegion region;
+        uint32_t length = unread_ - pending_;
+        if (length == 0) return region;
+        uint32_t start = read_offset_ + pending_;
+        if (start >= buffer_len_) start -= buffer_len_;
+        uint32_t first = length < buffer_len_ - start ? length : buffer_len_ - start;
+        region.first = ByteSpan(buffer_ + start, first);
+        region.second = ByteSpan(buffer_, length - first);
+        return region;
+    }
+
+    uint32_t available() const {
+        return unread_ - pending_;
+    }
+
+    /**
+     *  Mark `count` bytes from the front of `peek()` as consumed, committing
+     *  once the threshold is reached. `count` is clamped to `available()`.
+     */
+    MvStatus consume(uint32_t count) {
+        pending_ += count < available() ? count : available();
+        return pending_ >= commit_threshold_ ? commit() : MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Return all consumed bytes to Microvisor now.
+     */
+    MvStatus commit() {
+        if (pending_ == 0) return MV_STATUS_OKAY;
+        MvStatus status = mvReadChannelComplete(handle_, pending_);
+        if (status != MV_STATUS_OKAY) return status;
+        read_offset_ += pending_;
+        if (read_offset_ >= buffer_len_) read_offset_ -= buffer_len_;
+        unread_ -= pending_;
+        pending_ = 0;
+        commits_++;
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Refresh and feed the parser until it stops making progress. `parser`
+     *  is called as `uint32_t parser(const RingRegion &)` and returns the
+     *  number of bytes it consumed, which may end part-way through a frame;
+     *  zero means it needs more data. Consumption is left uncommitted below
+     *  the threshold.
+     */
+    template <typename Parser>
+    MvStatus process(Parser &&parser) {
+        MvStatus status = refresh();
+        bool refreshed = false;
+        while (status == MV_STATUS_OKAY && available() != 0) {
+            uint32_t used = parser(peek());
+            if (used != 0) {
+                status = consume(used);
+                refreshed = false;
+                continue;
+            }
+            // A partial frame can only complete once Microvisor has room for
+            // the rest of it, so return what has been consumed and look again.
+            if (refreshed || pending_ == 0) break;
+            status = commit();
+            if (status == MV_STATUS_OKAY) status = refresh();
+            refreshed = true;
+        }
+        return status;
+    }
+
+    uint32_t pendingCommit() const {
+        return pending_;
+    }
+
+    /**
+     *  Number of `mvReadChannelComplete` calls made.
+     */
+    uint32_t commits() const {
+        return commits_;
+    }
+
+private:
+    MvChannelHandle handle_;
+    const uint8_t *buffer_;
+    uint32_t buffer_len_;
+    uint32_t commit_threshold_;
+    uint32_t read_offset_ = 0;
+    uint32_t unread_ = 0;
+    uint32_t pending_ = 0;
+    uint32_t commits_ = 0;
+};
+
+}
+
+#endif
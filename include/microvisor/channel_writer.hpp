@@ -0,0 +1,233 @@
+#ifndef MV_CHANNEL_WRITER_HPP
+#define MV_CHANNEL_WRITER_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#include "byte_span.hpp"
+#include "mv_syscalls.h"
+
+namespace mv {
+
+/**
+ *  Coalescing writer for an `MV_CHANNELTYPE_OPAQUEBYTES` channel.
+ *
+ *  Small writes are gathered in an application-side buffer and passed to
+ *  Microvisor in one `mvWriteChannelStream` call once `flush_threshold`
+ *  bytes are held, once the oldest buffered byte is `max_delay_us` old (see
+ *  `poll()`), or on `flush()`. Writes at least as large as the buffer skip
+ *  it when it is empty.
+ *
+ *  The writer keeps a lower bound on the channel's free space, taken from
+ *  `mvWriteChannel` results and reduced by each write; Microvisor only ever
+ *  grows the real figure. `writeFrame()` uses it to avoid a zero-length
+ *  `mvWriteChannel` probe whenever the bound already shows the frame fits.
+ *  Only one writer may be used per channel.
+ *
+ *  @tparam BufferSize  Size of the coalescing buffer in bytes.
+ */
+template <uint32_t BufferSize = 512>
+class ChannelWriter {
+    static_assert(BufferSize > 0, "ChannelWriter needs a coalescing buffer");
+
+public:
+    /**
+     *  @param handle           An open opaque-bytes channel.
+     *  @param flush_threshold  Buffered bytes that trigger a flush; zero means a full buffer.
+     *  @param max_delay_us     Longest a byte may wait in the buffer before `poll()` flushes it; zero means no limit.
+     */
+    explicit ChannelWriter(MvChannelHandle handle, uint32_t flush_threshold = 0, uint32_t max_delay_us = 0)
+        : handle_(handle),
+          flush_threshold_(flush_threshold != 0 && flush_threshold < BufferSize ? flush_threshold : BufferSize),
+          max_delay_us_(max_delay_us) {}
+
+    ChannelWriter(const ChannelWriter &) = delete;
+    ChannelWriter &operator=(const ChannelWriter &) = delete;
+
+    /**
+     *  Write the segments in order in streaming mode, buffering what
+     *  Microvisor cannot take yet. `accepted` receives the number of bytes
+     *  taken, which is short of the total only when both the channel and
+     *  the coalescing buffer are full.
+     */
+    MvStatus write(const ByteSpan *segments, uint32_t count, uint32_t *accepted) {
+        MvStatus status = MV_STATUS_OKAY;
+        uint32_t taken = 0;
+        bool full = false;
+        for (uint32_t i = 0; i < count && !full && status == MV_STATUS_OKAY; ++i) {
+            const uint8_t *data = segments[i].data;
+            uint32_t remaining = segments[i].length;
+            while (remaining != 0) {
+                if (used_ == 0 && remaining >= BufferSize) {
+                    uint32_t written;
+                    status = stream(data, remaining, &written);
+                    if (status != MV_STATUS_OKAY) break;
+                    data += written;
+                    remaining -= written;
+                    taken += written;
+                    if (remaining == 0) break;
+                }
+                if (used_ == BufferSize) {
+                    status = flush();
+                    if (status != MV_STATUS_OKAY) break;
+                    if (used_ == BufferSize) {
+                        full = true;
+                        break;
+                    }
+                }
+                uint32_t chunk = remaining < BufferSize - used_ ? remaining : BufferSize - used_;
+                append(data, chunk);
+                data += chunk;
+                remaining -= chunk;
+                taken += chunk;
+            }
+        }
+        if (accepted != nullptr) *accepted = taken;
+        if (status != MV_STATUS_OKAY) return status;
+        return used_ >= flush_threshold_ ? flush() : MV_STATUS_OKAY;
+    }
+
+    MvStatus write(ByteSpan data, uint32_t *accepted = nullptr) {
+        return write(&data, 1, accepted);
+    }
+
+    /**
+     *  Write the segments as one frame which is either taken whole or not
+     *  at all, keeping it in order with earlier writes.
+     *
+     *  @retval MV_STATUS_INVALIDBUFFERSIZE Nothing was written because the frame does not fit yet.
+     */
+    MvStatus writeFrame(const ByteSpan *segments, uint32_t count) {
+        uint32_t total = 0;
+        for (uint32_t i = 0; i < count; ++i) total += segments[i].length;
+
+        if (total > BufferSize - used_) {
+            MvStatus status = flush();
+            if (status != MV_STATUS_OKAY) return status;
+        }
+        if (total <= BufferSize - used_) {
+            for (uint32_t i = 0; i < count; ++i) append(segments[i].data, segments[i].length);
+            return used_ >= flush_threshold_ ? flush() : MV_STATUS_OKAY;
+        }
+        if (used_ != 0) return MV_STATUS_INVALIDBUFFERSIZE;
+
+        // Too large for the coalescing buffer: hand it to Microvisor directly.
+        if (count == 1) {
+            uint32_t available;
+            MvStatus status = mvWriteChannel(handle_, segments[0].data, total, &available);
+            nsc_calls_++;
+            if (status == MV_STATUS_OKAY || status == MV_STATUS_INVALIDBUFFERSIZE) channel_free_ = available;
+            return status;
+        }
+        if (total > channel_free_) {
+            MvStatus status = probe(nullptr);
+            if (status != MV_STATUS_OKAY) return status;
+            if (total > channel_free_) return MV_STATUS_INVALIDBUFFERSIZE;
+        }
+        // With the space confirmed each segment is taken in full.
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t written;
+            MvStatus status = stream(segments[i].data, segments[i].length, &written);
+            if (status != MV_STATUS_OKAY) return status;
+        }
+        return MV_STATUS_OKAY;
+    }
+
+    MvStatus writeFrame(ByteSpan frame) {
+        return writeFrame(&frame, 1);
+    }
+
+    /**
+     *  Pass as much buffered data to Microvisor as it will take.
+     */
+    MvStatus flush() {
+        if (used_ == 0) return MV_STATUS_OKAY;
+        uint32_t written;
+        MvStatus status = stream(buffer_, used_, &written);
+        if (status != MV_STATUS_OKAY) return status;
+        used_ -= written;
+        if (used_ != 0) std::memmove(buffer_, buffer_ + written, used_);
+        flushes_++;
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Flush if buffered data has waited `max_delay_us`. Call from the
+     *  application's main loop or a periodic timer.
+     */
+    MvStatus poll() {
+        if (used_ == 0 || max_delay_us_ == 0) return MV_STATUS_OKAY;
+        uint64_t now;
+        mvGetMicroseconds(&now);
+        return now - buffered_since_ >= max_delay_us_ ? flush() : MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Ask Microvisor for the channel's free space with a zero-length
+     *  `mvWriteChannel`, refreshing the cached bound.
+     */
+    MvStatus probe(uint32_t *available) {
+        uint32_t space;
+        MvStatus status = mvWriteChannel(handle_, buffer_, 0, &space);
+        nsc_calls_++;
+        if (status != MV_STATUS_OKAY) return status;
+        channel_free_ = space;
+        if (available != nullptr) *available = space;
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Bytes held in the coalescing buffer.
+     */
+    uint32_t pending() const {
+        return used_;
+    }
+
+    /**
+     *  Number of `flush()` calls that reached Microvisor.
+     */
+    uint32_t flushes() const {
+        return flushes_;
+    }
+
+    /**
+     *  Number of write NSC calls made, including probes.
+     */
+    uint32_t nscCalls() const {
+        return nsc_calls_;
+    }
+
+private:
+    void append(const uint8_t *data, uint32_t length) {
+        if (length == 0) return;
+        if (used_ == 0 && max_delay_us_ != 0) mvGetMicroseconds(&buffered_since_);
+        std::memcpy(buffer_ + used_, data, length);
+        used_ += length;
+    }
+
+    MvStatus stream(const uint8_t *data, uint32_t length, uint32_t *written) {
+        MvStatus status = mvWriteChannelStream(handle_, data, length, written);
+        nsc_calls_++;
+        if (status != MV_STATUS_OKAY) return status;
+        if (*written < length || *written >= channel_free_) {
+            channel_free_ = 0;
+        } else {
+            channel_free_ -= *written;
+        }
+        return MV_STATUS_OKAY;
+    }
+
+    MvChannelHandle handle_;
+    uint32_t flush_threshold_;
+    uint32_t max_delay_us_;
+    uint32_t used_ = 0;
+    uint32_t channel_free_ = 0;
+    uint64_t buffered_since_ = 0;
+    uint32_t flushes_ = 0;
+    uint32_t nsc_calls_ = 0;
+    uint8_t buffer_[BufferSize];
+};
+
+}
+
+#endif
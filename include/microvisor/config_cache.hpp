@@ -0,0 +1,603 @@
+#ifndef MV_CONFIG_CACHE_HPP
+#define MV_CONFIG_CACHE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "byte_span.hpp"
+#include "channel_limits.hpp"
+#include "external_flash.hpp"
+#include "hash.hpp"
+#include "mv_syscalls.h"
+
+namespace mv {
+
+// Microvisor does not document these sizes; they are estimates. A batch
+// that turns out too large is split and fetched again, so an estimate
+// that is too low costs a round trip rather than a failure.
+
+/// Most keys `mvSendConfigFetchRequest` accepts in one request.
+constexpr uint32_t kMaxConfigKeys = 16;
+/// Fixed cost of a serialised fetch request, and the per-key cost in
+/// addition to the key's length.
+constexpr uint32_t kConfigRequestOverhead = 8;
+constexpr uint32_t kConfigKeyOverhead = 12;
+/// Fixed cost of a fetch response in the receive buffer, and the per-item
+/// cost in addition to the value's length.
+constexpr uint32_t kConfigResponseOverhead = 8;
+constexpr uint32_t kConfigItemOverhead = 8;
+
+struct ConfigKey {
+    MvConfigKeyFetchScope scope;
+    MvConfigKeyFetchStore store;
+    ByteSpan key;
+};
+
+/**
+ *  Fetches config and secret values on behalf of any number of callers,
+ *  serving repeat requests from a cache and fetching the rest together.
+ *
+ *  `request()` answers at once while a key's cached value is younger than
+ *  the cache's time to live. Otherwise the key is queued, joining any
+ *  request for it already queued or in progress, and `poll()` fetches
+ *  queued keys up to `kMaxConfigKeys` per channel, so a burst of requests
+ *  at boot costs one or two round trips. Values that Microvisor reports as
+ *  not found are cached too. If a request has too many keys or its
+ *  response is too large for the receive buffer, the batch is split and
+ *  fetched again, and the batch limit is halved. Each fetch that succeeds
+ *  at the limit raises it by one key, back up to `kMaxConfigKeys`.
+ *
+ *  With `attachFlash()`, values from the config store are also kept in
+ *  external flash and loaded at start-up, so a restart need not fetch them
+ *  again while they are fresh. Saves alternate between the two halves of
+ *  the region and erase only the sectors the new copy needs. Secrets are
+ *  only ever cached in RAM. Ages are carried across restarts by wall time:
+ *  values loaded before `mvGetWallTime` is available are treated as
+ *  expired.
+ *
+ *  Fetch slot `i` uses notification tag `base_tag + i`. Route those tags
+ *  to `onNotification()` and call `poll()` from the main loop, as for
+ *  `HttpScheduler`, including when `nextOpenAt()` arrives. Channel opens
+ *  are paced the same way. Completions run from `request()` or `poll()`.
+ *
+ *  @tparam MaxEntries      Distinct keys cached.
+ *  @tparam MaxKeySize      Longest key, at most 255 bytes.
+ *  @tparam MaxValueSize    Longest value; longer ones fail with `MV_STATUS_INVALIDBUFFERSIZE`.
+ *  @tparam Channels        Fetches run at once.
+ *  @tparam MaxWaiters      Requests waiting for a fetch at once.
+ */
+template <uint32_t MaxEntries = 16, uint32_t MaxKeySize = 64, uint32_t MaxValueSize = 256, uint32_t Channels = 1,
+          uint32_t MaxWaiters = MaxEntries>
+class ConfigCache {
+    static_assert(MaxEntries > 0 && MaxEntries < 0xffff, "Entry indices are 16 bits");
+    static_assert(MaxKeySize > 0 && MaxKeySize <= 255, "Key lengths are stored in a byte");
+    static_assert(MaxValueSize <= 0xffff, "Value lengths are stored in 16 bits");
+    static_assert(Channels > 0 && Channels <= kMaxChannels, "Microvisor allows at most four channels");
+    static_assert(MaxWaiters > 0, "ConfigCache needs waiters");
+
+public:
+    /**
+     *  Called when a requested value is available. `status` is
+     *  `MV_STATUS_OKAY` when `result` is Microvisor's answer for the key;
+     *  `value` is only valid during the call.
+     */
+    using Completion = void (*)(void *context, MvStatus status, MvConfigKeyFetchResult result, ByteSpan value);
+
+    /**
+     *  @param ttl_us   How long a fetched value is served from the cache.
+     */
+    ConfigCache(MvNotificationHandle notification_handle, MvNetworkHandle network_handle, uint32_t base_tag, uint64_t ttl_us)
+        : notification_handle_(notification_handle), network_handle_(network_handle), base_tag_(base_tag), ttl_us_(ttl_us) {}
+
+    ConfigCache(const ConfigCache &) = delete;
+    ConfigCache &operator=(const ConfigCache &) = delete;
+
+    /**
+     *  Keep config store values in a flash region of at least two sectors,
+     *  loading what was saved there before. Call before the first request.
+     *
+     *  @retval MV_STATUS_INVALIDBUFFERALIGNMENT    `base` or `size` is not a whole number of sectors per copy.
+     *  @retval MV_STATUS_INVALIDBUFFERSIZE         One copy of the cache would not fit half the region.
+     */
+    MvStatus attachFlash(MvExternalFlashHandle flash, uint32_t base, uint32_t size) {
+        if (base % kFlashSectorSize != 0 || size % (2 * kFlashSectorSize) != 0) return MV_STATUS_INVALIDBUFFERALIGNMENT;
+        if (sizeof(SnapshotHeader) + MaxEntries * (sizeof(Record) + MaxKeySize + MaxValueSize) > size / 2) {
+            return MV_STATUS_INVALIDBUFFERSIZE;
+        }
+        flash_ = flash;
+        flash_base_ = base;
+        copy_size_ = size / 2;
+
+        SnapshotHeader headers[2];
+        for (uint32_t copy = 0; copy < 2; ++copy) {
+            MvStatus status = mvExternalFlashReadBlocking(flash_, copyStart(copy), sizeof(SnapshotHeader),
+                                                          reinterpret_cast<uint8_t *>(&headers[copy]));
+            if (status != MV_STATUS_OKAY) return status;
+        }
+        bool valid[2] = {headers[0].magic == kSnapshotMagic, headers[1].magic == kSnapshotMagic};
+        uint32_t newest = valid[1] && (!valid[0] || headers[1].sequence > headers[0].sequence) ? 1 : 0;
+        for (uint32_t attempt = 0; attempt < 2; ++attempt) {
+            uint32_t copy = attempt == 0 ? newest : 1 - newest;
+            if (!valid[copy]) continue;
+            sequence_ = headers[copy].sequence;
+            active_copy_ = copy;
+            if (load(copy, headers[copy])) break;
+        }
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Ask for a value. If it is cached and fresh, `done` is called before
+     *  this returns; otherwise it is called from a later `poll()`.
+     *
+     *  @retval MV_STATUS_INVALIDCONFIGKEY  The key is empty, too long or not printable ASCII.
+     *  @retval MV_STATUS_TOOMANYELEMENTS   No entry or waiter is free.
+     */
+    MvStatus request(const ConfigKey &key, Completion done, void *context = nullptr) {
+        if (!validKey(key.key)) return MV_STATUS_INVALIDCONFIGKEY;
+        uint32_t slot = find(key);
+        uint16_t index = table_[slot];
+        if (index != 0 && fresh(entries_[index - 1])) {
+            Entry &entry = entries_[index - 1];
+            hits_++;
+            done(context, MV_STATUS_OKAY, static_cast<MvConfigKeyFetchResult>(entry.record.result), value(entry));
+            return MV_STATUS_OKAY;
+        }
+
+        uint32_t waiter = 0;
+        while (waiter < MaxWaiters && waiters_[waiter].done != nullptr) ++waiter;
+        if (waiter == MaxWaiters) return MV_STATUS_TOOMANYELEMENTS;
+        if (index == 0) {
+            if (entry_count_ == MaxEntries) return MV_STATUS_TOOMANYELEMENTS;
+            index = static_cast<uint16_t>(++entry_count_);
+            Entry &entry = entries_[index - 1];
+            entry.record = Record{};
+            entry.record.scope = static_cast<uint8_t>(key.scope);
+            entry.record.store = static_cast<uint8_t>(key.store);
+            entry.record.key_length = static_cast<uint8_t>(key.key.length);
+            std::memcpy(entry.key, key.key.data, key.key.length);
+            table_[slot] = index;
+        }
+
+        Entry &entry = entries_[index - 1];
+        if (entry.fetch == Fetch::Idle) {
+            entry.fetch = Fetch::Wanted;
+            misses_++;
+        } else {
+            coalesced_++;
+        }
+        waiters_[waiter] = Waiter{static_cast<uint16_t>(index - 1), done, context};
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Read a cached value without fetching. Returns false if the key has
+     *  no cached value; `fresh`, if given, is set as `request()` would judge it.
+     */
+    bool lookup(const ConfigKey &key, ByteSpan *out, bool *is_fresh = nullptr) const {
+        if (!validKey(key.key)) return false;
+        uint16_t index = table_[find(key)];
+        if (index == 0 || !entries_[index - 1].cached || entries_[index - 1].record.result != MV_CONFIGKEYFETCHRESULT_OK) {
+            return false;
+        }
+        *out = value(entries_[index - 1]);
+        if (is_fresh != nullptr) *is_fresh = fresh(entries_[index - 1]);
+        return true;
+    }
+
+    /**
+     *  Complete flagged fetches, start fetches for queued keys and save
+     *  the cache to flash once nothing is left to fetch.
+     */
+    void poll() {
+        uint32_t ready = ready_.exchange(0, std::memory_order_acquire);
+        for (uint32_t i = 0; i < Channels; ++i) {
+            if ((ready & (1u << i)) != 0 && slots_[i].handle != nullptr) check(i);
+        }
+        start();
+        if (dirty_ && in_flight_ == 0 && !wanted()) save();
+    }
+
+    /**
+     *  `NotificationRing` handler for the cache's tags; `context` is the cache.
+     */
+    static void onNotification(void *context, const MvNotification &notification) {
+        ConfigCache *cache = static_cast<ConfigCache *>(context);
+        uint32_t slot = notification.tag - cache->base_tag_;
+        if (slot < Channels) cache->ready_.fetch_or(1u << slot, std::memory_order_release);
+    }
+
+    /**
+     *  Requests answered from the cache, requests that needed a fetch, and
+     *  requests that joined one already queued or in progress.
+     */
+    uint32_t hits() const {
+        return hits_;
+    }
+
+    uint32_t misses() const {
+        return misses_;
+    }
+
+    uint32_t coalesced() const {
+        return coalesced_;
+    }
+
+    /**
+     *  Fetch requests sent, and keys fetched by them.
+     */
+    uint32_t fetches() const {
+        return fetches_;
+    }
+
+    uint32_t keysFetched() const {
+        return keys_fetched_;
+    }
+
+    /**
+     *  Most keys the next fetch will carry.
+     */
+    uint32_t batchLimit() const {
+        return batch_limit_;
+    }
+
+    uint32_t rateLimited() const {
+        return opens_.rateLimited();
+    }
+
+    /**
+     *  When `poll()` may next open a channel for queued keys, in
+     *  `mvGetMicroseconds` time. A time already past, such as zero, means now.
+     */
+    uint64_t nextOpenAt() const {
+        return opens_.nextAt();
+    }
+
+private:
+    static constexpr uint32_t kSendBufferSize =
+        channelBufferSizeFor(kConfigRequestOverhead + kMaxConfigKeys * (kConfigKeyOverhead + MaxKeySize));
+    static constexpr uint32_t kReceiveBufferSize =
+        channelBufferSizeFor(kConfigResponseOverhead + kMaxConfigKeys * (kConfigItemOverhead + MaxValueSize));
+    static constexpr uint32_t kSnapshotMagic = 0x43464743;
+
+    static constexpr uint32_t slotCount() {
+        uint32_t slots = 1;
+        while (slots < 2 * MaxEntries) slots <<= 1;
+        return slots;
+    }
+
+    static constexpr uint32_t kSlots = slotCount();
+
+    enum class Fetch : uint8_t { Idle, Wanted, Fetching };
+
+    // Saved ahead of each entry's key and value in flash.
+    struct Record {
+        uint8_t scope;
+        uint8_t store;
+        uint8_t key_length;
+        uint8_t result;
+        uint16_t value_length;
+        uint16_t reserved;
+        uint64_t expires_wall;
+    };
+
+    struct SnapshotHeader {
+        uint32_t magic;
+        uint32_t sequence;
+        uint32_t count;
+        uint32_t crc;
+    };
+
+    struct Entry {
+        Record record = {};
+        uint8_t key[MaxKeySize];
+        uint8_t value[MaxValueSize];
+        uint64_t expires_at = 0;
+        bool cached = false;
+        Fetch fetch = Fetch::Idle;
+    };
+
+    struct Waiter {
+        uint16_t entry;
+        Completion done;
+        void *context;
+    };
+
+    struct Slot {
+        MvChannelHandle handle = nullptr;
+        uint32_t count = 0;
+        uint16_t entries[kMaxConfigKeys];
+    };
+
+    static uint64_t now() {
+        uint64_t microseconds;
+        mvGetMicroseconds(&microseconds);
+        return microseconds;
+    }
+
+    static bool validKey(ByteSpan key) {
+        if (key.empty() || key.length > MaxKeySize) return false;
+        for (uint32_t i = 0; i < key.length; ++i) {
+            if (key.data[i] <= 0x20 || key.data[i] >= 0x7f) return false;
+        }
+        return true;
+    }
+
+    static uint32_t hash(const ConfigKey &key) {
+        return fnv1a(key.key, static_cast<uint32_t>(key.scope) << 1 | static_cast<uint32_t>(key.store));
+    }
+
+    static ByteSpan value(const Entry &entry) {
+        return ByteSpan(entry.value, entry.record.value_length);
+    }
+
+    bool fresh(const Entry &entry) const {
+        return entry.cached && entry.fetch == Fetch::Idle && now() < entry.expires_at;
+    }
+
+    bool wanted() const {
+        for (uint32_t i = 0; i < entry_count_; ++i) {
+            if (entries_[i].fetch == Fetch::Wanted) return true;
+        }
+        return false;
+    }
+
+    // The table slot holding `key`, or the empty slot where it belongs.
+    uint32_t find(const ConfigKey &key) const {
+        for (uint32_t slot = hash(key) & (kSlots - 1);; slot = (slot + 1) & (kSlots - 1)) {
+            uint16_t index = table_[slot];
+            if (index == 0) return slot;
+            const Record &record = entries_[index - 1].record;
+            if (record.scope == key.scope && record.store == key.store &&
+                ByteSpan(entries_[index - 1].key, record.key_length) == key.key) {
+                return slot;
+            }
+        }
+    }
+
+    void complete(uint32_t index, MvStatus status) {
+        Entry &entry = entries_[index];
+        entry.fetch = Fetch::Idle;
+        MvConfigKeyFetchResult result = static_cast<MvConfigKeyFetchResult>(entry.record.result);
+        for (Waiter &waiter : waiters_) {
+            if (waiter.done == nullptr || waiter.entry != index) continue;
+            Completion done = waiter.done;
+            waiter.done = nullptr;
+            done(waiter.context, status, result, status == MV_STATUS_OKAY ? value(entry) : ByteSpan());
+        }
+    }
+
+    void fail(const Slot &slot, MvStatus status) {
+        for (uint32_t i = 0; i < slot.count; ++i) complete(slot.entries[i], status);
+    }
+
+    void requeue(const Slot &slot) {
+        for (uint32_t i = 0; i < slot.count; ++i) entries_[slot.entries[i]].fetch = Fetch::Wanted;
+    }
+
+    void start() {
+        uint64_t at = now();
+        for (uint32_t index = 0; index < Channels && opens_.ready(at); ++index) {
+            Slot &slot = slots_[index];
+            if (slot.handle != nullptr) continue;
+            slot.count = 0;
+            for (uint32_t i = 0; i < entry_count_ && slot.count < batch_limit_; ++i) {
+                if (entries_[i].fetch == Fetch::Wanted) slot.entries[slot.count++] = static_cast<uint16_t>(i);
+            }
+            if (slot.count == 0) return;
+
+            MvOpenChannelParams params = {};
+            params.version = 1;
+            params.v1.notification_handle = notification_handle_;
+            params.v1.notification_tag = base_tag_ + index;
+            params.v1.network_handle = network_handle_;
+            params.v1.receive_buffer = receive_buffers_[index];
+            params.v1.receive_buffer_len = kReceiveBufferSize;
+            params.v1.send_buffer = send_buffers_[index];
+            params.v1.send_buffer_len = kSendBufferSize;
+            params.v1.channel_type = MV_CHANNELTYPE_CONFIGFETCH;
+
+            MvStatus status = mvOpenChannel(&params, &slot.handle);
+            if (opens_.opened(now(), status)) {
+                // Transient: the keys stay queued until `nextOpenAt()`.
+                slot.handle = nullptr;
+                return;
+            }
+            if (status != MV_STATUS_OKAY) {
+                slot.handle = nullptr;
+                fail(slot, status);
+                continue;
+            }
+
+            MvConfigKeyToFetch keys[kMaxConfigKeys];
+            for (uint32_t i = 0; i < slot.count; ++i) {
+                const Entry &entry = entries_[slot.entries[i]];
+                keys[i] = MvConfigKeyToFetch{static_cast<MvConfigKeyFetchScope>(entry.record.scope),
+                                             static_cast<MvConfigKeyFetchStore>(entry.record.store),
+                                             MvSizedString{entry.key, entry.record.key_length}};
+            }
+            MvConfigKeyFetchParams request = {slot.count, keys};
+            status = mvSendConfigFetchRequest(slot.handle, &request);
+            if (status != MV_STATUS_OKAY) {
+                mvCloseChannel(&slot.handle);
+                slot.handle = nullptr;
+                if (status == MV_STATUS_TOOMANYCONFIGKEYS && slot.count > 1) {
+                    batch_limit_ = slot.count / 2;
+                } else {
+                    fail(slot, status);
+                }
+                continue;
+            }
+            for (uint32_t i = 0; i < slot.count; ++i) entries_[slot.entries[i]].fetch = Fetch::Fetching;
+            fetches_++;
+            in_flight_++;
+        }
+    }
+
+    void check(uint32_t index) {
+        Slot &slot = slots_[index];
+        MvConfigResponseData response = {};
+        MvStatus status = mvReadConfigFetchResponseData(slot.handle, &response);
+        if (status == MV_STATUS_RESPONSENOTPRESENT) return;
+
+        if (status != MV_STATUS_OKAY) {
+            fail(slot, status);
+        } else if (response.result == MV_CONFIGFETCHRESULT_RESPONSETOOLARGE) {
+            if (slot.count > 1) {
+                batch_limit_ = slot.count / 2;
+                requeue(slot);
+            } else {
+                fail(slot, MV_STATUS_INVALIDBUFFERSIZE);
+            }
+        } else {
+            if (slot.count == batch_limit_ && batch_limit_ < kMaxConfigKeys) batch_limit_++;
+            uint64_t expires_at = now() + ttl_us_;
+            for (uint32_t i = 0; i < slot.count; ++i) {
+                Entry &entry = entries_[slot.entries[i]];
+                MvConfigKeyFetchResult result = MV_CONFIGKEYFETCHRESULT_SERVERERROR;
+                uint32_t length = 0;
+                MvConfigResponseReadItemParams params = {i, &result, {entry.value, MaxValueSize, &length}};
+                status = i < response.num_items ? mvReadConfigResponseItem(slot.handle, &params) : MV_STATUS_INDEXINVALID;
+                if (status == MV_STATUS_OKAY) {
+                    entry.record.result = static_cast<uint8_t>(result);
+                    entry.record.value_length = static_cast<uint16_t>(length);
+                    // Server errors are reported but not cached.
+                    entry.cached = result != MV_CONFIGKEYFETCHRESULT_SERVERERROR;
+                    entry.expires_at = expires_at;
+                    if (entry.cached && entry.record.store == MV_CONFIGKEYFETCHSTORE_CONFIG) dirty_ = flash_ != nullptr;
+                    keys_fetched_++;
+                } else {
+                    entry.cached = false;
+                }
+                complete(slot.entries[i], status);
+            }
+        }
+        mvCloseChannel(&slot.handle);
+        slot.handle = nullptr;
+        in_flight_--;
+    }
+
+    uint32_t copyStart(uint32_t copy) const {
+        return flash_base_ + copy * copy_size_;
+    }
+
+    // Read one saved copy into empty entries, keeping them only if the
+    // copy's CRC matches.
+    bool load(uint32_t copy, const SnapshotHeader &header) {
+        if (header.count > MaxEntries) return false;
+        uint64_t wall = 0;
+        bool clock = mvGetWallTime(&wall) == MV_STATUS_OKAY;
+        uint64_t microseconds = now();
+
+        uint32_t address = copyStart(copy) + sizeof(SnapshotHeader);
+        uint32_t crc = 0;
+        for (uint32_t i = 0; i < header.count; ++i) {
+            Entry &entry = entries_[i];
+            MvStatus status = mvExternalFlashReadBlocking(flash_, address, sizeof(Record), reinterpret_cast<uint8_t *>(&entry.record));
+            if (status != MV_STATUS_OKAY || entry.record.key_length == 0 || entry.record.key_length > MaxKeySize ||
+                entry.record.value_length > MaxValueSize) {
+                return false;
+            }
+            address += sizeof(Record);
+            status = mvExternalFlashReadBlocking(flash_, address, entry.record.key_length, entry.key);
+            address += entry.record.key_length;
+            if (status == MV_STATUS_OKAY) status = mvExternalFlashReadBlocking(flash_, address, entry.record.value_length, entry.value);
+            address += entry.record.value_length;
+            if (status != MV_STATUS_OKAY) return false;
+            crc = crc32(ByteSpan(reinterpret_cast<const uint8_t *>(&entry.record), sizeof(Record)), crc);
+            crc = crc32(ByteSpan(entry.key, entry.record.key_length), crc);
+            crc = crc32(value(entry), crc);
+        }
+        if (crc != header.crc) return false;
+
+        for (uint32_t i = 0; i < header.count; ++i) {
+            Entry &entry = entries_[i];
+            ConfigKey key = {static_cast<MvConfigKeyFetchScope>(entry.record.scope),
+                             static_cast<MvConfigKeyFetchStore>(entry.record.store), ByteSpan(entry.key, entry.record.key_length)};
+            uint32_t slot = find(key);
+            if (table_[slot] != 0) continue;
+            table_[slot] = static_cast<uint16_t>(i + 1);
+            entry.cached = true;
+            entry.expires_at = clock && entry.record.expires_wall > wall ? microseconds + (entry.record.expires_wall - wall) : 0;
+        }
+        entry_count_ = header.count;
+        return true;
+    }
+
+    static bool persisted(const Entry &entry) {
+        return entry.cached && entry.record.store == MV_CONFIGKEYFETCHSTORE_CONFIG &&
+               entry.record.result == MV_CONFIGKEYFETCHRESULT_OK;
+    }
+
+    // Write every cached config store value to the inactive copy, header
+    // last, then make it the active one. Only the sectors the copy needs
+    // are erased: `load()` reads no further than the header's count.
+    void save() {
+        dirty_ = false;
+        uint32_t copy = 1 - active_copy_;
+        uint32_t size = sizeof(SnapshotHeader);
+        for (uint32_t i = 0; i < entry_count_; ++i) {
+            const Entry &entry = entries_[i];
+            if (persisted(entry)) size += sizeof(Record) + entry.record.key_length + entry.record.value_length;
+        }
+        uint32_t erase = (size + kFlashSectorSize - 1) / kFlashSectorSize * kFlashSectorSize;
+        if (mvExternalFlashEraseBlocking(flash_, copyStart(copy), erase) != MV_STATUS_OKAY) return;
+
+        uint64_t wall = 0;
+        bool clock = mvGetWallTime(&wall) == MV_STATUS_OKAY;
+        uint64_t microseconds = now();
+        uint32_t address = copyStart(copy) + sizeof(SnapshotHeader);
+        SnapshotHeader header = {kSnapshotMagic, sequence_ + 1, 0, 0};
+        for (uint32_t i = 0; i < entry_count_; ++i) {
+            Entry &entry = entries_[i];
+            if (!persisted(entry)) continue;
+            entry.record.expires_wall = clock && entry.expires_at > microseconds ? wall + (entry.expires_at - microseconds) : 0;
+            ByteSpan parts[3] = {ByteSpan(reinterpret_cast<const uint8_t *>(&entry.record), sizeof(Record)),
+                                 ByteSpan(entry.key, entry.record.key_length), value(entry)};
+            for (const ByteSpan &part : parts) {
+                if (part.empty()) continue;
+                if (mvExternalFlashWriteBlocking(flash_, address, part.length, part.data) != MV_STATUS_OKAY) return;
+                address += part.length;
+                header.crc = crc32(part, header.crc);
+            }
+            header.count++;
+        }
+        if (mvExternalFlashWriteBlocking(flash_, copyStart(copy), sizeof(header), reinterpret_cast<const uint8_t *>(&header)) != MV_STATUS_OKAY) {
+            return;
+        }
+        sequence_ = header.sequence;
+        active_copy_ = copy;
+    }
+
+    alignas(kChannelBufferAlignment) uint8_t send_buffers_[Channels][kSendBufferSize];
+    alignas(kChannelBufferAlignment) uint8_t receive_buffers_[Channels][kReceiveBufferSize];
+    MvNotificationHandle notification_handle_;
+    MvNetworkHandle network_handle_;
+    uint32_t base_tag_;
+    uint64_t ttl_us_;
+    Entry entries_[MaxEntries];
+    uint32_t entry_count_ = 0;
+    uint16_t table_[kSlots] = {};
+    Waiter waiters_[MaxWaiters] = {};
+    Slot slots_[Channels];
+    uint32_t batch_limit_ = kMaxConfigKeys;
+    uint32_t in_flight_ = 0;
+    MvExternalFlashHandle flash_ = nullptr;
+    uint32_t flash_base_ = 0;
+    uint32_t copy_size_ = 0;
+    uint32_t active_copy_ = 1;
+    uint32_t sequence_ = 0;
+    bool dirty_ = false;
+    uint32_t hits_ = 0;
+    uint32_t misses_ = 0;
+    uint32_t coalesced_ = 0;
+    uint32_t fetches_ = 0;
+    uint32_t keys_fetched_ = 0;
+    ChannelOpenPacer opens_;
+    std::atomic<uint32_t> ready_{0};
+};
+
+}
+
+#endif
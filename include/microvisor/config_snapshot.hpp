@@ -0,0 +1,348 @@
+#ifndef MV_CONFIG_SNAPSHOT_HPP
+#define MV_CONFIG_SNAPSHOT_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "byte_span.hpp"
+#include "config_cache.hpp"
+#include "hash.hpp"
+#include "mv_syscalls.h"
+
+namespace mv {
+
+enum class ConfigType : uint8_t { String, Integer, Boolean };
+
+/**
+ *  A key the application reads, and the type its value is decoded to.
+ */
+struct ConfigKeySpec {
+    const char *name;
+    uint32_t length;
+    ConfigType type;
+    MvConfigKeyFetchScope scope;
+    MvConfigKeyFetchStore store;
+};
+
+template <size_t N>
+constexpr ConfigKeySpec configString(const char (&name)[N], MvConfigKeyFetchScope scope = MV_CONFIGKEYFETCHSCOPE_DEVICE,
+                                     MvConfigKeyFetchStore store = MV_CONFIGKEYFETCHSTORE_CONFIG) {
+    return ConfigKeySpec{name, static_cast<uint32_t>(N - 1), ConfigType::String, scope, store};
+}
+
+template <size_t N>
+constexpr ConfigKeySpec configInteger(const char (&name)[N], MvConfigKeyFetchScope scope = MV_CONFIGKEYFETCHSCOPE_DEVICE,
+                                      MvConfigKeyFetchStore store = MV_CONFIGKEYFETCHSTORE_CONFIG) {
+    return ConfigKeySpec{name, static_cast<uint32_t>(N - 1), ConfigType::Integer, scope, store};
+}
+
+template <size_t N>
+constexpr ConfigKeySpec configBoolean(const char (&name)[N], MvConfigKeyFetchScope scope = MV_CONFIGKEYFETCHSCOPE_DEVICE,
+                                      MvConfigKeyFetchStore store = MV_CONFIGKEYFETCHSTORE_CONFIG) {
+    return ConfigKeySpec{name, static_cast<uint32_t>(N - 1), ConfigType::Boolean, scope, store};
+}
+
+/**
+ *  An application's config keys with a hash table over their names, built
+ *  at compile time by `configKeySet()`. The hash is seeded so that every
+ *  name has a slot of its own and a lookup costs one hash and one
+ *  comparison; a set for which no seed does so fails to compile.
+ *
+ *  `index()` is constexpr, so hot code can resolve names when it is
+ *  compiled and read values by index:
+ *
+ *      constexpr auto kKeys = mv::configKeySet(mv::configInteger("sample-ms"), mv::configBoolean("verbose"));
+ *      constexpr uint32_t kSampleMs = kKeys.index("sample-ms");
+ */
+template <uint32_t Count>
+struct ConfigKeySet {
+    static constexpr uint32_t slotCount() {
+        uint32_t slots = 1;
+        while (slots < 4 * Count) slots <<= 1;
+        return slots;
+    }
+
+    static constexpr uint32_t kSlots = slotCount();
+
+    ConfigKeySpec keys[Count];
+    // Key index plus one; zero marks an empty slot.
+    uint16_t slots[kSlots];
+    uint32_t seed;
+
+    static constexpr uint32_t size() {
+        return Count;
+    }
+
+    template <typename Char>
+    static constexpr uint32_t hash(uint32_t seed, const Char *name, uint32_t length) {
+        uint32_t hash = fnv1a(name, length, seed * 2654435769u);
+        return hash ^ (hash >> 16);
+    }
+
+    /**
+     *  The index of `name`, or `size()` if it is not in the set.
+     */
+    constexpr uint32_t index(const char *name) const {
+        uint32_t length = 0;
+        while (name[length] != '\0') ++length;
+        return lookup(name, length);
+    }
+
+    uint32_t find(ByteSpan name) const {
+        return lookup(name.data, name.length);
+    }
+
+    template <typename Char>
+    constexpr uint32_t lookup(const Char *name, uint32_t length) const {
+        for (uint32_t slot = hash(seed, name, length) & (kSlots - 1);; slot = (slot + 1) & (kSlots - 1)) {
+            if (slots[slot] == 0) return Count;
+            const ConfigKeySpec &key = keys[slots[slot] - 1];
+            bool equal = key.length == length;
+            for (uint32_t i = 0; equal && i < length; ++i) equal = static_cast<uint8_t>(key.name[i]) == static_cast<uint8_t>(name[i]);
+            if (equal) return slots[slot] - 1;
+        }
+    }
+
+    // Fill the table with `seed`, failing if two keys share a home slot.
+    constexpr bool place(uint32_t seed_in) {
+        seed = seed_in;
+        for (uint32_t slot = 0; slot < kSlots; ++slot) slots[slot] = 0;
+        for (uint32_t i = 0; i < Count; ++i) {
+            uint32_t slot = hash(seed, keys[i].name, keys[i].length) & (kSlots - 1);
+            if (slots[slot] != 0) return false;
+            slots[slot] = static_cast<uint16_t>(i + 1);
+        }
+        return true;
+    }
+};
+
+namespace detail {
+
+// Never defined and not constexpr: reaching it while a `ConfigKeySet` is
+// built at compile time stops compilation with this name in the error.
+void noPerfectSeedForConfigKeys();
+
+}
+
+/**
+ *  Build a `ConfigKeySet` from `configString()`, `configInteger()` and
+ *  `configBoolean()` specs. Use it to initialise a `constexpr` variable so
+ *  the seed search happens at compile time.
+ */
+template <typename... Specs>
+constexpr ConfigKeySet<sizeof...(Specs)> configKeySet(const Specs &...specs) {
+    ConfigKeySet<sizeof...(Specs)> set = {{specs...}, {}, 0};
+    for (uint32_t seed = 0; seed < 4096; ++seed) {
+        if (set.place(seed)) return set;
+    }
+    // Duplicate names never place; otherwise the set is too large for its table.
+    detail::noPerfectSeedForConfigKeys();
+    return set;
+}
+
+/**
+ *  The values of a `ConfigKeySet`, read from config fetch responses into
+ *  one arena and decoded once, so reads cost an array access.
+ *
+ *  Microvisor accepts `kMaxConfigKeys` keys per fetch, so a set is fetched
+ *  in `batches()`: send `request(batch)` on a config fetch channel and pass
+ *  the channel to `read()` once the response has arrived. Integers are
+ *  decimal, or hexadecimal with `0x`; booleans are `true`, `false`, `yes`,
+ *  `no`, `on`, `off`, `1` or `0`, ignoring case. A value that does not
+ *  decode as its key's type reads as the fallback, and `string()` still
+ *  returns its text.
+ *
+ *  The snapshot refers to its key set rather than copying it, so the set
+ *  must outlive it; make the set a `constexpr` variable at namespace scope.
+ *
+ *  @tparam Count       Keys in the set.
+ *  @tparam ArenaSize   Bytes for every value's text.
+ */
+template <uint32_t Count, uint32_t ArenaSize = 1024>
+class ConfigSnapshot {
+    static_assert(Count > 0, "ConfigSnapshot needs keys");
+
+public:
+    explicit ConfigSnapshot(const ConfigKeySet<Count> &keys) : keys_(keys) {
+        for (uint32_t i = 0; i < Count; ++i) {
+            const ConfigKeySpec &key = keys.keys[i];
+            fetch_[i] = MvConfigKeyToFetch{key.scope, key.store, MvSizedString{reinterpret_cast<const uint8_t *>(key.name), key.length}};
+        }
+    }
+
+    // A temporary set would be gone before the first read.
+    explicit ConfigSnapshot(const ConfigKeySet<Count> &&) = delete;
+
+    ConfigSnapshot(const ConfigSnapshot &) = delete;
+    ConfigSnapshot &operator=(const ConfigSnapshot &) = delete;
+
+    static constexpr uint32_t batches() {
+        return (Count + kMaxConfigKeys - 1) / kMaxConfigKeys;
+    }
+
+    /**
+     *  The fetch request for one batch of keys, valid for the snapshot's
+     *  lifetime.
+     */
+    MvConfigKeyFetchParams request(uint32_t batch = 0) const {
+        uint32_t first = batch * kMaxConfigKeys;
+        uint32_t count = Count - first < kMaxConfigKeys ? Count - first : kMaxConfigKeys;
+        return MvConfigKeyFetchParams{count, fetch_ + first};
+    }
+
+    /**
+     *  Read and decode the response to `request(batch)`.
+     *
+     *  @retval MV_STATUS_INVALIDBUFFERSIZE     The arena is full, or Microvisor reported the response too large for the channel.
+     *  @retval MV_STATUS_WRONGDATAREQUESTED    The response does not have an item per key of the batch.
+     */
+    MvStatus read(MvChannelHandle handle, uint32_t batch = 0) {
+        MvConfigResponseData response = {};
+        MvStatus status = mvReadConfigFetchResponseData(handle, &response);
+        if (status != MV_STATUS_OKAY) return status;
+        if (response.result != MV_CONFIGFETCHRESULT_OK) return MV_STATUS_INVALIDBUFFERSIZE;
+        MvConfigKeyFetchParams params = request(batch);
+        if (response.num_items != params.num_items) return MV_STATUS_WRONGDATAREQUESTED;
+
+        uint32_t first = batch * kMaxConfigKeys;
+        for (uint32_t i = 0; i < params.num_items; ++i) {
+            Slot &slot = slots_[first + i];
+            MvConfigKeyFetchResult result = MV_CONFIGKEYFETCHRESULT_SERVERERROR;
+            uint32_t length = 0;
+            MvConfigResponseReadItemParams item = {i, &result, {arena_ + used_, ArenaSize - used_, &length}};
+            status = mvReadConfigResponseItem(handle, &item);
+            if (status != MV_STATUS_OKAY) return status;
+            slot = Slot{};
+            slot.result = result;
+            slot.offset = used_;
+            slot.length = length;
+            used_ += length;
+            if (result == MV_CONFIGKEYFETCHRESULT_OK) decode(keys_.keys[first + i].type, slot);
+        }
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Forget every value, ready to read a new set of responses.
+     */
+    void clear() {
+        for (Slot &slot : slots_) slot = Slot{};
+        used_ = 0;
+    }
+
+    /**
+     *  The index of `name`, or `Count` if it is not in the set; prefer
+     *  `ConfigKeySet::index()` at compile time.
+     */
+    uint32_t find(ByteSpan name) const {
+        return keys_.find(name);
+    }
+
+    /**
+     *  Microvisor's answer for the key, or `MV_CONFIGKEYFETCHRESULT_KEYNOTFOUND`
+     *  if `index` is not in the set or the key has not been read.
+     */
+    MvConfigKeyFetchResult result(uint32_t index) const {
+        return index < Count ? slots_[index].result : MV_CONFIGKEYFETCHRESULT_KEYNOTFOUND;
+    }
+
+    /**
+     *  Whether the key was found and its value decoded as its type.
+     */
+    bool valid(uint32_t index) const {
+        return index < Count && slots_[index].valid;
+    }
+
+    ByteSpan string(uint32_t index) const {
+        if (index >= Count || slots_[index].result != MV_CONFIGKEYFETCHRESULT_OK) return ByteSpan();
+        return ByteSpan(arena_ + slots_[index].offset, slots_[index].length);
+    }
+
+    int64_t integer(uint32_t index, int64_t fallback = 0) const {
+        return valid(index) && keys_.keys[index].type == ConfigType::Integer ? slots_[index].integer : fallback;
+    }
+
+    bool boolean(uint32_t index, bool fallback = false) const {
+        return valid(index) && keys_.keys[index].type == ConfigType::Boolean ? slots_[index].boolean : fallback;
+    }
+
+    uint32_t bytesUsed() const {
+        return used_;
+    }
+
+private:
+    struct Slot {
+        MvConfigKeyFetchResult result = MV_CONFIGKEYFETCHRESULT_KEYNOTFOUND;
+        bool valid = false;
+        bool boolean = false;
+        int64_t integer = 0;
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+
+    static bool parseInteger(ByteSpan text, int64_t *out) {
+        uint32_t i = 0;
+        bool negative = false;
+        if (i < text.length && (text.data[i] == '-' || text.data[i] == '+')) negative = text.data[i++] == '-';
+        uint32_t base = 10;
+        if (i + 1 < text.length && text.data[i] == '0' && asciiLower(text.data[i + 1]) == 'x') {
+            base = 16;
+            i += 2;
+        }
+        if (i == text.length) return false;
+        uint64_t value = 0;
+        uint64_t limit = negative ? static_cast<uint64_t>(INT64_MAX) + 1 : static_cast<uint64_t>(INT64_MAX);
+        for (; i < text.length; ++i) {
+            uint8_t c = asciiLower(text.data[i]);
+            uint32_t digit;
+            if (c >= '0' && c <= '9') {
+                digit = c - '0';
+            } else if (base == 16 && c >= 'a' && c <= 'f') {
+                digit = c - 'a' + 10;
+            } else {
+                return false;
+            }
+            if (value > (limit - digit) / base) return false;
+            value = value * base + digit;
+        }
+        *out = negative ? static_cast<int64_t>(0 - value) : static_cast<int64_t>(value);
+        return true;
+    }
+
+    static bool parseBoolean(ByteSpan text, bool *out) {
+        static const char *const kTrue[] = {"true", "yes", "on", "1"};
+        static const char *const kFalse[] = {"false", "no", "off", "0"};
+        for (uint32_t i = 0; i < 4; ++i) {
+            if (equalsIgnoreCase(text, ByteSpan(kTrue[i])) || equalsIgnoreCase(text, ByteSpan(kFalse[i]))) {
+                *out = equalsIgnoreCase(text, ByteSpan(kTrue[i]));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void decode(ConfigType type, Slot &slot) {
+        ByteSpan text(arena_ + slot.offset, slot.length);
+        switch (type) {
+            case ConfigType::String:
+                slot.valid = true;
+                break;
+            case ConfigType::Integer:
+                slot.valid = parseInteger(text, &slot.integer);
+                break;
+            case ConfigType::Boolean:
+                slot.valid = parseBoolean(text, &slot.boolean);
+                break;
+        }
+    }
+
+    const ConfigKeySet<Count> &keys_;
+    MvConfigKeyToFetch fetch_[Count];
+    Slot slots_[Count];
+    uint8_t arena_[ArenaSize];
+    uint32_t used_ = 0;
+};
+
+}
+
+#endif
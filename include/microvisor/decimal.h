@@ -0,0 +1,23 @@
+#ifndef MV_DECIMAL_H
+#define MV_DECIMAL_H
+
+#include <stdint.h>
+
+/**
+ *  Append `value` in decimal to the `length` bytes already in `buffer`,
+ *  writing no further than `size`, and return the new length. A number
+ *  that does not fit is cut short. Shared by the C trace code and the
+ *  C++ helpers, so it is a header-only C function.
+ */
+static inline uint32_t mvAppendDecimal(char *buffer, uint32_t length, uint32_t size, uint64_t value) {
+    char digits[20];
+    uint32_t count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (count > 0 && length < size) buffer[length++] = digits[--count];
+    return length;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef MV_EXTERNAL_FLASH_HPP
+#define MV_EXTERNAL_FLASH_HPP
+
+#include <cstdint>
+
+#include "byte_span.hpp"
+#include "hash.hpp"
+#include "mv_syscalls.h"
+
+namespace mv {
+
+/// External flash erase granularity: `mvExternalFlashEraseBlocking` takes
+/// addresses and lengths aligned to this.
+constexpr uint32_t kFlashSectorSize = 4096;
+
+}
+
+#endif
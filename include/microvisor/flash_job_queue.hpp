@@ -0,0 +1,226 @@
+#ifndef MV_FLASH_JOB_QUEUE_HPP
+#define MV_FLASH_JOB_QUEUE_HPP
+
+#include <atomic>
+#include <cstdint>
+
+#include "byte_span.hpp"
+#include "external_flash.hpp"
+#include "mv_syscalls.h"
+
+namespace mv {
+
+/**
+ *  Queues external flash reads, writes and erases and runs them a slice
+ *  at a time from the main loop, so no single call blocks for long.
+ *
+ *  Jobs may be submitted from anywhere, interrupt handlers included, as
+ *  the blocking calls themselves cannot be. `poll()` runs one slice of at
+ *  most one sector (4096 bytes, an erase sector) per step, and keeps
+ *  stepping until its time budget is spent, so large erases spread over
+ *  many passes of the main loop.
+ *
+ *  Reads go before writes and erases, but never before an earlier write
+ *  or erase to the bytes they read. Writes and erases run in the order
+ *  they were submitted. A job's completion runs from `poll()` once its
+ *  last slice is done or a slice fails; its buffer must stay valid until
+ *  then.
+ *
+ *  @tparam Capacity    Jobs queued or running at once.
+ */
+template <uint32_t Capacity = 8>
+class FlashJobQueue {
+public:
+    using Completion = void (*)(void *context, MvStatus status);
+
+    explicit FlashJobQueue(MvExternalFlashHandle flash) : flash_(flash) {}
+
+    FlashJobQueue(const FlashJobQueue &) = delete;
+    FlashJobQueue &operator=(const FlashJobQueue &) = delete;
+
+    /**
+     *  @retval MV_STATUS_TOOMANYELEMENTS   `Capacity` jobs are already queued.
+     */
+    MvStatus read(uint32_t address, uint32_t length, uint8_t *out, Completion done, void *context = nullptr) {
+        if (out == nullptr && length != 0) return MV_STATUS_PARAMETERFAULT;
+        return submit(kRead, address, length, out, nullptr, done, context);
+    }
+
+    MvStatus write(uint32_t address, ByteSpan data, Completion done, void *context = nullptr) {
+        if (data.data == nullptr && data.length != 0) return MV_STATUS_PARAMETERFAULT;
+        return submit(kWrite, address, data.length, nullptr, data.data, done, context);
+    }
+
+    /**
+     *  @retval MV_STATUS_INVALIDBUFFERALIGNMENT    `address` or `length` is not sector aligned.
+     */
+    MvStatus erase(uint32_t address, uint32_t length, Completion done, void *context = nullptr) {
+        if (address % kFlashSectorSize != 0 || length % kFlashSectorSize != 0) return MV_STATUS_INVALIDBUFFERALIGNMENT;
+        return submit(kErase, address, length, nullptr, nullptr, done, context);
+    }
+
+    /**
+     *  Run slices until `budget_us` has passed, or until no job is left.
+     *  At least one slice runs if any job is queued. Call from the main
+     *  loop.
+     *
+     *  @returns    Slices run.
+     */
+    uint32_t poll(uint32_t budget_us = 0) {
+        uint64_t start;
+        mvGetMicroseconds(&start);
+        uint32_t steps = 0;
+        for (;;) {
+            uint32_t index = next();
+            if (index == Capacity) break;
+            step(jobs_[index]);
+            steps++;
+            uint64_t now;
+            mvGetMicroseconds(&now);
+            if (now - start >= budget_us) break;
+        }
+        return steps;
+    }
+
+    /**
+     *  Whether no job is queued or running.
+     */
+    bool idle() const {
+        for (const Job &job : jobs_) {
+            if (job.state.load(std::memory_order_acquire) != kFree) return false;
+        }
+        return true;
+    }
+
+    /**
+     *  Slices run, and read slices run ahead of an earlier write or erase.
+     */
+    uint32_t slices() const {
+        return slices_;
+    }
+
+    uint32_t readsAhead() const {
+        return reads_ahead_;
+    }
+
+    /**
+     *  Jobs refused because the queue was full.
+     */
+    uint32_t rejected() const {
+        return rejected_.load(std::memory_order_relaxed);
+    }
+
+private:
+    enum Type : uint8_t { kRead, kWrite, kErase };
+    enum State : uint8_t { kFree, kClaimed, kQueued };
+
+    struct Job {
+        std::atomic<uint8_t> state{kFree};
+        Type type = kRead;
+        uint32_t sequence = 0;
+        uint32_t address = 0;
+        uint32_t length = 0;
+        uint32_t done = 0;
+        uint8_t *out = nullptr;
+        const uint8_t *in = nullptr;
+        Completion completion = nullptr;
+        void *context = nullptr;
+    };
+
+    // Claim a free slot with a compare-and-swap, so producers at several
+    // interrupt priorities can submit at once.
+    MvStatus submit(Type type, uint32_t address, uint32_t length, uint8_t *out, const uint8_t *in, Completion done, void *context) {
+        for (Job &job : jobs_) {
+            uint8_t expected = kFree;
+            if (!job.state.compare_exchange_strong(expected, kClaimed, std::memory_order_acquire)) continue;
+            job.type = type;
+            job.sequence = sequence_.fetch_add(1, std::memory_order_relaxed);
+            job.address = address;
+            job.length = length;
+            job.done = 0;
+            job.out = out;
+            job.in = in;
+            job.completion = done;
+            job.context = context;
+            job.state.store(kQueued, std::memory_order_release);
+            return MV_STATUS_OKAY;
+        }
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        return MV_STATUS_TOOMANYELEMENTS;
+    }
+
+    static bool before(const Job &a, const Job &b) {
+        return static_cast<int32_t>(a.sequence - b.sequence) < 0;
+    }
+
+    static bool overlaps(const Job &a, const Job &b) {
+        return a.address < b.address + b.length && b.address < a.address + a.length;
+    }
+
+    // The job to step next: the oldest read that no earlier write or erase
+    // overlaps, or else the oldest write or erase.
+    uint32_t next() {
+        uint32_t oldest_change = Capacity;
+        for (uint32_t i = 0; i < Capacity; ++i) {
+            if (jobs_[i].state.load(std::memory_order_acquire) != kQueued || jobs_[i].type == kRead) continue;
+            if (oldest_change == Capacity || before(jobs_[i], jobs_[oldest_change])) oldest_change = i;
+        }
+        uint32_t read = Capacity;
+        for (uint32_t i = 0; i < Capacity; ++i) {
+            const Job &job = jobs_[i];
+            if (job.state.load(std::memory_order_acquire) != kQueued || job.type != kRead) continue;
+            if (read != Capacity && before(jobs_[read], job)) continue;
+            bool blocked = false;
+            for (uint32_t j = 0; j < Capacity && !blocked; ++j) {
+                const Job &change = jobs_[j];
+                blocked = change.state.load(std::memory_order_acquire) == kQueued && change.type != kRead &&
+                          before(change, job) && overlaps(change, job);
+            }
+            if (!blocked) read = i;
+        }
+        if (read != Capacity) {
+            if (oldest_change != Capacity && before(jobs_[oldest_change], jobs_[read])) reads_ahead_++;
+            return read;
+        }
+        return oldest_change;
+    }
+
+    void step(Job &job) {
+        uint32_t offset = job.done;
+        uint32_t slice = job.length - offset < kFlashSectorSize ? job.length - offset : kFlashSectorSize;
+        MvStatus status = MV_STATUS_OKAY;
+        if (slice != 0) {
+            switch (job.type) {
+                case kRead:
+                    status = mvExternalFlashReadBlocking(flash_, job.address + offset, slice, job.out + offset);
+                    break;
+                case kWrite:
+                    status = mvExternalFlashWriteBlocking(flash_, job.address + offset, slice, job.in + offset);
+                    break;
+                case kErase:
+                    status = mvExternalFlashEraseBlocking(flash_, job.address + offset, slice);
+                    break;
+            }
+            slices_++;
+        }
+        job.done += slice;
+        if (status == MV_STATUS_OKAY && job.done < job.length) return;
+
+        // Free the slot before the completion runs, so it may submit again.
+        Completion done = job.completion;
+        void *context = job.context;
+        job.state.store(kFree, std::memory_order_release);
+        if (done != nullptr) done(context, status);
+    }
+
+    MvExternalFlashHandle flash_;
+    Job jobs_[Capacity];
+    std::atomic<uint32_t> sequence_{0};
+    std::atomic<uint32_t> rejected_{0};
+    uint32_t slices_ = 0;
+    uint32_t reads_ahead_ = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,665 @@
+#ifndef MV_FLASH_KV_STORE_HPP
+#define MV_FLASH_KV_STORE_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#include "byte_span.hpp"
+#include "external_flash.hpp"
+#include "hash.hpp"
+#include "mv_syscalls.h"
+
+namespace mv {
+
+/**
+ *  A key-value store in a region of external flash, written as a log so
+ *  an update costs one flash write rather than a sector erase.
+ *
+ *  Each `put()` or `erase()` appends a record with a CRC. A RAM index maps
+ *  each key's hash to its newest record, so `get()` is one flash read.
+ *  Sectors are written in turn around the region and collected in the
+ *  same order: collection copies the oldest sector's live records to the
+ *  head of the log, writes a checkpoint of the index and releases the
+ *  sector for reuse. Every sector is therefore erased equally often, and
+ *  its erase count is kept in its header. `open()` loads the newest
+ *  checkpoint and replays only the records written since.
+ *
+ *  Call `collect()` from the main loop while `collectionDue()`, so that
+ *  `put()` seldom has to collect a sector itself before it can write.
+ *
+ *  @tparam MaxKeys         Keys stored at once.
+ *  @tparam MaxKeySize      Longest key, at most 255 bytes.
+ *  @tparam MaxValueSize    Longest value.
+ */
+template <uint32_t MaxKeys = 128, uint32_t MaxKeySize = 32, uint32_t MaxValueSize = 256>
+class FlashKvStore {
+    struct SectorHeader {
+        uint32_t magic;
+        uint32_t sequence;
+        uint32_t erase_count;
+        uint32_t reserved;
+    };
+
+    struct RecordHeader {
+        uint16_t magic;
+        uint8_t type;
+        uint8_t key_length;
+        uint16_t value_length;
+        uint16_t reserved;
+        // Over the rest of the header, the key and the value.
+        uint32_t crc;
+    };
+
+    struct Entry {
+        uint32_t hash;
+        uint32_t address;
+        uint16_t value_length;
+        uint8_t key_length;
+        uint8_t used;
+    };
+
+    struct CheckpointHeader {
+        uint32_t tail_sector;
+        uint32_t count;
+    };
+
+    static constexpr uint32_t kSectorPayload = kFlashSectorSize - sizeof(SectorHeader);
+    static constexpr uint32_t kMaxRecordSize = (sizeof(RecordHeader) + MaxKeySize + MaxValueSize + 3) & ~3u;
+    static constexpr uint32_t kMaxCheckpointSize = sizeof(RecordHeader) + sizeof(CheckpointHeader) + MaxKeys * sizeof(Entry);
+
+    static_assert(sizeof(SectorHeader) == 16 && sizeof(RecordHeader) == 12 && sizeof(Entry) == 12, "Flash layout must not be padded");
+    static_assert(MaxKeys > 0 && MaxKeySize > 0 && MaxKeySize <= 255, "Keys are 1 to 255 bytes");
+    static_assert(kMaxRecordSize <= kSectorPayload / 2, "Records must fit half a flash sector");
+    static_assert(kMaxCheckpointSize <= kSectorPayload, "The index must fit one flash sector");
+
+public:
+    /**
+     *  @param base Start of the store's flash region, sector aligned.
+     *  @param size Size of the region, at least four sectors.
+     */
+    FlashKvStore(MvExternalFlashHandle flash, uint32_t base, uint32_t size)
+        : flash_(flash), base_(base), sectors_(size / kFlashSectorSize) {}
+
+    FlashKvStore(const FlashKvStore &) = delete;
+    FlashKvStore &operator=(const FlashKvStore &) = delete;
+
+    /**
+     *  Rebuild the index from flash, or start a store if the region holds
+     *  none.
+     *
+     *  @retval MV_STATUS_INVALIDBUFFERALIGNMENT    `base` is not sector aligned.
+     *  @retval MV_STATUS_INVALIDBUFFERSIZE         The region is smaller than four sectors.
+     */
+    MvStatus open() {
+        if (base_ % kFlashSectorSize != 0) return MV_STATUS_INVALIDBUFFERALIGNMENT;
+        if (sectors_ < kReserveSectors + 2) return MV_STATUS_INVALIDBUFFERSIZE;
+        open_ = false;
+        clearIndex();
+
+        // The log is a run of sectors with consecutive sequence numbers,
+        // beginning at the lowest. Sectors before the tail are free.
+        uint32_t oldest = sectors_;
+        uint32_t sequence = 0;
+        for (uint32_t sector = 0; sector < sectors_; ++sector) {
+            SectorHeader header;
+            MvStatus status = readSectorHeader(sector, &header);
+            if (status != MV_STATUS_OKAY) return status;
+            if (header.magic == kSectorMagic && (oldest == sectors_ || header.sequence < sequence)) {
+                oldest = sector;
+                sequence = header.sequence;
+            }
+        }
+        if (oldest == sectors_) {
+            sequence_ = 0;
+            MvStatus status = openSector(0);
+            if (status != MV_STATUS_OKAY) return status;
+            tail_sector_ = 0;
+            gc_cursor_ = head_;
+            open_ = true;
+            return MV_STATUS_OKAY;
+        }
+        uint32_t run = 1;
+        for (; run < sectors_; ++run) {
+            SectorHeader header;
+            MvStatus status = readSectorHeader((oldest + run) % sectors_, &header);
+            if (status != MV_STATUS_OKAY) return status;
+            if (header.magic != kSectorMagic || header.sequence != sequence + run) break;
+        }
+        sequence_ = sequence + run - 1;
+        head_sector_ = (oldest + run - 1) % sectors_;
+
+        // Start from the newest checkpoint that loads, or replay everything.
+        tail_sector_ = oldest;
+        uint32_t replay_sector = oldest;
+        uint32_t replay_from = sectorStart(oldest) + sizeof(SectorHeader);
+        for (uint32_t back = run; back-- > 0;) {
+            uint32_t sector = (oldest + back) % sectors_;
+            uint32_t found = 0;
+            uint32_t end;
+            MvStatus status = walk(sector, sectorStart(sector) + sizeof(SectorHeader), end, [&](uint32_t address, const RecordHeader &header, const uint8_t *) {
+                if (header.type == kCheckpoint) found = address;
+                return true;
+            });
+            if (status != MV_STATUS_OKAY) return status;
+            if (found == 0) continue;
+            uint32_t next;
+            status = loadCheckpoint(found, &next);
+            if (status == MV_STATUS_OKAY) {
+                replay_sector = sector;
+                replay_from = next;
+                break;
+            }
+            if (status != MV_STATUS_LATEFAULT) return status;
+            clearIndex();
+        }
+
+        for (uint32_t sector = replay_sector;; sector = (sector + 1) % sectors_) {
+            uint32_t address = sector == replay_sector ? replay_from : sectorStart(sector) + sizeof(SectorHeader);
+            MvStatus status = walk(sector, address, head_, [&](uint32_t at, const RecordHeader &header, const uint8_t *record) {
+                replay_status_ = replay(at, header, record);
+                return replay_status_ == MV_STATUS_OKAY;
+            });
+            if (status == MV_STATUS_OKAY) status = replay_status_;
+            if (status != MV_STATUS_OKAY) return status;
+            if (sector == head_sector_) break;
+        }
+        gc_cursor_ = sectorStart(tail_sector_) + sizeof(SectorHeader);
+        open_ = true;
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Copy the value of `key` into `value`.
+     *
+     *  @retval MV_STATUS_UNAVAILABLE       The store holds no value for `key`.
+     *  @retval MV_STATUS_INVALIDBUFFERSIZE `size` is smaller than the value; `*length` is its size.
+     */
+    MvStatus get(ByteSpan key, uint8_t *value, uint32_t size, uint32_t *length) {
+        if (!open_) return MV_STATUS_UNAVAILABLE;
+        uint32_t slot;
+        MvStatus status = find(key, &slot);
+        if (status != MV_STATUS_OKAY) return status;
+        if (!table_[slot].used) return MV_STATUS_UNAVAILABLE;
+        const Entry &entry = table_[slot];
+        *length = entry.value_length;
+        if (entry.value_length > size) return MV_STATUS_INVALIDBUFFERSIZE;
+        return read(entry.address + sizeof(RecordHeader) + entry.key_length, entry.value_length, value);
+    }
+
+    /**
+     *  Store `value` under `key`, replacing any value it had.
+     *
+     *  @retval MV_STATUS_INPUTTOOLONG      The key is empty or longer than `MaxKeySize`, or the value longer than `MaxValueSize`.
+     *  @retval MV_STATUS_TOOMANYELEMENTS   The store already holds `MaxKeys` keys, or the region is full.
+     */
+    MvStatus put(ByteSpan key, ByteSpan value) {
+        if (!open_) return MV_STATUS_UNAVAILABLE;
+        if (key.empty() || key.length > MaxKeySize || value.length > MaxValueSize) return MV_STATUS_INPUTTOOLONG;
+        uint32_t slot;
+        MvStatus status = find(key, &slot);
+        if (status != MV_STATUS_OKAY) return status;
+        bool replacing = table_[slot].used != 0;
+        if (!replacing && count_ == MaxKeys) return MV_STATUS_TOOMANYELEMENTS;
+        uint32_t size = recordSize(key.length, value.length);
+        uint32_t replaced = replacing ? recordSize(table_[slot].key_length, table_[slot].value_length) : 0;
+        if (live_bytes_ - replaced + size > capacity()) return MV_STATUS_TOOMANYELEMENTS;
+
+        uint32_t address;
+        status = append(kPut, key, value, &address);
+        if (status != MV_STATUS_OKAY) return status;
+        // Collection during the append may have moved the entry.
+        status = find(key, &slot);
+        if (status != MV_STATUS_OKAY) return status;
+        set(slot, hash(key), address, key.length, value.length);
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Remove `key`. Erasing a key that is not stored succeeds.
+     */
+    MvStatus erase(ByteSpan key) {
+        if (!open_) return MV_STATUS_UNAVAILABLE;
+        if (key.empty() || key.length > MaxKeySize) return MV_STATUS_INPUTTOOLONG;
+        uint32_t slot;
+        MvStatus status = find(key, &slot);
+        if (status != MV_STATUS_OKAY || !table_[slot].used) return status;
+        uint32_t address;
+        status = append(kErase, key, ByteSpan(), &address);
+        if (status != MV_STATUS_OKAY) return status;
+        status = find(key, &slot);
+        if (status == MV_STATUS_OKAY && table_[slot].used) remove(slot);
+        return status;
+    }
+
+    /**
+     *  Whether the log is close enough to filling the region that the
+     *  oldest sector should be collected.
+     */
+    bool collectionDue() const {
+        return open_ && freeSectors() <= kReserveSectors + 1;
+    }
+
+    /**
+     *  Collect the oldest sector, moving at most `max_records` live records
+     *  per call. The sector is released once every record has been moved
+     *  and a checkpoint written.
+     */
+    MvStatus collect(uint32_t max_records = UINT32_MAX) {
+        if (!open_ || tail_sector_ == head_sector_) return MV_STATUS_OKAY;
+        uint32_t moved = 0;
+        bool stopped = false;
+        MvStatus result = MV_STATUS_OKAY;
+        uint32_t end;
+        MvStatus status = walk(tail_sector_, gc_cursor_, end, [&](uint32_t address, const RecordHeader &header, const uint8_t *record) {
+            if (header.type != kPut || record == nullptr) return true;
+            uint32_t slot = locate(address);
+            if (slot == kSlots) return true;
+            uint32_t size = recordSize(header.key_length, header.value_length);
+            if (moved == max_records || (result = reserve(size, true)) != MV_STATUS_OKAY ||
+                (result = write(head_, ByteSpan(record, size))) != MV_STATUS_OKAY) {
+                stopped = true;
+                return false;
+            }
+            table_[slot].address = head_;
+            head_ += size;
+            moved++;
+            relocated_++;
+            return true;
+        });
+        if (status != MV_STATUS_OKAY) return status;
+        if (stopped) {
+            gc_cursor_ = end;
+            return result;
+        }
+
+        // Every live record has moved: record the new tail, then release the sector.
+        uint32_t next = (tail_sector_ + 1) % sectors_;
+        status = writeCheckpoint(next);
+        if (status != MV_STATUS_OKAY) return status;
+        tail_sector_ = next;
+        gc_cursor_ = sectorStart(next) + sizeof(SectorHeader);
+        collections_++;
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Write a checkpoint now, so the next `open()` replays less.
+     */
+    MvStatus checkpoint() {
+        if (!open_) return MV_STATUS_UNAVAILABLE;
+        return writeCheckpoint(tail_sector_);
+    }
+
+    /**
+     *  How many times `sector` of the region has been erased by the store.
+     */
+    MvStatus eraseCount(uint32_t sector, uint32_t *count) {
+        if (sector >= sectors_) return MV_STATUS_ADDRESSOUTOFRANGE;
+        SectorHeader header;
+        MvStatus status = readSectorHeader(sector, &header);
+        if (status != MV_STATUS_OKAY) return status;
+        *count = header.magic == kSectorMagic ? header.erase_count : 0;
+        return MV_STATUS_OKAY;
+    }
+
+    uint32_t keys() const {
+        return count_;
+    }
+
+    /**
+     *  Bytes of current records, and the most the region can hold while
+     *  keeping room to collect.
+     */
+    uint32_t liveBytes() const {
+        return live_bytes_;
+    }
+
+    uint32_t capacity() const {
+        return (sectors_ - kReserveSectors - 1) * (kSectorPayload - kMaxRecordSize);
+    }
+
+    uint32_t freeSectors() const {
+        return sectors_ - (head_sector_ + sectors_ - tail_sector_) % sectors_ - 1;
+    }
+
+    /**
+     *  Sectors collected and records moved by collection since `open()`.
+     */
+    uint32_t collections() const {
+        return collections_;
+    }
+
+    uint32_t relocated() const {
+        return relocated_;
+    }
+
+private:
+    static constexpr uint32_t kSectorMagic = 0x53564b4d;
+    static constexpr uint16_t kRecordMagic = 0x564b;
+    static constexpr uint8_t kPut = 1;
+    static constexpr uint8_t kErase = 2;
+    static constexpr uint8_t kCheckpoint = 3;
+    // Sectors kept free for collection: one for moved records, one for
+    // the checkpoint that releases the collected sector.
+    static constexpr uint32_t kReserveSectors = 2;
+    static constexpr uint32_t kCrcStart = 2;
+    static constexpr uint32_t kCrcSpan = 6;
+
+    static constexpr uint32_t slotCount() {
+        uint32_t slots = 1;
+        while (slots < 2 * MaxKeys) slots <<= 1;
+        return slots;
+    }
+
+    static constexpr uint32_t kSlots = slotCount();
+
+    static constexpr uint32_t recordSize(uint32_t key_length, uint32_t value_length) {
+        return (static_cast<uint32_t>(sizeof(RecordHeader)) + key_length + value_length + 3) & ~3u;
+    }
+
+    static uint32_t hash(ByteSpan key) {
+        return fnv1a(key);
+    }
+
+    static uint32_t headerCrc(const RecordHeader &header) {
+        return crc32(ByteSpan(reinterpret_cast<const uint8_t *>(&header) + kCrcStart, kCrcSpan));
+    }
+
+    uint32_t sectorStart(uint32_t sector) const {
+        return base_ + sector * kFlashSectorSize;
+    }
+
+    uint32_t sectorEnd(uint32_t sector) const {
+        return sectorStart(sector) + kFlashSectorSize;
+    }
+
+    MvStatus read(uint32_t address, uint32_t length, uint8_t *out) {
+        if (length == 0) return MV_STATUS_OKAY;
+        return mvExternalFlashReadBlocking(flash_, address, length, out);
+    }
+
+    MvStatus write(uint32_t address, ByteSpan data) {
+        if (data.empty()) return MV_STATUS_OKAY;
+        return mvExternalFlashWriteBlocking(flash_, address, data.length, data.data);
+    }
+
+    MvStatus readSectorHeader(uint32_t sector, SectorHeader *header) {
+        return read(sectorStart(sector), sizeof(*header), reinterpret_cast<uint8_t *>(header));
+    }
+
+    // Erase `sector`, carrying its erase count forward, and make it the head.
+    MvStatus openSector(uint32_t sector) {
+        SectorHeader header;
+        MvStatus status = readSectorHeader(sector, &header);
+        if (status != MV_STATUS_OKAY) return status;
+        uint32_t erase_count = (header.magic == kSectorMagic ? header.erase_count : 0) + 1;
+        status = mvExternalFlashEraseBlocking(flash_, sectorStart(sector), kFlashSectorSize);
+        if (status != MV_STATUS_OKAY) return status;
+        header = SectorHeader{kSectorMagic, sequence_ + 1, erase_count, 0xffffffffu};
+        status = write(sectorStart(sector), ByteSpan(reinterpret_cast<const uint8_t *>(&header), sizeof(header)));
+        if (status != MV_STATUS_OKAY) return status;
+        sequence_++;
+        head_sector_ = sector;
+        head_ = sectorStart(sector) + sizeof(SectorHeader);
+        return MV_STATUS_OKAY;
+    }
+
+    // Make room for `size` bytes at the head. Writes by the store itself
+    // may use the reserve; others collect first if they would need it.
+    MvStatus reserve(uint32_t size, bool collecting) {
+        if (head_ + size <= sectorEnd(head_sector_)) return MV_STATUS_OKAY;
+        for (uint32_t attempt = 0; !collecting && freeSectors() <= kReserveSectors; ++attempt) {
+            if (attempt == sectors_) return MV_STATUS_TOOMANYELEMENTS;
+            MvStatus status = collect();
+            if (status != MV_STATUS_OKAY) return status;
+        }
+        if (freeSectors() == 0) return MV_STATUS_TOOMANYELEMENTS;
+        return openSector((head_sector_ + 1) % sectors_);
+    }
+
+    MvStatus append(uint8_t type, ByteSpan key, ByteSpan value, uint32_t *address) {
+        uint32_t size = recordSize(key.length, value.length);
+        MvStatus status = reserve(size, false);
+        if (status != MV_STATUS_OKAY) return status;
+
+        RecordHeader header = {kRecordMagic, type, static_cast<uint8_t>(key.length), static_cast<uint16_t>(value.length), 0xffff, 0};
+        header.crc = crc32(value, crc32(key, headerCrc(header)));
+        std::memcpy(buffer_, &header, sizeof(header));
+        std::memcpy(buffer_ + sizeof(header), key.data, key.length);
+        if (!value.empty()) std::memcpy(buffer_ + sizeof(header) + key.length, value.data, value.length);
+        std::memset(buffer_ + sizeof(header) + key.length + value.length, 0xff, size - sizeof(header) - key.length - value.length);
+        status = write(head_, ByteSpan(buffer_, size));
+        if (status != MV_STATUS_OKAY) {
+            // The record may be partly programmed: leave the rest of the sector.
+            head_ = sectorEnd(head_sector_);
+            return status;
+        }
+        *address = head_;
+        head_ += size;
+        return MV_STATUS_OKAY;
+    }
+
+    // Call `visit(address, header, record)` for each record in `sector`
+    // from `address`, until it returns false. `record` is the whole record
+    // when it fits the buffer, and null otherwise. `end` receives where
+    // the walk stopped: the next record, the end of the written records,
+    // or the sector's end after an interrupted write.
+    template <typename Visit>
+    MvStatus walk(uint32_t sector, uint32_t address, uint32_t &end, Visit &&visit) {
+        uint32_t limit = sectorEnd(sector);
+        uint32_t block_at = 0;
+        uint32_t block_length = 0;
+        while (address + sizeof(RecordHeader) <= limit) {
+            if (address < block_at || address + sizeof(RecordHeader) > block_at + block_length) {
+                block_at = address;
+                block_length = limit - address < sizeof(buffer_) ? limit - address : sizeof(buffer_);
+                MvStatus status = read(block_at, block_length, buffer_);
+                if (status != MV_STATUS_OKAY) return status;
+            }
+            RecordHeader header;
+            std::memcpy(&header, buffer_ + (address - block_at), sizeof(header));
+            if (header.magic == 0xffff && header.type == 0xff && header.key_length == 0xff) break;
+            uint32_t size = recordSize(header.key_length, header.value_length);
+            if (header.magic != kRecordMagic || address + size > limit) {
+                address = limit;
+                break;
+            }
+
+            const uint8_t *record = nullptr;
+            if (size <= sizeof(buffer_)) {
+                if (address + size > block_at + block_length) {
+                    block_at = address;
+                    block_length = limit - address < sizeof(buffer_) ? limit - address : sizeof(buffer_);
+                    MvStatus status = read(block_at, block_length, buffer_);
+                    if (status != MV_STATUS_OKAY) return status;
+                }
+                record = buffer_ + (address - block_at);
+                uint32_t body = header.key_length + header.value_length;
+                if (crc32(ByteSpan(record + sizeof(header), body), headerCrc(header)) != header.crc) {
+                    address = limit;
+                    break;
+                }
+            }
+            if (!visit(address, header, record)) break;
+            address += size;
+        }
+        end = address;
+        return MV_STATUS_OKAY;
+    }
+
+    void clearIndex() {
+        for (Entry &entry : table_) entry = Entry{};
+        count_ = 0;
+        live_bytes_ = 0;
+    }
+
+    // The slot holding `key`, or the empty slot where it belongs.
+    MvStatus find(ByteSpan key, uint32_t *slot_out) {
+        uint32_t key_hash = hash(key);
+        for (uint32_t slot = key_hash & (kSlots - 1);; slot = (slot + 1) & (kSlots - 1)) {
+            const Entry &entry = table_[slot];
+            if (!entry.used) {
+                *slot_out = slot;
+                return MV_STATUS_OKAY;
+            }
+            if (entry.hash != key_hash || entry.key_length != key.length) continue;
+            MvStatus status = read(entry.address + sizeof(RecordHeader), key.length, key_buffer_);
+            if (status != MV_STATUS_OKAY) return status;
+            if (std::memcmp(key_buffer_, key.data, key.length) == 0) {
+                *slot_out = slot;
+                return MV_STATUS_OKAY;
+            }
+        }
+    }
+
+    // The slot whose entry refers to the record at `address`, or `kSlots`.
+    uint32_t locate(uint32_t address) const {
+        for (uint32_t slot = 0; slot < kSlots; ++slot) {
+            if (table_[slot].used && table_[slot].address == address) return slot;
+        }
+        return kSlots;
+    }
+
+    void set(uint32_t slot, uint32_t key_hash, uint32_t address, uint32_t key_length, uint32_t value_length) {
+        Entry &entry = table_[slot];
+        if (entry.used) {
+            live_bytes_ -= recordSize(entry.key_length, entry.value_length);
+        } else {
+            count_++;
+        }
+        entry = Entry{key_hash, address, static_cast<uint16_t>(value_length), static_cast<uint8_t>(key_length), 1};
+        live_bytes_ += recordSize(key_length, value_length);
+    }
+
+    // Linear-probing deletion: pull later members of the cluster back so
+    // no lookup is cut short by the hole.
+    void remove(uint32_t hole) {
+        live_bytes_ -= recordSize(table_[hole].key_length, table_[hole].value_length);
+        count_--;
+        table_[hole].used = 0;
+        for (uint32_t slot = (hole + 1) & (kSlots - 1); table_[slot].used; slot = (slot + 1) & (kSlots - 1)) {
+            uint32_t want = table_[slot].hash & (kSlots - 1);
+            bool movable = hole <= slot ? (want <= hole || want > slot) : (want <= hole && want > slot);
+            if (movable) {
+                table_[hole] = table_[slot];
+                table_[slot].used = 0;
+                hole = slot;
+            }
+        }
+    }
+
+    MvStatus replay(uint32_t address, const RecordHeader &header, const uint8_t *record) {
+        if (header.type == kCheckpoint || record == nullptr) return MV_STATUS_OKAY;
+        ByteSpan key(record + sizeof(RecordHeader), header.key_length);
+        uint32_t slot;
+        MvStatus status = find(key, &slot);
+        if (status != MV_STATUS_OKAY) return status;
+        if (header.type == kPut) {
+            if (!table_[slot].used && count_ == MaxKeys) return MV_STATUS_TOOMANYELEMENTS;
+            set(slot, hash(key), address, header.key_length, header.value_length);
+        } else if (header.type == kErase && table_[slot].used) {
+            remove(slot);
+        }
+        return MV_STATUS_OKAY;
+    }
+
+    // The index is written in two passes, the first to compute the CRC, so
+    // the header can go first and an interrupted checkpoint is detectable.
+    MvStatus writeCheckpoint(uint32_t tail_sector) {
+        CheckpointHeader checkpoint = {tail_sector, count_};
+        uint32_t length = sizeof(checkpoint) + count_ * sizeof(Entry);
+        uint32_t size = recordSize(0, length);
+        MvStatus status = reserve(size, true);
+        if (status != MV_STATUS_OKAY) return status;
+
+        RecordHeader header = {kRecordMagic, kCheckpoint, 0, static_cast<uint16_t>(length), 0xffff, 0};
+        uint32_t crc = crc32(ByteSpan(reinterpret_cast<const uint8_t *>(&checkpoint), sizeof(checkpoint)), headerCrc(header));
+        for (const Entry &entry : table_) {
+            if (entry.used) crc = crc32(ByteSpan(reinterpret_cast<const uint8_t *>(&entry), sizeof(entry)), crc);
+        }
+        header.crc = crc;
+
+        uint32_t address = head_;
+        std::memcpy(buffer_, &header, sizeof(header));
+        std::memcpy(buffer_ + sizeof(header), &checkpoint, sizeof(checkpoint));
+        uint32_t filled = sizeof(header) + sizeof(checkpoint);
+        for (uint32_t slot = 0; slot <= kSlots; ++slot) {
+            if (slot == kSlots || filled + sizeof(Entry) > sizeof(buffer_)) {
+                status = write(address, ByteSpan(buffer_, filled));
+                if (status != MV_STATUS_OKAY) {
+                    head_ = sectorEnd(head_sector_);
+                    return status;
+                }
+                address += filled;
+                filled = 0;
+            }
+            if (slot < kSlots && table_[slot].used) {
+                std::memcpy(buffer_ + filled, &table_[slot], sizeof(Entry));
+                filled += sizeof(Entry);
+            }
+        }
+        head_ += size;
+        return MV_STATUS_OKAY;
+    }
+
+    // Load the checkpoint at `address` into the index. Returns
+    // `MV_STATUS_LATEFAULT` if its CRC does not match.
+    MvStatus loadCheckpoint(uint32_t address, uint32_t *next) {
+        RecordHeader header;
+        CheckpointHeader checkpoint;
+        MvStatus status = read(address, sizeof(header), reinterpret_cast<uint8_t *>(&header));
+        if (status == MV_STATUS_OKAY) {
+            status = read(address + sizeof(header), sizeof(checkpoint), reinterpret_cast<uint8_t *>(&checkpoint));
+        }
+        if (status != MV_STATUS_OKAY) return status;
+        if (checkpoint.count > MaxKeys || checkpoint.tail_sector >= sectors_ ||
+            header.value_length != sizeof(checkpoint) + checkpoint.count * sizeof(Entry)) {
+            return MV_STATUS_LATEFAULT;
+        }
+
+        uint32_t crc = crc32(ByteSpan(reinterpret_cast<const uint8_t *>(&checkpoint), sizeof(checkpoint)), headerCrc(header));
+        uint32_t at = address + sizeof(header) + sizeof(checkpoint);
+        for (uint32_t i = 0; i < checkpoint.count;) {
+            uint32_t batch = checkpoint.count - i;
+            if (batch > sizeof(buffer_) / sizeof(Entry)) batch = sizeof(buffer_) / sizeof(Entry);
+            status = read(at, batch * sizeof(Entry), buffer_);
+            if (status != MV_STATUS_OKAY) return status;
+            crc = crc32(ByteSpan(buffer_, batch * sizeof(Entry)), crc);
+            for (uint32_t j = 0; j < batch; ++j) {
+                Entry entry;
+                std::memcpy(&entry, buffer_ + j * sizeof(Entry), sizeof(entry));
+                uint32_t slot = entry.hash & (kSlots - 1);
+                while (table_[slot].used) slot = (slot + 1) & (kSlots - 1);
+                set(slot, entry.hash, entry.address, entry.key_length, entry.value_length);
+            }
+            at += batch * sizeof(Entry);
+            i += batch;
+        }
+        if (crc != header.crc) return MV_STATUS_LATEFAULT;
+        tail_sector_ = checkpoint.tail_sector;
+        *next = address + recordSize(0, header.value_length);
+        return MV_STATUS_OKAY;
+    }
+
+    MvExternalFlashHandle flash_;
+    uint32_t base_;
+    uint32_t sectors_;
+    bool open_ = false;
+    uint32_t sequence_ = 0;
+    uint32_t head_sector_ = 0;
+    uint32_t head_ = 0;
+    uint32_t tail_sector_ = 0;
+    uint32_t gc_cursor_ = 0;
+    MvStatus replay_status_ = MV_STATUS_OKAY;
+    Entry table_[kSlots] = {};
+    uint32_t count_ = 0;
+    uint32_t live_bytes_ = 0;
+    uint32_t collections_ = 0;
+    uint32_t relocated_ = 0;
+    uint8_t key_buffer_[MaxKeySize];
+    uint8_t buffer_[kMaxRecordSize];
+};
+
+}
+
+#endif
@@ -0,0 +1,310 @@
+#ifndef MV_FLASH_PAGE_CACHE_HPP
+#define MV_FLASH_PAGE_CACHE_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#include "byte_span.hpp"
+#include "external_flash.hpp"
+#include "mv_syscalls.h"
+
+namespace mv {
+
+/**
+ *  An LRU cache of 4 KiB external flash pages, taking the place of the
+ *  blocking read, write and erase calls for code that makes many small
+ *  accesses.
+ *
+ *  A miss reads the whole page. A miss on the page after the previous
+ *  miss's read is taken as sequential and reads up to `ReadAhead` further
+ *  pages in the same call.
+ *
+ *  Writes are held in the cache: they clear bits in the cached page as
+ *  programming clears bits in flash, so reads see what flash will hold.
+ *  Each page's written bytes are programmed as one range when the page is
+ *  evicted or at `flush()`, which also joins dirty neighbouring pages into
+ *  one write. Data not yet flushed is lost on reset; call `flush()` where
+ *  it must be durable.
+ *
+ *  Like the calls it wraps, the cache must not be used from an interrupt.
+ *
+ *  @tparam Pages       Pages cached, each taking 4 KiB of RAM.
+ *  @tparam ReadAhead   Pages read beyond a sequential miss, fewer than `Pages`.
+ */
+template <uint32_t Pages = 4, uint32_t ReadAhead = 1>
+class FlashPageCache {
+    static_assert(Pages > 0 && ReadAhead < Pages, "The cache must hold a miss and its read-ahead");
+
+public:
+    /**
+     *  @param size The flash's `MvExternalFlashInfo` size, which bounds read-ahead.
+     */
+    FlashPageCache(MvExternalFlashHandle flash, uint32_t size) : flash_(flash), size_(size) {}
+
+    FlashPageCache(const FlashPageCache &) = delete;
+    FlashPageCache &operator=(const FlashPageCache &) = delete;
+
+    /**
+     *  Read `length` bytes at `address`, including any writes not yet flushed.
+     */
+    MvStatus read(uint32_t address, uint32_t length, uint8_t *out) {
+        if (static_cast<uint64_t>(address) + length > size_) return MV_STATUS_ADDRESSOUTOFRANGE;
+        while (length > 0) {
+            uint32_t slot;
+            MvStatus status = page(address, true, &slot);
+            if (status != MV_STATUS_OKAY) return status;
+            uint32_t offset = address % kFlashSectorSize;
+            uint32_t chunk = kFlashSectorSize - offset < length ? kFlashSectorSize - offset : length;
+            std::memcpy(out, pages_[slot] + offset, chunk);
+            out += chunk;
+            address += chunk;
+            length -= chunk;
+        }
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Program `data` at `address`. The write reaches flash when its page
+     *  is evicted or flushed.
+     */
+    MvStatus write(uint32_t address, ByteSpan data) {
+        if (static_cast<uint64_t>(address) + data.length > size_) return MV_STATUS_ADDRESSOUTOFRANGE;
+        const uint8_t *in = data.data;
+        uint32_t length = data.length;
+        while (length > 0) {
+            uint32_t slot;
+            MvStatus status = page(address, false, &slot);
+            if (status != MV_STATUS_OKAY) return status;
+            uint32_t offset = address % kFlashSectorSize;
+            uint32_t chunk = kFlashSectorSize - offset < length ? kFlashSectorSize - offset : length;
+            for (uint32_t i = 0; i < chunk; ++i) pages_[slot][offset + i] &= in[i];
+            Slot &entry = slots_[slot];
+            if (entry.dirty_from == entry.dirty_to) {
+                entry.dirty_from = offset;
+                entry.dirty_to = offset + chunk;
+            } else {
+                if (offset < entry.dirty_from) entry.dirty_from = offset;
+                if (offset + chunk > entry.dirty_to) entry.dirty_to = offset + chunk;
+            }
+            writes_++;
+            in += chunk;
+            address += chunk;
+            length -= chunk;
+        }
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Erase whole sectors, discarding any cached writes to them.
+     */
+    MvStatus erase(uint32_t address, uint32_t length) {
+        if (address % kFlashSectorSize != 0 || length % kFlashSectorSize != 0) return MV_STATUS_INVALIDBUFFERALIGNMENT;
+        for (Slot &slot : slots_) {
+            if (slot.valid && slot.address >= address && slot.address - address < length) slot = Slot{};
+        }
+        if (last_fetch_end_ > address && last_fetch_end_ - address <= length) last_fetch_end_ = kNoPage;
+        start();
+        return timed(mvExternalFlashEraseBlocking(flash_, address, length));
+    }
+
+    /**
+     *  Program every cached write.
+     */
+    MvStatus flush() {
+        for (uint32_t slot = 0; slot < Pages; ++slot) {
+            if (!dirty(slot)) continue;
+            // Join the following slots while they hold the next page and
+            // the written range runs on across the page boundary.
+            uint32_t last = slot;
+            while (last + 1 < Pages && slots_[last].dirty_to == kFlashSectorSize && dirty(last + 1) &&
+                   slots_[last + 1].address == slots_[last].address + kFlashSectorSize && slots_[last + 1].dirty_from == 0) {
+                last++;
+            }
+            MvStatus status = program(slot, last);
+            if (status != MV_STATUS_OKAY) return status;
+            slot = last;
+        }
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Drop every cached page without flushing, after something else has
+     *  written the flash.
+     */
+    void invalidate() {
+        for (Slot &slot : slots_) slot = Slot{};
+        last_fetch_end_ = kNoPage;
+    }
+
+    /**
+     *  Page lookups served from the cache and from flash.
+     */
+    uint32_t hits() const {
+        return hits_;
+    }
+
+    uint32_t misses() const {
+        return misses_;
+    }
+
+    /**
+     *  Pages read ahead of a sequential miss.
+     */
+    uint32_t readAhead() const {
+        return read_ahead_;
+    }
+
+    /**
+     *  Calls to `write()` per page, and the flash writes that carried them.
+     */
+    uint32_t writes() const {
+        return writes_;
+    }
+
+    uint32_t flashWrites() const {
+        return flash_writes_;
+    }
+
+    /**
+     *  Blocking flash calls made, the time spent in them, and the longest.
+     */
+    uint32_t flashCalls() const {
+        return flash_calls_;
+    }
+
+    uint64_t flashTimeUs() const {
+        return flash_time_us_;
+    }
+
+    uint32_t maxFlashCallUs() const {
+        return max_flash_call_us_;
+    }
+
+private:
+    static constexpr uint32_t kNoPage = 0xffffffffu;
+
+    struct Slot {
+        uint32_t address = 0;
+        uint32_t last_use = 0;
+        uint16_t dirty_from = 0;
+        uint16_t dirty_to = 0;
+        bool valid = false;
+    };
+
+    bool dirty(uint32_t slot) const {
+        return slots_[slot].valid && slots_[slot].dirty_from != slots_[slot].dirty_to;
+    }
+
+    // `start()` and `timed()` bracket each blocking call.
+    void start() {
+        mvGetMicroseconds(&begin_us_);
+    }
+
+    MvStatus timed(MvStatus status) {
+        uint64_t now;
+        mvGetMicroseconds(&now);
+        uint32_t elapsed = static_cast<uint32_t>(now - begin_us_);
+        flash_calls_++;
+        flash_time_us_ += elapsed;
+        if (elapsed > max_flash_call_us_) max_flash_call_us_ = elapsed;
+        return status;
+    }
+
+    // Program the written ranges of `first` to `last`, which hold
+    // consecutive pages, in one call.
+    MvStatus program(uint32_t first, uint32_t last) {
+        uint32_t from = slots_[first].dirty_from;
+        uint32_t length = (last - first) * kFlashSectorSize + slots_[last].dirty_to - from;
+        start();
+        MvStatus status = timed(mvExternalFlashWriteBlocking(flash_, slots_[first].address + from, length, pages_[first] + from));
+        if (status != MV_STATUS_OKAY) return status;
+        flash_writes_++;
+        for (uint32_t slot = first; slot <= last; ++slot) slots_[slot].dirty_from = slots_[slot].dirty_to = 0;
+        return MV_STATUS_OKAY;
+    }
+
+    // Find the slot holding the page containing `address`, reading it in
+    // on a miss, with read-ahead if `reading` continues a sequential read.
+    MvStatus page(uint32_t address, bool reading, uint32_t *slot_out) {
+        uint32_t page_address = address - address % kFlashSectorSize;
+        uint32_t found = lookup(page_address);
+        if (found < Pages) {
+            hits_++;
+            slots_[found].last_use = ++clock_;
+            *slot_out = found;
+            return MV_STATUS_OKAY;
+        }
+        misses_++;
+
+        uint32_t run = 1;
+        if (reading && page_address == last_fetch_end_) {
+            while (run <= ReadAhead && page_address + (run + 1) * kFlashSectorSize <= size_ &&
+                   lookup(page_address + run * kFlashSectorSize) == Pages) {
+                run++;
+            }
+        }
+
+        // Evict the least recently used run of adjacent slots.
+        uint32_t first = 0;
+        uint32_t best = 0xffffffffu;
+        for (uint32_t start = 0; start + run <= Pages; ++start) {
+            uint32_t newest = 0;
+            for (uint32_t slot = start; slot < start + run; ++slot) {
+                uint32_t use = slots_[slot].valid ? slots_[slot].last_use : 0;
+                if (use > newest) newest = use;
+            }
+            if (newest < best) {
+                best = newest;
+                first = start;
+            }
+        }
+        for (uint32_t slot = first; slot < first + run; ++slot) {
+            if (dirty(slot)) {
+                MvStatus status = program(slot, slot);
+                if (status != MV_STATUS_OKAY) return status;
+            }
+            slots_[slot] = Slot{};
+        }
+
+        start();
+        MvStatus status = timed(mvExternalFlashReadBlocking(flash_, page_address, run * kFlashSectorSize, pages_[first]));
+        if (status != MV_STATUS_OKAY) return status;
+        clock_++;
+        for (uint32_t i = 0; i < run; ++i) {
+            slots_[first + i].address = page_address + i * kFlashSectorSize;
+            slots_[first + i].valid = true;
+            slots_[first + i].last_use = clock_;
+        }
+        read_ahead_ += run - 1;
+        if (reading) last_fetch_end_ = page_address + run * kFlashSectorSize;
+        *slot_out = first;
+        return MV_STATUS_OKAY;
+    }
+
+    uint32_t lookup(uint32_t page_address) const {
+        for (uint32_t slot = 0; slot < Pages; ++slot) {
+            if (slots_[slot].valid && slots_[slot].address == page_address) return slot;
+        }
+        return Pages;
+    }
+
+    MvExternalFlashHandle flash_;
+    uint32_t size_;
+    Slot slots_[Pages];
+    uint32_t clock_ = 0;
+    uint32_t last_fetch_end_ = kNoPage;
+    uint64_t begin_us_ = 0;
+    uint32_t hits_ = 0;
+    uint32_t misses_ = 0;
+    uint32_t read_ahead_ = 0;
+    uint32_t writes_ = 0;
+    uint32_t flash_writes_ = 0;
+    uint32_t flash_calls_ = 0;
+    uint64_t flash_time_us_ = 0;
+    uint32_t max_flash_call_us_ = 0;
+    uint8_t pages_[Pages][kFlashSectorSize];
+};
+
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef MV_HASH_HPP
+#define MV_HASH_HPP
+
+#include <cstdint>
+
+#include "byte_span.hpp"
+
+namespace mv {
+
+struct Crc32Table {
+    uint32_t entries[256];
+};
+
+constexpr Crc32Table makeCrc32Table() {
+    Crc32Table table = {};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ ((crc & 1) != 0 ? 0xedb88320u : 0);
+        table.entries[i] = crc;
+    }
+    return table;
+}
+
+inline constexpr Crc32Table kCrc32Table = makeCrc32Table();
+
+/**
+ *  CRC-32 (IEEE 802.3), for checking records kept in external flash.
+ *  Pass the result of one call as `crc` to continue over further bytes.
+ */
+inline uint32_t crc32(ByteSpan data, uint32_t crc = 0) {
+    crc = ~crc;
+    for (uint32_t i = 0; i < data.length; ++i) crc = kCrc32Table.entries[(crc ^ data.data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+/// The 32-bit FNV-1a offset basis, the hash of no bytes.
+constexpr uint32_t kFnv1aBasis = 2166136261u;
+
+/**
+ *  Add one byte to a 32-bit FNV-1a hash, for callers that transform bytes
+ *  as they hash them.
+ */
+constexpr uint32_t fnv1aStep(uint32_t hash, uint8_t byte) {
+    return (hash ^ byte) * 16777619u;
+}
+
+/**
+ *  32-bit FNV-1a, for hash tables and tokens. A non-zero `seed` is mixed
+ *  into the basis, giving a different hash of the same bytes.
+ */
+template <typename Char>
+constexpr uint32_t fnv1a(const Char *data, uint32_t length, uint32_t seed = 0) {
+    uint32_t hash = kFnv1aBasis ^ seed;
+    for (uint32_t i = 0; i < length; ++i) hash = fnv1aStep(hash, static_cast<uint8_t>(data[i]));
+    return hash;
+}
+
+constexpr uint32_t fnv1a(ByteSpan data, uint32_t seed = 0) {
+    return fnv1a(data.data, data.length, seed);
+}
+
+}
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef MV_HTTP_BODY_READER_HPP
+#define MV_HTTP_BODY_READER_HPP
+
+#include <cstdint>
+
+#include "byte_span.hpp"
+#include "mv_syscalls.h"
+
+namespace mv {
+
+/**
+ *  Reads an HTTP response body in fixed-size chunks through two alternating
+ *  buffers, so bodies of any length can be consumed with `2 * ChunkSize`
+ *  bytes of RAM.
+ *
+ *  The chunk returned by `next()` stays valid until the following `next()`,
+ *  while `prefetch()` fills the other buffer. Call `prefetch()` when the
+ *  application would otherwise be idle, for example while waiting on a
+ *  flash write of the current chunk, and the next `next()` returns without
+ *  an NSC call. `next()` fetches the chunk itself if it was not prefetched.
+ *
+ *  @tparam ChunkSize   Bytes per `mvReadHttpResponseBody` call.
+ */
+template <uint32_t ChunkSize = 512>
+class HttpBodyReader {
+    static_assert(ChunkSize > 0, "HttpBodyReader needs a chunk size");
+
+public:
+    HttpBodyReader() = default;
+    HttpBodyReader(const HttpBodyReader &) = delete;
+    HttpBodyReader &operator=(const HttpBodyReader &) = delete;
+
+    /**
+     *  Start reading the response waiting on `handle`, and fetch the first chunk.
+     *
+     *  @retval MV_STATUS_REQUESTUNSUCCESSFUL The response's `result` is not `MV_HTTPRESULT_OK`.
+     */
+    MvStatus begin(MvChannelHandle handle) {
+        handle_ = handle;
+        offset_ = 0;
+        fetched_ = 0;
+        ready_ = false;
+        MvStatus status = mvReadHttpResponseData(handle_, &data_);
+        if (status != MV_STATUS_OKAY) return status;
+        if (data_.result != MV_HTTPRESULT_OK) return MV_STATUS_REQUESTUNSUCCESSFUL;
+        return prefetch();
+    }
+
+    /**
+     *  Fill the idle buffer with the chunk after the current one, if that
+     *  has not been done already.
+     */
+    MvStatus prefetch() {
+        if (ready_ || fetched_ == data_.body_length) return MV_STATUS_OKAY;
+        uint32_t length = chunkAt(fetched_);
+        uint8_t *buffer = buffers_[current_ ^ 1];
+        MvStatus status = mvReadHttpResponseBody(handle_, fetched_, buffer, length);
+        if (status != MV_STATUS_OKAY) return status;
+        ready_length_ = length;
+        fetched_ += length;
+        ready_ = true;
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Move to the next chunk. `chunk` is empty once the body is exhausted.
+     */
+    MvStatus next(ByteSpan *chunk) {
+        MvStatus status = prefetch();
+        if (status != MV_STATUS_OKAY) return status;
+        if (!ready_) {
+            *chunk = ByteSpan();
+            return MV_STATUS_OKAY;
+        }
+        current_ ^= 1;
+        ready_ = false;
+        offset_ = fetched_ - ready_length_;
+        *chunk = ByteSpan(buffers_[current_], ready_length_);
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Pass every remaining chunk to `consumer`, called as
+     *  `MvStatus consumer(ByteSpan chunk, uint32_t offset)`, prefetching the
+     *  following chunk first. Stops at the first status other than
+     *  `MV_STATUS_OKAY`.
+     */
+    template <typename Consumer>
+    MvStatus forEach(Consumer &&consumer) {
+        ByteSpan chunk;
+        for (;;) {
+            MvStatus status = next(&chunk);
+            if (status != MV_STATUS_OKAY || chunk.empty()) return status;
+            status = prefetch();
+            if (status != MV_STATUS_OKAY) return status;
+            status = consumer(chunk, offset_);
+            if (status != MV_STATUS_OKAY) return status;
+        }
+    }
+
+    const MvHttpResponseData &response() const {
+        return data_;
+    }
+
+    /**
+     *  Body offset of the chunk last returned by `next()`.
+     */
+    uint32_t offset() const {
+        return offset_;
+    }
+
+    /**
+     *  Body bytes not yet returned by `next()`.
+     */
+    uint32_t remaining() const {
+        return data_.body_length - fetched_ + (ready_ ? ready_length_ : 0);
+    }
+
+private:
+    uint32_t chunkAt(uint32_t offset) const {
+        uint32_t left = data_.body_length - offset;
+        return left < ChunkSize ? left : ChunkSize;
+    }
+
+    MvChannelHandle handle_ = nullptr;
+    MvHttpResponseData data_ = {};
+    uint32_t offset_ = 0;
+    uint32_t fetched_ = 0;
+    uint32_t ready_length_ = 0;
+    uint32_t current_ = 1;
+    bool ready_ = false;
+    uint8_t buffers_[2][ChunkSize];
+};
+
+}
+
+#endif
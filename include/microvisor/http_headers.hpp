@@ -0,0 +1,182 @@
+#ifndef MV_HTTP_HEADERS_HPP
+#define MV_HTTP_HEADERS_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#include "byte_span.hpp"
+#include "hash.hpp"
+#include "mv_syscalls.h"
+
+namespace mv {
+
+/**
+ *  The headers of an HTTP response, read once into an arena and indexed
+ *  by name.
+ *
+ *  `read()` makes one `mvReadHttpResponseHeader` call per header, letting
+ *  each write into the zeroed tail of the arena so its length is found
+ *  from the first NUL after it. Names and values are split at the first
+ *  colon with surrounding whitespace trimmed, and names are entered into
+ *  an open-addressed table hashed without regard to ASCII case, so
+ *  `find()` costs no NSC calls.
+ *
+ *  @tparam ArenaSize   Bytes available for the text of all headers.
+ *  @tparam MaxHeaders  Most headers a response may carry.
+ */
+template <uint32_t ArenaSize = 1024, uint32_t MaxHeaders = 32>
+class HttpHeaders {
+    static_assert(MaxHeaders > 0 && MaxHeaders < 0xffff, "MaxHeaders must fit the hash table's slot type");
+    static_assert(ArenaSize <= 0x10000, "Header offsets are stored in 16 bits");
+
+public:
+    HttpHeaders() = default;
+    HttpHeaders(const HttpHeaders &) = delete;
+    HttpHeaders &operator=(const HttpHeaders &) = delete;
+
+    /**
+     *  Read and index all headers of the response waiting on `handle`.
+     *  On failure the table is left empty.
+     *
+     *  @param handle       An HTTP channel with a successful response.
+     *  @param num_headers  The `num_headers` reported by `mvReadHttpResponseData`.
+     *
+     *  @retval MV_STATUS_TOOMANYELEMENTS   `num_headers` exceeds `MaxHeaders`.
+     *  @retval MV_STATUS_INVALIDBUFFERSIZE The headers do not fit in `ArenaSize`.
+     */
+    MvStatus read(MvChannelHandle handle, uint32_t num_headers) {
+        clear();
+        if (num_headers > MaxHeaders) return MV_STATUS_TOOMANYELEMENTS;
+        std::memset(arena_, 0, sizeof(arena_));
+
+        uint32_t used = 0;
+        for (uint32_t i = 0; i < num_headers; ++i) {
+            uint8_t *text = arena_ + used;
+            uint32_t space = ArenaSize - used;
+            MvStatus status = mvReadHttpResponseHeader(handle, i, text, space);
+            const void *end = status == MV_STATUS_OKAY ? std::memchr(text, 0, space) : nullptr;
+            if (end == nullptr) {
+                clear();
+                return status != MV_STATUS_OKAY ? status : MV_STATUS_INVALIDBUFFERSIZE;
+            }
+            uint32_t length = static_cast<uint32_t>(static_cast<const uint8_t *>(end) - text);
+            add(used, length);
+            // Leave the NUL in place as the next header's lower bound.
+            used += length + 1;
+        }
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Empty the table.
+     */
+    void clear() {
+        count_ = 0;
+        for (uint32_t i = 0; i < kSlots; ++i) slots_[i] = 0;
+    }
+
+    /**
+     *  Find the first header called `name`, ignoring ASCII case.
+     */
+    bool find(ByteSpan name, ByteSpan *value) const {
+        uint32_t hash = hashName(name);
+        for (uint32_t slot = hash & (kSlots - 1);; slot = (slot + 1) & (kSlots - 1)) {
+            uint32_t index = slots_[slot];
+            if (index == 0) return false;
+            const Entry &entry = entries_[index - 1];
+            if (entry.hash == hash && equalsIgnoreCase(this->name(index - 1), name)) {
+                if (value != nullptr) *value = this->value(index - 1);
+                return true;
+            }
+        }
+    }
+
+    /**
+     *  The value of the first header called `name`, or an empty span.
+     */
+    ByteSpan get(ByteSpan name) const {
+        ByteSpan value;
+        find(name, &value);
+        return value;
+    }
+
+    uint32_t count() const {
+        return count_;
+    }
+
+    ByteSpan name(uint32_t index) const {
+        return ByteSpan(arena_ + entries_[index].name_offset, entries_[index].name_length);
+    }
+
+    ByteSpan value(uint32_t index) const {
+        return ByteSpan(arena_ + entries_[index].value_offset, entries_[index].value_length);
+    }
+
+private:
+    struct Entry {
+        uint32_t hash;
+        uint16_t name_offset;
+        uint16_t name_length;
+        uint16_t value_offset;
+        uint16_t value_length;
+    };
+
+    // Power of two at least twice `MaxHeaders`, keeping probes short.
+    static constexpr uint32_t slotCount() {
+        uint32_t slots = 1;
+        while (slots < 2 * MaxHeaders) slots <<= 1;
+        return slots;
+    }
+
+    static constexpr uint32_t kSlots = slotCount();
+
+    static bool isSpace(uint8_t c) {
+        return c == ' ' || c == '\t';
+    }
+
+    static uint32_t hashName(ByteSpan name) {
+        // FNV-1a over the lower-cased name.
+        uint32_t hash = kFnv1aBasis;
+        for (uint32_t i = 0; i < name.length; ++i) hash = fnv1aStep(hash, asciiLower(name.data[i]));
+        return hash;
+    }
+
+    void add(uint32_t offset, uint32_t length) {
+        const uint8_t *text = arena_ + offset;
+        uint32_t colon = 0;
+        while (colon < length && text[colon] != ':') ++colon;
+
+        uint32_t name_end = colon;
+        while (name_end > 0 && isSpace(text[name_end - 1])) --name_end;
+        uint32_t value_start = colon < length ? colon + 1 : length;
+        while (value_start < length && isSpace(text[value_start])) ++value_start;
+        uint32_t value_end = length;
+        while (value_end > value_start && isSpace(text[value_end - 1])) --value_end;
+
+        Entry &entry = entries_[count_];
+        entry.name_offset = static_cast<uint16_t>(offset);
+        entry.name_length = static_cast<uint16_t>(name_end);
+        entry.value_offset = static_cast<uint16_t>(offset + value_start);
+        entry.value_length = static_cast<uint16_t>(value_end - value_start);
+        entry.hash = hashName(name(count_));
+        ++count_;
+
+        // The first of several same-named headers is the one `find()` returns.
+        uint32_t slot = entry.hash & (kSlots - 1);
+        while (slots_[slot] != 0) {
+            const Entry &other = entries_[slots_[slot] - 1];
+            if (other.hash == entry.hash && equalsIgnoreCase(name(slots_[slot] - 1u), name(count_ - 1))) return;
+            slot = (slot + 1) & (kSlots - 1);
+        }
+        slots_[slot] = static_cast<uint16_t>(count_);
+    }
+
+    uint8_t arena_[ArenaSize];
+    Entry entries_[MaxHeaders];
+    uint16_t slots_[kSlots] = {};
+    uint32_t count_ = 0;
+};
+
+}
+
+#endif
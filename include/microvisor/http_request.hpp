@@ -0,0 +1,256 @@
+#ifndef MV_HTTP_REQUEST_HPP
+#define MV_HTTP_REQUEST_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "byte_span.hpp"
+#include "channel_limits.hpp"
+#include "mv_syscalls.h"
+
+namespace mv {
+
+// Microvisor does not document how much of a channel's send buffer a
+// request takes, nor how many headers it accepts. These are estimates, not
+// guarantees, and the host stand-ins use the same figures; leave some
+// headroom in buffers sized from them.
+
+/// Most headers `mvSendHttpRequest` is assumed to accept.
+constexpr uint32_t kMaxHttpHeaders = 32;
+/// Estimated fixed cost of a serialised request in the channel's send buffer.
+constexpr uint32_t kHttpRequestOverhead = 24;
+/// Estimated per-header cost in addition to the header's length.
+constexpr uint32_t kHttpHeaderOverhead = 4;
+
+/**
+ *  Estimated bytes `request` occupies in a channel's send buffer.
+ *  `mvSendHttpRequest` returns `MV_STATUS_INVALIDBUFFERSIZE` when the real
+ *  figure exceeds `send_buffer_len`.
+ */
+inline uint32_t httpRequestWireSize(const MvHttpRequest &request) {
+    uint32_t size = kHttpRequestOverhead + request.method.length + request.url.length + request.body.length;
+    for (uint32_t i = 0; i < request.num_headers; ++i) size += kHttpHeaderOverhead + request.headers[i].length;
+    return size;
+}
+
+/**
+ *  A fixed set of complete `Name: value` headers, built at compile time
+ *  together with its wire size:
+ *
+ *      constexpr auto kJsonHeaders = mv::httpHeaderSet("Content-Type: application/json", "Accept: application/json");
+ */
+template <uint32_t Count>
+struct HttpHeaderSet {
+    const char *text[Count];
+    uint32_t length[Count];
+    uint32_t wire_size;
+
+    static constexpr uint32_t size() {
+        return Count;
+    }
+};
+
+namespace detail {
+
+template <size_t N>
+constexpr uint32_t literalLength(const char (&)[N]) {
+    return static_cast<uint32_t>(N - 1);
+}
+
+}
+
+template <size_t... N>
+constexpr HttpHeaderSet<sizeof...(N)> httpHeaderSet(const char (&...headers)[N]) {
+    static_assert(sizeof...(N) <= kMaxHttpHeaders, "Too many headers for one request");
+    return HttpHeaderSet<sizeof...(N)>{{headers...},
+                                      {detail::literalLength(headers)...},
+                                      ((kHttpHeaderOverhead + detail::literalLength(headers)) + ... + 0)};
+}
+
+/**
+ *  Assembles an `MvHttpRequest` in a caller-supplied arena and tracks its
+ *  wire size as it grows, so the channel can be opened with a send buffer
+ *  that fits and the request is never refused after the channel is spent.
+ *
+ *  Header text is packed from the start of the arena and the
+ *  `MvHttpHeader` array from the end. Spans passed in are referenced, not
+ *  copied, except by `header(name, value)` and `copy()`, so they must
+ *  outlive the request. Errors are latched: after the first failure later
+ *  calls do nothing and `status()`, `build()` and `send()` report it.
+ */
+class HttpRequestBuilder {
+public:
+    HttpRequestBuilder(uint8_t *arena, uint32_t arena_size)
+        : arena_(arena), text_end_(arena), headers_end_(alignedEnd(arena, arena_size)) {}
+
+    HttpRequestBuilder &method(ByteSpan method) {
+        wire_size_ += method.length - request_.method.length;
+        request_.method = method.sized();
+        return *this;
+    }
+
+    HttpRequestBuilder &url(ByteSpan url) {
+        wire_size_ += url.length - request_.url.length;
+        request_.url = url.sized();
+        return *this;
+    }
+
+    HttpRequestBuilder &body(ByteSpan body) {
+        wire_size_ += body.length - request_.body.length;
+        request_.body = body.sized();
+        return *this;
+    }
+
+    HttpRequestBuilder &timeout(uint32_t timeout_ms) {
+        request_.timeout_ms = timeout_ms;
+        return *this;
+    }
+
+    /**
+     *  Add a complete `Name: value` header without copying it.
+     */
+    HttpRequestBuilder &header(ByteSpan header) {
+        MvHttpHeader *slot = newHeader();
+        if (slot != nullptr) {
+            *slot = MvHttpHeader{header.length, header.data};
+            wire_size_ += kHttpHeaderOverhead + header.length;
+        }
+        return *this;
+    }
+
+    /**
+     *  Format `Name: value` into the arena and add it.
+     */
+    HttpRequestBuilder &header(ByteSpan name, ByteSpan value) {
+        uint32_t length = name.length + 2 + value.length;
+        uint8_t *text = take(length);
+        if (text == nullptr) return *this;
+        std::memcpy(text, name.data, name.length);
+        text[name.length] = ':';
+        text[name.length + 1] = ' ';
+        std::memcpy(text + name.length + 2, value.data, value.length);
+        return header(ByteSpan(text, length));
+    }
+
+    template <uint32_t Count>
+    HttpRequestBuilder &headers(const HttpHeaderSet<Count> &set) {
+        for (uint32_t i = 0; i < Count; ++i) header(ByteSpan(reinterpret_cast<const uint8_t *>(set.text[i]), set.length[i]));
+        return *this;
+    }
+
+    /**
+     *  Copy `data` into the arena, for URLs or bodies assembled in
+     *  temporary storage. Returns an empty span if the arena is full.
+     */
+    ByteSpan copy(ByteSpan data) {
+        uint8_t *text = take(data.length);
+        if (text == nullptr) return ByteSpan();
+        std::memcpy(text, data.data, data.length);
+        return ByteSpan(text, data.length);
+    }
+
+    /**
+     *  Bytes the request will occupy in the send buffer.
+     */
+    uint32_t wireSize() const {
+        return wire_size_;
+    }
+
+    /**
+     *  The `send_buffer_len` to open the channel with.
+     */
+    uint32_t sendBufferSize() const {
+        return channelBufferSizeFor(wire_size_);
+    }
+
+    MvStatus status() const {
+        return status_;
+    }
+
+    /**
+     *  Produce the request. The result points into the arena and the
+     *  caller's spans.
+     */
+    MvStatus build(MvHttpRequest *request) {
+        if (status_ != MV_STATUS_OKAY) return status_;
+        arrange(true);
+        *request = request_;
+        request->headers = headers_end_ - request_.num_headers;
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Send the request on `handle`, first checking it fits the channel's
+     *  send buffer so a refusal does not use up the channel.
+     *
+     *  @retval MV_STATUS_INVALIDBUFFERSIZE The request is larger than `send_buffer_len`; nothing was sent.
+     */
+    MvStatus send(MvChannelHandle handle, uint32_t send_buffer_len) {
+        MvHttpRequest request;
+        MvStatus status = build(&request);
+        if (status != MV_STATUS_OKAY) return status;
+        if (wire_size_ > send_buffer_len) return MV_STATUS_INVALIDBUFFERSIZE;
+        return mvSendHttpRequest(handle, &request);
+    }
+
+private:
+    static MvHttpHeader *alignedEnd(uint8_t *arena, uint32_t arena_size) {
+        uintptr_t end = reinterpret_cast<uintptr_t>(arena + arena_size);
+        return reinterpret_cast<MvHttpHeader *>(end & ~static_cast<uintptr_t>(alignof(MvHttpHeader) - 1));
+    }
+
+    uint8_t *take(uint32_t length) {
+        if (status_ != MV_STATUS_OKAY) return nullptr;
+        uint8_t *limit = reinterpret_cast<uint8_t *>(headers_end_ - request_.num_headers);
+        if (text_end_ > limit || length > static_cast<uint32_t>(limit - text_end_)) {
+            status_ = MV_STATUS_INVALIDBUFFERSIZE;
+            return nullptr;
+        }
+        uint8_t *text = text_end_;
+        text_end_ += length;
+        return text;
+    }
+
+    // The header array grows down towards the text, so entries are kept
+    // newest first while building and put in order by `build()`.
+    void arrange(bool in_order) {
+        if (in_order == in_order_) return;
+        MvHttpHeader *first = headers_end_ - request_.num_headers;
+        for (MvHttpHeader *low = first, *high = headers_end_ - 1; low < high; ++low, --high) {
+            MvHttpHeader swap = *low;
+            *low = *high;
+            *high = swap;
+        }
+        in_order_ = in_order;
+    }
+
+    MvHttpHeader *newHeader() {
+        if (status_ != MV_STATUS_OKAY) return nullptr;
+        arrange(false);
+        if (request_.num_headers == kMaxHttpHeaders) {
+            status_ = MV_STATUS_TOOMANYELEMENTS;
+            return nullptr;
+        }
+        MvHttpHeader *first = headers_end_ - request_.num_headers;
+        uint8_t *limit = reinterpret_cast<uint8_t *>(first - 1);
+        if (reinterpret_cast<uint8_t *>(first) < arena_ + sizeof(MvHttpHeader) || limit < text_end_) {
+            status_ = MV_STATUS_INVALIDBUFFERSIZE;
+            return nullptr;
+        }
+        request_.num_headers++;
+        return first - 1;
+    }
+
+    uint8_t *arena_;
+    uint8_t *text_end_;
+    MvHttpHeader *headers_end_;
+    MvHttpRequest request_ = {{nullptr, 0}, {nullptr, 0}, 0, nullptr, {nullptr, 0}, 10000};
+    uint32_t wire_size_ = kHttpRequestOverhead;
+    MvStatus status_ = MV_STATUS_OKAY;
+    bool in_order_ = false;
+};
+
+}
+
+#endif
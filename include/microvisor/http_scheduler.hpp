@@ -0,0 +1,220 @@
+#ifndef MV_HTTP_SCHEDULER_HPP
+#define MV_HTTP_SCHEDULER_HPP
+
+#include <atomic>
+#include <cstdint>
+
+#include "channel_limits.hpp"
+#include "http_request.hpp"
+#include "mv_syscalls.h"
+
+namespace mv {
+
+/**
+ *  Runs queued HTTP requests on a pool of channels, opening each channel
+ *  only when a request is ready for it and closing it once the response
+ *  has been handled.
+ *
+ *  Opens are paced by a `ChannelOpenPacer`, so `mvOpenChannel` is not
+ *  refused with `MV_STATUS_RATELIMITED` unless other code is opening
+ *  channels too. When Microvisor refuses an open because every channel is
+ *  in use or the network is down, the request stays queued and the next
+ *  attempt waits `kChannelRetryUs`.
+ *
+ *  Slot `i` is opened with notification tag `base_tag + i`. Route those
+ *  tags to `onNotification()`, which is safe to call from the notification
+ *  IRQ, and call `poll()` from the main loop when it has flagged a slot or
+ *  when `nextOpenAt()` arrives, so the loop can sleep in between.
+ *  Completion callbacks run from `poll()` with the channel still open, so
+ *  they can read headers and body. The channel is closed when the callback
+ *  returns.
+ *
+ *  @tparam QueueDepth          Requests that may wait for a channel.
+ *  @tparam SendBufferSize      Per-channel send buffer; a multiple of 512.
+ *  @tparam ReceiveBufferSize   Per-channel receive buffer; a multiple of 512.
+ *  @tparam Channels            Channels used concurrently, at most `kMaxChannels`.
+ */
+template <uint32_t QueueDepth = 8, uint32_t SendBufferSize = 1024, uint32_t ReceiveBufferSize = 2048,
+          uint32_t Channels = kMaxChannels>
+class HttpScheduler {
+    static_assert(QueueDepth > 0, "HttpScheduler needs a queue");
+    static_assert(SendBufferSize % kChannelBufferAlignment == 0 && SendBufferSize > 0, "Send buffer size must be a multiple of 512");
+    static_assert(ReceiveBufferSize % kChannelBufferAlignment == 0 && ReceiveBufferSize > 0, "Receive buffer size must be a multiple of 512");
+    static_assert(Channels > 0 && Channels <= kMaxChannels, "Microvisor allows at most four channels");
+
+public:
+    /**
+     *  Called once per request. `status` is `MV_STATUS_OKAY` when `response`
+     *  holds the outcome reported by `mvReadHttpResponseData`; otherwise the
+     *  request failed locally and `response` is zeroed. `handle` is null if
+     *  no channel was opened.
+     */
+    using Completion = void (*)(void *context, MvChannelHandle handle, MvStatus status, const MvHttpResponseData &response);
+
+    HttpScheduler(MvNotificationHandle notification_handle, MvNetworkHandle network_handle, uint32_t base_tag)
+        : notification_handle_(notification_handle), network_handle_(network_handle), base_tag_(base_tag) {}
+
+    HttpScheduler(const HttpScheduler &) = delete;
+    HttpScheduler &operator=(const HttpScheduler &) = delete;
+
+    /**
+     *  Queue `request`, which must remain valid until `done` is called, and
+     *  start it at once if a channel and an open token are free.
+     *
+     *  @retval MV_STATUS_INVALIDBUFFERSIZE The request would not fit `SendBufferSize`.
+     *  @retval MV_STATUS_TOOMANYELEMENTS   The queue is full.
+     */
+    MvStatus submit(const MvHttpRequest *request, Completion done, void *context = nullptr) {
+        if (request->num_headers > kMaxHttpHeaders) return MV_STATUS_TOOMANYELEMENTS;
+        if (httpRequestWireSize(*request) > SendBufferSize) return MV_STATUS_INVALIDBUFFERSIZE;
+        if (queued_ == QueueDepth) return MV_STATUS_TOOMANYELEMENTS;
+        queue_[(queue_head_ + queued_) % QueueDepth] = Job{request, done, context};
+        queued_++;
+        start(now());
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Complete flagged requests, then start queued ones as channels and
+     *  tokens allow.
+     */
+    void poll() {
+        uint32_t ready = ready_.exchange(0, std::memory_order_acquire);
+        for (uint32_t i = 0; i < Channels; ++i) {
+            if ((ready & (1u << i)) != 0 && slots_[i].handle != nullptr) check(i);
+        }
+        start(now());
+    }
+
+    /**
+     *  `NotificationRing` handler for the scheduler's tags; `context` is the scheduler.
+     */
+    static void onNotification(void *context, const MvNotification &notification) {
+        HttpScheduler *scheduler = static_cast<HttpScheduler *>(context);
+        uint32_t slot = notification.tag - scheduler->base_tag_;
+        if (slot < Channels) scheduler->ready_.fetch_or(1u << slot, std::memory_order_release);
+    }
+
+    /**
+     *  When `poll()` may next open a channel, in `mvGetMicroseconds` time,
+     *  after the open rate limit or a refused open. A time already past,
+     *  such as zero, means now.
+     */
+    uint64_t nextOpenAt() const {
+        return opens_.nextAt();
+    }
+
+    uint32_t queued() const {
+        return queued_;
+    }
+
+    uint32_t inFlight() const {
+        return in_flight_;
+    }
+
+    /**
+     *  Opens refused with `MV_STATUS_RATELIMITED` despite the token bucket.
+     */
+    uint32_t rateLimited() const {
+        return opens_.rateLimited();
+    }
+
+private:
+    struct Job {
+        const MvHttpRequest *request;
+        Completion done;
+        void *context;
+    };
+
+    struct Slot {
+        MvChannelHandle handle = nullptr;
+        Job job = {};
+    };
+
+    static uint64_t now() {
+        uint64_t microseconds;
+        mvGetMicroseconds(&microseconds);
+        return microseconds;
+    }
+
+    void start(uint64_t at) {
+        while (queued_ != 0 && in_flight_ < Channels && opens_.ready(at)) {
+            uint32_t index = 0;
+            while (slots_[index].handle != nullptr) ++index;
+            Slot &slot = slots_[index];
+            const Job &job = queue_[queue_head_];
+
+            MvOpenChannelParams params = {};
+            params.version = 1;
+            params.v1.notification_handle = notification_handle_;
+            params.v1.notification_tag = base_tag_ + index;
+            params.v1.network_handle = network_handle_;
+            params.v1.receive_buffer = receive_buffers_[index];
+            params.v1.receive_buffer_len = ReceiveBufferSize;
+            params.v1.send_buffer = send_buffers_[index];
+            params.v1.send_buffer_len = SendBufferSize;
+            params.v1.channel_type = MV_CHANNELTYPE_HTTP;
+
+            MvStatus status = mvOpenChannel(&params, &slot.handle);
+            if (opens_.opened(now(), status)) {
+                // Transient: leave the request queued until `nextOpenAt()`.
+                slot.handle = nullptr;
+                return;
+            }
+
+            Job next = job;
+            queue_head_ = (queue_head_ + 1) % QueueDepth;
+            queued_--;
+            if (status != MV_STATUS_OKAY) {
+                slot.handle = nullptr;
+                fail(next, nullptr, status);
+                continue;
+            }
+            status = mvSendHttpRequest(slot.handle, next.request);
+            if (status != MV_STATUS_OKAY) {
+                fail(next, slot.handle, status);
+                mvCloseChannel(&slot.handle);
+                continue;
+            }
+            slot.job = next;
+            in_flight_++;
+        }
+    }
+
+    void check(uint32_t index) {
+        Slot &slot = slots_[index];
+        MvHttpResponseData response = {};
+        MvStatus status = mvReadHttpResponseData(slot.handle, &response);
+        if (status == MV_STATUS_RESPONSENOTPRESENT) return;
+        if (status == MV_STATUS_OKAY) {
+            slot.job.done(slot.job.context, slot.handle, status, response);
+        } else {
+            fail(slot.job, slot.handle, status);
+        }
+        mvCloseChannel(&slot.handle);
+        slot.handle = nullptr;
+        in_flight_--;
+    }
+
+    static void fail(const Job &job, MvChannelHandle handle, MvStatus status) {
+        MvHttpResponseData response = {};
+        job.done(job.context, handle, status, response);
+    }
+
+    alignas(kChannelBufferAlignment) uint8_t send_buffers_[Channels][SendBufferSize];
+    alignas(kChannelBufferAlignment) uint8_t receive_buffers_[Channels][ReceiveBufferSize];
+    MvNotificationHandle notification_handle_;
+    MvNetworkHandle network_handle_;
+    uint32_t base_tag_;
+    Slot slots_[Channels];
+    Job queue_[QueueDepth] = {};
+    uint32_t queue_head_ = 0;
+    uint32_t queued_ = 0;
+    uint32_t in_flight_ = 0;
+    ChannelOpenPacer opens_;
+    std::atomic<uint32_t> ready_{0};
+};
+
+}
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef MV_MQTT_ACK_QUEUE_HPP
+#define MV_MQTT_ACK_QUEUE_HPP
+
+#include <atomic>
+#include <cstdint>
+
+#include "mv_syscalls.h"
+
+namespace mv {
+
+/**
+ *  Defers `mvMqttAcknowledgeMessage` calls for QoS 1 and 2 messages so
+ *  handlers can finish a message wherever and whenever suits them and the
+ *  acknowledgements are made together, off the receive path.
+ *
+ *  `defer()` only records the correlation id in a single-producer,
+ *  single-consumer ring, so it may be called from an interrupt handler
+ *  while the main loop runs `poll()`. `poll()` sends the queued
+ *  acknowledgements once `batch_size` have built up or the oldest has
+ *  waited `max_delay_us` since `poll()` first saw it. Microvisor has no
+ *  batched acknowledgement, so a flush is still one call per message,
+ *  but the calls are made back to back at a time of the application's
+ *  choosing.
+ *
+ *  Call `close()` before `mvMqttRequestDisconnect`, `mvCloseChannel`,
+ *  `mvDeepSleep` or `mvRestart`, or let `MqttSession` do so through
+ *  `onChannelChange()`; unacknowledged messages are otherwise redelivered.
+ *  `close()` flushes the queue and makes `defer()` refuse until `bind()`,
+ *  so once it returns `MV_STATUS_OKAY` no acknowledgement is left behind.
+ *
+ *  @tparam Capacity    Acknowledgements that may be queued, a power of two.
+ */
+template <uint32_t Capacity = 32>
+class MqttAckQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    /**
+     *  @param batch_size   Queued acknowledgements that trigger a flush from `poll()`.
+     *  @param max_delay_us Longest `poll()` leaves an acknowledgement queued; zero means no limit.
+     */
+    explicit MqttAckQueue(MvChannelHandle handle = nullptr, uint32_t batch_size = Capacity / 2, uint32_t max_delay_us = 100000)
+        : handle_(handle), batch_size_(batch_size != 0 ? batch_size : 1), max_delay_us_(max_delay_us) {}
+
+    MqttAckQueue(const MqttAckQueue &) = delete;
+    MqttAckQueue &operator=(const MqttAckQueue &) = delete;
+
+    /**
+     *  Queue an acknowledgement. QoS 0 messages need none and are ignored.
+     *  Never calls into Microvisor. A refused acknowledgement is not made,
+     *  so the broker redelivers the message unless the caller defers it
+     *  again after the main loop has flushed.
+     *
+     *  @retval MV_STATUS_TOOMANYELEMENTS   The queue is full.
+     *  @retval MV_STATUS_CHANNELCLOSED     The queue is closed until `bind()`.
+     */
+    MvStatus defer(uint32_t correlation_id, uint32_t qos = 1) {
+        if (qos == 0) return MV_STATUS_OKAY;
+        if (closed_.load(std::memory_order_acquire)) {
+            refused_++;
+            return MV_STATUS_CHANNELCLOSED;
+        }
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == Capacity) {
+            refused_++;
+            return MV_STATUS_TOOMANYELEMENTS;
+        }
+        ids_[tail % Capacity] = correlation_id;
+        tail_.store(tail + 1, std::memory_order_release);
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Flush if the batch is full or the oldest acknowledgement is due.
+     *  Call from the main loop.
+     */
+    MvStatus poll() {
+        uint32_t queued = pending();
+        if (queued == 0) {
+            waiting_ = false;
+            return MV_STATUS_OKAY;
+        }
+        if (queued >= batch_size_) return flush();
+        if (max_delay_us_ == 0) return MV_STATUS_OKAY;
+
+        uint64_t now;
+        mvGetMicroseconds(&now);
+        if (!waiting_) {
+            waiting_ = true;
+            waiting_since_ = now;
+            return MV_STATUS_OKAY;
+        }
+        return now - waiting_since_ >= max_delay_us_ ? flush() : MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Send every queued acknowledgement. If the channel has closed they
+     *  are dropped, as the broker will redeliver those messages anyway.
+     */
+    MvStatus flush() {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        if (head == tail) return MV_STATUS_OKAY;
+        MvStatus status = MV_STATUS_OKAY;
+        while (head != tail) {
+            status = mvMqttAcknowledgeMessage(handle_, ids_[head % Capacity]);
+            if (status != MV_STATUS_OKAY && status != MV_STATUS_CHANNELCLOSED && status != MV_STATUS_INVALIDHANDLE) break;
+            if (status == MV_STATUS_OKAY) {
+                acknowledged_++;
+            } else {
+                dropped_++;
+            }
+            ++head;
+        }
+        head_.store(head, std::memory_order_release);
+        waiting_ = false;
+        flushes_++;
+        return status;
+    }
+
+    /**
+     *  Stop accepting acknowledgements and send every queued one. Returns
+     *  `MV_STATUS_OKAY` if the queue is empty afterwards; any other status
+     *  is the failed `mvMqttAcknowledgeMessage` call, with the remaining
+     *  acknowledgements still queued.
+     */
+    MvStatus close() {
+        closed_.store(true, std::memory_order_release);
+        MvStatus status = flush();
+        if (status == MV_STATUS_CHANNELCLOSED || status == MV_STATUS_INVALIDHANDLE) status = MV_STATUS_OKAY;
+        return status == MV_STATUS_OKAY && pending() != 0 ? MV_STATUS_UNAVAILABLE : status;
+    }
+
+    bool closed() const {
+        return closed_.load(std::memory_order_acquire);
+    }
+
+    /**
+     *  Direct later acknowledgements to `handle`, dropping any still
+     *  queued for the previous channel, and accept them again.
+     */
+    void bind(MvChannelHandle handle) {
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        dropped_ += tail - head_.load(std::memory_order_relaxed);
+        head_.store(tail, std::memory_order_release);
+        handle_ = handle;
+        waiting_ = false;
+        closed_.store(false, std::memory_order_release);
+    }
+
+    /**
+     *  `MqttSession` channel hook: closes the queue before the channel
+     *  closes and binds to its replacement. `context` is the queue.
+     */
+    static void onChannelChange(void *context, MvChannelHandle closing, MvChannelHandle opened) {
+        MqttAckQueue *queue = static_cast<MqttAckQueue *>(context);
+        if (closing != nullptr) queue->close();
+        if (opened != nullptr) queue->bind(opened);
+    }
+
+    uint32_t pending() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     *  Acknowledgements sent by `flush()`, refused by `defer()`, and
+     *  dropped with their channel.
+     */
+    uint32_t acknowledged() const {
+        return acknowledged_;
+    }
+
+    uint32_t refused() const {
+        return refused_.load(std::memory_order_relaxed);
+    }
+
+    uint32_t dropped() const {
+        return dropped_;
+    }
+
+    uint32_t flushes() const {
+        return flushes_;
+    }
+
+private:
+    MvChannelHandle handle_;
+    uint32_t batch_size_;
+    uint32_t max_delay_us_;
+    uint32_t ids_[Capacity];
+    std::atomic<uint32_t> head_{0};
+    std::atomic<uint32_t> tail_{0};
+    std::atomic<bool> closed_{false};
+    bool waiting_ = false;
+    uint64_t waiting_since_ = 0;
+    uint32_t acknowledged_ = 0;
+    std::atomic<uint32_t> refused_{0};
+    uint32_t dropped_ = 0;
+    uint32_t flushes_ = 0;
+};
+
+}
+
+#endif
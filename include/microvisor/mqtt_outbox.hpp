@@ -0,0 +1,469 @@
+#ifndef MV_MQTT_OUTBOX_HPP
+#define MV_MQTT_OUTBOX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "byte_span.hpp"
+#include "external_flash.hpp"
+#include "mqtt_publisher.hpp"
+#include "mv_syscalls.h"
+
+namespace mv {
+
+/**
+ *  A store-and-forward queue of MQTT publishes kept in external flash, so
+ *  messages survive outages and restarts without holding RAM.
+ *
+ *  `append()` writes each publish to a log in a region of whole flash
+ *  sectors, with a CRC over the record. `pump()` reads the log ahead in
+ *  blocks and publishes from it through an `MqttPublisher` until the
+ *  window is full. When the broker accepts a publish its record is marked
+ *  delivered in place, and a sector whose records are all delivered is
+ *  erased when the log next needs the space. A publish that fails, for
+ *  example with `MV_MQTTREQUESTSTATE_NOTCONNECTED`, is sent again from the
+ *  log once the publishes ahead of it have settled.
+ *
+ *  Give the publisher `onPublished` as its completion, or call `complete()`
+ *  from yours for publishes whose context is the outbox. When the channel
+ *  is reopened, call the publisher's `reset()` and then `rewind()`.
+ *  Delivery is at least once: a publish accepted just before a restart may
+ *  be sent again.
+ *
+ *  @tparam MaxMessageSize  Largest topic plus payload, in bytes.
+ *  @tparam Window          Records being published at once.
+ */
+template <uint32_t MaxMessageSize = 1024, uint32_t Window = 8>
+class MqttOutbox {
+    struct RecordHeader {
+        uint16_t topic_length;
+        uint16_t payload_length;
+        uint8_t qos;
+        uint8_t retain;
+        uint16_t magic;
+        uint32_t crc;
+        // All ones until the record is delivered, then programmed to zero.
+        uint32_t pending;
+    };
+
+    struct SectorHeader {
+        uint32_t magic;
+        uint32_t sequence;
+    };
+
+    static_assert(sizeof(RecordHeader) == 16 && sizeof(SectorHeader) == 8, "Flash layout must not be padded");
+    static_assert(Window > 0, "MqttOutbox needs a window");
+    static_assert(MaxMessageSize <= kFlashSectorSize - sizeof(SectorHeader) - sizeof(RecordHeader), "Records must fit a flash sector");
+
+public:
+    /**
+     *  @param base Start of the outbox's flash region, sector aligned.
+     *  @param size Size of the region, at least two sectors.
+     */
+    MqttOutbox(MvExternalFlashHandle flash, uint32_t base, uint32_t size)
+        : flash_(flash), base_(base), sectors_(size / kFlashSectorSize) {}
+
+    MqttOutbox(const MqttOutbox &) = delete;
+    MqttOutbox &operator=(const MqttOutbox &) = delete;
+
+    /**
+     *  Recover the log from flash, or start one if the region holds none.
+     *
+     *  @retval MV_STATUS_INVALIDBUFFERALIGNMENT    `base` is not sector aligned.
+     *  @retval MV_STATUS_INVALIDBUFFERSIZE         The region is smaller than two sectors.
+     */
+    MvStatus open() {
+        if (base_ % kFlashSectorSize != 0) return MV_STATUS_INVALIDBUFFERALIGNMENT;
+        if (sectors_ < 2) return MV_STATUS_INVALIDBUFFERSIZE;
+        open_ = false;
+        flight_count_ = 0;
+        pending_ = 0;
+
+        // The log is a run of sectors with consecutive sequence numbers,
+        // beginning at the lowest.
+        uint32_t oldest = sectors_;
+        uint32_t sequence = 0;
+        for (uint32_t sector = 0; sector < sectors_; ++sector) {
+            SectorHeader header;
+            MvStatus status = readSectorHeader(sector, &header);
+            if (status != MV_STATUS_OKAY) return status;
+            if (header.magic == kSectorMagic && (oldest == sectors_ || header.sequence < sequence)) {
+                oldest = sector;
+                sequence = header.sequence;
+            }
+        }
+        if (oldest == sectors_) {
+            sequence_ = 0;
+            MvStatus status = startSector(0);
+            if (status != MV_STATUS_OKAY) return status;
+            head_ = cursor_ = tail_;
+            open_ = true;
+            return MV_STATUS_OKAY;
+        }
+
+        bool found_head = false;
+        uint32_t last = 0;
+        for (uint32_t sector = oldest, count = 0; count < sectors_; sector = (sector + 1) % sectors_, ++count) {
+            SectorHeader header;
+            MvStatus status = readSectorHeader(sector, &header);
+            if (status != MV_STATUS_OKAY) return status;
+            if (count != 0 && (header.magic != kSectorMagic || header.sequence != sequence + 1)) break;
+            sequence = header.sequence;
+            tail_sector_ = sector;
+            status = scanSector(sector, &found_head, &last);
+            if (status != MV_STATUS_OKAY) return status;
+        }
+        sequence_ = sequence;
+
+        // Only the newest record can have been cut short by a reset.
+        if (last != 0) {
+            RecordHeader header;
+            bool intact;
+            MvStatus status = verify(last, &header, &intact);
+            if (status != MV_STATUS_OKAY) return status;
+            if (!intact && header.pending != 0) {
+                markDelivered(last);
+                pending_--;
+                corrupt_++;
+                tail_ = sectorEnd(tail_sector_);
+                if (head_ == last) found_head = false;
+            }
+        }
+        if (!found_head) head_ = tail_;
+        cursor_ = head_;
+        open_ = true;
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Store a publish at the end of the log. Microvisor's QoS and retain
+     *  semantics apply when it is published.
+     *
+     *  @retval MV_STATUS_INPUTTOOLONG      Topic and payload exceed `MaxMessageSize`.
+     *  @retval MV_STATUS_TOOMANYELEMENTS   The region is full of undelivered records.
+     */
+    MvStatus append(ByteSpan topic, ByteSpan payload, uint32_t qos, bool retain) {
+        if (!open_) return MV_STATUS_UNAVAILABLE;
+        if (topic.length + payload.length > MaxMessageSize) return MV_STATUS_INPUTTOOLONG;
+        uint32_t size = recordSize(topic.length + payload.length);
+        if (tail_ + size > sectorEnd(tail_sector_)) {
+            uint32_t next = (tail_sector_ + 1) % sectors_;
+            if (head_ != tail_ && sectorOf(head_) == next) return MV_STATUS_TOOMANYELEMENTS;
+            bool idle = head_ == tail_;
+            MvStatus status = startSector(next);
+            if (status != MV_STATUS_OKAY) return status;
+            if (idle) head_ = cursor_ = tail_;
+        }
+
+        RecordHeader header = {static_cast<uint16_t>(topic.length), static_cast<uint16_t>(payload.length),
+                               static_cast<uint8_t>(qos), static_cast<uint8_t>(retain ? 1 : 0), kRecordMagic, 0, 0xffffffffu};
+        header.crc = crc32(payload, crc32(topic, crc32(ByteSpan(reinterpret_cast<const uint8_t *>(&header), kCrcSpan))));
+
+        MvStatus status = write(tail_, ByteSpan(reinterpret_cast<const uint8_t *>(&header), sizeof(header)));
+        if (status != MV_STATUS_OKAY) {
+            // The header may be partly programmed: leave the rest of the sector.
+            tail_ = sectorEnd(tail_sector_);
+            return status;
+        }
+        status = write(tail_ + sizeof(header), topic);
+        if (status == MV_STATUS_OKAY) status = write(tail_ + sizeof(header) + topic.length, payload);
+        if (status != MV_STATUS_OKAY) {
+            markDelivered(tail_);
+            tail_ += size;
+            return status;
+        }
+        tail_ += size;
+        pending_++;
+        appended_++;
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Publish stored records, in order, until the log is exhausted or the
+     *  window or `publisher` is full.
+     *
+     *  @retval MV_STATUS_OKAY  Publishing stopped for want of records or space; call again later.
+     */
+    template <uint32_t PublisherWindow>
+    MvStatus pump(MqttPublisher<PublisherWindow> &publisher) {
+        if (!open_) return MV_STATUS_UNAVAILABLE;
+        uint32_t block_at = 0;
+        uint32_t block_length = 0;
+        MvStatus result = MV_STATUS_OKAY;
+
+        while (cursor_ != tail_ && flight_count_ < Window && !publisher.full()) {
+            uint32_t sector = sectorOf(cursor_);
+            uint32_t limit = sector == tail_sector_ ? tail_ : sectorEnd(sector);
+            if (cursor_ + sizeof(RecordHeader) > limit) {
+                nextSector(sector);
+                continue;
+            }
+            if (cursor_ < block_at || cursor_ + sizeof(RecordHeader) > block_at + block_length) {
+                block_at = cursor_;
+                block_length = limit - cursor_ < sizeof(buffer_) ? limit - cursor_ : sizeof(buffer_);
+                result = mvExternalFlashReadBlocking(flash_, block_at, block_length, buffer_);
+                if (result != MV_STATUS_OKAY) break;
+            }
+
+            RecordHeader header;
+            std::memcpy(&header, buffer_ + (cursor_ - block_at), sizeof(header));
+            uint32_t length = header.topic_length + header.payload_length;
+            uint32_t size = recordSize(length);
+            if (header.magic != kRecordMagic || cursor_ + size > limit) {
+                // Erased space or the remains of an interrupted write.
+                nextSector(sector);
+                continue;
+            }
+            if (length <= MaxMessageSize && cursor_ + sizeof(header) + length > block_at + block_length) {
+                block_length = 0;
+                continue;
+            }
+
+            const uint8_t *record = buffer_ + (cursor_ - block_at);
+            ByteSpan topic(record + sizeof(header), header.topic_length);
+            ByteSpan payload(topic.data + topic.length, header.payload_length);
+            Flight flight = {0, cursor_, State::Delivered};
+            if (header.pending == 0) {
+                // Delivered out of order before a rewind or restart.
+            } else if (length > MaxMessageSize || crc32(payload, crc32(topic, crc32(ByteSpan(record, kCrcSpan)))) != header.crc) {
+                markDelivered(cursor_);
+                pending_--;
+                corrupt_++;
+            } else {
+                result = publisher.publish(topic, payload, header.qos, header.retain != 0, this, &flight.id);
+                if (result == MV_STATUS_RATELIMITED) {
+                    result = MV_STATUS_OKAY;
+                    break;
+                }
+                if (result != MV_STATUS_OKAY) break;
+                flight.state = State::Sent;
+            }
+            flights_[(flight_head_ + flight_count_) % Window] = flight;
+            flight_count_++;
+            cursor_ += size;
+        }
+        advance();
+        return result;
+    }
+
+    /**
+     *  `MqttPublisher` completion for publishes made by `pump()`; `context`
+     *  is the outbox.
+     */
+    static void onPublished(void *context, uint32_t correlation_id, MvMqttRequestState state, uint32_t, uint64_t) {
+        static_cast<MqttOutbox *>(context)->complete(correlation_id, state == MV_MQTTREQUESTSTATE_REQUESTCOMPLETED);
+    }
+
+    /**
+     *  Record the outcome of a publish made by `pump()`. A delivered record
+     *  is marked in flash; a failed one is sent again.
+     */
+    void complete(uint32_t correlation_id, bool delivered) {
+        bool sending = false;
+        bool failed = false;
+        for (uint32_t i = 0; i < flight_count_; ++i) {
+            Flight &flight = flights_[(flight_head_ + i) % Window];
+            if (flight.state == State::Sent && flight.id == correlation_id) {
+                if (delivered) {
+                    markDelivered(flight.address);
+                    pending_--;
+                    delivered_++;
+                    flight.state = State::Delivered;
+                } else {
+                    flight.state = State::Failed;
+                }
+            }
+            sending = sending || flight.state == State::Sent;
+            failed = failed || flight.state == State::Failed;
+        }
+        advance();
+        if (failed && !sending) rewind();
+    }
+
+    /**
+     *  Forget the publishes in progress and resume from the oldest
+     *  undelivered record, for example after the channel has been reopened.
+     */
+    void rewind() {
+        flight_count_ = 0;
+        cursor_ = head_;
+    }
+
+    /**
+     *  Records stored and not yet delivered, including those being published.
+     */
+    uint32_t pending() const {
+        return pending_;
+    }
+
+    uint32_t inFlight() const {
+        uint32_t sent = 0;
+        for (uint32_t i = 0; i < flight_count_; ++i) sent += flights_[(flight_head_ + i) % Window].state == State::Sent ? 1 : 0;
+        return sent;
+    }
+
+    /**
+     *  Records appended and delivered since `open()`, and records skipped
+     *  because their CRC did not match.
+     */
+    uint32_t appended() const {
+        return appended_;
+    }
+
+    uint32_t delivered() const {
+        return delivered_;
+    }
+
+    uint32_t corrupt() const {
+        return corrupt_;
+    }
+
+private:
+    static constexpr uint16_t kRecordMagic = 0x4f4d;
+    static constexpr uint32_t kSectorMagic = 0x424f564d;
+    // The CRC covers the lengths, QoS, retain flag and magic, then the topic and payload.
+    static constexpr uint32_t kCrcSpan = 8;
+
+    enum class State : uint8_t { Sent, Delivered, Failed };
+
+    struct Flight {
+        uint32_t id;
+        uint32_t address;
+        State state;
+    };
+
+    static constexpr uint32_t recordSize(uint32_t message_length) {
+        return (static_cast<uint32_t>(sizeof(RecordHeader)) + message_length + 3) & ~3u;
+    }
+
+    uint32_t sectorStart(uint32_t sector) const {
+        return base_ + sector * kFlashSectorSize;
+    }
+
+    uint32_t sectorEnd(uint32_t sector) const {
+        return sectorStart(sector) + kFlashSectorSize;
+    }
+
+    // Record addresses lie past a sector's header, so an address on a
+    // sector boundary is the end of the sector before it.
+    uint32_t sectorOf(uint32_t address) const {
+        return (address - base_ - 1) / kFlashSectorSize;
+    }
+
+    MvStatus write(uint32_t address, ByteSpan data) {
+        if (data.empty()) return MV_STATUS_OKAY;
+        return mvExternalFlashWriteBlocking(flash_, address, data.length, data.data);
+    }
+
+    void markDelivered(uint32_t address) {
+        static const uint8_t zero[4] = {};
+        // A failure leaves the record pending, so it is at worst sent twice.
+        write(address + offsetof(RecordHeader, pending), ByteSpan(zero, sizeof(zero)));
+    }
+
+    MvStatus readSectorHeader(uint32_t sector, SectorHeader *header) {
+        return mvExternalFlashReadBlocking(flash_, sectorStart(sector), sizeof(*header), reinterpret_cast<uint8_t *>(header));
+    }
+
+    MvStatus startSector(uint32_t sector) {
+        MvStatus status = mvExternalFlashEraseBlocking(flash_, sectorStart(sector), kFlashSectorSize);
+        SectorHeader header = {kSectorMagic, sequence_ + 1};
+        if (status == MV_STATUS_OKAY) {
+            status = write(sectorStart(sector), ByteSpan(reinterpret_cast<const uint8_t *>(&header), sizeof(header)));
+        }
+        if (status != MV_STATUS_OKAY) return status;
+        sequence_++;
+        tail_sector_ = sector;
+        tail_ = sectorStart(sector) + sizeof(SectorHeader);
+        return MV_STATUS_OKAY;
+    }
+
+    void nextSector(uint32_t sector) {
+        // The tail sector has nothing readable past `tail_`.
+        cursor_ = sector == tail_sector_ ? tail_ : sectorStart((sector + 1) % sectors_) + sizeof(SectorHeader);
+    }
+
+    // Walk a sector's records during `open()`, finding the first pending
+    // one and the end of the log.
+    MvStatus scanSector(uint32_t sector, bool *found_head, uint32_t *last) {
+        uint32_t address = sectorStart(sector) + sizeof(SectorHeader);
+        uint32_t end = sectorEnd(sector);
+        uint32_t block_at = 0;
+        uint32_t block_length = 0;
+        *last = 0;
+        while (address + sizeof(RecordHeader) <= end) {
+            if (address < block_at || address + sizeof(RecordHeader) > block_at + block_length) {
+                block_at = address;
+                block_length = end - address < sizeof(buffer_) ? end - address : sizeof(buffer_);
+                MvStatus status = mvExternalFlashReadBlocking(flash_, block_at, block_length, buffer_);
+                if (status != MV_STATUS_OKAY) return status;
+            }
+            RecordHeader header;
+            std::memcpy(&header, buffer_ + (address - block_at), sizeof(header));
+            if (header.topic_length == 0xffff && header.payload_length == 0xffff && header.magic == 0xffff) break;
+            uint32_t size = recordSize(header.topic_length + header.payload_length);
+            if (header.magic != kRecordMagic || address + size > end) {
+                // Interrupted write: nothing more is appended to this sector.
+                address = end;
+                break;
+            }
+            if (header.pending != 0) {
+                pending_++;
+                if (!*found_head) head_ = address;
+                *found_head = true;
+            }
+            *last = address;
+            address += size;
+        }
+        tail_ = address;
+        return MV_STATUS_OKAY;
+    }
+
+    MvStatus verify(uint32_t address, RecordHeader *header, bool *intact) {
+        MvStatus status = mvExternalFlashReadBlocking(flash_, address, sizeof(*header), reinterpret_cast<uint8_t *>(header));
+        if (status != MV_STATUS_OKAY) return status;
+        uint32_t length = header->topic_length + header->payload_length;
+        if (length > MaxMessageSize) {
+            *intact = false;
+            return MV_STATUS_OKAY;
+        }
+        status = mvExternalFlashReadBlocking(flash_, address + sizeof(*header), length, buffer_);
+        if (status != MV_STATUS_OKAY) return status;
+        uint32_t crc = crc32(ByteSpan(reinterpret_cast<const uint8_t *>(header), kCrcSpan));
+        *intact = crc32(ByteSpan(buffer_, length), crc) == header->crc;
+        return MV_STATUS_OKAY;
+    }
+
+    // Retire settled publishes from the front; the head is the oldest
+    // record not yet delivered.
+    void advance() {
+        while (flight_count_ != 0 && flights_[flight_head_].state == State::Delivered) {
+            flight_head_ = (flight_head_ + 1) % Window;
+            flight_count_--;
+        }
+        head_ = flight_count_ != 0 ? flights_[flight_head_].address : cursor_;
+    }
+
+    MvExternalFlashHandle flash_;
+    uint32_t base_;
+    uint32_t sectors_;
+    bool open_ = false;
+    uint32_t head_ = 0;
+    uint32_t cursor_ = 0;
+    uint32_t tail_ = 0;
+    uint32_t tail_sector_ = 0;
+    uint32_t sequence_ = 0;
+    Flight flights_[Window] = {};
+    uint32_t flight_head_ = 0;
+    uint32_t flight_count_ = 0;
+    uint32_t pending_ = 0;
+    uint32_t appended_ = 0;
+    uint32_t delivered_ = 0;
+    uint32_t corrupt_ = 0;
+    uint8_t buffer_[sizeof(RecordHeader) + MaxMessageSize];
+};
+
+}
+
+#endif
@@ -0,0 +1,223 @@
+#ifndef MV_MQTT_PUBLISHER_HPP
+#define MV_MQTT_PUBLISHER_HPP
+
+#include <cstdint>
+
+#include "byte_span.hpp"
+#include "mv_syscalls.h"
+
+namespace mv {
+
+/**
+ *  Keeps up to `Window` publishes outstanding on an MQTT channel and
+ *  matches their responses, which may arrive in any order, by correlation
+ *  id.
+ *
+ *  Outstanding publishes are held in an open-addressed table keyed by
+ *  correlation id, sized at least twice `Window` so lookups stay within a
+ *  probe or two. When the window is full `publish()` returns
+ *  `MV_STATUS_RATELIMITED`, as Microvisor does when the channel's send
+ *  buffer is full, so callers apply one backpressure rule for both: wait
+ *  for a publish response or write space and try again.
+ *
+ *  The publisher does not read the channel itself, since publish responses
+ *  share the readable queue with other data. Call `handleResponse()` when
+ *  `mvMqttGetNextReadableDataType` reports
+ *  `MV_MQTTREADABLEDATATYPE_PUBLISHRESPONSE`.
+ *
+ *  @tparam Window  Most publishes outstanding at once.
+ */
+template <uint32_t Window = 8>
+class MqttPublisher {
+    static_assert(Window > 0, "MqttPublisher needs a window");
+
+public:
+    /**
+     *  Called once per publish with its outcome and the time in
+     *  microseconds from `mvMqttRequestPublish` to the response being read.
+     */
+    using Completion = void (*)(void *context, uint32_t correlation_id, MvMqttRequestState state, uint32_t reason_code,
+                                uint64_t latency_us);
+
+    explicit MqttPublisher(MvChannelHandle handle, Completion done = nullptr)
+        : handle_(handle), done_(done) {}
+
+    MqttPublisher(const MqttPublisher &) = delete;
+    MqttPublisher &operator=(const MqttPublisher &) = delete;
+
+    /**
+     *  Request a publish. Microvisor copies the topic and payload, so they
+     *  need not outlive the call.
+     *
+     *  @param context          Passed to the completion callback for this publish.
+     *  @param correlation_id   If not null, receives the id assigned to the publish.
+     *
+     *  @retval MV_STATUS_RATELIMITED The window or the channel's send buffer is full; nothing was sent.
+     */
+    MvStatus publish(ByteSpan topic, ByteSpan payload, uint32_t qos, bool retain, void *context = nullptr,
+                     uint32_t *correlation_id = nullptr) {
+        if (outstanding_ == Window) return MV_STATUS_RATELIMITED;
+        uint32_t id;
+        do {
+            id = next_id_++;
+        } while (find(id) != kSlots);
+
+        MvMqttPublishRequest request = {id, topic.sized(), payload.sized(), qos, static_cast<uint32_t>(retain ? 1 : 0)};
+        uint64_t sent_at = now();
+        MvStatus status = mvMqttRequestPublish(handle_, &request);
+        if (status != MV_STATUS_OKAY) return status;
+
+        insert(Entry{id, true, sent_at, context});
+        outstanding_++;
+        if (correlation_id != nullptr) *correlation_id = id;
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Read one publish response and complete the matching publish.
+     *  Responses for ids this publisher did not send are counted by
+     *  `unmatched()` and otherwise ignored.
+     */
+    MvStatus handleResponse() {
+        MvMqttPublishResponse response;
+        MvStatus status = mvMqttReadPublishResponse(handle_, &response);
+        if (status != MV_STATUS_OKAY) return status;
+
+        uint32_t slot = find(response.correlation_id);
+        if (slot == kSlots) {
+            unmatched_++;
+            return MV_STATUS_OKAY;
+        }
+        Entry entry = table_[slot];
+        erase(slot);
+        outstanding_--;
+
+        uint64_t latency = now() - entry.sent_at;
+        completed_++;
+        latency_total_ += latency;
+        if (latency > latency_max_) latency_max_ = latency;
+        if (latency < latency_min_) latency_min_ = latency;
+        if (response.request_state != MV_MQTTREQUESTSTATE_REQUESTCOMPLETED) failed_++;
+        if (done_ != nullptr) done_(entry.context, entry.id, response.request_state, response.reason_code, latency);
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Forget every outstanding publish, for example after the channel has
+     *  closed. No completions are called.
+     */
+    void reset() {
+        for (uint32_t i = 0; i < kSlots; ++i) table_[i].used = false;
+        outstanding_ = 0;
+    }
+
+    uint32_t outstanding() const {
+        return outstanding_;
+    }
+
+    bool full() const {
+        return outstanding_ == Window;
+    }
+
+    /**
+     *  Publishes completed, and of those how many Microvisor did not report
+     *  as `MV_MQTTREQUESTSTATE_REQUESTCOMPLETED`.
+     */
+    uint32_t completed() const {
+        return completed_;
+    }
+
+    uint32_t failed() const {
+        return failed_;
+    }
+
+    uint32_t unmatched() const {
+        return unmatched_;
+    }
+
+    /**
+     *  Latency over all completed publishes, in microseconds.
+     */
+    uint64_t latencyMinUs() const {
+        return completed_ == 0 ? 0 : latency_min_;
+    }
+
+    uint64_t latencyMaxUs() const {
+        return latency_max_;
+    }
+
+    uint64_t latencyMeanUs() const {
+        return completed_ == 0 ? 0 : latency_total_ / completed_;
+    }
+
+private:
+    struct Entry {
+        uint32_t id;
+        bool used;
+        uint64_t sent_at;
+        void *context;
+    };
+
+    static constexpr uint32_t slotCount() {
+        uint32_t slots = 1;
+        while (slots < 2 * Window) slots <<= 1;
+        return slots;
+    }
+
+    static constexpr uint32_t kSlots = slotCount();
+
+    static uint32_t home(uint32_t id) {
+        // Fibonacci hashing spreads sequential ids across the table.
+        return ((id * 2654435769u) >> 16) & (kSlots - 1);
+    }
+
+    static uint64_t now() {
+        uint64_t microseconds;
+        mvGetMicroseconds(&microseconds);
+        return microseconds;
+    }
+
+    uint32_t find(uint32_t id) const {
+        for (uint32_t slot = home(id);; slot = (slot + 1) & (kSlots - 1)) {
+            if (!table_[slot].used) return kSlots;
+            if (table_[slot].id == id) return slot;
+        }
+    }
+
+    void insert(const Entry &entry) {
+        uint32_t slot = home(entry.id);
+        while (table_[slot].used) slot = (slot + 1) & (kSlots - 1);
+        table_[slot] = entry;
+    }
+
+    // Linear-probing deletion: pull later members of the cluster back so
+    // no lookup is cut short by the hole.
+    void erase(uint32_t hole) {
+        table_[hole].used = false;
+        for (uint32_t slot = (hole + 1) & (kSlots - 1); table_[slot].used; slot = (slot + 1) & (kSlots - 1)) {
+            uint32_t want = home(table_[slot].id);
+            bool movable = hole <= slot ? (want <= hole || want > slot) : (want <= hole && want > slot);
+            if (movable) {
+                table_[hole] = table_[slot];
+                table_[slot].used = false;
+                hole = slot;
+            }
+        }
+    }
+
+    MvChannelHandle handle_;
+    Completion done_;
+    Entry table_[kSlots] = {};
+    uint32_t next_id_ = 1;
+    uint32_t outstanding_ = 0;
+    uint32_t completed_ = 0;
+    uint32_t failed_ = 0;
+    uint32_t unmatched_ = 0;
+    uint64_t latency_total_ = 0;
+    uint64_t latency_min_ = UINT64_MAX;
+    uint64_t latency_max_ = 0;
+};
+
+}
+
+#endif
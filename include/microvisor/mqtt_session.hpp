@@ -0,0 +1,491 @@
+#ifndef MV_MQTT_SESSION_HPP
+#define MV_MQTT_SESSION_HPP
+
+#include <cstdint>
+
+#include "byte_span.hpp"
+#include "channel_limits.hpp"
+#include "mv_syscalls.h"
+
+namespace mv {
+
+// Microvisor does not document these; they are estimates. The overhead
+// only sizes the next receive buffer after a loss, and a subscribe
+// response with more codes than the limit fails to read rather than
+// overrunning.
+
+/// Bytes each MQTT item occupies in a channel's receive buffer beyond its topic and payload.
+constexpr uint32_t kMqttItemOverhead = 16;
+/// Most subscriptions a single subscribe request may carry.
+constexpr uint32_t kMaxMqttSubscriptions = 8;
+
+/**
+ *  A message copied out of the channel by `MqttSession::next()`. It holds
+ *  a pool buffer until passed to `MqttSession::release()`.
+ */
+struct MqttReceivedMessage {
+    ByteSpan topic;
+    ByteSpan payload;
+    uint32_t correlation_id;
+    uint32_t qos;
+    bool retain;
+    uint32_t slot;
+};
+
+/**
+ *  An MQTT channel that grows its receive buffer when messages are lost.
+ *
+ *  Microvisor drops a message with `MV_MQTTREADABLEDATATYPE_MESSAGELOST`
+ *  when it does not fit the channel's receive buffer, and that buffer is
+ *  fixed when the channel opens. The session records the size of each
+ *  lost message and the largest message received, and when a loss shows
+ *  the buffer is too small it disconnects, reopens the channel with the
+ *  smallest size class (512 bytes doubling up to `MaxReceiveSize`) that
+ *  holds two such messages, reconnects and resubscribes. The connect and
+ *  subscribe requests are the caller's and are reused unchanged; connect
+ *  with `clean_start` clear so the broker redelivers what was lost.
+ *
+ *  The receive buffer and the pool of received messages share one arena
+ *  of `ArenaSize` bytes. The receive buffer takes the front of it at its
+ *  current size class, and the rest is cut into slots of `TopicSize` plus
+ *  the largest payload that buffer can deliver. Received messages are
+ *  copied by `mvMqttReceiveMessage` straight into a free slot, freeing
+ *  Microvisor's receive buffer for the next message while the application
+ *  still works on this one. Growing the receive buffer leaves fewer,
+ *  larger slots, so RAM is spent where the traffic needs it. A reopen
+ *  waits until every pooled message has been released, since their
+ *  correlation ids belong to the old channel and their slots move.
+ *
+ *  A message whose topic is longer than `TopicSize` is read into a slot
+ *  with room moved from its payload to its topic, acknowledged so the
+ *  broker does not redeliver it, and counted by `skippedMessages()`.
+ *
+ *  @tparam ArenaSize       Bytes for the receive buffer and the message pool together.
+ *  @tparam MaxReceiveSize  Largest receive buffer, a power of two multiple of 512.
+ *  @tparam TopicSize       Largest topic a pooled message may carry.
+ */
+template <uint32_t ArenaSize = 12288, uint32_t MaxReceiveSize = 4096, uint32_t TopicSize = 128>
+class MqttSession {
+    static_assert(MaxReceiveSize >= kChannelBufferAlignment && (MaxReceiveSize & (MaxReceiveSize - 1)) == 0,
+                  "Receive size classes are powers of two from 512");
+    static_assert(ArenaSize >= MaxReceiveSize + TopicSize + MaxReceiveSize - kMqttItemOverhead,
+                  "The arena must hold one message slot beside the largest receive buffer");
+
+public:
+    enum class State {
+        Closed,
+        Connecting,
+        Subscribing,
+        Ready,
+        Reopening,
+        Failed,
+    };
+
+    /**
+     *  Handles readable data the session does not consume itself, such as
+     *  publish responses. It should read the item at the head of the queue.
+     */
+    using OtherHandler = void (*)(void *context, MvChannelHandle handle, MvMqttReadableDataType type);
+
+    /**
+     *  Called with `closing` set just before the session disconnects or
+     *  closes its channel, and with `opened` set once a channel is open.
+     */
+    using ChannelHook = void (*)(void *context, MvChannelHandle closing, MvChannelHandle opened);
+
+    /**
+     *  @param send_buffer  512-aligned send buffer for the channel, kept across reopens.
+     *  @param connect      Connect request, reused for each reconnect.
+     *  @param subscribe    Subscribe request made after each connect, or null.
+     */
+    MqttSession(MvNotificationHandle notification_handle, uint32_t notification_tag, MvNetworkHandle network_handle,
+                uint8_t *send_buffer, uint32_t send_buffer_len, const MvMqttConnectRequest *connect,
+                const MvMqttSubscribeRequest *subscribe)
+        : notification_handle_(notification_handle),
+          notification_tag_(notification_tag),
+          network_handle_(network_handle),
+          send_buffer_(send_buffer),
+          send_buffer_len_(send_buffer_len),
+          connect_(connect),
+          subscribe_(subscribe) {}
+
+    MqttSession(const MqttSession &) = delete;
+    MqttSession &operator=(const MqttSession &) = delete;
+
+    void onOther(OtherHandler handler, void *context = nullptr) {
+        other_ = handler;
+        other_context_ = context;
+    }
+
+    /**
+     *  Register a hook for channel changes, for example
+     *  `MqttAckQueue::onChannelChange` to flush acknowledgements in time.
+     */
+    void onChannelChange(ChannelHook hook, void *context = nullptr) {
+        channel_hook_ = hook;
+        channel_hook_context_ = context;
+    }
+
+    /**
+     *  Open the channel with a `receive_size` byte buffer, rounded up to a
+     *  size class, and request the connection.
+     */
+    MvStatus start(uint32_t receive_size = kChannelBufferAlignment) {
+        receive_len_ = sizeClass(receive_size);
+        return open();
+    }
+
+    /**
+     *  Process readable data until a message is available, and copy it
+     *  into a pool buffer. Call when the channel's notification fires, and
+     *  again until it returns something other than `MV_STATUS_OKAY`.
+     *
+     *  @retval MV_STATUS_UNAVAILABLE       Nothing to return: no message, or no slot is free.
+     *  @retval MV_STATUS_WRONGDATAREQUESTED Readable data belongs to no handler; see `onOther()`.
+     */
+    MvStatus next(MqttReceivedMessage *message) {
+        if (state_ == State::Closed) {
+            MvStatus status = open();
+            if (status != MV_STATUS_OKAY) return status;
+        }
+        if (state_ == State::Failed) return MV_STATUS_UNAVAILABLE;
+        if (state_ == State::Reopening && disconnected_) {
+            // Messages that arrived before the disconnect response may still
+            // be held, and the new receive buffer would overlap their slots.
+            if (held_ != 0) return MV_STATUS_UNAVAILABLE;
+            MvStatus status = reopen();
+            if (status != MV_STATUS_OKAY) return status;
+        }
+
+        for (;;) {
+            MvMqttReadableDataType type;
+            MvStatus status = mvMqttGetNextReadableDataType(handle_, &type);
+            if (status == MV_STATUS_CHANNELCLOSED) {
+                // Reopen at the same size on the next call.
+                close(State::Closed);
+                return status;
+            }
+            if (status != MV_STATUS_OKAY) return status;
+
+            switch (type) {
+            case MV_MQTTREADABLEDATATYPE_NONE:
+                if (state_ == State::Ready && grow_to_ > receive_len_ && held_ == 0) {
+                    reopens_++;
+                    if (channel_hook_ != nullptr) channel_hook_(channel_hook_context_, handle_, nullptr);
+                    if (mvMqttRequestDisconnect(handle_) != MV_STATUS_OKAY) return reopen();
+                    state_ = State::Reopening;
+                }
+                return MV_STATUS_UNAVAILABLE;
+
+            case MV_MQTTREADABLEDATATYPE_CONNECTRESPONSE:
+                status = connected();
+                break;
+
+            case MV_MQTTREADABLEDATATYPE_SUBSCRIBERESPONSE:
+                status = subscribed();
+                break;
+
+            case MV_MQTTREADABLEDATATYPE_MESSAGELOST:
+                status = lost();
+                break;
+
+            case MV_MQTTREADABLEDATATYPE_MESSAGERECEIVED: {
+                bool delivered = false;
+                status = receive(message, &delivered);
+                if (delivered) return MV_STATUS_OKAY;
+                break;
+            }
+
+            case MV_MQTTREADABLEDATATYPE_DISCONNECTRESPONSE: {
+                MvMqttDisconnectResponse response;
+                mvMqttReadDisconnectResponse(handle_, &response);
+                if (state_ == State::Reopening) {
+                    disconnected_ = true;
+                    if (held_ != 0) return MV_STATUS_UNAVAILABLE;
+                    status = reopen();
+                    if (status != MV_STATUS_OKAY) return status;
+                }
+                break;
+            }
+
+            default:
+                if (other_ == nullptr) return MV_STATUS_WRONGDATAREQUESTED;
+                other_(other_context_, handle_, type);
+                MvMqttReadableDataType after;
+                if (mvMqttGetNextReadableDataType(handle_, &after) == MV_STATUS_OKAY && after == type) {
+                    return MV_STATUS_WRONGDATAREQUESTED;
+                }
+                break;
+            }
+            if (status != MV_STATUS_OKAY) return status;
+        }
+    }
+
+    /**
+     *  Return a message's slot. A reopen waiting for the pool to empty
+     *  happens on the next call to `next()`.
+     */
+    void release(const MqttReceivedMessage &message) {
+        if (message.slot < slotCount(receive_len_)) held_ &= ~(1u << message.slot);
+    }
+
+    MvChannelHandle handle() const {
+        return handle_;
+    }
+
+    State state() const {
+        return state_;
+    }
+
+    /**
+     *  The outcome of the last connect request.
+     */
+    MvMqttConnectResponse connectResponse() const {
+        return connect_response_;
+    }
+
+    uint32_t receiveBufferSize() const {
+        return receive_len_;
+    }
+
+    /**
+     *  Messages the application may hold at once at the current receive
+     *  buffer size.
+     */
+    uint32_t poolSlots() const {
+        return slotCount(receive_len_);
+    }
+
+    uint32_t lostMessages() const {
+        return lost_;
+    }
+
+    /**
+     *  Receive buffer bytes needed by the largest lost message.
+     */
+    uint32_t largestLost() const {
+        return largest_lost_;
+    }
+
+    /**
+     *  Receive buffer bytes used by the largest message received.
+     */
+    uint32_t highWater() const {
+        return high_water_;
+    }
+
+    uint32_t reopens() const {
+        return reopens_;
+    }
+
+    /**
+     *  Messages acknowledged and dropped because their topic was longer
+     *  than `TopicSize`.
+     */
+    uint32_t skippedMessages() const {
+        return skipped_;
+    }
+
+private:
+    static constexpr uint32_t sizeClass(uint32_t bytes) {
+        uint32_t size = kChannelBufferAlignment;
+        while (size < bytes && size < MaxReceiveSize) size <<= 1;
+        return size;
+    }
+
+    // A slot holds a topic and the largest payload a receive buffer of
+    // `receive_len` bytes can deliver.
+    static constexpr uint32_t slotSize(uint32_t receive_len) {
+        return TopicSize + receive_len - kMqttItemOverhead;
+    }
+
+    // Slot occupancy is a 32-bit mask.
+    static constexpr uint32_t slotCount(uint32_t receive_len) {
+        uint32_t count = (ArenaSize - receive_len) / slotSize(receive_len);
+        return count < 32 ? count : 32;
+    }
+
+    uint8_t *slot(uint32_t index) {
+        return arena_ + receive_len_ + index * slotSize(receive_len_);
+    }
+
+    // The first free slot, or `slotCount()` if every one is held.
+    uint32_t freeSlot() const {
+        uint32_t index = 0;
+        while (index < slotCount(receive_len_) && (held_ & (1u << index)) != 0) ++index;
+        return index;
+    }
+
+    MvStatus open() {
+        MvOpenChannelParams params = {};
+        params.version = 1;
+        params.v1.notification_handle = notification_handle_;
+        params.v1.notification_tag = notification_tag_;
+        params.v1.network_handle = network_handle_;
+        params.v1.receive_buffer = arena_;
+        params.v1.receive_buffer_len = receive_len_;
+        params.v1.send_buffer = send_buffer_;
+        params.v1.send_buffer_len = send_buffer_len_;
+        params.v1.channel_type = MV_CHANNELTYPE_MQTT;
+
+        MvStatus status = mvOpenChannel(&params, &handle_);
+        if (status != MV_STATUS_OKAY) {
+            handle_ = nullptr;
+            state_ = State::Closed;
+            return status;
+        }
+        status = mvMqttRequestConnect(handle_, connect_);
+        if (status != MV_STATUS_OKAY) {
+            close(State::Failed);
+            return status;
+        }
+        state_ = State::Connecting;
+        if (channel_hook_ != nullptr) channel_hook_(channel_hook_context_, nullptr, handle_);
+        return MV_STATUS_OKAY;
+    }
+
+    void close(State state) {
+        if (handle_ != nullptr) {
+            if (channel_hook_ != nullptr) channel_hook_(channel_hook_context_, handle_, nullptr);
+            mvCloseChannel(&handle_);
+        }
+        handle_ = nullptr;
+        state_ = state;
+        disconnected_ = false;
+    }
+
+    MvStatus reopen() {
+        close(State::Closed);
+        receive_len_ = grow_to_;
+        return open();
+    }
+
+    MvStatus connected() {
+        MvStatus status = mvMqttReadConnectResponse(handle_, &connect_response_);
+        if (status != MV_STATUS_OKAY) return status;
+        if (connect_response_.request_state != MV_MQTTREQUESTSTATE_REQUESTCOMPLETED) {
+            close(State::Failed);
+            return MV_STATUS_UNAVAILABLE;
+        }
+        if (subscribe_ == nullptr || subscribe_->num_subscriptions == 0) {
+            state_ = State::Ready;
+            return MV_STATUS_OKAY;
+        }
+        state_ = State::Subscribing;
+        return mvMqttRequestSubscribe(handle_, subscribe_);
+    }
+
+    MvStatus subscribed() {
+        MvMqttRequestState request_state;
+        uint32_t correlation_id;
+        uint32_t codes[kMaxMqttSubscriptions];
+        uint32_t codes_len;
+        MvMqttSubscribeResponse response = {&request_state, &correlation_id, codes, sizeof(codes), &codes_len};
+        MvStatus status = mvMqttReadSubscribeResponse(handle_, &response);
+        if (status != MV_STATUS_OKAY) return status;
+        if (state_ == State::Subscribing) state_ = State::Ready;
+        return MV_STATUS_OKAY;
+    }
+
+    MvStatus lost() {
+        MvMqttLostMessageReason reason;
+        uint8_t local[TopicSize];
+        uint32_t topic_len = 0;
+        uint32_t message_len = 0;
+        MvMqttLostMessageInfo info = {&reason, {local, sizeof(local), &topic_len}, &message_len};
+        // A free slot leaves room for a topic longer than `TopicSize`.
+        uint32_t index = freeSlot();
+        if (index < slotCount(receive_len_)) info.topic = {slot(index), slotSize(receive_len_), &topic_len};
+        MvStatus status = mvMqttReceiveLostMessageInfo(handle_, &info);
+        if (status != MV_STATUS_OKAY) return status;
+
+        lost_++;
+        uint32_t needed = kMqttItemOverhead + topic_len + message_len;
+        if (needed > largest_lost_) largest_lost_ = needed;
+        // Room for two such messages, so one can arrive while the other is read.
+        uint32_t size = sizeClass(2 * needed);
+        if (size > grow_to_) grow_to_ = size;
+        return MV_STATUS_OKAY;
+    }
+
+    /**
+     *  Copy the message at the head of the queue into a free slot. Sets
+     *  `delivered` if `message` holds it, and leaves it clear if no slot is
+     *  free or the message was skipped.
+     */
+    MvStatus receive(MqttReceivedMessage *message, bool *delivered) {
+        uint32_t index = freeSlot();
+        if (index == slotCount(receive_len_)) return MV_STATUS_UNAVAILABLE;
+
+        uint8_t *buffer = slot(index);
+        uint32_t size = slotSize(receive_len_);
+        uint32_t topic_len = 0;
+        uint32_t payload_len = 0;
+        uint8_t retain = 0;
+        MvStatus status = read(message, buffer, TopicSize, &topic_len, &payload_len, &retain);
+        if (status == MV_STATUS_INVALIDBUFFERSIZE) {
+            // The topic is longer than `TopicSize`. Topic and payload
+            // together fit the slot's payload space, so widening the topic
+            // a `TopicSize` at a time reaches a split that holds both.
+            for (uint32_t split = 2 * TopicSize; status == MV_STATUS_INVALIDBUFFERSIZE && split <= size;
+                 split += TopicSize) {
+                status = read(message, buffer, split, &topic_len, &payload_len, &retain);
+            }
+            if (status != MV_STATUS_OKAY) return status;
+            skipped_++;
+            if (message->qos != 0) mvMqttAcknowledgeMessage(handle_, message->correlation_id);
+            return MV_STATUS_OKAY;
+        }
+        if (status != MV_STATUS_OKAY) return status;
+
+        held_ |= 1u << index;
+        uint32_t used = kMqttItemOverhead + topic_len + payload_len;
+        if (used > high_water_) high_water_ = used;
+        message->topic = ByteSpan(buffer, topic_len);
+        message->payload = ByteSpan(buffer + TopicSize, payload_len);
+        message->retain = retain != 0;
+        message->slot = index;
+        *delivered = true;
+        return MV_STATUS_OKAY;
+    }
+
+    // Read the head message into `buffer`, the topic in its first `split` bytes.
+    MvStatus read(MqttReceivedMessage *message, uint8_t *buffer, uint32_t split, uint32_t *topic_len,
+                  uint32_t *payload_len, uint8_t *retain) {
+        MvMqttMessage request = {&message->correlation_id,
+                                 {buffer, split, topic_len},
+                                 {buffer + split, slotSize(receive_len_) - split, payload_len},
+                                 &message->qos,
+                                 retain};
+        return mvMqttReceiveMessage(handle_, &request);
+    }
+
+    alignas(kChannelBufferAlignment) uint8_t arena_[ArenaSize];
+    MvNotificationHandle notification_handle_;
+    uint32_t notification_tag_;
+    MvNetworkHandle network_handle_;
+    uint8_t *send_buffer_;
+    uint32_t send_buffer_len_;
+    const MvMqttConnectRequest *connect_;
+    const MvMqttSubscribeRequest *subscribe_;
+    OtherHandler other_ = nullptr;
+    void *other_context_ = nullptr;
+    ChannelHook channel_hook_ = nullptr;
+    void *channel_hook_context_ = nullptr;
+    MvChannelHandle handle_ = nullptr;
+    State state_ = State::Closed;
+    MvMqttConnectResponse connect_response_ = {};
+    uint32_t receive_len_ = kChannelBufferAlignment;
+    uint32_t grow_to_ = 0;
+    uint32_t held_ = 0;
+    bool disconnected_ = false;
+    uint32_t lost_ = 0;
+    uint32_t largest_lost_ = 0;
+    uint32_t high_water_ = 0;
+    uint32_t reopens_ = 0;
+    uint32_t skipped_ = 0;
+};
+
+}
+
+#endif
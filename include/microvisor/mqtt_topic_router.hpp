@@ -0,0 +1,231 @@
+#ifndef MV_MQTT_TOPIC_ROUTER_HPP
+#define MV_MQTT_TOPIC_ROUTER_HPP
+
+#include <cstdint>
+
+#include "byte_span.hpp"
+#include "hash.hpp"
+#include "mv_syscalls.h"
+
+namespace mv {
+
+/**
+ *  Routes received MQTT messages to handlers by topic filter, with MQTT's
+ *  `+` and `#` wildcards, in time proportional to the topic's length.
+ *
+ *  Filters form a trie with one node per level. Literal levels are found
+ *  through a hash table keyed by parent node and level text, so a node
+ *  with hundreds of children costs the same to pass through as one with
+ *  a single child. Each node also links directly to its `+` and `#`
+ *  children. As in MQTT, wildcards at the first level do not match topics
+ *  beginning with `$`, and `a/#` also matches `a`.
+ *
+ *  The filter text is referenced, not copied, so it must outlive the
+ *  router, as the topics in an `MvMqttSubscription` array passed to
+ *  `mvMqttRequestSubscribe` usually do.
+ *
+ *  @tparam MaxNodes    Trie nodes, at most one per distinct filter level, plus the root.
+ *  @tparam MaxRoutes   Handlers registered across all filters.
+ */
+template <uint32_t MaxNodes = 64, uint32_t MaxRoutes = 32>
+class MqttTopicRouter {
+    static_assert(MaxNodes >= 2 && MaxNodes < 0xffff, "Node indices are 16 bits");
+    static_assert(MaxRoutes > 0 && MaxRoutes < 0xffff, "Route indices are 16 bits");
+
+public:
+    using Handler = void (*)(void *context, ByteSpan topic, ByteSpan payload, uint32_t qos);
+
+    MqttTopicRouter() = default;
+    MqttTopicRouter(const MqttTopicRouter &) = delete;
+    MqttTopicRouter &operator=(const MqttTopicRouter &) = delete;
+
+    /**
+     *  Call `handler` for messages whose topic matches `filter`. Returns
+     *  false if the filter is malformed or the router is full.
+     */
+    bool add(ByteSpan filter, Handler handler, void *context = nullptr) {
+        if (route_count_ == MaxRoutes || !validFilter(filter)) return false;
+
+        uint32_t node = 0;
+        for (uint32_t start = 0; start <= filter.length;) {
+            uint32_t end = levelEnd(filter, start);
+            ByteSpan level = filter.subspan(start, end - start);
+            node = child(node, level);
+            if (node == kNone) return false;
+            start = end + 1;
+        }
+        routes_[route_count_] = Route{handler, context, nodes_[node].first_route};
+        nodes_[node].first_route = static_cast<uint16_t>(++route_count_);
+        return true;
+    }
+
+    /**
+     *  Add every filter of a subscribe request, all routed to `handler`.
+     */
+    bool add(const MvMqttSubscription *subscriptions, uint32_t count, Handler handler, void *context = nullptr) {
+        for (uint32_t i = 0; i < count; ++i) {
+            if (!add(ByteSpan(subscriptions[i].topic), handler, context)) return false;
+        }
+        return true;
+    }
+
+    /**
+     *  Add each filter of a subscribe request with its own handler and
+     *  context; `contexts` may be null.
+     */
+    bool add(const MvMqttSubscription *subscriptions, uint32_t count, const Handler *handlers, void *const *contexts) {
+        for (uint32_t i = 0; i < count; ++i) {
+            if (!add(ByteSpan(subscriptions[i].topic), handlers[i], contexts != nullptr ? contexts[i] : nullptr)) return false;
+        }
+        return true;
+    }
+
+    /**
+     *  Call every handler whose filter matches `topic`. Returns the number
+     *  called.
+     */
+    uint32_t dispatch(ByteSpan topic, ByteSpan payload, uint32_t qos) {
+        Message message = {topic, payload, qos, 0};
+        match(0, message, 0);
+        if (message.calls == 0) unmatched_++;
+        return message.calls;
+    }
+
+    /**
+     *  Messages that matched no filter.
+     */
+    uint32_t unmatched() const {
+        return unmatched_;
+    }
+
+    uint32_t nodes() const {
+        return node_count_;
+    }
+
+private:
+    static constexpr uint16_t kNone = 0xffff;
+
+    struct Node {
+        uint16_t plus = kNone;
+        uint16_t hash = kNone;
+        uint16_t first_route = 0;
+    };
+
+    struct Route {
+        Handler handler;
+        void *context;
+        uint16_t next;
+    };
+
+    struct Edge {
+        uint32_t key = 0;
+        uint16_t parent = kNone;
+        uint16_t child = kNone;
+        ByteSpan level;
+    };
+
+    struct Message {
+        ByteSpan topic;
+        ByteSpan payload;
+        uint32_t qos;
+        uint32_t calls;
+    };
+
+    static constexpr uint32_t edgeCount() {
+        uint32_t slots = 1;
+        while (slots < 2 * MaxNodes) slots <<= 1;
+        return slots;
+    }
+
+    static constexpr uint32_t kEdges = edgeCount();
+
+    static uint32_t levelEnd(ByteSpan text, uint32_t start) {
+        while (start < text.length && text.data[start] != '/') ++start;
+        return start;
+    }
+
+    static bool validFilter(ByteSpan filter) {
+        if (filter.empty()) return false;
+        for (uint32_t i = 0; i < filter.length; ++i) {
+            uint8_t c = filter.data[i];
+            if (c != '+' && c != '#') continue;
+            // Wildcards occupy a whole level, and `#` only the last.
+            if (i > 0 && filter.data[i - 1] != '/') return false;
+            if (i + 1 < filter.length && (c == '#' || filter.data[i + 1] != '/')) return false;
+        }
+        return true;
+    }
+
+    static uint32_t edgeKey(uint32_t parent, ByteSpan level) {
+        return fnv1a(level, parent);
+    }
+
+    uint32_t findEdge(uint32_t parent, ByteSpan level, uint32_t key) const {
+        for (uint32_t slot = key & (kEdges - 1);; slot = (slot + 1) & (kEdges - 1)) {
+            const Edge &edge = edges_[slot];
+            if (edge.child == kNone) return slot;
+            if (edge.key == key && edge.parent == parent && edge.level == level) return slot;
+        }
+    }
+
+    uint16_t newNode() {
+        if (node_count_ == MaxNodes) return kNone;
+        return static_cast<uint16_t>(node_count_++);
+    }
+
+    uint16_t child(uint32_t parent, ByteSpan level) {
+        Node &node = nodes_[parent];
+        if (level.length == 1 && (level.data[0] == '+' || level.data[0] == '#')) {
+            uint16_t &wildcard = level.data[0] == '+' ? node.plus : node.hash;
+            if (wildcard == kNone) wildcard = newNode();
+            return wildcard;
+        }
+        uint32_t key = edgeKey(parent, level);
+        Edge &edge = edges_[findEdge(parent, level, key)];
+        if (edge.child == kNone) {
+            uint16_t created = newNode();
+            if (created == kNone) return kNone;
+            edge = Edge{key, static_cast<uint16_t>(parent), created, level};
+        }
+        return edge.child;
+    }
+
+    void fire(uint32_t node, Message &message) {
+        for (uint32_t route = nodes_[node].first_route; route != 0; route = routes_[route - 1].next) {
+            const Route &entry = routes_[route - 1];
+            entry.handler(entry.context, message.topic, message.payload, message.qos);
+            message.calls++;
+        }
+    }
+
+    // `start` is the offset of the next topic level, or past the end once
+    // every level has been consumed.
+    void match(uint32_t node, Message &message, uint32_t start) {
+        const Node &current = nodes_[node];
+        ByteSpan topic = message.topic;
+        bool wildcards = start != 0 || topic.empty() || topic.data[0] != '$';
+
+        if (current.hash != kNone && wildcards) fire(current.hash, message);
+        if (start > topic.length) {
+            fire(node, message);
+            return;
+        }
+
+        uint32_t end = levelEnd(topic, start);
+        ByteSpan level = topic.subspan(start, end - start);
+        const Edge &edge = edges_[findEdge(node, level, edgeKey(node, level))];
+        if (edge.child != kNone) match(edge.child, message, end + 1);
+        if (current.plus != kNone && wildcards) match(current.plus, message, end + 1);
+    }
+
+    Node nodes_[MaxNodes];
+    Edge edges_[kEdges];
+    Route routes_[MaxRoutes];
+    uint32_t node_count_ = 1;
+    uint32_t route_count_ = 0;
+    uint32_t unmatched_ = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef MV_NOTIFICATION_RING_HPP
+#define MV_NOTIFICATION_RING_HPP
+
+#include <atomic>
+#include <cstdint>
+
+#include "mv_syscalls.h"
+#ifdef MV_SYSCALL_TRACE
+#include "trace_ring.h"
+#endif
+
+namespace mv {
+
+/**
+ *  Consumer for the notification buffer passed to `mvSetupNotifications`.
+ *
+ *  Microvisor fills the buffer in order, wrapping at the end, and a slot is
+ *  free again once the application zeroes its `event_type`. `drain()` is
+ *  intended to be the whole body of the notification IRQ handler: it walks
+ *  forward from the last consumed slot only as far as the newest entry,
+ *  issues a single acquire fence for the batch, releases each slot as soon
+ *  as it is copied and dispatches by `tag` through a flat table.
+ *
+ *  Microvisor cannot write into an occupied slot, so a drain that finds
+ *  every slot occupied means notifications may have been dropped. Those
+ *  drains are counted by `overflows()`; size `Capacity` so it stays zero.
+ *
+ *  With `MV_SYSCALL_TRACE`, each notification is also added to the trace
+ *  ring in `trace_ring.h`.
+ *
+ *  @tparam Capacity    Number of `MvNotification` entries in the buffer (at least 2).
+ *  @tparam MaxTags     Size of the dispatch table. Tags at or above this go to the fallback handler.
+ */
+template <uint32_t Capacity, uint32_t MaxTags = 16>
+class NotificationRing {
+    static_assert(Capacity >= 2, "Microvisor requires a notification buffer of at least 32 bytes");
+
+public:
+    using Handler = void (*)(void *context, const MvNotification &notification);
+
+    NotificationRing() = default;
+    NotificationRing(const NotificationRing &) = delete;
+    NotificationRing &operator=(const NotificationRing &) = delete;
+
+    /**
+     *  The parameters for `mvSetupNotifications` describing this ring's buffer.
+     */
+    MvNotificationSetup setup(uint32_t irq) {
+        return MvNotificationSetup{irq, entries_, sizeof(entries_)};
+    }
+
+    /**
+     *  Register the buffer with Microvisor. The application must still
+     *  configure and enable `irq` itself and call `drain()` from its handler.
+     */
+    MvStatus open(uint32_t irq, MvNotificationHandle *handle_out) {
+        MvNotificationSetup params = setup(irq);
+        return mvSetupNotifications(&params, handle_out);
+    }
+
+    /**
+     *  Route notifications carrying `tag` to `handler`. Returns false if
+     *  `tag` does not fit the dispatch table.
+     */
+    bool on(uint32_t tag, Handler handler, void *context = nullptr) {
+        if (tag >= MaxTags) return false;
+        handlers_[tag] = {handler, context};
+        return true;
+    }
+
+    /**
+     *  Handler for tags with no entry in the dispatch table.
+     */
+    void onUnhandled(Handler handler, void *context = nullptr) {
+        fallback_ = {handler, context};
+    }
+
+    /**
+     *  Consume and dispatch every notification written since the last call.
+     *  Returns the number consumed. Must not be called concurrently with itself.
+     */
+    uint32_t drain() {
+        uint32_t count = 0;
+        uint32_t index = read_;
+        while (count < Capacity &&
+               __atomic_load_n(&entries_[index].event_type, __ATOMIC_RELAXED) != MV_EVENTTYPE_NOEVENT) {
+            ++count;
+            index = next(index);
+        }
+        if (count == 0) return 0;
+        if (count == Capacity) overflows_.fetch_add(1, std::memory_order_relaxed);
+
+        // Pairs with Microvisor publishing each entry's `event_type` last.
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        for (uint32_t i = 0; i < count; ++i) {
+            MvNotification &slot = entries_[read_];
+            MvNotification notification = {slot.microseconds, slot.event_type, slot.tag};
+            __atomic_store_n(&slot.event_type, MV_EVENTTYPE_NOEVENT, __ATOMIC_RELEASE);
+            read_ = next(read_);
+#ifdef MV_SYSCALL_TRACE
+            mvTraceNotification(&notification);
+#endif
+            dispatch(notification);
+        }
+        consumed_.fetch_add(count, std::memory_order_relaxed);
+        return count;
+    }
+
+    /**
+     *  Total notifications consumed by `drain()`.
+     */
+    uint32_t consumed() const {
+        return consumed_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     *  Drains that found the buffer full, each implying lost notifications.
+     */
+    uint32_t overflows() const {
+        return overflows_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     *  Notifications whose tag had no handler and no fallback.
+     */
+    uint32_t unhandled() const {
+        return unhandled_.load(std::memory_order_relaxed);
+    }
+
+    static constexpr uint32_t capacity() {
+        return Capacity;
+    }
+
+private:
+    struct Entry {
+        Handler handler;
+        void *context;
+    };
+
+    static uint32_t next(uint32_t index) {
+        return index + 1 == Capacity ? 0 : index + 1;
+    }
+
+    void dispatch(const MvNotification &notification) {
+        const Entry &entry = notification.tag < MaxTags ? handlers_[notification.tag] : fallback_;
+        const Entry &target = entry.handler != nullptr ? entry : fallback_;
+        if (target.handler == nullptr) {
+            unhandled_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        target.handler(target.context, notification);
+    }
+
+    alignas(8) MvNotification entries_[Capacity] = {};
+    uint32_t read_ = 0;
+    Entry handlers_[MaxTags] = {};
+    Entry fallback_ = {};
+    std::atomic<uint32_t> consumed_{0};
+    std::atomic<uint32_t> overflows_{0};
+    std::atomic<uint32_t> unhandled_{0};
+};
+
+}
+
+#endif
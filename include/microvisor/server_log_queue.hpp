@@ -0,0 +1,368 @@
+#ifndef MV_SERVER_LOG_QUEUE_HPP
+#define MV_SERVER_LOG_QUEUE_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#include "byte_span.hpp"
+#include "decimal.h"
+#include "mv_syscalls.h"
+
+namespace mv {
+
+enum class LogSeverity : uint8_t { Error, Warning, Info, Debug };
+
+/**
+ *  Stages server log messages in RAM and feeds them to `mvServerLog` from
+ *  `poll()` as its buffer drains, so `log()` never waits or retries.
+ *
+ *  - A message identical to the newest queued one, or to the last sent
+ *    within `coalesce_us`, is counted rather than queued, and goes out
+ *    as "repeated N more times".
+ *  - Each severity can be rate limited with a token bucket.
+ *  - Once the server disables logging, `log()` drops messages without an
+ *    NSC call until `retry_us` has passed.
+ *  - Every `report_us`, if messages were dropped, a summary of the drop
+ *    counters is logged.
+ *
+ *  Messages that do not fit the staging ring are dropped and counted.
+ *  Call `log()` and `poll()` from the main loop, not from interrupts.
+ *
+ *  @tparam Capacity    Bytes of staged messages, each taking its length plus eight.
+ *  @tparam MaxMessage  Longest message; longer ones are truncated. The last one sent is kept
+ *                      to match repeats of it.
+ */
+template <uint32_t Capacity = 2048, uint32_t MaxMessage = 256>
+class ServerLogQueue {
+    static_assert(Capacity % 4 == 0 && Capacity >= 2 * (MaxMessage + 8), "Capacity must be word aligned and hold two messages");
+
+public:
+    static constexpr uint32_t kSeverities = 4;
+
+    /**
+     *  @param coalesce_us  How long after sending a message a repeat of it is still counted.
+     *  @param retry_us     How long to drop messages after the server disables logging.
+     *  @param report_us    Interval between drop summaries; zero for none.
+     */
+    explicit ServerLogQueue(uint32_t coalesce_us = 1000000, uint32_t retry_us = 60000000, uint32_t report_us = 60000000)
+        : coalesce_us_(coalesce_us), retry_us_(retry_us), report_us_(report_us) {}
+
+    ServerLogQueue(const ServerLogQueue &) = delete;
+    ServerLogQueue &operator=(const ServerLogQueue &) = delete;
+
+    /**
+     *  Allow `severity` `per_second` messages on average, in bursts of up
+     *  to `burst`. Zero `per_second` removes the limit.
+     */
+    void setRateLimit(LogSeverity severity, uint32_t per_second, uint32_t burst) {
+        Bucket &bucket = buckets_[static_cast<uint32_t>(severity)];
+        bucket.per_second = per_second;
+        bucket.burst = burst != 0 ? burst : 1;
+        bucket.tokens = static_cast<uint64_t>(bucket.burst) * kTokenScale;
+        bucket.updated = 0;
+    }
+
+    /**
+     *  Queue `message`. Returns false if it was dropped.
+     */
+    bool log(LogSeverity severity, ByteSpan message) {
+        uint64_t now;
+        mvGetMicroseconds(&now);
+        if (disabled_) {
+            if (now - disabled_at_ < retry_us_) {
+                dropped_disabled_++;
+                return false;
+            }
+            disabled_ = false;
+        }
+        if (message.length > MaxMessage) message.length = MaxMessage;
+
+        // Repeats of the newest queued message, or of the last one sent.
+        if (count_ != 0) {
+            Entry &newest = entryAt(newest_);
+            if (newest.severity == static_cast<uint8_t>(severity) && newest.length == message.length &&
+                std::memcmp(bytes_ + newest_ + sizeof(Entry), message.data, message.length) == 0) {
+                newest.repeats++;
+                coalesced_++;
+                return true;
+            }
+        } else if (sent_valid_ && sent_severity_ == static_cast<uint8_t>(severity) && sent_length_ == message.length &&
+                   std::memcmp(sent_text_, message.data, message.length) == 0 && now - sent_at_ < coalesce_us_) {
+            repeats_++;
+            coalesced_++;
+            return true;
+        }
+        flushRepeats();
+
+        Bucket &bucket = buckets_[static_cast<uint32_t>(severity)];
+        if (bucket.per_second != 0 && !bucket.take(now)) {
+            dropped_rate_[static_cast<uint32_t>(severity)]++;
+            return false;
+        }
+        if (!push(severity, message)) {
+            dropped_full_++;
+            return false;
+        }
+        return true;
+    }
+
+    bool log(LogSeverity severity, const char *message) {
+        return log(severity, ByteSpan(message));
+    }
+
+    /**
+     *  Send queued messages until `mvServerLog` has no room, and log the
+     *  drop summary when it is due. Call from the main loop.
+     */
+    void poll() {
+        uint64_t now;
+        mvGetMicroseconds(&now);
+        if (repeats_ != 0 && count_ == 0 && now - sent_at_ >= coalesce_us_) flushRepeats();
+        if (report_us_ != 0 && now - reported_at_ >= report_us_) {
+            reported_at_ = now;
+            report();
+        }
+        if (disabled_) return;
+
+        while (count_ != 0) {
+            const Entry &entry = entryAt(head_);
+            ByteSpan text(bytes_ + head_ + sizeof(Entry), entry.length);
+            uint32_t length = entry.length;
+            const uint8_t *message = text.data;
+            if (entry.repeats != 0) {
+                length = compose(text, entry.repeats);
+                message = scratch_;
+            }
+            MvStatus status = mvServerLog(message, static_cast<uint16_t>(length));
+            if (status == MV_STATUS_INVALIDBUFFERSIZE || status == MV_STATUS_UNAVAILABLE) return;
+            if (status == MV_STATUS_LOGGINGDISABLEDBYSERVER) {
+                disabled_ = true;
+                disabled_at_ = now;
+                dropped_disabled_ += count_;
+                clear();
+                return;
+            }
+            if (status == MV_STATUS_OKAY) {
+                sent_++;
+                std::memcpy(sent_text_, text.data, text.length);
+                sent_length_ = entry.length;
+                sent_severity_ = entry.severity;
+                sent_valid_ = true;
+                sent_at_ = now;
+            } else {
+                dropped_failed_++;
+            }
+            pop();
+        }
+    }
+
+    /**
+     *  Messages queued, sent, and counted as repeats of another.
+     */
+    uint32_t queued() const {
+        return count_;
+    }
+
+    uint32_t sent() const {
+        return sent_;
+    }
+
+    uint32_t coalesced() const {
+        return coalesced_;
+    }
+
+    /**
+     *  Messages dropped by the rate limit for `severity`, because the
+     *  ring was full, while the server had disabled logging, and because
+     *  `mvServerLog` refused them.
+     */
+    uint32_t droppedByRate(LogSeverity severity) const {
+        return dropped_rate_[static_cast<uint32_t>(severity)];
+    }
+
+    uint32_t droppedFull() const {
+        return dropped_full_;
+    }
+
+    uint32_t droppedDisabled() const {
+        return dropped_disabled_;
+    }
+
+    uint32_t droppedFailed() const {
+        return dropped_failed_;
+    }
+
+    bool disabledByServer() const {
+        return disabled_;
+    }
+
+private:
+    static constexpr uint64_t kTokenScale = 1000000;
+
+    struct Entry {
+        uint16_t length;
+        uint8_t severity;
+        uint8_t reserved;
+        uint32_t repeats;
+    };
+
+    struct Bucket {
+        uint32_t per_second = 0;
+        uint32_t burst = 1;
+        // Messages allowed, in millionths.
+        uint64_t tokens = 0;
+        uint64_t updated = 0;
+
+        bool take(uint64_t now) {
+            if (updated != 0) {
+                tokens += (now - updated) * per_second;
+                uint64_t full = static_cast<uint64_t>(burst) * kTokenScale;
+                if (tokens > full) tokens = full;
+            }
+            updated = now;
+            if (tokens < kTokenScale) return false;
+            tokens -= kTokenScale;
+            return true;
+        }
+    };
+
+    static uint32_t sizeFor(uint32_t length) {
+        return (static_cast<uint32_t>(sizeof(Entry)) + length + 3) & ~3u;
+    }
+
+    Entry &entryAt(uint32_t offset) {
+        return *reinterpret_cast<Entry *>(bytes_ + offset);
+    }
+
+    // The ring keeps each entry contiguous: when one does not fit before
+    // the end, it goes at the start and `end_` marks where reading wraps.
+    bool push(LogSeverity severity, ByteSpan message) {
+        uint32_t size = sizeFor(message.length);
+        uint32_t at;
+        if (count_ == 0) {
+            head_ = tail_ = 0;
+            wrapped_ = false;
+        }
+        if (!wrapped_ && Capacity - tail_ >= size) {
+            at = tail_;
+        } else if (!wrapped_ && head_ >= size) {
+            end_ = tail_;
+            wrapped_ = true;
+            at = 0;
+        } else if (wrapped_ && head_ - tail_ >= size) {
+            at = tail_;
+        } else {
+            return false;
+        }
+        Entry &entry = entryAt(at);
+        entry.length = static_cast<uint16_t>(message.length);
+        entry.severity = static_cast<uint8_t>(severity);
+        entry.reserved = 0;
+        entry.repeats = 0;
+        std::memcpy(bytes_ + at + sizeof(Entry), message.data, message.length);
+        newest_ = at;
+        tail_ = at + size;
+        count_++;
+        return true;
+    }
+
+    void pop() {
+        head_ += sizeFor(entryAt(head_).length);
+        count_--;
+        if (wrapped_ && head_ == end_) {
+            head_ = 0;
+            wrapped_ = false;
+        }
+    }
+
+    void clear() {
+        count_ = 0;
+        head_ = tail_ = 0;
+        wrapped_ = false;
+    }
+
+    // Compose "<message> (repeated N more times)" in the scratch buffer.
+    uint32_t compose(ByteSpan message, uint32_t repeats) {
+        std::memcpy(scratch_, message.data, message.length);
+        uint32_t length = message.length;
+        length = append(length, " (repeated ");
+        length = appendNumber(length, repeats);
+        return append(length, " more times)");
+    }
+
+    uint32_t append(uint32_t length, const char *text) {
+        while (*text != '\0' && length < sizeof(scratch_)) scratch_[length++] = static_cast<uint8_t>(*text++);
+        return length;
+    }
+
+    uint32_t appendNumber(uint32_t length, uint32_t value) {
+        return mvAppendDecimal(reinterpret_cast<char *>(scratch_), length, sizeof(scratch_), value);
+    }
+
+    // Queue "last message repeated N times" for repeats of the last
+    // message sent.
+    void flushRepeats() {
+        if (repeats_ == 0) return;
+        uint32_t length = append(0, "last message repeated ");
+        length = appendNumber(length, repeats_);
+        length = append(length, " times");
+        repeats_ = 0;
+        if (!push(LogSeverity::Info, ByteSpan(scratch_, length))) dropped_full_++;
+    }
+
+    void report() {
+        uint32_t rate = 0;
+        for (uint32_t dropped : dropped_rate_) rate += dropped;
+        uint32_t total = rate + dropped_full_ + dropped_disabled_ + dropped_failed_;
+        if (total == reported_total_) return;
+        reported_total_ = total;
+        uint32_t length = append(0, "log: dropped ");
+        length = appendNumber(length, rate);
+        length = append(length, " rate limited (E/W/I/D ");
+        for (uint32_t i = 0; i < kSeverities; ++i) {
+            if (i != 0) length = append(length, "/");
+            length = appendNumber(length, dropped_rate_[i]);
+        }
+        length = append(length, "), ");
+        length = appendNumber(length, dropped_full_);
+        length = append(length, " full, ");
+        length = appendNumber(length, dropped_disabled_);
+        length = append(length, " disabled, ");
+        length = appendNumber(length, dropped_failed_);
+        length = append(length, " refused");
+        if (!disabled_ && !push(LogSeverity::Warning, ByteSpan(scratch_, length))) dropped_full_++;
+    }
+
+    uint32_t coalesce_us_;
+    uint32_t retry_us_;
+    uint32_t report_us_;
+    Bucket buckets_[kSeverities];
+    alignas(4) uint8_t bytes_[Capacity];
+    uint8_t scratch_[MaxMessage + 32];
+    uint32_t head_ = 0;
+    uint32_t tail_ = 0;
+    uint32_t end_ = 0;
+    uint32_t newest_ = 0;
+    uint32_t count_ = 0;
+    bool wrapped_ = false;
+    bool disabled_ = false;
+    uint64_t disabled_at_ = 0;
+    bool sent_valid_ = false;
+    uint8_t sent_severity_ = 0;
+    uint16_t sent_length_ = 0;
+    uint8_t sent_text_[MaxMessage];
+    uint64_t sent_at_ = 0;
+    uint32_t repeats_ = 0;
+    uint64_t reported_at_ = 0;
+    uint32_t reported_total_ = 0;
+    uint32_t sent_ = 0;
+    uint32_t coalesced_ = 0;
+    uint32_t dropped_rate_[kSeverities] = {};
+    uint32_t dropped_full_ = 0;
+    uint32_t dropped_disabled_ = 0;
+    uint32_t dropped_failed_ = 0;
+};
+
+}
+
+#endif
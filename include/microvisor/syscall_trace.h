@@ -0,0 +1,76 @@
+#ifndef MV_SYSCALL_TRACE_H
+#define MV_SYSCALL_TRACE_H
+
+#include <stdint.h>
+
+#include "mv_syscalls.h"
+
+/**
+ *  Per-call statistics gathered when `microvisor-sdk` is configured with
+ *  `-DMV_SYSCALL_TRACE=ON`. Every function in `mv_syscalls.h` is then
+ *  wrapped at link time (`-Wl,--wrap`) and timed with `mvGetMicroseconds`.
+ *
+ *  Counters are updated without locking, so calls made from interrupt
+ *  handlers may occasionally be lost.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Latency histogram buckets: bucket `i` counts calls under `2^i`
+/// microseconds, and the last every slower call.
+#define MV_SYSCALL_TRACE_BUCKETS    16
+
+/// Distinct non-OKAY statuses counted per call; others add to `other_errors`.
+#define MV_SYSCALL_TRACE_STATUSES   4
+
+struct MvSyscallStatusCount {
+    enum MvStatus status;
+    uint32_t count;
+};
+
+struct MvSyscallStats {
+    const char *name;
+    uint32_t calls;
+    uint32_t errors;
+    uint32_t other_errors;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t histogram[MV_SYSCALL_TRACE_BUCKETS];
+    struct MvSyscallStatusCount statuses[MV_SYSCALL_TRACE_STATUSES];
+};
+
+/**
+ *  The number of wrapped calls, and the statistics of each by index.
+ */
+uint32_t mvSyscallTraceCount(void);
+const struct MvSyscallStats *mvSyscallTraceStats(uint32_t index);
+
+/**
+ *  Zero every counter.
+ */
+void mvSyscallTraceReset(void);
+
+/**
+ *  Write one line of text per call made since the last reset:
+ *
+ *      <name> <calls> <errors> <total us> <max us> <histogram,...> [<status>:<count>,...]
+ *
+ *  with histogram counts up to the last non-zero bucket. Lines that do
+ *  not fit `size` are left out.
+ *
+ *  @returns    Bytes written.
+ */
+uint32_t mvSyscallTraceSnapshot(char *buffer, uint32_t size);
+
+/**
+ *  Called by the generated wrappers.
+ */
+void mvSyscallTraceRecord(uint32_t index, enum MvStatus status, uint64_t start_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
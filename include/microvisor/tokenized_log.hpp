@@ -0,0 +1,185 @@
+#ifndef MV_TOKENIZED_LOG_HPP
+#define MV_TOKENIZED_LOG_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "byte_span.hpp"
+#include "hash.hpp"
+#include "mv_syscalls.h"
+
+// Each format string gets a section of its own, so those in inline
+// functions, which the compiler places in COMDAT groups, do not conflict
+// with the rest.
+#define MV_LOG_TOKEN_STRINGIFY(x) #x
+#define MV_LOG_TOKEN_SECTION_AT(line, counter) ".mv_log_tokens." MV_LOG_TOKEN_STRINGIFY(line) "." MV_LOG_TOKEN_STRINGIFY(counter)
+#define MV_LOG_TOKEN_SECTION MV_LOG_TOKEN_SECTION_AT(__LINE__, __COUNTER__)
+
+/**
+ *  Log a printf-style message to the server as a token and packed
+ *  arguments instead of formatted text:
+ *
+ *      MV_LOG_TOKENIZED("sensor %u read %d mV", sensor, millivolts);
+ *
+ *  The format string is never formatted on the device. It is kept in the
+ *  non-loaded `.mv_log_tokens` ELF sections, and the message carries its
+ *  32-bit token, `mv::logToken()` of the string, computed at compile time.
+ *  `tools/mv_detokenize.py` rebuilds the text from the ELF. Arguments are
+ *  checked against the format as for printf.
+ *
+ *  GCC ignores the section of static variables in templates (GCC bug
+ *  88061), so log from a non-template function there.
+ *
+ *  Evaluates to the `MvStatus` of the `mvServerLog` call.
+ */
+#define MV_LOG_TOKENIZED(format, ...)                                                                                       \
+    ([&]() -> MvStatus {                                                                                                    \
+        [[maybe_unused]] static const char mv_log_format_[] __attribute__((section(MV_LOG_TOKEN_SECTION), used)) = format;  \
+        if (false) ::mv::detail::checkLogFormat(format, ##__VA_ARGS__);                                                     \
+        return ::mv::logTokenized<::mv::logToken(format)>(__VA_ARGS__);                                                     \
+    }())
+
+namespace mv {
+
+/// Most bytes of packed arguments a tokenized message may carry.
+constexpr uint32_t kMaxTokenizedArguments = 96;
+
+/// Longest string argument; longer strings are truncated.
+constexpr uint32_t kMaxTokenizedString = 63;
+
+/// Longest tokenized message: `$`, then the base64 of the token and arguments.
+constexpr uint32_t kMaxTokenizedMessage = 1 + (4 + kMaxTokenizedArguments + 2) / 3 * 4;
+
+/**
+ *  The token of a format string: its 32-bit FNV-1a hash.
+ */
+template <uint32_t N>
+constexpr uint32_t logToken(const char (&format)[N]) {
+    return fnv1a(format, N - 1);
+}
+
+namespace detail {
+
+[[gnu::format(printf, 1, 2)]] inline void checkLogFormat(const char *, ...) {}
+
+// Integers are zigzag varints, floating point values 32-bit floats, and
+// strings a length byte and their bytes.
+class LogArgumentWriter {
+public:
+    // An argument that does not fit is dropped with all that follow it.
+    template <typename T>
+    void add(const T &value) {
+        if (overflowed_) return;
+        uint32_t start = length_;
+        encode(value);
+        if (overflowed_) length_ = start;
+    }
+
+    uint32_t length() const {
+        return length_;
+    }
+
+    const uint8_t *data() const {
+        return data_;
+    }
+
+private:
+    template <typename T>
+    void encode(const T &value) {
+        if constexpr (std::is_integral<T>::value || std::is_enum<T>::value) {
+            integer(static_cast<int64_t>(value));
+        } else if constexpr (std::is_floating_point<T>::value) {
+            real(static_cast<float>(value));
+        } else if constexpr (std::is_same<T, ByteSpan>::value) {
+            string(value);
+        } else if constexpr (std::is_convertible<T, const char *>::value) {
+            const char *text = value;
+            string(text != nullptr ? ByteSpan(text) : ByteSpan());
+        } else {
+            static_assert(std::is_pointer<T>::value, "Unsupported tokenized log argument");
+            integer(static_cast<int64_t>(reinterpret_cast<uintptr_t>(value)));
+        }
+    }
+
+    void integer(int64_t value) {
+        uint64_t zigzag = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+        do {
+            uint8_t byte = zigzag & 0x7f;
+            zigzag >>= 7;
+            put(zigzag != 0 ? byte | 0x80 : byte);
+        } while (zigzag != 0);
+    }
+
+    void real(float value) {
+        uint8_t bytes[sizeof(value)];
+        std::memcpy(bytes, &value, sizeof(value));
+        for (uint8_t byte : bytes) put(byte);
+    }
+
+    void string(ByteSpan value) {
+        uint32_t length = value.length < kMaxTokenizedString ? value.length : kMaxTokenizedString;
+        put(static_cast<uint8_t>(length));
+        for (uint32_t i = 0; i < length; ++i) put(value.data[i]);
+    }
+
+    void put(uint8_t byte) {
+        if (length_ == sizeof(data_)) {
+            overflowed_ = true;
+            return;
+        }
+        data_[length_++] = byte;
+    }
+
+    uint8_t data_[kMaxTokenizedArguments];
+    uint32_t length_ = 0;
+    bool overflowed_ = false;
+};
+
+}
+
+/**
+ *  Encode a tokenized message into `out`, which must hold
+ *  `kMaxTokenizedMessage` bytes, and return its length. Arguments beyond
+ *  `kMaxTokenizedArguments` bytes are dropped and the decoder shows them
+ *  as missing.
+ */
+template <typename... Args>
+uint32_t encodeTokenized(uint8_t *out, uint32_t token, const Args &...args) {
+    // The token is little-endian and fixed size, not a varint.
+    uint8_t raw[4 + kMaxTokenizedArguments];
+    for (int i = 0; i < 4; ++i) raw[i] = static_cast<uint8_t>(token >> (8 * i));
+    detail::LogArgumentWriter arguments;
+    (arguments.add(args), ...);
+    std::memcpy(raw + 4, arguments.data(), arguments.length());
+    uint32_t length = 4 + arguments.length();
+
+    static constexpr char kBase64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    uint32_t written = 0;
+    out[written++] = '$';
+    for (uint32_t i = 0; i < length; i += 3) {
+        uint32_t chunk = raw[i] << 16;
+        if (i + 1 < length) chunk |= raw[i + 1] << 8;
+        if (i + 2 < length) chunk |= raw[i + 2];
+        out[written++] = kBase64[(chunk >> 18) & 0x3f];
+        out[written++] = kBase64[(chunk >> 12) & 0x3f];
+        out[written++] = i + 1 < length ? kBase64[(chunk >> 6) & 0x3f] : '=';
+        out[written++] = i + 2 < length ? kBase64[chunk & 0x3f] : '=';
+    }
+    return written;
+}
+
+/**
+ *  Send a tokenized message with `mvServerLog`. Use `MV_LOG_TOKENIZED()`,
+ *  which also records the format string for the decoder.
+ */
+template <uint32_t Token, typename... Args>
+MvStatus logTokenized(const Args &...args) {
+    uint8_t message[kMaxTokenizedMessage];
+    uint32_t length = encodeTokenized(message, Token, args...);
+    return mvServerLog(message, static_cast<uint16_t>(length));
+}
+
+}
+
+#endif
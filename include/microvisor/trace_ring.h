@@ -0,0 +1,109 @@
+#ifndef MV_TRACE_RING_H
+#define MV_TRACE_RING_H
+
+#include <stdint.h>
+
+#include "mv_syscalls.h"
+
+/**
+ *  A timeline of NSC calls, notifications and application spans, available
+ *  when `microvisor-sdk` is configured with `-DMV_SYSCALL_TRACE=ON`.
+ *
+ *  Events are written into a caller-supplied ring, oldest overwritten
+ *  first, and only while recording. Every wrapped call adds a begin and an
+ *  end event, `mv::NotificationRing` adds one for each notification using
+ *  its `microseconds`, and the application may add its own spans.
+ *
+ *  `mvTraceExport()` serialises the ring for `tools/mv_trace_to_chrome.py`,
+ *  which writes Chrome trace JSON for `chrome://tracing` or Perfetto.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Names that `mvTraceName()` can register.
+#define MV_TRACE_NAMES              32
+
+/// Returned by `mvTraceName()` once every name is taken.
+#define MV_TRACE_NAME_INVALID       0xffff
+
+enum MvTraceKind {
+    MV_TRACE_CALL_BEGIN = 1,        //< `name` is the call index.
+    MV_TRACE_CALL_END = 2,          //< `arg` is the status returned.
+    MV_TRACE_NOTIFICATION = 3,      //< `name` is the event type and `arg` the tag.
+    MV_TRACE_BEGIN = 4,
+    MV_TRACE_END = 5,
+    MV_TRACE_ASYNC_BEGIN = 6,       //< `arg` pairs the begin with its end.
+    MV_TRACE_ASYNC_END = 7,
+};
+
+struct MvTraceEvent {
+    uint64_t us;
+    uint16_t name;
+    uint8_t kind;
+    uint8_t reserved;
+    uint32_t arg;
+};
+
+/**
+ *  Clear the ring and start recording into `events`.
+ *
+ *  @param capacity     Number of events. If it is not a power of two, only
+ *                      the largest power of two below it are used. If it
+ *                      is zero, or `events` is null, nothing is recorded.
+ */
+void mvTraceStart(struct MvTraceEvent *events, uint32_t capacity);
+
+/**
+ *  Stop recording, keeping the events for `mvTraceExport()`.
+ */
+void mvTraceStop(void);
+
+/**
+ *  Register a name for application spans. Returns its id, the same each
+ *  time the name is registered, or `MV_TRACE_NAME_INVALID`. `name` must
+ *  stay valid.
+ */
+uint16_t mvTraceName(const char *name);
+
+/**
+ *  Application spans, timed now. Synchronous spans must nest with each
+ *  other and with calls; asynchronous ones, such as an MQTT publish
+ *  awaiting its response, are matched by `id` instead.
+ */
+void mvTraceBegin(uint16_t name, uint32_t arg);
+void mvTraceEnd(uint16_t name, uint32_t arg);
+void mvTraceAsyncBegin(uint16_t name, uint32_t id);
+void mvTraceAsyncEnd(uint16_t name, uint32_t id);
+
+/**
+ *  Record a notification at the time Microvisor issued it.
+ */
+void mvTraceNotification(const struct MvNotification *notification);
+
+/**
+ *  Events overwritten since recording started.
+ */
+uint32_t mvTraceDropped(void);
+
+/**
+ *  The ring as a byte stream: a header, the names, then events oldest
+ *  first. `mvTraceExport()` copies the bytes at `offset`, so the stream can
+ *  be sent in pieces. Stop recording first.
+ *
+ *  @returns    Bytes copied, 0 at the end of the stream.
+ */
+uint32_t mvTraceExportSize(void);
+uint32_t mvTraceExport(uint32_t offset, uint8_t *buffer, uint32_t size);
+
+/**
+ *  Called by `mvSyscallTraceRecord()`.
+ */
+void mvTraceCall(uint32_t index, enum MvStatus status, uint64_t start_us, uint64_t end_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
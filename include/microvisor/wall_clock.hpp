@@ -0,0 +1,192 @@
+#ifndef MV_WALL_CLOCK_HPP
+#define MV_WALL_CLOCK_HPP
+
+#include <cstdint>
+
+#include "mv_syscalls.h"
+
+namespace mv {
+
+/**
+ *  A timestamp taken with `WallClock::stamp()`: wall time if the clock was
+ *  set, otherwise the `mvGetMicroseconds` time, to be converted by
+ *  `WallClock::backfill()` once it is.
+ */
+struct WallStamp {
+    uint64_t us;
+    bool wall;
+};
+
+/**
+ *  Wall time extrapolated from `mvGetMicroseconds`, so timestamping needs
+ *  no `mvGetWallTime` call.
+ *
+ *  `poll()` samples `mvGetWallTime` every `resync_us`, or every
+ *  `retry_us` until the time is set, and keeps the offset between the two
+ *  clocks. A later sample within `step_us` of the extrapolated time is
+ *  taken up gradually, at most `max_slew_ppm` of elapsed time, so wall
+ *  time keeps running forwards. A larger difference, such as a server
+ *  resync after a long time offline, is applied at once and counted in
+ *  `steps()`.
+ *
+ *  `toWall()` is arithmetic only, for timestamps already taken from
+ *  `mvGetMicroseconds` or `MvNotification::microseconds`.
+ */
+class WallClock {
+public:
+    /**
+     *  @param resync_us    Interval between samples once the time is set.
+     *  @param retry_us     Interval between samples until it is.
+     *  @param step_us      Largest difference slewed rather than stepped.
+     *  @param max_slew_ppm Fastest slew, in microseconds per second.
+     */
+    explicit WallClock(uint32_t resync_us = 600000000, uint32_t retry_us = 1000000, uint32_t step_us = 1000000,
+                       uint32_t max_slew_ppm = 500)
+        : resync_us_(resync_us), retry_us_(retry_us), step_us_(step_us), max_slew_ppm_(max_slew_ppm) {}
+
+    WallClock(const WallClock &) = delete;
+    WallClock &operator=(const WallClock &) = delete;
+
+    /**
+     *  Sample `mvGetWallTime` if it is due. Call from the main loop.
+     */
+    MvStatus poll() {
+        uint64_t now;
+        mvGetMicroseconds(&now);
+        if (sampled_ && now - sampled_at_ < (set_ ? resync_us_ : retry_us_)) return MV_STATUS_OKAY;
+        return sync(now);
+    }
+
+    /**
+     *  Sample `mvGetWallTime` now, for example after the network connects.
+     */
+    MvStatus sync() {
+        uint64_t now;
+        mvGetMicroseconds(&now);
+        return sync(now);
+    }
+
+    bool isSet() const {
+        return set_;
+    }
+
+    /**
+     *  Wall time, in microseconds since the Unix epoch, at `monotonic_us`
+     *  on the `mvGetMicroseconds` clock.
+     *
+     *  @retval MV_STATUS_TIMENOTSET    No wall time has been sampled yet.
+     */
+    MvStatus toWall(uint64_t monotonic_us, uint64_t *wall_us) const {
+        if (!set_) return MV_STATUS_TIMENOTSET;
+        *wall_us = static_cast<uint64_t>(static_cast<int64_t>(monotonic_us) + offsetAt(monotonic_us));
+        return MV_STATUS_OKAY;
+    }
+
+    MvStatus now(uint64_t *wall_us) const {
+        uint64_t monotonic;
+        mvGetMicroseconds(&monotonic);
+        return toWall(monotonic, wall_us);
+    }
+
+    /**
+     *  The current time as a `WallStamp`, wall time if it is set.
+     */
+    WallStamp stamp() const {
+        uint64_t monotonic;
+        mvGetMicroseconds(&monotonic);
+        return stampAt(monotonic);
+    }
+
+    WallStamp stampAt(uint64_t monotonic_us) const {
+        WallStamp stamp = {monotonic_us, false};
+        stamp.wall = toWall(monotonic_us, &stamp.us) == MV_STATUS_OKAY;
+        return stamp;
+    }
+
+    /**
+     *  Convert a stamp taken before the time was set to wall time. Returns
+     *  false, leaving it unchanged, while the time is still not set.
+     */
+    bool backfill(WallStamp &stamp) const {
+        if (stamp.wall) return true;
+        uint64_t wall;
+        if (toWall(stamp.us, &wall) != MV_STATUS_OKAY) return false;
+        stamp = WallStamp{wall, true};
+        return true;
+    }
+
+    /**
+     *  `mvGetWallTime` calls made, differences applied at once, and the
+     *  last difference between a sample and the extrapolated time.
+     */
+    uint32_t samples() const {
+        return samples_;
+    }
+
+    uint32_t steps() const {
+        return steps_;
+    }
+
+    int64_t lastErrorUs() const {
+        return last_error_us_;
+    }
+
+private:
+    MvStatus sync(uint64_t now) {
+        sampled_ = true;
+        sampled_at_ = now;
+        uint64_t wall;
+        MvStatus status = mvGetWallTime(&wall);
+        // Take the monotonic time again so the call's own latency is split.
+        uint64_t after;
+        mvGetMicroseconds(&after);
+        if (status != MV_STATUS_OKAY) return status;
+        samples_++;
+
+        uint64_t monotonic = now + (after - now) / 2;
+        int64_t offset = static_cast<int64_t>(wall) - static_cast<int64_t>(monotonic);
+        if (!set_) {
+            set_ = true;
+            from_ = target_ = offset;
+            slew_start_ = monotonic;
+            return MV_STATUS_OKAY;
+        }
+
+        int64_t current = offsetAt(monotonic);
+        last_error_us_ = offset - current;
+        int64_t magnitude = last_error_us_ < 0 ? -last_error_us_ : last_error_us_;
+        from_ = magnitude > step_us_ ? offset : current;
+        target_ = offset;
+        slew_start_ = monotonic;
+        if (magnitude > step_us_) steps_++;
+        return MV_STATUS_OKAY;
+    }
+
+    // The offset moves from `from_` toward `target_` at `max_slew_ppm_`.
+    int64_t offsetAt(uint64_t monotonic_us) const {
+        if (from_ == target_ || monotonic_us <= slew_start_) return from_;
+        uint64_t moved = (monotonic_us - slew_start_) * max_slew_ppm_ / 1000000;
+        if (target_ > from_) {
+            return moved >= static_cast<uint64_t>(target_ - from_) ? target_ : from_ + static_cast<int64_t>(moved);
+        }
+        return moved >= static_cast<uint64_t>(from_ - target_) ? target_ : from_ - static_cast<int64_t>(moved);
+    }
+
+    uint32_t resync_us_;
+    uint32_t retry_us_;
+    int64_t step_us_;
+    uint32_t max_slew_ppm_;
+    bool set_ = false;
+    bool sampled_ = false;
+    uint64_t sampled_at_ = 0;
+    int64_t from_ = 0;
+    int64_t target_ = 0;
+    uint64_t slew_start_ = 0;
+    uint32_t samples_ = 0;
+    uint32_t steps_ = 0;
+    int64_t last_error_us_ = 0;
+};
+
+}
+
+#endif
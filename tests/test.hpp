@@ -0,0 +1,101 @@
+#ifndef MV_TEST_HPP
+#define MV_TEST_HPP
+
+#include <cstdio>
+
+#include "mv_host.h"
+#include "mv_syscalls.h"
+
+namespace test {
+
+inline const char *&current() {
+    static const char *name = "";
+    return name;
+}
+
+inline int &failures() {
+    static int count = 0;
+    return count;
+}
+
+inline bool check(bool passed, const char *expression, const char *file, int line) {
+    if (!passed) {
+        std::fprintf(stderr, "%s:%d: %s: CHECK(%s) failed\n", file, line, current(), expression);
+        failures()++;
+    }
+    return passed;
+}
+
+/**
+ *  Run one test against freshly reset stand-ins.
+ */
+inline void run(const char *name, void (*body)()) {
+    current() = name;
+    mvHostReset();
+    body();
+}
+
+/**
+ *  The exit status for `main()`: zero if every check passed.
+ */
+inline int finish() {
+    mvHostReset();
+    if (failures() != 0) std::fprintf(stderr, "%d checks failed\n", failures());
+    return failures() == 0 ? 0 : 1;
+}
+
+inline uint64_t now() {
+    uint64_t us;
+    mvGetMicroseconds(&us);
+    return us;
+}
+
+/**
+ *  A network handle and a notification buffer for opening channels. The
+ *  buffer is never drained; tests that need notifications set up their own.
+ */
+struct Network {
+    Network() {
+        MvNotificationSetup setup = {10, buffer, sizeof(buffer)};
+        mvSetupNotifications(&setup, &notifications);
+        MvRequestNetworkParams params = {};
+        params.version = 1;
+        params.v1.notification_handle = notifications;
+        mvRequestNetwork(&params, &network);
+    }
+
+    /**
+     *  Open a channel, waiting out the channel-open rate limit.
+     */
+    MvStatus open(MvChannelType type, uint8_t *receive, uint32_t receive_len, uint8_t *send, uint32_t send_len,
+                  MvChannelHandle *handle) {
+        MvOpenChannelParams params = {};
+        params.version = 1;
+        params.v1.notification_handle = notifications;
+        params.v1.network_handle = network;
+        params.v1.receive_buffer = receive;
+        params.v1.receive_buffer_len = receive_len;
+        params.v1.send_buffer = send;
+        params.v1.send_buffer_len = send_len;
+        params.v1.channel_type = type;
+        MvStatus status;
+        while ((status = mvOpenChannel(&params, handle)) == MV_STATUS_RATELIMITED) mvHostWaitForInterrupt(50000);
+        return status;
+    }
+
+    MvNotificationHandle notifications = 0;
+    MvNetworkHandle network = 0;
+    MvNotification buffer[16] = {};
+};
+
+inline MvSizedString text(const char *value) {
+    uint32_t length = 0;
+    while (value[length] != '\0') length++;
+    return MvSizedString{reinterpret_cast<const uint8_t *>(value), length};
+}
+
+}
+
+#define CHECK(expression) test::check(static_cast<bool>(expression), #expression, __FILE__, __LINE__)
+
+#endif
@@ -0,0 +1,149 @@
+#include <cstring>
+
+#include "microvisor/channel_reader.hpp"
+#include "test.hpp"
+
+namespace {
+
+alignas(512) uint8_t receive_buffer[512];
+alignas(512) uint8_t send_buffer[512];
+
+// Frames are a length byte followed by that many payload bytes.
+struct FrameParser {
+    uint8_t received[8192];
+    uint32_t length = 0;
+    uint32_t frames = 0;
+
+    uint32_t operator()(const mv::RingRegion &region) {
+        uint8_t size;
+        if (!region.copy(0, &size, 1) || region.size() < 1u + size) return 0;
+        uint8_t scratch[255];
+        const uint8_t *payload = region.contiguous(1, size, scratch);
+        std::memcpy(received + length, payload, size);
+        length += size;
+        frames++;
+        return 1u + size;
+    }
+};
+
+MvChannelHandle openChannel(test::Network &network) {
+    MvChannelHandle channel = 0;
+    CHECK(network.open(MV_CHANNELTYPE_OPAQUEBYTES, receive_buffer, sizeof(receive_buffer), send_buffer,
+                       sizeof(send_buffer), &channel) == MV_STATUS_OKAY);
+    CHECK(mvHostChannelSetPeer(channel, MV_HOSTPEERMODE_HOLD) == MV_STATUS_OKAY);
+    return channel;
+}
+
+uint32_t inject(MvChannelHandle channel, const uint8_t *data, uint32_t length) {
+    uint32_t accepted = 0;
+    mvHostChannelInject(channel, data, length, &accepted);
+    return accepted;
+}
+
+// Frames of varying size wrap around the receive buffer many times and
+// arrive intact, with far fewer commits than frames.
+void testFramesAcrossWrap() {
+    test::Network network;
+    MvChannelHandle channel = openChannel(network);
+    mv::ChannelReader reader(channel, receive_buffer, sizeof(receive_buffer), 128);
+
+    static FrameParser parser;
+    static uint8_t expected[8192];
+    uint32_t expected_length = 0;
+    uint32_t frames = 0;
+    for (uint32_t round = 0; round < 300 && expected_length < 8000; ++round) {
+        uint8_t frame[64];
+        uint8_t size = static_cast<uint8_t>(round * 7 % 60 + 1);
+        frame[0] = size;
+        for (uint32_t i = 0; i < size; ++i) frame[1 + i] = static_cast<uint8_t>(round + i);
+        if (inject(channel, frame, 1u + size) != 1u + size) {
+            CHECK(reader.process(parser) == MV_STATUS_OKAY);
+            CHECK(reader.commit() == MV_STATUS_OKAY);
+            CHECK(inject(channel, frame, 1u + size) == 1u + size);
+        }
+        std::memcpy(expected + expected_length, frame + 1, size);
+        expected_length += size;
+        frames++;
+        if (round % 3 == 0) CHECK(reader.process(parser) == MV_STATUS_OKAY);
+    }
+    CHECK(reader.process(parser) == MV_STATUS_OKAY);
+    CHECK(reader.commit() == MV_STATUS_OKAY);
+
+    CHECK(parser.frames == frames);
+    CHECK(parser.length == expected_length);
+    CHECK(std::memcmp(parser.received, expected, expected_length) == 0);
+    CHECK(reader.commits() < frames / 4);
+    CHECK(reader.available() == 0);
+}
+
+// Consumption below the threshold stays local until `commit()`.
+void testCommitThreshold() {
+    test::Network network;
+    MvChannelHandle channel = openChannel(network);
+    mv::ChannelReader reader(channel, receive_buffer, sizeof(receive_buffer), 100);
+
+    uint8_t data[150];
+    std::memset(data, 'x', sizeof(data));
+    CHECK(inject(channel, data, sizeof(data)) == sizeof(data));
+    CHECK(reader.refresh() == MV_STATUS_OKAY);
+    CHECK(reader.available() == 150);
+
+    CHECK(reader.consume(60) == MV_STATUS_OKAY);
+    CHECK(reader.commits() == 0);
+    CHECK(reader.pendingCommit() == 60);
+    CHECK(reader.available() == 90);
+    CHECK(reader.peek().size() == 90);
+
+    CHECK(reader.consume(60) == MV_STATUS_OKAY);
+    CHECK(reader.commits() == 1);
+    CHECK(reader.pendingCommit() == 0);
+
+    // Consuming more than is available is clamped.
+    CHECK(reader.consume(1000) == MV_STATUS_OKAY);
+    CHECK(reader.available() == 0);
+    CHECK(reader.pendingCommit() == 30);
+    CHECK(reader.commit() == MV_STATUS_OKAY);
+    CHECK(reader.refresh() == MV_STATUS_OKAY);
+    CHECK(reader.available() == 0);
+}
+
+// A frame that only fits once consumed bytes are handed back: `process()`
+// commits early so the server can deliver the rest.
+void testPartialFrameCommitsEarly() {
+    test::Network network;
+    MvChannelHandle channel = openChannel(network);
+    mv::ChannelReader reader(channel, receive_buffer, sizeof(receive_buffer), 1000);
+    FrameParser parser;
+
+    uint8_t frame[256];
+    for (uint32_t i = 0; i < 3; ++i) {
+        frame[0] = 99;
+        std::memset(frame + 1, 'a' + static_cast<int>(i), 99);
+        CHECK(inject(channel, frame, 100) == 100);
+    }
+    CHECK(reader.process(parser) == MV_STATUS_OKAY);
+    CHECK(parser.frames == 3);
+    CHECK(reader.pendingCommit() == 300);
+
+    frame[0] = 255;
+    std::memset(frame + 1, 'z', 255);
+    uint32_t accepted = inject(channel, frame, 256);
+    CHECK(accepted == sizeof(receive_buffer) - 300);
+    CHECK(reader.process(parser) == MV_STATUS_OKAY);
+    CHECK(reader.pendingCommit() == 0);
+    CHECK(reader.commits() == 1);
+
+    CHECK(inject(channel, frame + accepted, 256 - accepted) == 256 - accepted);
+    CHECK(reader.process(parser) == MV_STATUS_OKAY);
+    CHECK(parser.frames == 4);
+    CHECK(parser.received[parser.length - 1] == 'z');
+}
+
+}
+
+int main() {
+    test::run("frames across wrap", testFramesAcrossWrap);
+    test::run("commit threshold", testCommitThreshold);
+    test::run("partial frame commits early", testPartialFrameCommitsEarly);
+    return test::finish();
+}
@@ -0,0 +1,123 @@
+#include <cstdio>
+#include <cstring>
+
+#include "microvisor/channel_writer.hpp"
+#include "test.hpp"
+
+namespace {
+
+alignas(512) uint8_t receive_buffer[512];
+alignas(512) uint8_t send_buffer[1024];
+
+MvChannelHandle openChannel(test::Network &network) {
+    MvChannelHandle channel = 0;
+    CHECK(network.open(MV_CHANNELTYPE_OPAQUEBYTES, receive_buffer, sizeof(receive_buffer), send_buffer,
+                       sizeof(send_buffer), &channel) == MV_STATUS_OKAY);
+    CHECK(mvHostChannelSetPeer(channel, MV_HOSTPEERMODE_HOLD) == MV_STATUS_OKAY);
+    return channel;
+}
+
+struct Sink {
+    uint8_t data[32768];
+    uint32_t length = 0;
+
+    void drain(MvChannelHandle channel) {
+        uint32_t count;
+        while (mvHostChannelDrain(channel, data + length, sizeof(data) - length, &count) == MV_STATUS_OKAY &&
+               count != 0) {
+            length += count;
+        }
+    }
+};
+
+// Small records are gathered into few NSC calls and reach the server in
+// order, whether written as streams or as frames.
+void testCoalescesInOrder() {
+    test::Network network;
+    MvChannelHandle channel = openChannel(network);
+    mv::ChannelWriter<256> writer(channel, 200);
+    static Sink sink;
+    static char expected[32768];
+    uint32_t expected_length = 0;
+
+    for (uint32_t i = 0; i < 1000; ++i) {
+        char record[16];
+        uint32_t length = static_cast<uint32_t>(std::snprintf(record, sizeof(record), "r%u;", i));
+        mv::ByteSpan segments[2] = {mv::ByteSpan("<"), mv::ByteSpan(reinterpret_cast<uint8_t *>(record), length)};
+        if (i % 5 == 0) {
+            CHECK(writer.writeFrame(segments, 2) == MV_STATUS_OKAY);
+        } else {
+            uint32_t accepted = 0;
+            CHECK(writer.write(segments, 2, &accepted) == MV_STATUS_OKAY);
+            CHECK(accepted == 1 + length);
+        }
+        expected[expected_length++] = '<';
+        std::memcpy(expected + expected_length, record, length);
+        expected_length += length;
+        if (i % 50 == 0) sink.drain(channel);
+    }
+    CHECK(writer.flush() == MV_STATUS_OKAY);
+    sink.drain(channel);
+
+    CHECK(writer.pending() == 0);
+    CHECK(sink.length == expected_length);
+    CHECK(std::memcmp(sink.data, expected, expected_length) == 0);
+    CHECK(writer.nscCalls() < 1000 / 10);
+}
+
+// A frame is taken whole or not at all, and one larger than the
+// coalescing buffer bypasses it once the channel has room.
+void testFramesAreAtomic() {
+    test::Network network;
+    MvChannelHandle channel = openChannel(network);
+    mv::ChannelWriter<256> writer(channel);
+    Sink sink;
+
+    static uint8_t big[700];
+    std::memset(big, 'x', sizeof(big));
+    mv::ByteSpan halves[2] = {mv::ByteSpan(big, 350), mv::ByteSpan(big + 350, 350)};
+    CHECK(writer.writeFrame(halves, 2) == MV_STATUS_OKAY);
+    CHECK(writer.pending() == 0);
+    // The send buffer now has 324 bytes free, too few for another.
+    CHECK(writer.writeFrame(halves, 2) == MV_STATUS_INVALIDBUFFERSIZE);
+
+    // Buffered bytes must go first, so a large frame waits for them.
+    CHECK(writer.write(mv::ByteSpan("head")) == MV_STATUS_OKAY);
+    CHECK(writer.pending() == 4);
+    sink.drain(channel);
+    CHECK(writer.writeFrame(halves, 2) == MV_STATUS_OKAY);
+    CHECK(writer.flush() == MV_STATUS_OKAY);
+    sink.drain(channel);
+    CHECK(sink.length == 1404);
+    CHECK(std::memcmp(sink.data + 700, "head", 4) == 0);
+}
+
+// `poll()` flushes data that has waited `max_delay_us`.
+void testPollFlushesAfterDelay() {
+    test::Network network;
+    MvChannelHandle channel = openChannel(network);
+    mv::ChannelWriter<256> writer(channel, 0, 2000);
+
+    CHECK(writer.write(mv::ByteSpan("tick")) == MV_STATUS_OKAY);
+    CHECK(writer.poll() == MV_STATUS_OKAY);
+    CHECK(writer.pending() == 4);
+    uint64_t start = test::now();
+    while (test::now() - start < 3000) {
+    }
+    CHECK(writer.poll() == MV_STATUS_OKAY);
+    CHECK(writer.pending() == 0);
+    CHECK(writer.flushes() == 1);
+
+    Sink sink;
+    sink.drain(channel);
+    CHECK(sink.length == 4);
+}
+
+}
+
+int main() {
+    test::run("coalesces in order", testCoalescesInOrder);
+    test::run("frames are atomic", testFramesAreAtomic);
+    test::run("poll flushes after delay", testPollFlushesAfterDelay);
+    return test::finish();
+}
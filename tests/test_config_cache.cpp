@@ -0,0 +1,166 @@
+#include <string>
+
+#include "microvisor/config_cache.hpp"
+#include "microvisor/notification_ring.hpp"
+#include "test.hpp"
+
+namespace {
+
+constexpr uint32_t kIrq = 21;
+constexpr uint32_t kBaseTag = 8;
+constexpr uint64_t kTtl = 60000000;
+
+using Cache = mv::ConfigCache<128, 32, 256, 1, 32>;
+
+mv::NotificationRing<32> *irq_ring;
+
+void drainFromIrq() {
+    irq_ring->drain();
+}
+
+MvNotificationHandle openRing(mv::NotificationRing<32> &ring) {
+    MvNotificationHandle handle = 0;
+    CHECK(ring.open(kIrq, &handle) == MV_STATUS_OKAY);
+    irq_ring = &ring;
+    CHECK(mvHostSetInterruptHandler(kIrq, drainFromIrq) == MV_STATUS_OKAY);
+    return handle;
+}
+
+struct Results {
+    uint32_t done = 0;
+    uint32_t found = 0;
+    std::string last;
+};
+
+void onValue(void *context, MvStatus status, MvConfigKeyFetchResult result, mv::ByteSpan value) {
+    Results *results = static_cast<Results *>(context);
+    results->done++;
+    if (status == MV_STATUS_OKAY && result == MV_CONFIGKEYFETCHRESULT_OK) {
+        results->found++;
+        results->last.assign(reinterpret_cast<const char *>(value.data), value.length);
+    }
+}
+
+void setConfig(const std::string &key, const std::string &value) {
+    mvHostConfigSet(MV_CONFIGKEYFETCHSCOPE_DEVICE, MV_CONFIGKEYFETCHSTORE_CONFIG, test::text(key.c_str()),
+                    MvSizedString{reinterpret_cast<const uint8_t *>(value.data()), uint32_t(value.size())});
+}
+
+mv::ConfigKey configKey(const std::string &key) {
+    return {MV_CONFIGKEYFETCHSCOPE_DEVICE, MV_CONFIGKEYFETCHSTORE_CONFIG,
+            mv::ByteSpan(reinterpret_cast<const uint8_t *>(key.data()), uint32_t(key.size()))};
+}
+
+// A cache with its tags routed from a notification ring.
+struct Fixture {
+    Fixture() {
+        ring.on(kBaseTag, Cache::onNotification, &cache);
+    }
+
+    void run(Results &results, uint32_t count) {
+        uint64_t start = test::now();
+        while (results.done < count && test::now() - start < 5000000) {
+            cache.poll();
+            mvHostWaitForInterrupt(10000);
+        }
+        cache.poll();
+    }
+
+    test::Network network;
+    mv::NotificationRing<32> ring;
+    MvNotificationHandle notifications = openRing(ring);
+    Cache cache{notifications, network.network, kBaseTag, kTtl};
+};
+
+// Requests for a key already queued join its fetch, and a fresh value is
+// answered without one.
+void testCoalescesAndCaches() {
+    Fixture fixture;
+    setConfig("name", "value");
+    Results results;
+    CHECK(fixture.cache.request(configKey("name"), onValue, &results) == MV_STATUS_OKAY);
+    CHECK(fixture.cache.request(configKey("name"), onValue, &results) == MV_STATUS_OKAY);
+    fixture.run(results, 2);
+    CHECK(results.found == 2);
+    CHECK(results.last == "value");
+    CHECK(fixture.cache.fetches() == 1);
+    CHECK(fixture.cache.coalesced() == 1);
+
+    CHECK(fixture.cache.request(configKey("name"), onValue, &results) == MV_STATUS_OKAY);
+    CHECK(results.done == 3);
+    CHECK(fixture.cache.hits() == 1);
+    CHECK(fixture.cache.fetches() == 1);
+}
+
+// A response too large for the receive buffer halves the batch limit,
+// and fetches that succeed at the limit raise it again a key at a time.
+void testBatchLimitRecovers() {
+    Fixture fixture;
+    Cache &cache = fixture.cache;
+    Results results;
+    // The first eight values are too long for the cache and the whole
+    // batch too long for its receive buffer; the second eight fit.
+    for (uint32_t i = 0; i < 16; ++i) {
+        setConfig("big" + std::to_string(i), std::string(i < 8 ? 400 : 200, 'b'));
+        CHECK(cache.request(configKey("big" + std::to_string(i)), onValue, &results) == MV_STATUS_OKAY);
+    }
+    fixture.run(results, 16);
+    CHECK(results.done == 16);
+    CHECK(results.found == 8);
+    CHECK(cache.batchLimit() == 9);
+
+    for (uint32_t round = 0; round < 8; ++round) {
+        Results small;
+        uint32_t limit = cache.batchLimit();
+        for (uint32_t i = 0; i < limit; ++i) {
+            std::string key = "s" + std::to_string(round) + "k" + std::to_string(i);
+            setConfig(key, "v");
+            CHECK(cache.request(configKey(key), onValue, &small) == MV_STATUS_OKAY);
+        }
+        fixture.run(small, limit);
+        CHECK(small.found == limit);
+        if (cache.batchLimit() == mv::kMaxConfigKeys) break;
+    }
+    CHECK(cache.batchLimit() == mv::kMaxConfigKeys);
+}
+
+// A save erases only the sectors the copy needs, and a new cache loads
+// the saved values.
+void testSavesToFlash() {
+    MvExternalFlashHandle flash = 0;
+    CHECK(mvExternalFlashOpen(&flash) == MV_STATUS_OKAY);
+    constexpr uint32_t kBase = 16 * mv::kFlashSectorSize;
+    constexpr uint32_t kSize = 2 * 16 * mv::kFlashSectorSize;
+    mvHostSetWallTime(1000000000000ull);
+    setConfig("saved", "persisted");
+
+    Fixture fixture;
+    CHECK(fixture.cache.attachFlash(flash, kBase, kSize) == MV_STATUS_OKAY);
+    Results results;
+    CHECK(fixture.cache.request(configKey("saved"), onValue, &results) == MV_STATUS_OKAY);
+    MvHostFlashStats before;
+    mvHostExternalFlashGetStats(&before);
+    fixture.run(results, 1);
+    MvHostFlashStats after;
+    mvHostExternalFlashGetStats(&after);
+    CHECK(results.found == 1);
+    CHECK(after.erase_ops == before.erase_ops + 1);
+    CHECK(after.erase_bytes - before.erase_bytes == mv::kFlashSectorSize);
+
+    Cache restarted{fixture.notifications, fixture.network.network, kBaseTag, kTtl};
+    CHECK(restarted.attachFlash(flash, kBase, kSize) == MV_STATUS_OKAY);
+    mv::ByteSpan value;
+    bool fresh = false;
+    CHECK(restarted.lookup(configKey("saved"), &value, &fresh));
+    CHECK(value == mv::ByteSpan("persisted"));
+    CHECK(fresh);
+}
+
+}
+
+int main() {
+    test::run("coalesces and caches", testCoalescesAndCaches);
+    test::run("batch limit recovers", testBatchLimitRecovers);
+    test::run("saves to flash", testSavesToFlash);
+    return test::finish();
+}
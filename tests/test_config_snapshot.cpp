@@ -0,0 +1,112 @@
+#include <string>
+
+#include "microvisor/config_snapshot.hpp"
+#include "test.hpp"
+
+namespace {
+
+constexpr auto kKeys = mv::configKeySet(
+    mv::configInteger("sample-ms"), mv::configBoolean("verbose"), mv::configString("endpoint"), mv::configInteger("neg"),
+    mv::configInteger("hex"), mv::configInteger("bad-int"), mv::configBoolean("off-flag"), mv::configString("missing"),
+    mv::configInteger("k08"), mv::configInteger("k09"), mv::configInteger("k10"), mv::configInteger("k11"),
+    mv::configInteger("k12"), mv::configInteger("k13"), mv::configInteger("k14"), mv::configInteger("k15"),
+    mv::configInteger("k16"), mv::configInteger("k17"),
+    mv::configString("secret", MV_CONFIGKEYFETCHSCOPE_ACCOUNT, MV_CONFIGKEYFETCHSTORE_SECRET));
+
+constexpr uint32_t kSampleMs = kKeys.index("sample-ms");
+constexpr uint32_t kSecret = kKeys.index("secret");
+static_assert(kSampleMs == 0 && kKeys.index("k17") == 17 && kSecret == 18, "Names resolve at compile time");
+static_assert(kKeys.index("absent") == kKeys.size(), "Unknown names resolve to size()");
+
+using Snapshot = mv::ConfigSnapshot<kKeys.size(), 512>;
+
+alignas(512) uint8_t receive_buffer[2048];
+alignas(512) uint8_t send_buffer[1024];
+
+void setConfig(const char *key, const char *value, MvConfigKeyFetchScope scope = MV_CONFIGKEYFETCHSCOPE_DEVICE,
+               MvConfigKeyFetchStore store = MV_CONFIGKEYFETCHSTORE_CONFIG) {
+    mvHostConfigSet(scope, store, test::text(key), test::text(value));
+}
+
+// Fetch every batch of the snapshot's keys on its own channel.
+void fetch(Snapshot &snapshot) {
+    test::Network network;
+    for (uint32_t batch = 0; batch < snapshot.batches(); ++batch) {
+        MvChannelHandle channel = 0;
+        CHECK(network.open(MV_CHANNELTYPE_CONFIGFETCH, receive_buffer, sizeof(receive_buffer), send_buffer,
+                           sizeof(send_buffer), &channel) == MV_STATUS_OKAY);
+        MvConfigKeyFetchParams request = snapshot.request(batch);
+        CHECK(mvSendConfigFetchRequest(channel, &request) == MV_STATUS_OKAY);
+        MvStatus status;
+        uint64_t start = test::now();
+        while ((status = snapshot.read(channel, batch)) == MV_STATUS_RESPONSENOTPRESENT && test::now() - start < 1000000) {
+            mvHostWaitForInterrupt(10000);
+        }
+        CHECK(status == MV_STATUS_OKAY);
+        mvCloseChannel(&channel);
+    }
+}
+
+// Every name has its own slot, so a lookup needs no probing.
+void testPerfectTable() {
+    for (uint32_t i = 0; i < kKeys.size(); ++i) {
+        const mv::ConfigKeySpec &key = kKeys.keys[i];
+        uint32_t home = kKeys.hash(kKeys.seed, key.name, key.length) & (kKeys.kSlots - 1);
+        CHECK(kKeys.slots[home] == i + 1);
+    }
+    CHECK(kKeys.find(mv::ByteSpan("endpoint")) == 2);
+    CHECK(kKeys.find(mv::ByteSpan("endpoin")) == kKeys.size());
+}
+
+// Values are decoded once as their key's type, across two batches.
+void testDecodesValues() {
+    setConfig("sample-ms", "250");
+    setConfig("verbose", "Yes");
+    setConfig("endpoint", "mqtt.example.com");
+    setConfig("neg", "-9223372036854775808");
+    setConfig("hex", "0x1F");
+    setConfig("bad-int", "12a");
+    setConfig("off-flag", "OFF");
+    for (uint32_t i = 8; i < 18; ++i) {
+        std::string key = "k" + std::to_string(i);
+        std::string value = std::to_string(i * i);
+        setConfig(key.c_str(), value.c_str());
+    }
+    setConfig("secret", "s3cr3t", MV_CONFIGKEYFETCHSCOPE_ACCOUNT, MV_CONFIGKEYFETCHSTORE_SECRET);
+
+    static Snapshot snapshot(kKeys);
+    CHECK(snapshot.batches() == 2);
+    fetch(snapshot);
+
+    CHECK(snapshot.integer(kSampleMs) == 250);
+    CHECK(snapshot.boolean(kKeys.index("verbose")));
+    CHECK(snapshot.string(kKeys.index("endpoint")) == mv::ByteSpan("mqtt.example.com"));
+    CHECK(snapshot.integer(kKeys.index("neg")) == INT64_MIN);
+    CHECK(snapshot.integer(kKeys.index("hex")) == 31);
+    CHECK(!snapshot.valid(kKeys.index("bad-int")));
+    CHECK(snapshot.integer(kKeys.index("bad-int"), -1) == -1);
+    CHECK(snapshot.string(kKeys.index("bad-int")) == mv::ByteSpan("12a"));
+    CHECK(!snapshot.boolean(kKeys.index("off-flag"), true));
+    CHECK(snapshot.result(kKeys.index("missing")) == MV_CONFIGKEYFETCHRESULT_KEYNOTFOUND);
+    CHECK(snapshot.integer(kKeys.index("k17")) == 289);
+    CHECK(snapshot.string(kSecret) == mv::ByteSpan("s3cr3t"));
+}
+
+// Out-of-range indices read as absent rather than past the table.
+void testOutOfRange() {
+    static Snapshot snapshot(kKeys);
+    CHECK(snapshot.result(kKeys.size()) == MV_CONFIGKEYFETCHRESULT_KEYNOTFOUND);
+    CHECK(snapshot.result(0xffffffffu) == MV_CONFIGKEYFETCHRESULT_KEYNOTFOUND);
+    CHECK(!snapshot.valid(kKeys.size()));
+    CHECK(snapshot.string(kKeys.size()).empty());
+    CHECK(snapshot.integer(kKeys.size(), 7) == 7);
+}
+
+}
+
+int main() {
+    test::run("perfect table", testPerfectTable);
+    test::run("decodes values", testDecodesValues);
+    test::run("out of range", testOutOfRange);
+    return test::finish();
+}
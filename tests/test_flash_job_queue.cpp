@@ -0,0 +1,122 @@
+#include <string>
+#include <vector>
+
+#include "microvisor/flash_job_queue.hpp"
+#include "test.hpp"
+
+namespace {
+
+using Queue = mv::FlashJobQueue<4>;
+
+std::vector<std::string> completions;
+
+void *tag(const char *name) {
+    return const_cast<char *>(name);
+}
+
+void onDone(void *context, MvStatus status) {
+    completions.push_back(std::string(static_cast<const char *>(context)) + (status == MV_STATUS_OKAY ? "" : " failed"));
+}
+
+MvExternalFlashHandle openFlash() {
+    MvExternalFlashHandle flash = 0;
+    CHECK(mvExternalFlashOpen(&flash) == MV_STATUS_OKAY);
+    return flash;
+}
+
+uint32_t drain(Queue &queue) {
+    uint32_t polls = 0;
+    while (!queue.idle() && polls < 1000) {
+        queue.poll();
+        polls++;
+    }
+    return polls;
+}
+
+// A read clear of the queued erase runs ahead of it; one the erase covers
+// waits for it, and sees erased bytes.
+void testReadsAhead() {
+    MvExternalFlashHandle flash = openFlash();
+    completions.clear();
+    static uint8_t pattern[2 * mv::kFlashSectorSize];
+    for (uint8_t &byte : pattern) byte = 0x5a;
+    CHECK(mvExternalFlashWriteBlocking(flash, 0, sizeof(pattern), pattern) == MV_STATUS_OKAY);
+
+    Queue queue(flash);
+    uint8_t covered[100] = {};
+    uint8_t clear[100] = {};
+    CHECK(queue.erase(0, 8 * mv::kFlashSectorSize, onDone, tag("erase")) == MV_STATUS_OKAY);
+    CHECK(queue.read(100, sizeof(covered), covered, onDone, tag("covered")) == MV_STATUS_OKAY);
+    CHECK(queue.read(0x100000, sizeof(clear), clear, onDone, tag("clear")) == MV_STATUS_OKAY);
+    drain(queue);
+
+    CHECK(completions == (std::vector<std::string>{"clear", "erase", "covered"}));
+    CHECK(queue.readsAhead() == 1);
+    CHECK(covered[0] == 0xff && covered[99] == 0xff);
+    CHECK(queue.slices() == 8 + 1 + 1);
+}
+
+// Writes and erases run in the order they were submitted.
+void testChangesInOrder() {
+    MvExternalFlashHandle flash = openFlash();
+    completions.clear();
+    Queue queue(flash);
+    const uint8_t first[4] = {0x0f, 0x0f, 0x0f, 0x0f};
+    const uint8_t second[4] = {0x3c, 0x3c, 0x3c, 0x3c};
+    CHECK(queue.erase(0, mv::kFlashSectorSize, onDone, tag("erase")) == MV_STATUS_OKAY);
+    CHECK(queue.write(0, mv::ByteSpan(first, sizeof(first)), onDone, tag("first")) == MV_STATUS_OKAY);
+    CHECK(queue.erase(0, mv::kFlashSectorSize, onDone, tag("again")) == MV_STATUS_OKAY);
+    CHECK(queue.write(0, mv::ByteSpan(second, sizeof(second)), onDone, tag("second")) == MV_STATUS_OKAY);
+    drain(queue);
+
+    CHECK(completions == (std::vector<std::string>{"erase", "first", "again", "second"}));
+    uint8_t check[4] = {};
+    CHECK(mvExternalFlashReadBlocking(flash, 0, sizeof(check), check) == MV_STATUS_OKAY);
+    CHECK(check[0] == 0x3c && check[3] == 0x3c);
+}
+
+// A large erase is spread over many polls, each stopping at the first
+// slice to end past its budget.
+void testPollBudget() {
+    MvExternalFlashHandle flash = openFlash();
+    completions.clear();
+    mvHostExternalFlashSetTiming(0, 0, 0, 1000);
+    Queue queue(flash);
+    CHECK(queue.erase(0, 32 * mv::kFlashSectorSize, onDone, tag("erase")) == MV_STATUS_OKAY);
+
+    uint32_t polls = 0;
+    uint32_t most = 0;
+    while (!queue.idle() && polls < 1000) {
+        uint32_t steps = queue.poll(2500);
+        CHECK(steps >= 1);
+        if (steps > most) most = steps;
+        polls++;
+    }
+    CHECK(most <= 3);
+    CHECK(polls >= 11);
+    CHECK(completions == (std::vector<std::string>{"erase"}));
+}
+
+// A full queue refuses more jobs, and bad arguments are refused up front.
+void testRefuses() {
+    Queue queue(openFlash());
+    uint8_t buffer[16];
+    for (uint32_t i = 0; i < 4; ++i) CHECK(queue.read(i * 16, sizeof(buffer), buffer, nullptr) == MV_STATUS_OKAY);
+    CHECK(queue.read(64, sizeof(buffer), buffer, nullptr) == MV_STATUS_TOOMANYELEMENTS);
+    CHECK(queue.rejected() == 1);
+    CHECK(queue.erase(5, mv::kFlashSectorSize, nullptr) == MV_STATUS_INVALIDBUFFERALIGNMENT);
+    CHECK(queue.read(0, 16, nullptr, nullptr) == MV_STATUS_PARAMETERFAULT);
+    drain(queue);
+    CHECK(queue.idle());
+    CHECK(queue.read(64, sizeof(buffer), buffer, nullptr) == MV_STATUS_OKAY);
+}
+
+}
+
+int main() {
+    test::run("reads ahead", testReadsAhead);
+    test::run("changes in order", testChangesInOrder);
+    test::run("poll budget", testPollBudget);
+    test::run("refuses", testRefuses);
+    return test::finish();
+}
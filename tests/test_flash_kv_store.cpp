@@ -0,0 +1,137 @@
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include "microvisor/flash_kv_store.hpp"
+#include "test.hpp"
+
+namespace {
+
+using Store = mv::FlashKvStore<64, 16, 200>;
+
+constexpr uint32_t kBase = 16 * mv::kFlashSectorSize;
+constexpr uint32_t kSize = 8 * mv::kFlashSectorSize;
+
+MvExternalFlashHandle openFlash() {
+    MvExternalFlashHandle flash = 0;
+    CHECK(mvExternalFlashOpen(&flash) == MV_STATUS_OKAY);
+    return flash;
+}
+
+mv::ByteSpan span(const std::string &text) {
+    return mv::ByteSpan(reinterpret_cast<const uint8_t *>(text.data()), static_cast<uint32_t>(text.size()));
+}
+
+std::string get(Store &store, const std::string &key, MvStatus *status = nullptr) {
+    uint8_t value[200];
+    uint32_t length = 0;
+    MvStatus result = store.get(span(key), value, sizeof(value), &length);
+    if (status != nullptr) *status = result;
+    return result == MV_STATUS_OKAY ? std::string(reinterpret_cast<const char *>(value), length) : std::string();
+}
+
+// The store holds exactly the keys in `model`, with the same values.
+bool matches(Store &store, const std::map<std::string, std::string> &model) {
+    bool same = store.keys() == model.size();
+    for (const auto &entry : model) same = same && get(store, entry.first) == entry.second;
+    return same;
+}
+
+// Random puts and erases, many times the region's size, with the store
+// reopened from flash along the way.
+void testChurnAndReopen() {
+    MvExternalFlashHandle flash = openFlash();
+    std::map<std::string, std::string> model;
+    std::srand(3);
+    Store store(flash, kBase, kSize);
+    CHECK(store.open() == MV_STATUS_OKAY);
+    for (uint32_t i = 0; i < 3000; ++i) {
+        std::string key = "k" + std::to_string(std::rand() % 60);
+        if (std::rand() % 5 == 0) {
+            store.erase(span(key));
+            model.erase(key);
+        } else {
+            std::string value(std::rand() % 200, static_cast<char>('a' + i % 26));
+            CHECK(store.put(span(key), span(value)) == MV_STATUS_OKAY);
+            model[key] = value;
+        }
+        while (store.collectionDue()) CHECK(store.collect(4) == MV_STATUS_OKAY);
+        if (i % 500 == 499) {
+            CHECK(matches(store, model));
+            Store reopened(flash, kBase, kSize);
+            CHECK(reopened.open() == MV_STATUS_OKAY);
+            CHECK(matches(reopened, model));
+        }
+    }
+    CHECK(store.collections() > 0);
+
+    // Sectors are collected in turn, so they wear evenly.
+    uint32_t least = UINT32_MAX;
+    uint32_t most = 0;
+    for (uint32_t sector = 0; sector < kSize / mv::kFlashSectorSize; ++sector) {
+        uint32_t count = 0;
+        CHECK(store.eraseCount(sector, &count) == MV_STATUS_OKAY);
+        if (count < least) least = count;
+        if (count > most) most = count;
+    }
+    CHECK(most - least <= 1);
+}
+
+// A record cut short by a reset fails its CRC, and the key keeps the
+// value it had before.
+void testTornWrite() {
+    MvExternalFlashHandle flash = openFlash();
+    {
+        Store store(flash, kBase, kSize);
+        CHECK(store.open() == MV_STATUS_OKAY);
+        CHECK(store.put("mode", "first") == MV_STATUS_OKAY);
+        CHECK(store.put("mode", "second") == MV_STATUS_OKAY);
+    }
+
+    static uint8_t image[kSize];
+    CHECK(mvExternalFlashReadBlocking(flash, kBase, kSize, image) == MV_STATUS_OKAY);
+    uint32_t at = 0;
+    while (at + 6 < kSize && std::memcmp(image + at, "second", 6) != 0) ++at;
+    CHECK(at + 6 < kSize);
+    const uint8_t zeros[3] = {};
+    CHECK(mvExternalFlashWriteBlocking(flash, kBase + at + 3, sizeof(zeros), zeros) == MV_STATUS_OKAY);
+
+    Store store(flash, kBase, kSize);
+    CHECK(store.open() == MV_STATUS_OKAY);
+    CHECK(get(store, "mode") == "first");
+    CHECK(store.put("mode", "third") == MV_STATUS_OKAY);
+
+    Store reopened(flash, kBase, kSize);
+    CHECK(reopened.open() == MV_STATUS_OKAY);
+    CHECK(get(reopened, "mode") == "third");
+}
+
+// Erasures and checkpoints survive a reopen.
+void testEraseAndCheckpoint() {
+    MvExternalFlashHandle flash = openFlash();
+    {
+        Store store(flash, kBase, kSize);
+        CHECK(store.open() == MV_STATUS_OKAY);
+        CHECK(store.put("a", "1") == MV_STATUS_OKAY);
+        CHECK(store.put("b", "2") == MV_STATUS_OKAY);
+        CHECK(store.checkpoint() == MV_STATUS_OKAY);
+        CHECK(store.erase("a") == MV_STATUS_OKAY);
+    }
+    Store store(flash, kBase, kSize);
+    CHECK(store.open() == MV_STATUS_OKAY);
+    MvStatus status = MV_STATUS_OKAY;
+    get(store, "a", &status);
+    CHECK(status == MV_STATUS_UNAVAILABLE);
+    CHECK(get(store, "b") == "2");
+    CHECK(store.keys() == 1);
+}
+
+}
+
+int main() {
+    test::run("churn and reopen", testChurnAndReopen);
+    test::run("torn write", testTornWrite);
+    test::run("erase and checkpoint", testEraseAndCheckpoint);
+    return test::finish();
+}
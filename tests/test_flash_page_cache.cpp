@@ -0,0 +1,166 @@
+#include <cstring>
+
+#include "microvisor/flash_page_cache.hpp"
+#include "test.hpp"
+
+namespace {
+
+constexpr uint32_t kPage = mv::kFlashSectorSize;
+
+MvExternalFlashHandle openFlash() {
+    MvExternalFlashHandle flash = 0;
+    CHECK(mvExternalFlashOpen(&flash) == MV_STATUS_OKAY);
+    return flash;
+}
+
+// A byte as flash holds it, bypassing the cache.
+uint8_t flashByte(MvExternalFlashHandle flash, uint32_t address) {
+    uint8_t value = 0;
+    CHECK(mvExternalFlashReadBlocking(flash, address, 1, &value) == MV_STATUS_OKAY);
+    return value;
+}
+
+template <typename Cache>
+uint8_t cachedByte(Cache &cache, uint32_t address) {
+    uint8_t value = 0;
+    CHECK(cache.read(address, 1, &value) == MV_STATUS_OKAY);
+    return value;
+}
+
+uint32_t flashWriteOps() {
+    MvHostFlashStats stats;
+    mvHostExternalFlashGetStats(&stats);
+    return stats.write_ops;
+}
+
+// Reads see writes not yet flushed, with bits cleared as programming
+// clears them, while flash is untouched until `flush()`.
+void testReadYourWrites() {
+    MvExternalFlashHandle flash = openFlash();
+    mv::FlashPageCache<2, 1> cache(flash, MV_HOST_FLASH_DEFAULT_SIZE);
+    const uint8_t first[] = {0xf0, 0x0f};
+    const uint8_t second[] = {0x3c, 0x3c};
+    CHECK(cache.write(10, mv::ByteSpan(first, sizeof(first))) == MV_STATUS_OKAY);
+    CHECK(cache.write(10, mv::ByteSpan(second, sizeof(second))) == MV_STATUS_OKAY);
+
+    uint8_t read[3];
+    CHECK(cache.read(9, sizeof(read), read) == MV_STATUS_OKAY);
+    CHECK(read[0] == 0xff && read[1] == 0x30 && read[2] == 0x0c);
+    CHECK(flashByte(flash, 10) == 0xff);
+    CHECK(cache.flashWrites() == 0);
+
+    CHECK(cache.flush() == MV_STATUS_OKAY);
+    CHECK(flashByte(flash, 10) == 0x30);
+    CHECK(flashByte(flash, 11) == 0x0c);
+    CHECK(cache.flashWrites() == 1);
+    CHECK(cache.writes() == 2);
+}
+
+// The least recently used page is evicted for a miss, and its writes are
+// programmed first. Pages still cached are not.
+void testEvictsDirty() {
+    MvExternalFlashHandle flash = openFlash();
+    mv::FlashPageCache<2, 0> cache(flash, MV_HOST_FLASH_DEFAULT_SIZE);
+    CHECK(cache.write(100, "a") == MV_STATUS_OKAY);
+    CHECK(cache.write(kPage + 100, "b") == MV_STATUS_OKAY);
+    CHECK(cachedByte(cache, 100) == 'a');
+
+    // Page 1 is now the older, so page 2 takes its slot.
+    CHECK(cachedByte(cache, 2 * kPage) == 0xff);
+    CHECK(cache.flashWrites() == 1);
+    CHECK(flashByte(flash, kPage + 100) == 'b');
+    CHECK(flashByte(flash, 100) == 0xff);
+
+    // Reading page 1 back evicts page 0, now the older.
+    CHECK(cachedByte(cache, kPage + 100) == 'b');
+    CHECK(cache.flashWrites() == 2);
+    CHECK(flashByte(flash, 100) == 'a');
+    CHECK(cache.flush() == MV_STATUS_OKAY);
+    CHECK(cache.flashWrites() == 2);
+}
+
+// A write that runs across pages held in adjacent slots is programmed as
+// one flash write; a gap between written pages splits it.
+void testFlushJoins() {
+    MvExternalFlashHandle flash = openFlash();
+    mv::FlashPageCache<4, 1> cache(flash, MV_HOST_FLASH_DEFAULT_SIZE);
+    static uint8_t data[2 * kPage + 100];
+    std::memset(data, 0x5a, sizeof(data));
+    CHECK(cache.write(kPage - 50, mv::ByteSpan(data, sizeof(data))) == MV_STATUS_OKAY);
+
+    uint32_t before = flashWriteOps();
+    CHECK(cache.flush() == MV_STATUS_OKAY);
+    CHECK(cache.flashWrites() == 1);
+    CHECK(flashWriteOps() - before == 1);
+    CHECK(flashByte(flash, kPage - 51) == 0xff);
+    CHECK(flashByte(flash, kPage - 50) == 0x5a);
+    CHECK(flashByte(flash, 3 * kPage + 49) == 0x5a);
+    CHECK(flashByte(flash, 3 * kPage + 50) == 0xff);
+
+    // Nothing is left to write.
+    CHECK(cache.flush() == MV_STATUS_OKAY);
+    CHECK(cache.flashWrites() == 1);
+
+    mv::FlashPageCache<4, 1> gap(flash, MV_HOST_FLASH_DEFAULT_SIZE);
+    CHECK(gap.write(8 * kPage + kPage - 1, "x") == MV_STATUS_OKAY);
+    CHECK(gap.write(10 * kPage, "y") == MV_STATUS_OKAY);
+    CHECK(gap.flush() == MV_STATUS_OKAY);
+    CHECK(gap.flashWrites() == 2);
+}
+
+// A miss on the page after the previous miss's read reads ahead; other
+// misses, and writes, read one page.
+void testReadAhead() {
+    MvExternalFlashHandle flash = openFlash();
+    mv::FlashPageCache<4, 2> cache(flash, MV_HOST_FLASH_DEFAULT_SIZE);
+    cachedByte(cache, 0);
+    CHECK(cache.misses() == 1);
+    CHECK(cache.readAhead() == 0);
+
+    cachedByte(cache, kPage);
+    CHECK(cache.misses() == 2);
+    CHECK(cache.readAhead() == 2);
+    cachedByte(cache, 2 * kPage);
+    cachedByte(cache, 3 * kPage);
+    CHECK(cache.misses() == 2);
+    CHECK(cache.hits() == 2);
+
+    cachedByte(cache, 20 * kPage);
+    CHECK(cache.readAhead() == 2);
+    CHECK(cache.write(21 * kPage, "w") == MV_STATUS_OKAY);
+    CHECK(cache.readAhead() == 2);
+    CHECK(cache.misses() == 4);
+
+    // Read-ahead stops at the end of flash.
+    cachedByte(cache, MV_HOST_FLASH_DEFAULT_SIZE - 2 * kPage);
+    cachedByte(cache, MV_HOST_FLASH_DEFAULT_SIZE - kPage);
+    CHECK(cache.readAhead() == 2);
+}
+
+// Erasing drops cached writes to the erased sectors, so neither a flush
+// nor a later read brings them back.
+void testEraseDiscards() {
+    MvExternalFlashHandle flash = openFlash();
+    mv::FlashPageCache<4, 1> cache(flash, MV_HOST_FLASH_DEFAULT_SIZE);
+    CHECK(cache.write(5, "gone") == MV_STATUS_OKAY);
+    CHECK(cache.write(kPage + 5, "kept") == MV_STATUS_OKAY);
+    CHECK(cache.erase(0, kPage) == MV_STATUS_OKAY);
+    CHECK(cachedByte(cache, 5) == 0xff);
+
+    CHECK(cache.flush() == MV_STATUS_OKAY);
+    CHECK(cache.flashWrites() == 1);
+    CHECK(flashByte(flash, 5) == 0xff);
+    CHECK(flashByte(flash, kPage + 5) == 'k');
+    CHECK(cache.erase(1, kPage) == MV_STATUS_INVALIDBUFFERALIGNMENT);
+}
+
+}
+
+int main() {
+    test::run("read your writes", testReadYourWrites);
+    test::run("evicts dirty", testEvictsDirty);
+    test::run("flush joins", testFlushJoins);
+    test::run("read ahead", testReadAhead);
+    test::run("erase discards", testEraseDiscards);
+    return test::finish();
+}
@@ -0,0 +1,117 @@
+#include <cstring>
+
+#include "microvisor/http_body_reader.hpp"
+#include "test.hpp"
+
+namespace {
+
+alignas(512) uint8_t receive_buffer[8192];
+alignas(512) uint8_t send_buffer[512];
+
+struct Endpoint {
+    MvHttpResult result = MV_HTTPRESULT_OK;
+    uint8_t body[5000];
+    uint32_t length = 0;
+};
+
+void respond(void *context, const MvHttpRequest *, MvHostHttpResponse *response) {
+    Endpoint *endpoint = static_cast<Endpoint *>(context);
+    response->result = endpoint->result;
+    response->status_code = 200;
+    response->body = MvSizedString{endpoint->body, endpoint->length};
+}
+
+// Sends a GET and waits for the response to arrive.
+MvChannelHandle request(test::Network &network, Endpoint *endpoint) {
+    mvHostSetHttpHandler(respond, endpoint);
+    MvChannelHandle channel = 0;
+    CHECK(network.open(MV_CHANNELTYPE_HTTP, receive_buffer, sizeof(receive_buffer), send_buffer, sizeof(send_buffer),
+                       &channel) == MV_STATUS_OKAY);
+    MvHttpRequest request = {test::text("GET"), test::text("https://example.com/"), 0, nullptr, {nullptr, 0}, 10000};
+    CHECK(mvSendHttpRequest(channel, &request) == MV_STATUS_OKAY);
+
+    MvHttpResponseData data;
+    uint64_t start = test::now();
+    while (mvReadHttpResponseData(channel, &data) == MV_STATUS_RESPONSENOTPRESENT && test::now() - start < 1000000) {
+        mvHostWaitForInterrupt(10000);
+    }
+    return channel;
+}
+
+// Every chunk arrives at the right offset, and stays intact while the
+// following one is prefetched.
+void testReadsWholeBody() {
+    test::Network network;
+    static Endpoint endpoint;
+    endpoint.length = sizeof(endpoint.body);
+    for (uint32_t i = 0; i < endpoint.length; ++i) endpoint.body[i] = static_cast<uint8_t>('a' + i % 26);
+    MvChannelHandle channel = request(network, &endpoint);
+
+    mv::HttpBodyReader<300> reader;
+    CHECK(reader.begin(channel) == MV_STATUS_OKAY);
+    CHECK(reader.response().body_length == endpoint.length);
+    CHECK(reader.remaining() == endpoint.length);
+
+    static uint8_t received[5000];
+    uint32_t length = 0;
+    uint32_t chunks = 0;
+    bool offsets_match = true;
+    MvStatus status = reader.forEach([&](mv::ByteSpan chunk, uint32_t offset) {
+        if (offset != length) offsets_match = false;
+        std::memcpy(received + length, chunk.data, chunk.length);
+        length += chunk.length;
+        chunks++;
+        return MV_STATUS_OKAY;
+    });
+    CHECK(status == MV_STATUS_OKAY);
+    CHECK(offsets_match);
+    CHECK(chunks == 17);
+    CHECK(length == endpoint.length);
+    CHECK(std::memcmp(received, endpoint.body, length) == 0);
+    CHECK(reader.remaining() == 0);
+}
+
+// `prefetch()` is idempotent and `next()` steps through the chunks.
+void testNextAndPrefetch() {
+    test::Network network;
+    static Endpoint endpoint;
+    endpoint.length = 1000;
+    for (uint32_t i = 0; i < endpoint.length; ++i) endpoint.body[i] = static_cast<uint8_t>(i);
+    MvChannelHandle channel = request(network, &endpoint);
+
+    mv::HttpBodyReader<512> reader;
+    CHECK(reader.begin(channel) == MV_STATUS_OKAY);
+    CHECK(reader.prefetch() == MV_STATUS_OKAY);
+    CHECK(reader.remaining() == 1000);
+
+    mv::ByteSpan chunk;
+    CHECK(reader.next(&chunk) == MV_STATUS_OKAY);
+    CHECK(chunk.length == 512);
+    CHECK(reader.offset() == 0);
+    CHECK(reader.remaining() == 488);
+    CHECK(reader.next(&chunk) == MV_STATUS_OKAY);
+    CHECK(chunk.length == 488);
+    CHECK(reader.offset() == 512);
+    CHECK(chunk.data[0] == static_cast<uint8_t>(512));
+    CHECK(reader.next(&chunk) == MV_STATUS_OKAY);
+    CHECK(chunk.empty());
+}
+
+void testUnsuccessfulRequest() {
+    test::Network network;
+    static Endpoint endpoint;
+    endpoint.result = MV_HTTPRESULT_REQUESTFAILED;
+    MvChannelHandle channel = request(network, &endpoint);
+
+    mv::HttpBodyReader<64> reader;
+    CHECK(reader.begin(channel) == MV_STATUS_REQUESTUNSUCCESSFUL);
+}
+
+}
+
+int main() {
+    test::run("reads whole body", testReadsWholeBody);
+    test::run("next and prefetch", testNextAndPrefetch);
+    test::run("unsuccessful request", testUnsuccessfulRequest);
+    return test::finish();
+}
@@ -0,0 +1,86 @@
+#include "microvisor/http_headers.hpp"
+#include "test.hpp"
+
+namespace {
+
+alignas(512) uint8_t receive_buffer[2048];
+alignas(512) uint8_t send_buffer[512];
+
+const char *const kHeaders[] = {
+    "Content-Type: text/plain",
+    "ETag:  \"abc\"  ",
+    "X-Dup: 1",
+    "x-dup: 2",
+    "Empty:",
+};
+constexpr uint32_t kHeaderCount = sizeof(kHeaders) / sizeof(kHeaders[0]);
+
+void respond(void *, const MvHttpRequest *, MvHostHttpResponse *response) {
+    static MvSizedString headers[kHeaderCount];
+    for (uint32_t i = 0; i < kHeaderCount; ++i) headers[i] = test::text(kHeaders[i]);
+    response->num_headers = kHeaderCount;
+    response->headers = headers;
+}
+
+MvChannelHandle request(test::Network &network, MvHttpResponseData *data) {
+    mvHostSetHttpHandler(respond, nullptr);
+    MvChannelHandle channel = 0;
+    CHECK(network.open(MV_CHANNELTYPE_HTTP, receive_buffer, sizeof(receive_buffer), send_buffer, sizeof(send_buffer),
+                       &channel) == MV_STATUS_OKAY);
+    MvHttpRequest request = {test::text("GET"), test::text("https://example.com/"), 0, nullptr, {nullptr, 0}, 10000};
+    CHECK(mvSendHttpRequest(channel, &request) == MV_STATUS_OKAY);
+    uint64_t start = test::now();
+    while (mvReadHttpResponseData(channel, data) == MV_STATUS_RESPONSENOTPRESENT && test::now() - start < 1000000) {
+        mvHostWaitForInterrupt(10000);
+    }
+    CHECK(data->num_headers == kHeaderCount);
+    return channel;
+}
+
+// Lookups ignore case, values are trimmed, and the first of repeated
+// headers wins.
+void testFindsHeaders() {
+    test::Network network;
+    MvHttpResponseData data;
+    MvChannelHandle channel = request(network, &data);
+
+    mv::HttpHeaders<256, 8> headers;
+    CHECK(headers.read(channel, data.num_headers) == MV_STATUS_OKAY);
+    CHECK(headers.count() == kHeaderCount);
+
+    CHECK(headers.get("content-type") == mv::ByteSpan("text/plain"));
+    CHECK(headers.get("ETAG") == mv::ByteSpan("\"abc\""));
+    CHECK(headers.get("X-DUP") == mv::ByteSpan("1"));
+    CHECK(headers.name(3) == mv::ByteSpan("x-dup"));
+    CHECK(headers.value(3) == mv::ByteSpan("2"));
+
+    mv::ByteSpan value("unchanged");
+    CHECK(headers.find("Empty", &value));
+    CHECK(value.empty());
+    CHECK(!headers.find("missing", &value));
+    CHECK(!headers.find("Content-Typ", nullptr));
+}
+
+// Responses that do not fit leave the table empty.
+void testLimits() {
+    test::Network network;
+    MvHttpResponseData data;
+    MvChannelHandle channel = request(network, &data);
+
+    mv::HttpHeaders<40, 8> small_arena;
+    CHECK(small_arena.read(channel, data.num_headers) == MV_STATUS_INVALIDBUFFERSIZE);
+    CHECK(small_arena.count() == 0);
+    CHECK(!small_arena.find("content-type", nullptr));
+
+    mv::HttpHeaders<256, 2> few_headers;
+    CHECK(few_headers.read(channel, data.num_headers) == MV_STATUS_TOOMANYELEMENTS);
+    CHECK(few_headers.count() == 0);
+}
+
+}
+
+int main() {
+    test::run("finds headers", testFindsHeaders);
+    test::run("limits", testLimits);
+    return test::finish();
+}
@@ -0,0 +1,78 @@
+#include <cstring>
+
+#include "microvisor/http_request.hpp"
+#include "test.hpp"
+
+namespace {
+
+alignas(512) uint8_t receive_buffer[512];
+alignas(512) uint8_t send_buffer[512];
+
+constexpr auto kJsonHeaders = mv::httpHeaderSet("Content-Type: application/json", "Accept: application/json");
+
+// Headers keep the order they were added in, and the wire size tracks
+// every part of the request.
+void testBuildsRequest() {
+    uint8_t arena[256];
+    mv::HttpRequestBuilder builder(arena, sizeof(arena));
+    builder.method("POST").url("https://example.com/items").body("{}").timeout(5000);
+    builder.headers(kJsonHeaders).header("X-Id", "42");
+
+    MvHttpRequest request;
+    CHECK(builder.build(&request) == MV_STATUS_OKAY);
+    CHECK(request.num_headers == 3);
+    CHECK(mv::ByteSpan(request.headers[0].data, request.headers[0].length) == mv::ByteSpan("Content-Type: application/json"));
+    CHECK(mv::ByteSpan(request.headers[2].data, request.headers[2].length) == mv::ByteSpan("X-Id: 42"));
+    CHECK(request.timeout_ms == 5000);
+
+    uint32_t expected = mv::kHttpRequestOverhead + 4 + 25 + 2 + kJsonHeaders.wire_size + mv::kHttpHeaderOverhead + 8;
+    CHECK(builder.wireSize() == expected);
+    CHECK(mv::httpRequestWireSize(request) == expected);
+    CHECK(builder.sendBufferSize() == 512);
+}
+
+void testArenaExhausted() {
+    uint8_t arena[64];
+    mv::HttpRequestBuilder builder(arena, sizeof(arena));
+    builder.method("GET").url("https://example.com/");
+    for (uint32_t i = 0; i < 8; ++i) builder.header("X-Padding", "0123456789");
+    CHECK(builder.status() == MV_STATUS_INVALIDBUFFERSIZE);
+    MvHttpRequest request;
+    CHECK(builder.build(&request) == MV_STATUS_INVALIDBUFFERSIZE);
+}
+
+// The helper's estimate agrees with the stand-in's model at the boundary,
+// and `send()` refuses an oversized request without spending the channel.
+void testSendBufferBoundary() {
+    test::Network network;
+    MvChannelHandle channel = 0;
+    CHECK(network.open(MV_CHANNELTYPE_HTTP, receive_buffer, sizeof(receive_buffer), send_buffer, sizeof(send_buffer),
+                       &channel) == MV_STATUS_OKAY);
+
+    static uint8_t body[512];
+    std::memset(body, 'b', sizeof(body));
+    uint8_t arena[128];
+    mv::HttpRequestBuilder builder(arena, sizeof(arena));
+    builder.method("POST").url("https://example.com/");
+    uint32_t fitting = sizeof(send_buffer) - builder.wireSize();
+
+    builder.body(mv::ByteSpan(body, fitting + 1));
+    CHECK(builder.wireSize() == sizeof(send_buffer) + 1);
+    CHECK(builder.send(channel, sizeof(send_buffer)) == MV_STATUS_INVALIDBUFFERSIZE);
+    MvHttpRequest request;
+    CHECK(builder.build(&request) == MV_STATUS_OKAY);
+    CHECK(mvSendHttpRequest(channel, &request) == MV_STATUS_INVALIDBUFFERSIZE);
+
+    builder.body(mv::ByteSpan(body, fitting));
+    CHECK(builder.wireSize() == sizeof(send_buffer));
+    CHECK(builder.send(channel, sizeof(send_buffer)) == MV_STATUS_OKAY);
+}
+
+}
+
+int main() {
+    test::run("builds request", testBuildsRequest);
+    test::run("arena exhausted", testArenaExhausted);
+    test::run("send buffer boundary", testSendBufferBoundary);
+    return test::finish();
+}
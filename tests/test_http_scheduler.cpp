@@ -0,0 +1,164 @@
+#include "microvisor/http_scheduler.hpp"
+#include "microvisor/notification_ring.hpp"
+#include "test.hpp"
+
+namespace {
+
+constexpr uint32_t kIrq = 20;
+constexpr uint32_t kBaseTag = 4;
+
+using Scheduler = mv::HttpScheduler<32>;
+
+mv::NotificationRing<32> *irq_ring;
+
+void drainFromIrq() {
+    irq_ring->drain();
+}
+
+struct Results {
+    uint32_t done = 0;
+    uint32_t succeeded = 0;
+    uint64_t times[32] = {};
+};
+
+void onDone(void *context, MvChannelHandle, MvStatus status, const MvHttpResponseData &response) {
+    Results *results = static_cast<Results *>(context);
+    if (status == MV_STATUS_OKAY && response.status_code == 200) results->succeeded++;
+    results->times[results->done++] = test::now();
+}
+
+MvNotificationHandle openRing(mv::NotificationRing<32> &ring) {
+    MvNotificationHandle handle = 0;
+    CHECK(ring.open(kIrq, &handle) == MV_STATUS_OKAY);
+    irq_ring = &ring;
+    CHECK(mvHostSetInterruptHandler(kIrq, drainFromIrq) == MV_STATUS_OKAY);
+    return handle;
+}
+
+// The scheduler, with its tags routed from the notification ring, and a
+// network for other code to open channels on.
+struct Fixture {
+    Fixture() {
+        for (uint32_t i = 0; i < 4; ++i) ring.on(kBaseTag + i, Scheduler::onNotification, &scheduler);
+    }
+
+    // Poll until `results` has `count` completions, sleeping until the
+    // scheduler's next open rather than spinning.
+    void run(Results &results, uint32_t count) {
+        uint64_t start = test::now();
+        while (results.done < count && test::now() - start < 5000000) {
+            uint64_t now = test::now();
+            uint64_t next = scheduler.nextOpenAt();
+            uint64_t wait = scheduler.queued() != 0 && next > now ? next - now : 0;
+            mvHostWaitForInterrupt(static_cast<uint32_t>(wait > 20000 || wait == 0 ? 20000 : wait));
+            scheduler.poll();
+        }
+    }
+
+    test::Network network;
+    mv::NotificationRing<32> ring;
+    MvNotificationHandle notifications = openRing(ring);
+    Scheduler scheduler{notifications, network.network, kBaseTag};
+};
+
+const MvHttpRequest kRequest = {test::text("GET"), test::text("https://example.com/"), 0, nullptr, {nullptr, 0}, 10000};
+
+// Twenty requests need three windows of the open rate limit. None is
+// refused, and no more than eight start in any second.
+void testRateLimiting() {
+    Fixture fixture;
+    Results results;
+    uint64_t start = test::now();
+    for (uint32_t i = 0; i < 20; ++i) CHECK(fixture.scheduler.submit(&kRequest, onDone, &results) == MV_STATUS_OKAY);
+    CHECK(fixture.scheduler.inFlight() == 4);
+    CHECK(fixture.scheduler.queued() == 16);
+
+    fixture.run(results, 20);
+    CHECK(results.done == 20);
+    CHECK(results.succeeded == 20);
+    CHECK(fixture.scheduler.rateLimited() == 0);
+    // A request completes after its channel opens.
+    uint32_t first_window = 0;
+    uint32_t second_window = 0;
+    for (uint32_t i = 0; i < 20; ++i) {
+        if (results.times[i] - start < mv::kChannelOpenWindowUs) first_window++;
+        if (results.times[i] - start < 2 * mv::kChannelOpenWindowUs) second_window++;
+    }
+    CHECK(first_window == 8);
+    CHECK(second_window == 16);
+    CHECK(results.times[19] - start >= 2 * mv::kChannelOpenWindowUs);
+    CHECK(results.times[19] - start < 3 * mv::kChannelOpenWindowUs);
+}
+
+// Opens made by other code are discovered through `MV_STATUS_RATELIMITED`,
+// after which the scheduler waits out a whole window.
+void testSharedRateLimit() {
+    Fixture fixture;
+    alignas(512) static uint8_t buffer[2][512];
+    for (uint32_t i = 0; i < mv::kChannelOpenLimit; ++i) {
+        MvChannelHandle channel;
+        CHECK(fixture.network.open(MV_CHANNELTYPE_OPAQUEBYTES, buffer[0], 512, buffer[1], 512, &channel) == MV_STATUS_OKAY);
+        mvCloseChannel(&channel);
+    }
+
+    Results results;
+    uint64_t start = test::now();
+    CHECK(fixture.scheduler.submit(&kRequest, onDone, &results) == MV_STATUS_OKAY);
+    CHECK(fixture.scheduler.rateLimited() == 1);
+    CHECK(fixture.scheduler.queued() == 1);
+    CHECK(fixture.scheduler.nextOpenAt() >= start + mv::kChannelOpenWindowUs);
+
+    fixture.run(results, 1);
+    CHECK(results.succeeded == 1);
+    CHECK(fixture.scheduler.rateLimited() == 1);
+}
+
+// With every channel taken by other code the request stays queued and the
+// scheduler gives a retry time instead of asking to be polled at once.
+void testRetryWhenChannelsBusy() {
+    Fixture fixture;
+    alignas(512) static uint8_t buffers[mv::kMaxChannels][2][512];
+    MvChannelHandle channels[mv::kMaxChannels];
+    for (uint32_t i = 0; i < mv::kMaxChannels; ++i) {
+        CHECK(fixture.network.open(MV_CHANNELTYPE_OPAQUEBYTES, buffers[i][0], 512, buffers[i][1], 512, &channels[i]) ==
+              MV_STATUS_OKAY);
+    }
+
+    Results results;
+    uint64_t start = test::now();
+    CHECK(fixture.scheduler.submit(&kRequest, onDone, &results) == MV_STATUS_OKAY);
+    CHECK(fixture.scheduler.queued() == 1);
+    uint64_t retry = fixture.scheduler.nextOpenAt();
+    CHECK(retry > test::now());
+    CHECK(retry <= start + mv::kChannelRetryUs + 1000);
+
+    // Polling before the retry time makes no attempt, even with a channel free.
+    mvCloseChannel(&channels[0]);
+    fixture.scheduler.poll();
+    CHECK(test::now() >= retry || fixture.scheduler.queued() == 1);
+
+    fixture.run(results, 1);
+    CHECK(results.succeeded == 1);
+    CHECK(results.times[0] >= retry);
+    for (uint32_t i = 1; i < mv::kMaxChannels; ++i) mvCloseChannel(&channels[i]);
+}
+
+void testRejectsOversizedRequest() {
+    Fixture fixture;
+    static uint8_t body[1024];
+    MvHttpRequest request = kRequest;
+    request.body = MvSizedString{body, sizeof(body)};
+    Results results;
+    CHECK(fixture.scheduler.submit(&request, onDone, &results) == MV_STATUS_INVALIDBUFFERSIZE);
+    CHECK(fixture.scheduler.queued() == 0);
+}
+
+}
+
+int main() {
+    test::run("rate limiting", testRateLimiting);
+    test::run("shared rate limit", testSharedRateLimit);
+    test::run("retry when channels busy", testRetryWhenChannelsBusy);
+    test::run("rejects oversized request", testRejectsOversizedRequest);
+    return test::finish();
+}
@@ -0,0 +1,98 @@
+#include "microvisor/mqtt_ack_queue.hpp"
+#include "test.hpp"
+
+namespace {
+
+alignas(512) uint8_t receive_buffer[512];
+alignas(512) uint8_t send_buffer[512];
+
+MvChannelHandle openMqtt(test::Network &network) {
+    MvChannelHandle channel = 0;
+    CHECK(network.open(MV_CHANNELTYPE_MQTT, receive_buffer, sizeof(receive_buffer), send_buffer, sizeof(send_buffer),
+                       &channel) == MV_STATUS_OKAY);
+    return channel;
+}
+
+// A full queue refuses without calling into Microvisor, and a flush makes
+// room again.
+void testFullAndFlush() {
+    test::Network network;
+    mv::MqttAckQueue<4> queue(openMqtt(network), 4, 0);
+    for (uint32_t id = 1; id <= 4; ++id) CHECK(queue.defer(id) == MV_STATUS_OKAY);
+    CHECK(queue.defer(5, 0) == MV_STATUS_OKAY);
+    CHECK(queue.defer(6) == MV_STATUS_TOOMANYELEMENTS);
+    CHECK(queue.refused() == 1);
+    CHECK(queue.pending() == 4);
+    CHECK(queue.acknowledged() == 0);
+
+    CHECK(queue.flush() == MV_STATUS_OKAY);
+    CHECK(queue.acknowledged() == 4);
+    CHECK(queue.pending() == 0);
+    CHECK(queue.defer(6) == MV_STATUS_OKAY);
+}
+
+// `poll()` waits for a full batch, or for the oldest acknowledgement to
+// reach its delay.
+void testPollBatchAndDelay() {
+    test::Network network;
+    mv::MqttAckQueue<8> queue(openMqtt(network), 3, 50000);
+    queue.defer(1);
+    queue.defer(2);
+    CHECK(queue.poll() == MV_STATUS_OKAY);
+    CHECK(queue.flushes() == 0);
+    queue.defer(3);
+    CHECK(queue.poll() == MV_STATUS_OKAY);
+    CHECK(queue.flushes() == 1);
+    CHECK(queue.acknowledged() == 3);
+
+    queue.defer(4);
+    queue.poll();
+    CHECK(queue.pending() == 1);
+    mvHostWaitForInterrupt(60000);
+    queue.poll();
+    CHECK(queue.pending() == 0);
+    CHECK(queue.flushes() == 2);
+}
+
+// Once `close()` succeeds nothing is queued and nothing more can be
+// until the queue is bound to a channel again.
+void testCloseBeforeSleep() {
+    test::Network network;
+    MvChannelHandle channel = openMqtt(network);
+    mv::MqttAckQueue<8> queue(channel);
+    queue.defer(1);
+    queue.defer(2);
+    CHECK(queue.close() == MV_STATUS_OKAY);
+    CHECK(queue.closed());
+    CHECK(queue.pending() == 0);
+    CHECK(queue.acknowledged() == 2);
+    CHECK(queue.defer(3) == MV_STATUS_CHANNELCLOSED);
+    CHECK(queue.pending() == 0);
+
+    queue.bind(channel);
+    CHECK(!queue.closed());
+    CHECK(queue.defer(3) == MV_STATUS_OKAY);
+}
+
+// Acknowledgements for a channel that has gone are dropped, not retried.
+void testChannelGone() {
+    test::Network network;
+    MvChannelHandle channel = openMqtt(network);
+    mv::MqttAckQueue<8> queue(channel);
+    queue.defer(1);
+    queue.defer(2);
+    mvCloseChannel(&channel);
+    CHECK(queue.close() == MV_STATUS_OKAY);
+    CHECK(queue.dropped() == 2);
+    CHECK(queue.acknowledged() == 0);
+}
+
+}
+
+int main() {
+    test::run("full and flush", testFullAndFlush);
+    test::run("poll batch and delay", testPollBatchAndDelay);
+    test::run("close before sleep", testCloseBeforeSleep);
+    test::run("channel gone", testChannelGone);
+    return test::finish();
+}
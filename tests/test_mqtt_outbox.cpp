@@ -0,0 +1,117 @@
+#include <cstring>
+
+#include "microvisor/mqtt_outbox.hpp"
+#include "microvisor/mqtt_session.hpp"
+#include "test.hpp"
+
+namespace {
+
+using Outbox = mv::MqttOutbox<256, 4>;
+
+constexpr uint32_t kBase = 4 * mv::kFlashSectorSize;
+constexpr uint32_t kSize = 4 * mv::kFlashSectorSize;
+
+MvExternalFlashHandle openFlash() {
+    MvExternalFlashHandle flash = 0;
+    CHECK(mvExternalFlashOpen(&flash) == MV_STATUS_OKAY);
+    return flash;
+}
+
+uint32_t reopenPending(MvExternalFlashHandle flash) {
+    Outbox outbox(flash, kBase, kSize);
+    CHECK(outbox.open() == MV_STATUS_OKAY);
+    return outbox.pending();
+}
+
+// Records survive a reopen, across sector boundaries.
+void testReopen() {
+    MvExternalFlashHandle flash = openFlash();
+    {
+        Outbox outbox(flash, kBase, kSize);
+        CHECK(outbox.open() == MV_STATUS_OKAY);
+        CHECK(outbox.pending() == 0);
+        static uint8_t payload[200];
+        for (uint32_t i = 0; i < 40; ++i) CHECK(outbox.append("t/a", mv::ByteSpan(payload, sizeof(payload)), 1, false) == MV_STATUS_OKAY);
+        CHECK(outbox.pending() == 40);
+    }
+    CHECK(reopenPending(flash) == 40);
+}
+
+// A record torn by a reset mid-write fails its CRC: it is skipped and
+// counted on open, and the log carries on after it.
+void testTornRecord() {
+    MvExternalFlashHandle flash = openFlash();
+    {
+        Outbox outbox(flash, kBase, kSize);
+        CHECK(outbox.open() == MV_STATUS_OKAY);
+        CHECK(outbox.append("t/z", "hello", 1, false) == MV_STATUS_OKAY);
+        CHECK(outbox.append("t/z", "world", 1, false) == MV_STATUS_OKAY);
+    }
+
+    // Clear bits in the second payload, as an interrupted program would leave it.
+    static uint8_t image[kSize];
+    CHECK(mvExternalFlashReadBlocking(flash, kBase, kSize, image) == MV_STATUS_OKAY);
+    uint32_t at = 0;
+    while (at + 5 < kSize && std::memcmp(image + at, "world", 5) != 0) ++at;
+    CHECK(at + 5 < kSize);
+    const uint8_t zeros[2] = {};
+    CHECK(mvExternalFlashWriteBlocking(flash, kBase + at + 3, sizeof(zeros), zeros) == MV_STATUS_OKAY);
+
+    Outbox outbox(flash, kBase, kSize);
+    CHECK(outbox.open() == MV_STATUS_OKAY);
+    CHECK(outbox.pending() == 1);
+    CHECK(outbox.corrupt() == 1);
+    CHECK(outbox.append("t/z", "again", 1, false) == MV_STATUS_OKAY);
+    CHECK(reopenPending(flash) == 2);
+}
+
+mv::MqttPublisher<8> *publisher;
+
+void onOther(void *, MvChannelHandle, MvMqttReadableDataType type) {
+    if (type == MV_MQTTREADABLEDATATYPE_PUBLISHRESPONSE) publisher->handleResponse();
+}
+
+// Published records are marked delivered in flash, so a reopen finds
+// nothing left to send.
+void testDelivers() {
+    MvExternalFlashHandle flash = openFlash();
+    Outbox outbox(flash, kBase, kSize);
+    CHECK(outbox.open() == MV_STATUS_OKAY);
+    for (uint32_t i = 0; i < 20; ++i) CHECK(outbox.append("t/b", "payload", 1, false) == MV_STATUS_OKAY);
+
+    test::Network network;
+    alignas(512) static uint8_t send_buffer[2048];
+    MvMqttConnectRequest connect = {};
+    connect.host = test::text("broker");
+    connect.clientid = test::text("device");
+    static mv::MqttSession<4096, 1024, 32> session(network.notifications, 3, network.network, send_buffer,
+                                                   sizeof(send_buffer), &connect, nullptr);
+    session.onOther(onOther);
+    CHECK(session.start() == MV_STATUS_OKAY);
+
+    mv::MqttReceivedMessage message;
+    for (uint32_t i = 0; i < 20 && session.state() != decltype(session)::State::Ready; ++i) {
+        mvHostWaitForInterrupt(20000);
+        session.next(&message);
+    }
+    mv::MqttPublisher<8> sender(session.handle(), Outbox::onPublished);
+    publisher = &sender;
+
+    for (uint32_t i = 0; i < 200 && outbox.pending() != 0; ++i) {
+        CHECK(outbox.pump(sender) == MV_STATUS_OKAY);
+        mvHostWaitForInterrupt(5000);
+        session.next(&message);
+    }
+    CHECK(outbox.pending() == 0);
+    CHECK(outbox.delivered() == 20);
+    CHECK(reopenPending(flash) == 0);
+}
+
+}
+
+int main() {
+    test::run("reopen", testReopen);
+    test::run("torn record", testTornRecord);
+    test::run("delivers", testDelivers);
+    return test::finish();
+}
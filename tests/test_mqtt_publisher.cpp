@@ -0,0 +1,173 @@
+#include <string>
+
+#include "microvisor/mqtt_publisher.hpp"
+#include "test.hpp"
+
+namespace {
+
+alignas(512) uint8_t receive_buffer[512];
+alignas(512) uint8_t send_buffer[512];
+
+// Completions in the order they ran, and each publish's reported latency
+// by correlation id.
+std::string completed;
+uint64_t latency[64];
+
+void onDone(void *, uint32_t correlation_id, MvMqttRequestState state, uint32_t, uint64_t latency_us) {
+    completed += std::to_string(correlation_id) + (state == MV_MQTTREQUESTSTATE_REQUESTCOMPLETED ? ";" : "!;");
+    if (correlation_id < 64) latency[correlation_id] = latency_us;
+}
+
+MvChannelHandle connect(test::Network &network) {
+    MvChannelHandle channel = 0;
+    CHECK(network.open(MV_CHANNELTYPE_MQTT, receive_buffer, sizeof(receive_buffer), send_buffer, sizeof(send_buffer),
+                       &channel) == MV_STATUS_OKAY);
+    MvMqttConnectRequest request = {};
+    request.host = test::text("broker");
+    request.clientid = test::text("device");
+    CHECK(mvMqttRequestConnect(channel, &request) == MV_STATUS_OKAY);
+    MvMqttConnectResponse response = {};
+    for (uint32_t i = 0; i < 20 && mvMqttReadConnectResponse(channel, &response) != MV_STATUS_OKAY; ++i) {
+        mvHostWaitForInterrupt(10000);
+    }
+    CHECK(response.request_state == MV_MQTTREQUESTSTATE_REQUESTCOMPLETED);
+    completed.clear();
+    return channel;
+}
+
+// Read every publish response waiting on the channel.
+template <typename Publisher>
+void drain(MvChannelHandle channel, Publisher &publisher) {
+    MvMqttReadableDataType type;
+    while (mvMqttGetNextReadableDataType(channel, &type) == MV_STATUS_OKAY &&
+           type == MV_MQTTREADABLEDATATYPE_PUBLISHRESPONSE) {
+        CHECK(publisher.handleResponse() == MV_STATUS_OKAY);
+    }
+}
+
+// Publish with the server taking `latency_us` to respond.
+template <typename Publisher>
+MvStatus publishAfter(Publisher &publisher, uint32_t latency_us, uint32_t *id = nullptr) {
+    mvHostSetNetworkLatency(latency_us, 0);
+    return publisher.publish("t/a", "payload", 1, false, nullptr, id);
+}
+
+// Responses come back in the order the server answers, not the order the
+// publishes went out, and each is matched to its publish by correlation
+// id. Latency runs from the request to the response being read.
+void testOutOfOrder() {
+    test::Network network;
+    MvChannelHandle channel = connect(network);
+    mv::MqttPublisher<8> publisher(channel, onDone);
+    uint32_t ids[3];
+    CHECK(publishAfter(publisher, 30000, &ids[0]) == MV_STATUS_OKAY);
+    CHECK(publishAfter(publisher, 10000, &ids[1]) == MV_STATUS_OKAY);
+    CHECK(publishAfter(publisher, 20000, &ids[2]) == MV_STATUS_OKAY);
+    CHECK(publisher.outstanding() == 3);
+
+    for (uint32_t i = 0; i < 20 && publisher.outstanding() != 0; ++i) {
+        mvHostWaitForInterrupt(5000);
+        drain(channel, publisher);
+    }
+    CHECK(completed == std::to_string(ids[1]) + ";" + std::to_string(ids[2]) + ";" + std::to_string(ids[0]) + ";");
+    CHECK(publisher.completed() == 3);
+    CHECK(publisher.failed() == 0);
+    CHECK(publisher.unmatched() == 0);
+
+    uint64_t first = latency[ids[0]];
+    uint64_t second = latency[ids[1]];
+    uint64_t third = latency[ids[2]];
+    CHECK(second >= 10000 && second < third);
+    CHECK(third >= 20000 && third < first);
+    CHECK(first >= 30000);
+    CHECK(publisher.latencyMinUs() == second);
+    CHECK(publisher.latencyMaxUs() == first);
+    CHECK(publisher.latencyMeanUs() == (first + second + third) / 3);
+}
+
+// A full window refuses without calling into Microvisor, and so does a
+// full send buffer, with the same status. Either way nothing is left
+// outstanding for the refused publish.
+void testBackpressure() {
+    test::Network network;
+    MvChannelHandle channel = connect(network);
+    // Responses wait, so the send buffer stays in use until they arrive.
+    mvHostSetNetworkLatency(5000, 0);
+    mv::MqttPublisher<2> window(channel, onDone);
+    CHECK(window.publish("t/a", "one", 1, false) == MV_STATUS_OKAY);
+    CHECK(window.publish("t/a", "two", 1, false) == MV_STATUS_OKAY);
+    CHECK(window.full());
+    uint64_t calls = mvHostGetCallCount();
+    CHECK(window.publish("t/a", "three", 1, false) == MV_STATUS_RATELIMITED);
+    CHECK(mvHostGetCallCount() == calls);
+    mvHostWaitForInterrupt(10000);
+    drain(channel, window);
+    CHECK(window.outstanding() == 0);
+    CHECK(window.publish("t/a", "three", 1, false) == MV_STATUS_OKAY);
+    mvHostWaitForInterrupt(10000);
+    drain(channel, window);
+
+    static uint8_t payload[200];
+    mv::MqttPublisher<16> buffer(channel, onDone);
+    uint32_t sent = 0;
+    MvStatus status;
+    while ((status = buffer.publish("t/a", mv::ByteSpan(payload, sizeof(payload)), 1, false)) == MV_STATUS_OKAY) sent++;
+    CHECK(status == MV_STATUS_RATELIMITED);
+    CHECK(sent > 0 && sent < 16);
+    CHECK(buffer.outstanding() == sent);
+    mvHostWaitForInterrupt(10000);
+    drain(channel, buffer);
+    CHECK(buffer.outstanding() == 0);
+    CHECK(buffer.completed() == sent);
+    CHECK(buffer.unmatched() == 0);
+    CHECK(buffer.publish("t/a", mv::ByteSpan(payload, sizeof(payload)), 1, false) == MV_STATUS_OKAY);
+}
+
+// With a window of four the table has eight slots. Ids 2 and 3 share a
+// home slot, so 3 probes past 1 and wraps to slot 0. Completing 2 first
+// must pull 3 back into the hole, or the lookup for 3 stops there.
+void testClusterDeletion() {
+    test::Network network;
+    MvChannelHandle channel = connect(network);
+    mv::MqttPublisher<4> publisher(channel, onDone);
+    CHECK(publishAfter(publisher, 30000) == MV_STATUS_OKAY);
+    CHECK(publishAfter(publisher, 10000) == MV_STATUS_OKAY);
+    CHECK(publishAfter(publisher, 20000) == MV_STATUS_OKAY);
+    CHECK(publishAfter(publisher, 40000) == MV_STATUS_OKAY);
+
+    for (uint32_t i = 0; i < 20 && publisher.outstanding() != 0; ++i) {
+        mvHostWaitForInterrupt(5000);
+        drain(channel, publisher);
+    }
+    CHECK(completed == "2;3;1;4;");
+    CHECK(publisher.unmatched() == 0);
+    CHECK(publisher.outstanding() == 0);
+}
+
+// Under jittered latency with the window kept full, every response still
+// finds its publish.
+void testChurn() {
+    test::Network network;
+    MvChannelHandle channel = connect(network);
+    mv::MqttPublisher<8> publisher(channel, onDone);
+    mvHostSetNetworkLatency(1000, 20000);
+    uint32_t sent = 0;
+    for (uint32_t i = 0; i < 5000 && publisher.completed() < 200; ++i) {
+        while (sent < 200 && publisher.publish("t/a", "x", 1, false) == MV_STATUS_OKAY) sent++;
+        mvHostWaitForInterrupt(2000);
+        drain(channel, publisher);
+    }
+    CHECK(publisher.completed() == 200);
+    CHECK(publisher.unmatched() == 0);
+    CHECK(publisher.outstanding() == 0);
+}
+
+}
+
+int main() {
+    test::run("out of order", testOutOfOrder);
+    test::run("backpressure", testBackpressure);
+    test::run("cluster deletion", testClusterDeletion);
+    test::run("churn", testChurn);
+    return test::finish();
+}
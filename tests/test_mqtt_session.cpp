@@ -0,0 +1,155 @@
+#include <string>
+
+#include "microvisor/mqtt_session.hpp"
+#include "test.hpp"
+
+namespace {
+
+using Session = mv::MqttSession<12288, 4096, 32>;
+
+alignas(512) uint8_t send_buffer[512];
+
+const MvMqttSubscription kSubscription = {test::text("a/#"), 1, 0, 0, 0};
+const MvMqttSubscribeRequest kSubscribe = {1, &kSubscription, 1};
+
+MvMqttConnectRequest connectRequest() {
+    MvMqttConnectRequest request = {};
+    request.host = test::text("broker");
+    request.clientid = test::text("device");
+    return request;
+}
+
+void publish(const std::string &topic, const std::string &payload, uint32_t qos = 1) {
+    mvHostMqttInjectMessage(MvSizedString{reinterpret_cast<const uint8_t *>(topic.data()), uint32_t(topic.size())},
+                            MvSizedString{reinterpret_cast<const uint8_t *>(payload.data()), uint32_t(payload.size())},
+                            qos, 0);
+}
+
+// A connected session, with the messages it returns collected until the
+// test releases them.
+struct Fixture {
+    Fixture() {
+        CHECK(session.start() == MV_STATUS_OKAY);
+        for (uint32_t i = 0; i < 20 && session.state() != Session::State::Ready; ++i) poll();
+        CHECK(session.state() == Session::State::Ready);
+    }
+
+    // Wait for the broker, then take messages until `next()` has none.
+    void poll(bool release = true) {
+        mvHostWaitForInterrupt(20000);
+        mv::MqttReceivedMessage message;
+        while (session.next(&message) == MV_STATUS_OKAY) {
+            topics += std::string(reinterpret_cast<const char *>(message.topic.data), message.topic.length) + ";";
+            payload_bytes += message.payload.length;
+            if (release) {
+                session.release(message);
+            } else {
+                held[held_count++] = message;
+            }
+        }
+    }
+
+    test::Network network;
+    MvMqttConnectRequest connect = connectRequest();
+    Session session{network.notifications, 3, network.network, send_buffer, sizeof(send_buffer), &connect, &kSubscribe};
+    std::string topics;
+    uint32_t payload_bytes = 0;
+    mv::MqttReceivedMessage held[32];
+    uint32_t held_count = 0;
+};
+
+// A message too large for the receive buffer is lost, and the session
+// reopens with a size class that holds two of them, trading pool slots
+// for the larger buffer.
+void testGrowsAfterLoss() {
+    Fixture fixture;
+    Session &session = fixture.session;
+    CHECK(session.receiveBufferSize() == 512);
+    CHECK(session.poolSlots() == (12288 - 512) / (32 + 512 - mv::kMqttItemOverhead));
+
+    publish("a/big", std::string(1500, 'x'));
+    for (uint32_t i = 0; i < 20 && session.reopens() == 0; ++i) fixture.poll();
+    for (uint32_t i = 0; i < 20 && session.state() != Session::State::Ready; ++i) fixture.poll();
+    CHECK(session.lostMessages() == 1);
+    CHECK(session.largestLost() == mv::kMqttItemOverhead + 5 + 1500);
+    CHECK(session.reopens() == 1);
+    CHECK(session.receiveBufferSize() == 4096);
+    CHECK(session.poolSlots() == 1);
+    CHECK(session.state() == Session::State::Ready);
+
+    publish("a/big", std::string(1500, 'y'));
+    fixture.poll();
+    CHECK(fixture.topics == "a/big;");
+    CHECK(fixture.payload_bytes == 1500);
+    CHECK(session.highWater() == mv::kMqttItemOverhead + 5 + 1500);
+}
+
+// A message that arrives between the disconnect request and its response
+// is still held when the session is ready to reopen. The reopen waits for
+// its release, so the larger receive buffer never overlaps its slot.
+void testReopenWaitsForHeld() {
+    Fixture fixture;
+    Session &session = fixture.session;
+    // Latency keeps the disconnect response behind the next message.
+    mvHostSetNetworkLatency(5000, 0);
+    publish("a/big", std::string(1500, 'x'));
+    for (uint32_t i = 0; i < 20 && session.reopens() == 0; ++i) fixture.poll();
+    CHECK(session.state() == Session::State::Reopening);
+
+    publish("a/held", "kept intact");
+    for (uint32_t i = 0; i < 5; ++i) fixture.poll(false);
+    CHECK(fixture.held_count == 1);
+    CHECK(session.state() == Session::State::Reopening);
+    CHECK(session.receiveBufferSize() == 512);
+    mv::MqttReceivedMessage &held = fixture.held[0];
+    CHECK(held.topic == mv::ByteSpan("a/held"));
+    CHECK(held.payload == mv::ByteSpan("kept intact"));
+
+    session.release(held);
+    for (uint32_t i = 0; i < 20 && session.state() != Session::State::Ready; ++i) fixture.poll();
+    CHECK(session.state() == Session::State::Ready);
+    CHECK(session.receiveBufferSize() == 4096);
+    CHECK(session.reopens() == 1);
+}
+
+// Each held message occupies a slot; with none free `next()` leaves the
+// message in the channel until one is released.
+void testPoolSlotsHeld() {
+    Fixture fixture;
+    Session &session = fixture.session;
+    uint32_t slots = session.poolSlots();
+    for (uint32_t i = 0; i <= slots; ++i) publish("a/" + std::to_string(i), "m");
+    fixture.poll(false);
+    CHECK(fixture.held_count == slots);
+
+    mv::MqttReceivedMessage message;
+    CHECK(session.next(&message) == MV_STATUS_UNAVAILABLE);
+    session.release(fixture.held[0]);
+    CHECK(session.next(&message) == MV_STATUS_OKAY);
+    CHECK(message.topic == mv::ByteSpan(("a/" + std::to_string(slots)).c_str()));
+    CHECK(message.slot == fixture.held[0].slot);
+}
+
+// A topic longer than `TopicSize` is read and dropped instead of blocking
+// the messages behind it.
+void testSkipsLongTopic() {
+    Fixture fixture;
+    Session &session = fixture.session;
+    publish("a/" + std::string(100, 't'), "dropped");
+    publish("a/next", "kept");
+    fixture.poll();
+    CHECK(session.skippedMessages() == 1);
+    CHECK(fixture.topics == "a/next;");
+    CHECK(fixture.payload_bytes == 4);
+    CHECK(session.state() == Session::State::Ready);
+}
+
+}
+
+int main() {
+    test::run("grows after loss", testGrowsAfterLoss);
+    test::run("reopen waits for held", testReopenWaitsForHeld);
+    test::run("pool slots held", testPoolSlotsHeld);
+    test::run("skips long topic", testSkipsLongTopic);
+    return test::finish();
+}
@@ -0,0 +1,145 @@
+#include <string>
+
+#include "microvisor/mqtt_topic_router.hpp"
+#include "test.hpp"
+
+namespace {
+
+using Router = mv::MqttTopicRouter<64, 32>;
+
+// Each handler context is a name; a call appends it to `calls`.
+std::string calls;
+
+void record(void *context, mv::ByteSpan, mv::ByteSpan, uint32_t) {
+    calls += static_cast<const char *>(context);
+    calls += ";";
+}
+
+// The handlers called for `topic`, in the order they ran.
+std::string dispatch(Router &router, const char *topic) {
+    calls.clear();
+    router.dispatch(mv::ByteSpan(topic), mv::ByteSpan("payload"), 0);
+    return calls;
+}
+
+bool add(Router &router, const char *filter) {
+    return router.add(mv::ByteSpan(filter), record, const_cast<char *>(filter));
+}
+
+// `+` matches exactly one level, empty or not; `#` matches the rest,
+// including nothing, so `a/#` matches `a` too.
+void testWildcards() {
+    static Router router;
+    CHECK(add(router, "a/+/c"));
+    CHECK(add(router, "a/#"));
+    CHECK(add(router, "+"));
+
+    CHECK(dispatch(router, "a/b/c") == "a/#;a/+/c;");
+    CHECK(dispatch(router, "a//c") == "a/#;a/+/c;");
+    CHECK(dispatch(router, "a/b/c/d") == "a/#;");
+    CHECK(dispatch(router, "a/b") == "a/#;");
+    CHECK(dispatch(router, "a") == "a/#;+;");
+    CHECK(dispatch(router, "b") == "+;");
+    CHECK(dispatch(router, "b/c") == "");
+    CHECK(router.unmatched() == 1);
+}
+
+// Several handlers on one filter all run, and a topic matching both a
+// literal filter and a wildcard one reaches both.
+void testLiteralAndWildcard() {
+    static Router router;
+    static char first[] = "first";
+    static char second[] = "second";
+    CHECK(router.add(mv::ByteSpan("sensors/temp"), record, first));
+    CHECK(router.add(mv::ByteSpan("sensors/temp"), record, second));
+    CHECK(add(router, "sensors/+"));
+
+    std::string called = dispatch(router, "sensors/temp");
+    CHECK(called.find("first;") != std::string::npos);
+    CHECK(called.find("second;") != std::string::npos);
+    CHECK(called.find("sensors/+;") != std::string::npos);
+    CHECK(dispatch(router, "sensors/humidity") == "sensors/+;");
+    CHECK(dispatch(router, "sensors") == "");
+}
+
+// Wildcards at the first level do not match topics starting with `$`,
+// but a literal `$` level and wildcards below it do.
+void testDollarTopics() {
+    static Router router;
+    CHECK(add(router, "#"));
+    CHECK(add(router, "+/info"));
+    CHECK(add(router, "$SYS/#"));
+
+    CHECK(dispatch(router, "$SYS/info") == "$SYS/#;");
+    CHECK(dispatch(router, "dev/info") == "#;+/info;");
+}
+
+// Wildcards must fill a whole level, and `#` must be the last.
+void testRejectsMalformed() {
+    static Router router;
+    CHECK(!add(router, ""));
+    CHECK(!add(router, "a#"));
+    CHECK(!add(router, "#/a"));
+    CHECK(!add(router, "a/b+"));
+    CHECK(!add(router, "a/+b"));
+    CHECK(!add(router, "a/#/b"));
+    CHECK(router.nodes() == 1);
+    CHECK(dispatch(router, "a") == "");
+}
+
+// The subscribe-request overloads add every filter, to one handler or to
+// one handler per filter.
+void testSubscriptions() {
+    static Router router;
+    const MvMqttSubscription subscriptions[] = {{test::text("cmd/+"), 1, 0, 0, 0},
+                                                {test::text("cfg/#"), 1, 0, 0, 0}};
+    static char shared[] = "shared";
+    CHECK(router.add(subscriptions, 2, record, shared));
+    CHECK(dispatch(router, "cmd/reboot") == "shared;");
+    CHECK(dispatch(router, "cfg") == "shared;");
+
+    static Router each;
+    static char cmd[] = "cmd";
+    static char cfg[] = "cfg";
+    const Router::Handler handlers[] = {record, record};
+    void *const contexts[] = {cmd, cfg};
+    CHECK(each.add(subscriptions, 2, handlers, contexts));
+    CHECK(dispatch(each, "cmd/reboot") == "cmd;");
+    CHECK(dispatch(each, "cfg/a/b") == "cfg;");
+
+    static Router bad;
+    const MvMqttSubscription malformed[] = {{test::text("ok"), 1, 0, 0, 0}, {test::text("bad#"), 1, 0, 0, 0}};
+    CHECK(!bad.add(malformed, 2, record, shared));
+}
+
+// Adding fails once the trie has no node for a new level or no route is
+// left; existing filters keep working.
+void testFull() {
+    static mv::MqttTopicRouter<4, 8> nodes;
+    static char handler[] = "h";
+    CHECK(nodes.add(mv::ByteSpan("a/b/c"), record, handler));
+    CHECK(nodes.nodes() == 4);
+    CHECK(!nodes.add(mv::ByteSpan("d"), record, handler));
+    CHECK(nodes.add(mv::ByteSpan("a/b"), record, handler));
+    calls.clear();
+    CHECK(nodes.dispatch(mv::ByteSpan("a/b/c"), mv::ByteSpan(), 0) == 1);
+
+    static mv::MqttTopicRouter<8, 2> routes;
+    CHECK(routes.add(mv::ByteSpan("x"), record, handler));
+    CHECK(routes.add(mv::ByteSpan("y"), record, handler));
+    CHECK(!routes.add(mv::ByteSpan("x"), record, handler));
+    calls.clear();
+    CHECK(routes.dispatch(mv::ByteSpan("x"), mv::ByteSpan(), 0) == 1);
+}
+
+}
+
+int main() {
+    test::run("wildcards", testWildcards);
+    test::run("literal and wildcard", testLiteralAndWildcard);
+    test::run("dollar topics", testDollarTopics);
+    test::run("rejects malformed", testRejectsMalformed);
+    test::run("subscriptions", testSubscriptions);
+    test::run("full", testFull);
+    return test::finish();
+}
@@ -0,0 +1,139 @@
+#include <atomic>
+#include <thread>
+
+#include "microvisor/notification_ring.hpp"
+#include "test.hpp"
+
+namespace {
+
+constexpr uint32_t kIrq = 20;
+constexpr uint32_t kSequenceTag = 1000;
+
+struct Received {
+    uint32_t count = 0;
+    uint32_t last = 0;
+    bool ordered = true;
+};
+
+// The producers below number notifications in their tags, which are above
+// the dispatch table and so reach the fallback handler.
+void onSequence(void *context, const MvNotification &notification) {
+    Received *received = static_cast<Received *>(context);
+    uint32_t sequence = notification.tag - kSequenceTag;
+    if (received->count != 0 && sequence <= received->last) received->ordered = false;
+    received->last = sequence;
+    received->count++;
+}
+
+void onTag(void *context, const MvNotification &notification) {
+    static_cast<uint32_t *>(context)[notification.tag]++;
+}
+
+mv::NotificationRing<8> *irq_ring;
+
+void drainFromIrq() {
+    irq_ring->drain();
+}
+
+void testDispatchFromInterrupt() {
+    static mv::NotificationRing<8> ring;
+    MvNotificationHandle handle;
+    CHECK(ring.open(kIrq, &handle) == MV_STATUS_OKAY);
+    irq_ring = &ring;
+    CHECK(mvHostSetInterruptHandler(kIrq, drainFromIrq) == MV_STATUS_OKAY);
+
+    uint32_t counts[4] = {};
+    CHECK(ring.on(1, onTag, counts));
+    CHECK(ring.on(2, onTag, counts));
+    CHECK(!ring.on(16, onTag, counts));
+
+    for (uint32_t i = 0; i < 5; ++i) mvTempTriggerNotification(handle, MV_EVENTTYPE_CHANNELDATAREADABLE, 1);
+    mvTempTriggerNotification(handle, MV_EVENTTYPE_CHANNELDATAREADABLE, 2);
+    mvTempTriggerNotification(handle, MV_EVENTTYPE_CHANNELDATAREADABLE, 3);
+    mvHostDispatchInterrupts();
+
+    CHECK(counts[1] == 5);
+    CHECK(counts[2] == 1);
+    CHECK(counts[3] == 0);
+    CHECK(ring.consumed() == 7);
+    CHECK(ring.unhandled() == 1);
+    CHECK(ring.overflows() == 0);
+}
+
+// A producer fills the buffer while the consumer is held off: Microvisor
+// drops what does not fit, the next drain reports the overflow and the
+// ring carries on in order once slots are free again.
+void testOverflowWithProducerThread() {
+    static mv::NotificationRing<8> ring;
+    MvNotificationHandle handle;
+    CHECK(ring.open(kIrq, &handle) == MV_STATUS_OKAY);
+    Received received;
+    ring.onUnhandled(onSequence, &received);
+
+    std::atomic<int> phase{0};
+    std::thread producer([&] {
+        for (uint32_t i = 0; i < 20; ++i) {
+            mvTempTriggerNotification(handle, MV_EVENTTYPE_CHANNELDATAREADABLE, kSequenceTag + i);
+        }
+        phase.store(1);
+        while (phase.load() != 2) std::this_thread::yield();
+        for (uint32_t i = 20; i < 24; ++i) {
+            mvTempTriggerNotification(handle, MV_EVENTTYPE_CHANNELDATAREADABLE, kSequenceTag + i);
+        }
+    });
+
+    while (phase.load() != 1) std::this_thread::yield();
+    CHECK(ring.drain() == 8);
+    CHECK(ring.overflows() == 1);
+    CHECK(received.count == 8);
+    CHECK(received.last == 7);
+
+    phase.store(2);
+    producer.join();
+    CHECK(ring.drain() == 4);
+    CHECK(ring.overflows() == 1);
+    CHECK(received.count == 12);
+    CHECK(received.last == 23);
+    CHECK(received.ordered);
+    CHECK(ring.consumed() == 12);
+}
+
+// The consumer drains while a producer thread writes as fast as it can.
+// Whatever is delivered must arrive exactly once and in order.
+void testConcurrentProducer() {
+    static mv::NotificationRing<16> ring;
+    MvNotificationHandle handle;
+    CHECK(ring.open(kIrq, &handle) == MV_STATUS_OKAY);
+    Received received;
+    ring.onUnhandled(onSequence, &received);
+
+    constexpr uint32_t kCount = 50000;
+    std::atomic<bool> done{false};
+    std::thread producer([&] {
+        for (uint32_t i = 0; i < kCount; ++i) {
+            mvTempTriggerNotification(handle, MV_EVENTTYPE_CHANNELDATAREADABLE, kSequenceTag + i);
+        }
+        done.store(true);
+    });
+    while (!done.load()) ring.drain();
+    producer.join();
+    ring.drain();
+
+    CHECK(received.ordered);
+    CHECK(received.count > 0);
+    CHECK(received.count <= kCount);
+    CHECK(received.count == ring.consumed());
+    // Every slot was handed back.
+    mvTempTriggerNotification(handle, MV_EVENTTYPE_CHANNELDATAREADABLE, kSequenceTag + kCount);
+    CHECK(ring.drain() == 1);
+    CHECK(received.last == kCount);
+}
+
+}
+
+int main() {
+    test::run("dispatch from interrupt", testDispatchFromInterrupt);
+    test::run("overflow with producer thread", testOverflowWithProducerThread);
+    test::run("concurrent producer", testConcurrentProducer);
+    return test::finish();
+}
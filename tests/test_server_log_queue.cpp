@@ -0,0 +1,119 @@
+#include <string>
+#include <vector>
+
+#include "microvisor/server_log_queue.hpp"
+#include "test.hpp"
+
+namespace {
+
+using Queue = mv::ServerLogQueue<512, 64>;
+
+alignas(512) uint8_t log_buffer[1024];
+
+std::vector<std::string> sent;
+
+void onLog(void *, const uint8_t *message, uint16_t length) {
+    sent.emplace_back(reinterpret_cast<const char *>(message), length);
+}
+
+void startLogging() {
+    sent.clear();
+    mvHostServerLogSetSink(onLog, nullptr);
+    CHECK(mvServerLoggingInit(log_buffer, sizeof(log_buffer)) == MV_STATUS_OKAY);
+}
+
+// Repeats of the newest queued message go out as one line with a count,
+// and repeats of the last one sent as a line of their own.
+void testCoalescesRepeats() {
+    startLogging();
+    static Queue queue(100000, 60000000, 0);
+    for (int i = 0; i < 5; ++i) CHECK(queue.log(mv::LogSeverity::Error, "sensor offline"));
+    CHECK(queue.queued() == 1);
+    queue.poll();
+    for (int i = 0; i < 3; ++i) CHECK(queue.log(mv::LogSeverity::Error, "sensor offline"));
+    CHECK(queue.queued() == 0);
+    CHECK(queue.log(mv::LogSeverity::Info, "sensor online"));
+    queue.poll();
+    CHECK((sent == std::vector<std::string>{"sensor offline (repeated 4 more times)", "last message repeated 3 times",
+                                            "sensor online"}));
+    CHECK(queue.coalesced() == 7);
+}
+
+// Only the same text at the same severity counts as a repeat of the last
+// message sent.
+void testRepeatsMatchText() {
+    startLogging();
+    static Queue queue(1000000, 60000000, 0);
+    CHECK(queue.log(mv::LogSeverity::Warning, "value 1234"));
+    queue.poll();
+    CHECK(queue.log(mv::LogSeverity::Warning, "value 1243"));
+    CHECK(queue.log(mv::LogSeverity::Error, "value 1243"));
+    CHECK(queue.queued() == 2);
+    queue.poll();
+    CHECK(queue.log(mv::LogSeverity::Error, "value 1243"));
+    CHECK(queue.queued() == 0);
+    CHECK(queue.coalesced() == 1);
+    CHECK(sent.size() == 3);
+}
+
+// Each severity has its own token bucket.
+void testRateLimit() {
+    startLogging();
+    static Queue queue(0, 60000000, 0);
+    queue.setRateLimit(mv::LogSeverity::Debug, 1, 3);
+    uint32_t accepted = 0;
+    for (int i = 0; i < 10; ++i) {
+        std::string message = "debug " + std::to_string(i);
+        if (queue.log(mv::LogSeverity::Debug, message.c_str())) accepted++;
+        CHECK(queue.log(mv::LogSeverity::Info, message.c_str()));
+        queue.poll();
+    }
+    CHECK(accepted == 3);
+    CHECK(queue.droppedByRate(mv::LogSeverity::Debug) == 7);
+    CHECK(queue.droppedByRate(mv::LogSeverity::Info) == 0);
+}
+
+// Once the server disables logging, messages are dropped without an NSC
+// call until the retry interval has passed.
+void testDisabledByServer() {
+    startLogging();
+    static Queue queue(0, 50000, 0);
+    mvHostServerLogSetDisabled(1);
+    CHECK(queue.log(mv::LogSeverity::Info, "first"));
+    queue.poll();
+    CHECK(queue.disabledByServer());
+    CHECK(!queue.log(mv::LogSeverity::Info, "second"));
+    CHECK(queue.droppedDisabled() == 2);
+
+    mvHostServerLogSetDisabled(0);
+    mvHostWaitForInterrupt(60000);
+    CHECK(queue.log(mv::LogSeverity::Info, "third"));
+    queue.poll();
+    CHECK((sent == std::vector<std::string>{"third"}));
+}
+
+// Messages that do not fit the ring are dropped and counted.
+void testFull() {
+    startLogging();
+    static Queue queue(0, 60000000, 0);
+    uint32_t accepted = 0;
+    for (int i = 0; i < 20; ++i) {
+        std::string message = "message " + std::to_string(i) + std::string(40, '.');
+        if (queue.log(mv::LogSeverity::Info, message.c_str())) accepted++;
+    }
+    CHECK(accepted == queue.queued());
+    CHECK(queue.droppedFull() == 20 - accepted);
+    queue.poll();
+    CHECK(sent.size() == accepted);
+}
+
+}
+
+int main() {
+    test::run("coalesces repeats", testCoalescesRepeats);
+    test::run("repeats match text", testRepeatsMatchText);
+    test::run("rate limit", testRateLimit);
+    test::run("disabled by server", testDisabledByServer);
+    test::run("full", testFull);
+    return test::finish();
+}
@@ -0,0 +1,125 @@
+#include <cstring>
+
+#include "microvisor/decimal.h"
+#include "microvisor/syscall_trace.h"
+#include "test.hpp"
+
+namespace {
+
+uint32_t indexOf(const char *name) {
+    for (uint32_t i = 0; i < mvSyscallTraceCount(); ++i) {
+        if (std::strcmp(mvSyscallTraceStats(i)->name, name) == 0) return i;
+    }
+    CHECK(false);
+    return 0;
+}
+
+// Reset the counters, returning the time just before, so reading the
+// clock is not itself counted.
+uint64_t reset() {
+    uint64_t now;
+    mvGetMicroseconds(&now);
+    mvSyscallTraceReset();
+    return now;
+}
+
+// Every function in `mv_syscalls.h` is wrapped, and calls made through
+// the wrappers are counted with their status.
+void testWrappers() {
+    CHECK(mvSyscallTraceCount() > 50);
+    CHECK(mvSyscallTraceStats(mvSyscallTraceCount()) == nullptr);
+    mvSyscallTraceReset();
+
+    uint8_t id[34];
+    for (uint32_t i = 0; i < 3; ++i) CHECK(mvGetDeviceId(id, sizeof(id)) == MV_STATUS_OKAY);
+    MvChannelHandle handle = reinterpret_cast<MvChannelHandle>(uintptr_t(0x1234));
+    MvStatus status = mvCloseChannel(&handle);
+    CHECK(status != MV_STATUS_OKAY);
+
+    const MvSyscallStats *device_id = mvSyscallTraceStats(indexOf("mvGetDeviceId"));
+    CHECK(device_id->calls == 3);
+    CHECK(device_id->errors == 0);
+    const MvSyscallStats *close = mvSyscallTraceStats(indexOf("mvCloseChannel"));
+    CHECK(close->calls == 1);
+    CHECK(close->errors == 1);
+    CHECK(close->statuses[0].status == status);
+    CHECK(close->statuses[0].count == 1);
+
+    mvSyscallTraceReset();
+    CHECK(device_id->calls == 0);
+    CHECK(std::strcmp(device_id->name, "mvGetDeviceId") == 0);
+}
+
+// Bucket `i` counts calls under `2^i` microseconds, and the last bucket
+// every slower one.
+void testBuckets() {
+    uint64_t now = reset();
+    uint32_t index = indexOf("mvGetDeviceId");
+    mvSyscallTraceRecord(index, MV_STATUS_OKAY, now - 1500);
+    mvSyscallTraceRecord(index, MV_STATUS_OKAY, now - 10000000);
+    const MvSyscallStats *stats = mvSyscallTraceStats(index);
+    CHECK(stats->calls == 2);
+    CHECK(stats->histogram[11] == 1);
+    CHECK(stats->histogram[MV_SYSCALL_TRACE_BUCKETS - 1] == 1);
+    CHECK(stats->max_us >= 10000000);
+    CHECK(stats->total_us >= 10001500);
+}
+
+// Distinct error statuses fill the status slots in order; once they are
+// taken, new statuses count as `other_errors` and known ones still count.
+void testStatusOverflow() {
+    uint64_t now = reset();
+    uint32_t index = indexOf("mvGetDeviceId");
+    const MvStatus statuses[] = {MV_STATUS_INVALIDHANDLE, MV_STATUS_INVALIDBUFFERSIZE, MV_STATUS_PARAMETERFAULT,
+                                 MV_STATUS_UNAVAILABLE, MV_STATUS_RATELIMITED, MV_STATUS_CHANNELCLOSED};
+    for (MvStatus status : statuses) mvSyscallTraceRecord(index, status, now);
+    mvSyscallTraceRecord(index, MV_STATUS_PARAMETERFAULT, now);
+    mvSyscallTraceRecord(index, MV_STATUS_OKAY, now);
+
+    const MvSyscallStats *stats = mvSyscallTraceStats(index);
+    CHECK(stats->calls == 8);
+    CHECK(stats->errors == 7);
+    for (uint32_t i = 0; i < MV_SYSCALL_TRACE_STATUSES; ++i) CHECK(stats->statuses[i].status == statuses[i]);
+    CHECK(stats->statuses[2].count == 2);
+    CHECK(stats->other_errors == 2);
+}
+
+// The snapshot has a line per call made, and keeps only whole lines.
+void testSnapshotWholeLines() {
+    uint64_t now = reset();
+    mvSyscallTraceRecord(indexOf("mvGetDeviceId"), MV_STATUS_OKAY, now);
+    mvSyscallTraceRecord(indexOf("mvCloseChannel"), MV_STATUS_INVALIDHANDLE, now);
+
+    char text[512];
+    uint32_t length = mvSyscallTraceSnapshot(text, sizeof(text));
+    CHECK(length > 0 && length < sizeof(text));
+    const char *first_end = static_cast<const char *>(std::memchr(text, '\n', length));
+    CHECK(first_end != nullptr);
+    uint32_t first = static_cast<uint32_t>(first_end - text) + 1;
+    CHECK(text[length - 1] == '\n');
+    CHECK(std::memchr(text + first, '\n', length - first) == text + length - 1);
+
+    // Indexes follow mv_syscalls.h, where mvGetDeviceId comes first.
+    CHECK(std::strncmp(text, "mvGetDeviceId 1 0 ", 18) == 0);
+    CHECK(std::strncmp(text + first, "mvCloseChannel 1 1 ", 19) == 0);
+    char status[16];
+    uint32_t status_length = mvAppendDecimal(status, 0, sizeof(status), MV_STATUS_INVALIDHANDLE);
+    CHECK(std::strncmp(text + length - status_length - 3, status, status_length) == 0);
+    CHECK(std::strncmp(text + length - 3, ":1\n", 3) == 0);
+
+    char small[512];
+    CHECK(mvSyscallTraceSnapshot(small, length - 1) == first);
+    CHECK(std::memcmp(small, text, first) == 0);
+    CHECK(mvSyscallTraceSnapshot(small, first) == first);
+    CHECK(mvSyscallTraceSnapshot(small, first - 1) == 0);
+}
+
+}
+
+int main() {
+    test::run("wrappers", testWrappers);
+    test::run("buckets", testBuckets);
+    test::run("status overflow", testStatusOverflow);
+    test::run("snapshot whole lines", testSnapshotWholeLines);
+    return test::finish();
+}
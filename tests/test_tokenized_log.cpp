@@ -0,0 +1,95 @@
+#include <string>
+#include <vector>
+
+#include "microvisor/tokenized_log.hpp"
+#include "test.hpp"
+
+namespace {
+
+alignas(512) uint8_t log_buffer[4096];
+
+std::vector<std::string> sent;
+
+void onLog(void *, const uint8_t *message, uint16_t length) {
+    sent.emplace_back(reinterpret_cast<const char *>(message), length);
+}
+
+void startLogging() {
+    sent.clear();
+    mvHostServerLogSetSink(onLog, nullptr);
+    CHECK(mvServerLoggingInit(log_buffer, sizeof(log_buffer)) == MV_STATUS_OKAY);
+}
+
+// The packed bytes of a message, or nothing if it is not `$` and base64.
+std::vector<uint8_t> unpack(const std::string &message) {
+    static const std::string kBase64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::vector<uint8_t> bytes;
+    if (message.empty() || message[0] != '$' || (message.size() - 1) % 4 != 0) return bytes;
+    uint32_t bits = 0;
+    uint32_t count = 0;
+    for (size_t i = 1; i < message.size() && message[i] != '='; ++i) {
+        size_t digit = kBase64.find(message[i]);
+        if (digit == std::string::npos) return std::vector<uint8_t>();
+        bits = (bits << 6) | static_cast<uint32_t>(digit);
+        count += 6;
+        if (count >= 8) {
+            count -= 8;
+            bytes.push_back(static_cast<uint8_t>(bits >> count));
+        }
+    }
+    return bytes;
+}
+
+uint32_t tokenOf(const std::vector<uint8_t> &bytes) {
+    uint32_t token = 0;
+    for (int i = 0; i < 4 && i < static_cast<int>(bytes.size()); ++i) token |= uint32_t(bytes[i]) << (8 * i);
+    return token;
+}
+
+// The token leads, little-endian, and integers follow as zigzag varints
+// and strings as a length byte and their bytes.
+void testPacksArguments() {
+    startLogging();
+    CHECK(MV_LOG_TOKENIZED("sensor %u read %d mV, %s", 3u, -1234, "ok") == MV_STATUS_OKAY);
+    CHECK(sent.size() == 1);
+    std::vector<uint8_t> bytes = unpack(sent[0]);
+    CHECK(tokenOf(bytes) == mv::logToken("sensor %u read %d mV, %s"));
+    CHECK((std::vector<uint8_t>(bytes.begin() + 4, bytes.end()) == std::vector<uint8_t>{6, 0xa3, 0x13, 2, 'o', 'k'}));
+    CHECK(sent[0].size() == 1 + (bytes.size() + 2) / 3 * 4);
+}
+
+// Messages with no arguments carry only the token.
+void testTokenOnly() {
+    startLogging();
+    constexpr uint32_t kToken = mv::logToken("boot");
+    static_assert(kToken == mv::fnv1a("boot", 4), "Tokens are FNV-1a of the format string");
+    CHECK(MV_LOG_TOKENIZED("boot") == MV_STATUS_OKAY);
+    CHECK(sent.size() == 1);
+    CHECK(sent[0].size() == 9);
+    CHECK(unpack(sent[0]).size() == 4);
+    CHECK(tokenOf(unpack(sent[0])) == kToken);
+}
+
+// Long strings are truncated, and an argument that no longer fits is
+// dropped with all that follow it, so the message never passes its limit.
+void testLimits() {
+    startLogging();
+    std::string long_text(100, 'a');
+    MV_LOG_TOKENIZED("%d %s %s %d", 5, long_text.c_str(), long_text.c_str(), 6);
+    CHECK(sent.size() == 1);
+    std::vector<uint8_t> bytes = unpack(sent[0]);
+    CHECK(bytes.size() == 4 + 1 + 1 + mv::kMaxTokenizedString);
+    CHECK(bytes[4] == 10);
+    CHECK(bytes[5] == mv::kMaxTokenizedString);
+    CHECK(bytes.back() == 'a');
+    CHECK(sent[0].size() <= mv::kMaxTokenizedMessage);
+}
+
+}
+
+int main() {
+    test::run("packs arguments", testPacksArguments);
+    test::run("token only", testTokenOnly);
+    test::run("limits", testLimits);
+    return test::finish();
+}
@@ -0,0 +1,137 @@
+#include <cstring>
+#include <vector>
+
+#include "microvisor/syscall_trace.h"
+#include "microvisor/trace_ring.h"
+#include "test.hpp"
+
+namespace {
+
+// The stream header, as `mvTraceExport()` writes it.
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t calls;
+    uint32_t names;
+    uint32_t events;
+    uint32_t dropped;
+};
+
+struct Stream {
+    Header header;
+    std::vector<MvTraceEvent> events;
+};
+
+std::vector<uint8_t> exportAll() {
+    std::vector<uint8_t> bytes(mvTraceExportSize());
+    CHECK(mvTraceExport(0, bytes.data(), static_cast<uint32_t>(bytes.size())) == bytes.size());
+    return bytes;
+}
+
+// Split an exported stream into its header and events, skipping the names.
+Stream parse(const std::vector<uint8_t> &bytes) {
+    Stream stream = {};
+    CHECK(bytes.size() >= sizeof(Header));
+    std::memcpy(&stream.header, bytes.data(), sizeof(Header));
+    size_t at = sizeof(Header);
+    for (uint32_t i = 0; i < stream.header.calls + stream.header.names; ++i) {
+        while (at < bytes.size() && bytes[at] != 0) ++at;
+        ++at;
+    }
+    CHECK(bytes.size() - at == stream.header.events * sizeof(MvTraceEvent));
+    stream.events.resize(stream.header.events);
+    if (!stream.events.empty()) std::memcpy(stream.events.data(), bytes.data() + at, bytes.size() - at);
+    return stream;
+}
+
+uint16_t span() {
+    return mvTraceName("span");
+}
+
+// Until the ring wraps every event is kept, in order, and none dropped.
+// Wrapped calls add a begin and an end event.
+void testRecords() {
+    static MvTraceEvent events[8];
+    mvTraceStart(events, 8);
+    mvTraceBegin(span(), 1);
+    uint64_t us;
+    mvGetMicroseconds(&us);
+    mvTraceEnd(span(), 2);
+    mvTraceStop();
+    mvTraceBegin(span(), 3);
+
+    Stream stream = parse(exportAll());
+    CHECK(stream.header.magic == 0x5254564du);
+    CHECK(stream.header.calls == mvSyscallTraceCount());
+    CHECK(stream.header.events == 4);
+    CHECK(stream.header.dropped == 0);
+    CHECK(mvTraceDropped() == 0);
+    CHECK(stream.events[0].kind == MV_TRACE_BEGIN && stream.events[0].name == span() && stream.events[0].arg == 1);
+    CHECK(stream.events[1].kind == MV_TRACE_CALL_BEGIN);
+    CHECK(std::strcmp(mvSyscallTraceStats(stream.events[1].name)->name, "mvGetMicroseconds") == 0);
+    CHECK(stream.events[2].kind == MV_TRACE_CALL_END && stream.events[2].arg == MV_STATUS_OKAY);
+    CHECK(stream.events[3].kind == MV_TRACE_END && stream.events[3].arg == 2);
+    CHECK(stream.events[0].us <= stream.events[1].us && stream.events[2].us <= stream.events[3].us);
+}
+
+// Once the ring wraps the oldest events are overwritten and counted as
+// dropped, and the export starts from the oldest kept, across the wrap.
+// A capacity that is not a power of two is rounded down.
+void testWraps() {
+    static MvTraceEvent events[6];
+    mvTraceStart(events, 6);
+    for (uint32_t i = 0; i < 10; ++i) mvTraceBegin(span(), i);
+    mvTraceStop();
+
+    CHECK(mvTraceDropped() == 6);
+    Stream stream = parse(exportAll());
+    CHECK(stream.header.events == 4);
+    CHECK(stream.header.dropped == 6);
+    for (uint32_t i = 0; i < 4; ++i) CHECK(stream.events[i].arg == 6 + i);
+}
+
+// The stream can be copied in pieces of any size from any offset.
+void testExportPieces() {
+    static MvTraceEvent events[4];
+    mvTraceStart(events, 4);
+    for (uint32_t i = 0; i < 7; ++i) mvTraceAsyncBegin(span(), i);
+    mvTraceStop();
+    std::vector<uint8_t> whole = exportAll();
+
+    for (uint32_t piece : {1u, 7u, 16u, 100u}) {
+        std::vector<uint8_t> joined;
+        uint8_t buffer[100];
+        uint32_t copied;
+        while ((copied = mvTraceExport(static_cast<uint32_t>(joined.size()), buffer, piece)) != 0) {
+            CHECK(copied <= piece);
+            joined.insert(joined.end(), buffer, buffer + copied);
+        }
+        CHECK(joined == whole);
+    }
+    CHECK(mvTraceExport(static_cast<uint32_t>(whole.size()) + 10, whole.data(), 1) == 0);
+}
+
+// Starting without a ring records nothing and exports only the header and
+// names.
+void testNoRing() {
+    static MvTraceEvent events[4];
+    for (uint32_t capacity : {0u, 4u}) {
+        mvTraceStart(capacity == 0 ? events : nullptr, capacity);
+        mvTraceBegin(span(), 1);
+        mvTraceStop();
+        CHECK(mvTraceDropped() == 0);
+        Stream stream = parse(exportAll());
+        CHECK(stream.header.events == 0);
+        CHECK(stream.header.dropped == 0);
+    }
+}
+
+}
+
+int main() {
+    test::run("records", testRecords);
+    test::run("wraps", testWraps);
+    test::run("export pieces", testExportPieces);
+    test::run("no ring", testNoRing);
+    return test::finish();
+}
@@ -0,0 +1,85 @@
+#include "microvisor/wall_clock.hpp"
+#include "test.hpp"
+
+namespace {
+
+constexpr uint64_t kEpoch = 1700000000000000ull;
+
+uint64_t wallAt(const mv::WallClock &clock, uint64_t monotonic_us) {
+    uint64_t wall = 0;
+    CHECK(clock.toWall(monotonic_us, &wall) == MV_STATUS_OKAY);
+    return wall;
+}
+
+// Stamps taken before the time is set are converted once it is.
+void testBackfill() {
+    mvHostClearWallTime();
+    mv::WallClock clock(2000000, 100000);
+    CHECK(clock.poll() == MV_STATUS_TIMENOTSET);
+    CHECK(!clock.isSet());
+    mv::WallStamp early = clock.stamp();
+    CHECK(!early.wall);
+    CHECK(!clock.backfill(early));
+
+    mvHostWaitForInterrupt(150000);
+    mvHostSetWallTime(kEpoch);
+    CHECK(clock.poll() == MV_STATUS_OKAY);
+    CHECK(clock.isSet());
+    CHECK(clock.backfill(early));
+    CHECK(early.wall);
+    CHECK(early.us < kEpoch - 100000 && early.us > kEpoch - 1000000);
+}
+
+// Samples are taken every `retry_us` until the time is set, then every
+// `resync_us`.
+void testSampleInterval() {
+    mvHostClearWallTime();
+    mv::WallClock clock(1000000, 20000);
+    for (int i = 0; i < 5; ++i) {
+        clock.poll();
+        mvHostWaitForInterrupt(25000);
+    }
+    CHECK(!clock.isSet());
+    mvHostSetWallTime(kEpoch);
+    clock.poll();
+    CHECK(clock.samples() == 1);
+    for (int i = 0; i < 5; ++i) {
+        mvHostWaitForInterrupt(25000);
+        clock.poll();
+    }
+    CHECK(clock.samples() == 1);
+}
+
+// A small difference is slewed, so wall time keeps running forwards at no
+// more than the slew rate off true; a large one is stepped.
+void testSlewAndStep() {
+    mvHostSetWallTime(kEpoch);
+    mv::WallClock clock(600000000, 1000000, 1000000, 500);
+    CHECK(clock.sync() == MV_STATUS_OKAY);
+
+    uint64_t wall = 0;
+    CHECK(clock.now(&wall) == MV_STATUS_OKAY);
+    mvHostSetWallTime(wall - 200000);
+    CHECK(clock.sync() == MV_STATUS_OKAY);
+    CHECK(clock.steps() == 0);
+    CHECK(clock.lastErrorUs() < -199000 && clock.lastErrorUs() > -201000);
+    uint64_t start = test::now();
+    uint64_t second = wallAt(clock, start + 1000000) - wallAt(clock, start);
+    CHECK(second >= 1000000 - 501 && second <= 1000000 - 499);
+    CHECK(wallAt(clock, start + 1000000000) - wallAt(clock, start + 500000000) == 500000000);
+
+    mvHostSetWallTime(kEpoch + 100000000000ull);
+    CHECK(clock.sync() == MV_STATUS_OKAY);
+    CHECK(clock.steps() == 1);
+    CHECK(clock.now(&wall) == MV_STATUS_OKAY);
+    CHECK(wall >= kEpoch + 100000000000ull && wall < kEpoch + 100000000000ull + 100000);
+}
+
+}
+
+int main() {
+    test::run("backfill", testBackfill);
+    test::run("sample interval", testSampleInterval);
+    test::run("slew and step", testSlewAndStep);
+    return test::finish();
+}
@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""Decode messages logged with MV_LOG_TOKENIZED() back into text.
+
+The format strings are read from the `.mv_log_tokens` section of the
+application's ELF file. Log lines are read from the given files, or from
+standard input, and written out with each `$`-prefixed tokenized message
+replaced by its text:
+
+    tools/mv_detokenize.py build/app.elf < server.log
+"""
+
+import argparse
+import base64
+import re
+import struct
+import sys
+
+SECTION = ".mv_log_tokens"
+MESSAGE = re.compile(r"\$([A-Za-z0-9+/]+={0,2})")
+SPECIFIER = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|j|z|t|L)?([diouxXcsfFeEgGaAp%])")
+
+
+def token(text):
+    """FNV-1a, as mv::logToken()."""
+    value = 2166136261
+    for byte in text:
+        value = ((value ^ byte) * 16777619) & 0xFFFFFFFF
+    return value
+
+
+def read_sections(path, prefix):
+    with open(path, "rb") as elf:
+        data = elf.read()
+    if data[:4] != b"\x7fELF":
+        raise ValueError(f"{path} is not an ELF file")
+    wide = data[4] == 2
+    order = "<" if data[5] == 1 else ">"
+    if wide:
+        shoff, = struct.unpack_from(order + "Q", data, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(order + "HHH", data, 0x3A)
+        layout = order + "IIQQQQ"
+    else:
+        shoff, = struct.unpack_from(order + "I", data, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(order + "HHH", data, 0x2E)
+        layout = order + "IIIIII"
+
+    def header(index):
+        name_offset, kind, _flags, _address, offset, size = struct.unpack_from(layout, data, shoff + index * shentsize)
+        return name_offset, kind, offset, size
+
+    # The device linker script gathers the strings into one section;
+    # other links may leave a section per string.
+    _, _, names_offset, _ = header(shstrndx)
+    contents = []
+    for index in range(shnum):
+        name_offset, kind, offset, size = header(index)
+        end = data.index(b"\0", names_offset + name_offset)
+        name = data[names_offset + name_offset:end].decode()
+        # SHT_NOBITS sections hold no strings.
+        if (name == prefix or name.startswith(prefix + ".")) and kind != 8:
+            contents.append(data[offset:offset + size])
+    return b"\0".join(contents)
+
+
+def load_formats(paths):
+    formats = {}
+    for path in paths:
+        for text in read_sections(path, SECTION).split(b"\0"):
+            if not text:
+                continue
+            key = token(text)
+            previous = formats.get(key)
+            if previous is not None and previous != text:
+                print(f"warning: token {key:08x} is shared by {previous!r} and {text!r}", file=sys.stderr)
+            formats[key] = text
+    return formats
+
+
+class Arguments:
+    def __init__(self, data):
+        self.data = data
+        self.offset = 0
+
+    def integer(self):
+        value = 0
+        shift = 0
+        while True:
+            if self.offset >= len(self.data):
+                raise IndexError
+            byte = self.data[self.offset]
+            self.offset += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if byte & 0x80 == 0:
+                return (value >> 1) ^ -(value & 1)
+
+    def real(self):
+        if self.offset + 4 > len(self.data):
+            raise IndexError
+        value, = struct.unpack_from("<f", self.data, self.offset)
+        self.offset += 4
+        return value
+
+    def string(self):
+        if self.offset >= len(self.data):
+            raise IndexError
+        length = self.data[self.offset]
+        text = self.data[self.offset + 1:self.offset + 1 + length]
+        if len(text) != length:
+            raise IndexError
+        self.offset += 1 + length
+        return text.decode(errors="replace")
+
+
+def render(format_text, arguments):
+    def substitute(match):
+        flags, width, precision, length, conversion = match.groups()
+        if conversion == "%":
+            return "%"
+        try:
+            if width == "*":
+                width = str(arguments.integer())
+            if precision == "*":
+                precision = str(arguments.integer())
+            spec = "%" + flags + (width or "") + ("." + precision if precision else "")
+            if conversion in "di":
+                return (spec + "d") % arguments.integer()
+            if conversion in "ouxX":
+                bits = 64 if length in ("ll", "j") else 32
+                return (spec + conversion.replace("u", "d")) % (arguments.integer() & ((1 << bits) - 1))
+            if conversion == "p":
+                return "0x%08x" % (arguments.integer() & 0xFFFFFFFFFFFFFFFF)
+            if conversion == "c":
+                return (spec + "c") % chr(arguments.integer() & 0xFF)
+            if conversion == "s":
+                return (spec + "s") % arguments.string()
+            return (spec + conversion.replace("F", "f")) % arguments.real()
+        except IndexError:
+            return "<missing>"
+
+    return SPECIFIER.sub(substitute, format_text)
+
+
+def decode(message, formats):
+    try:
+        raw = base64.b64decode(message, validate=True)
+    except ValueError:
+        return None
+    if len(raw) < 4:
+        return None
+    key, = struct.unpack_from("<I", raw)
+    text = formats.get(key)
+    if text is None:
+        return f"<unknown token {key:08x}>"
+    return render(text.decode(errors="replace"), Arguments(raw[4:]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf", nargs="+", help="application ELF files holding the format strings")
+    parser.add_argument("--log", action="append", default=[], help="log file to decode (default: standard input)")
+    options = parser.parse_args()
+
+    formats = load_formats(options.elf)
+    streams = [open(path, errors="replace") for path in options.log] or [sys.stdin]
+    for stream in streams:
+        for line in stream:
+            sys.stdout.write(MESSAGE.sub(lambda match: decode(match.group(1), formats) or match.group(0), line))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""Convert a trace exported with mvTraceExport() to Chrome trace JSON.
+
+The output opens in chrome://tracing or https://ui.perfetto.dev. NSC calls
+and application spans appear on one track, notifications on another and
+asynchronous spans, such as MQTT publishes awaiting their responses, as
+separate rows:
+
+    tools/mv_trace_to_chrome.py trace.bin > trace.json
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = 0x5254564D
+VERSION = 1
+HEADER = struct.Struct("<6I")
+EVENT = struct.Struct("<QHBBI")
+
+CALL_BEGIN, CALL_END, NOTIFICATION, BEGIN, END, ASYNC_BEGIN, ASYNC_END = range(1, 8)
+
+EVENT_TYPES = {
+    1: "NETWORKSTATUSCHANGED",
+    2: "CHANNELDATAREADABLE",
+    3: "CHANNELDATAWRITESPACE",
+    4: "CHANNELNOTCONNECTED",
+    5: "UPDATEDOWNLOADED",
+}
+
+PROCESS = 1
+CALLS_TRACK = 1
+NOTIFICATIONS_TRACK = 2
+
+
+def parse(data):
+    magic, version, calls, names, events, dropped = HEADER.unpack_from(data, 0)
+    if magic != MAGIC:
+        raise ValueError("not an mvTraceExport() stream")
+    if version != VERSION:
+        raise ValueError(f"unsupported trace version {version}")
+
+    offset = HEADER.size
+    table = []
+    for _ in range(calls + names):
+        end = data.index(b"\0", offset)
+        table.append(data[offset:end].decode())
+        offset = end + 1
+
+    records = [EVENT.unpack_from(data, offset + index * EVENT.size) for index in range(events)]
+    return table, records, dropped
+
+
+def convert(table, records):
+    def name(index):
+        return table[index] if index < len(table) else f"#{index}"
+
+    output = [
+        {"ph": "M", "pid": PROCESS, "name": "process_name", "args": {"name": "Microvisor application"}},
+        {"ph": "M", "pid": PROCESS, "tid": CALLS_TRACK, "name": "thread_name", "args": {"name": "Calls"}},
+        {"ph": "M", "pid": PROCESS, "tid": NOTIFICATIONS_TRACK, "name": "thread_name",
+         "args": {"name": "Notifications"}},
+    ]
+    # The ring may have overwritten the begin of the oldest spans.
+    open_spans = []
+    # Events are recorded as calls complete, so a call's begin can follow
+    # newer events; a stable sort restores the order of equal times.
+    for us, index, kind, _reserved, arg in sorted(records, key=lambda record: record[0]):
+        event = {"pid": PROCESS, "tid": CALLS_TRACK, "ts": us, "name": name(index)}
+        if kind in (CALL_BEGIN, BEGIN):
+            open_spans.append(index)
+            event.update(ph="B", cat="call" if kind == CALL_BEGIN else "span")
+            if kind == BEGIN:
+                event["args"] = {"arg": arg}
+        elif kind in (CALL_END, END):
+            if index not in open_spans:
+                continue
+            del open_spans[len(open_spans) - 1 - open_spans[::-1].index(index)]
+            event.update(ph="E")
+            event["args"] = {"status": f"0x{arg:x}"} if kind == CALL_END else {"arg": arg}
+        elif kind == NOTIFICATION:
+            event.update(ph="i", s="t", tid=NOTIFICATIONS_TRACK, cat="notification",
+                         name=EVENT_TYPES.get(index, f"event {index}"), args={"tag": arg})
+        elif kind in (ASYNC_BEGIN, ASYNC_END):
+            event.update(ph="b" if kind == ASYNC_BEGIN else "e", cat="async", id=f"0x{arg:x}")
+        else:
+            continue
+        output.append(event)
+    return output
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("trace", help="bytes written by mvTraceExport()")
+    parser.add_argument("-o", "--output", help="JSON file to write (default: standard output)")
+    args = parser.parse_args()
+
+    with open(args.trace, "rb") as source:
+        table, records, dropped = parse(source.read())
+    if dropped:
+        print(f"{dropped} older events were overwritten", file=sys.stderr)
+
+    trace = {"traceEvents": convert(table, records), "displayTimeUnit": "ms"}
+    if args.output:
+        with open(args.output, "w") as target:
+            json.dump(trace, target)
+    else:
+        json.dump(trace, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,97 @@
+#include <string.h>
+
+#include "microvisor/decimal.h"
+#include "microvisor/syscall_trace.h"
+#include "microvisor/trace_ring.h"
+
+// Generated with the wrappers: the table of calls, indexed as they are.
+extern struct MvSyscallStats mv_syscall_trace_stats[];
+extern const uint32_t mv_syscall_trace_count;
+
+// The wrapped clock, which must not itself be counted.
+enum MvStatus __real_mvGetMicroseconds(uint64_t *us);
+
+uint32_t mvSyscallTraceCount(void) {
+    return mv_syscall_trace_count;
+}
+
+const struct MvSyscallStats *mvSyscallTraceStats(uint32_t index) {
+    return index < mv_syscall_trace_count ? &mv_syscall_trace_stats[index] : NULL;
+}
+
+void mvSyscallTraceReset(void) {
+    for (uint32_t i = 0; i < mv_syscall_trace_count; ++i) {
+        const char *name = mv_syscall_trace_stats[i].name;
+        memset(&mv_syscall_trace_stats[i], 0, sizeof(mv_syscall_trace_stats[i]));
+        mv_syscall_trace_stats[i].name = name;
+    }
+}
+
+void mvSyscallTraceRecord(uint32_t index, enum MvStatus status, uint64_t start_us) {
+    uint64_t end_us;
+    __real_mvGetMicroseconds(&end_us);
+    mvTraceCall(index, status, start_us, end_us);
+    struct MvSyscallStats *stats = &mv_syscall_trace_stats[index];
+    uint64_t elapsed = end_us - start_us;
+    uint32_t bucket = 0;
+    while (bucket + 1 < MV_SYSCALL_TRACE_BUCKETS && elapsed >= (1ull << bucket)) bucket++;
+
+    stats->calls++;
+    stats->total_us += elapsed;
+    if (elapsed > stats->max_us) stats->max_us = elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+    stats->histogram[bucket]++;
+    if (status == MV_STATUS_OKAY) return;
+
+    stats->errors++;
+    for (uint32_t i = 0; i < MV_SYSCALL_TRACE_STATUSES; ++i) {
+        struct MvSyscallStatusCount *slot = &stats->statuses[i];
+        if (slot->count == 0) slot->status = status;
+        if (slot->status == status) {
+            slot->count++;
+            return;
+        }
+    }
+    stats->other_errors++;
+}
+
+static uint32_t appendText(char *line, uint32_t length, uint32_t size, const char *text) {
+    while (*text != '\0' && length < size) line[length++] = *text++;
+    return length;
+}
+
+uint32_t mvSyscallTraceSnapshot(char *buffer, uint32_t size) {
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < mv_syscall_trace_count; ++i) {
+        const struct MvSyscallStats *stats = &mv_syscall_trace_stats[i];
+        if (stats->calls == 0) continue;
+
+        // Build the line in place and keep it only if it fits whole.
+        char *line = buffer + written;
+        uint32_t room = size - written;
+        uint32_t length = appendText(line, 0, room, stats->name);
+        length = appendText(line, length, room, " ");
+        length = mvAppendDecimal(line, length, room, stats->calls);
+        length = appendText(line, length, room, " ");
+        length = mvAppendDecimal(line, length, room, stats->errors);
+        length = appendText(line, length, room, " ");
+        length = mvAppendDecimal(line, length, room, stats->total_us);
+        length = appendText(line, length, room, " ");
+        length = mvAppendDecimal(line, length, room, stats->max_us);
+        uint32_t last = MV_SYSCALL_TRACE_BUCKETS;
+        while (last > 1 && stats->histogram[last - 1] == 0) last--;
+        for (uint32_t bucket = 0; bucket < last; ++bucket) {
+            length = appendText(line, length, room, bucket == 0 ? " " : ",");
+            length = mvAppendDecimal(line, length, room, stats->histogram[bucket]);
+        }
+        for (uint32_t slot = 0; slot < MV_SYSCALL_TRACE_STATUSES && stats->statuses[slot].count != 0; ++slot) {
+            length = appendText(line, length, room, slot == 0 ? " " : ",");
+            length = mvAppendDecimal(line, length, room, stats->statuses[slot].status);
+            length = appendText(line, length, room, ":");
+            length = mvAppendDecimal(line, length, room, stats->statuses[slot].count);
+        }
+        length = appendText(line, length, room, "\n");
+        if (length == 0 || line[length - 1] != '\n') break;
+        written += length;
+    }
+    return written;
+}
@@ -0,0 +1,161 @@
+#include <stdbool.h>
+#include <string.h>
+
+#include "microvisor/syscall_trace.h"
+#include "microvisor/trace_ring.h"
+
+#define TRACE_MAGIC     0x5254564du    // "MVTR"
+#define TRACE_VERSION   1u
+
+// Little-endian, as the events that follow it.
+struct TraceHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t calls;
+    uint32_t names;
+    uint32_t events;
+    uint32_t dropped;
+};
+
+enum MvStatus __real_mvGetMicroseconds(uint64_t *us);
+
+static struct MvTraceEvent *trace_events;
+static uint32_t trace_mask;
+static uint32_t trace_head;
+static bool trace_recording;
+static const char *trace_names[MV_TRACE_NAMES];
+static uint32_t trace_name_count;
+
+static void record(uint64_t us, uint16_t name, uint8_t kind, uint32_t arg) {
+    if (!__atomic_load_n(&trace_recording, __ATOMIC_ACQUIRE)) return;
+    // Interrupt handlers may record too, so each event claims its slot first.
+    uint32_t slot = __atomic_fetch_add(&trace_head, 1, __ATOMIC_RELAXED);
+    struct MvTraceEvent *event = &trace_events[slot & trace_mask];
+    event->us = us;
+    event->name = name;
+    event->kind = kind;
+    event->reserved = 0;
+    event->arg = arg;
+}
+
+static void recordNow(uint16_t name, uint8_t kind, uint32_t arg) {
+    uint64_t now;
+    __real_mvGetMicroseconds(&now);
+    record(now, name, kind, arg);
+}
+
+void mvTraceStart(struct MvTraceEvent *events, uint32_t capacity) {
+    __atomic_store_n(&trace_recording, false, __ATOMIC_RELAXED);
+    // Slots are indexed with a mask, so use the largest power of two that
+    // fits. Without a ring nothing is recorded or exported.
+    while ((capacity & (capacity - 1)) != 0) capacity &= capacity - 1;
+    if (events == NULL || capacity == 0) {
+        events = NULL;
+        capacity = 1;
+    }
+    trace_events = events;
+    trace_mask = capacity - 1;
+    trace_head = 0;
+    __atomic_store_n(&trace_recording, events != NULL, __ATOMIC_RELEASE);
+}
+
+void mvTraceStop(void) {
+    __atomic_store_n(&trace_recording, false, __ATOMIC_RELEASE);
+}
+
+uint16_t mvTraceName(const char *name) {
+    uint32_t first = mvSyscallTraceCount();
+    for (uint32_t i = 0; i < trace_name_count; ++i) {
+        if (strcmp(trace_names[i], name) == 0) return (uint16_t)(first + i);
+    }
+    if (trace_name_count == MV_TRACE_NAMES) return MV_TRACE_NAME_INVALID;
+    trace_names[trace_name_count] = name;
+    return (uint16_t)(first + trace_name_count++);
+}
+
+void mvTraceBegin(uint16_t name, uint32_t arg) {
+    recordNow(name, MV_TRACE_BEGIN, arg);
+}
+
+void mvTraceEnd(uint16_t name, uint32_t arg) {
+    recordNow(name, MV_TRACE_END, arg);
+}
+
+void mvTraceAsyncBegin(uint16_t name, uint32_t id) {
+    recordNow(name, MV_TRACE_ASYNC_BEGIN, id);
+}
+
+void mvTraceAsyncEnd(uint16_t name, uint32_t id) {
+    recordNow(name, MV_TRACE_ASYNC_END, id);
+}
+
+void mvTraceNotification(const struct MvNotification *notification) {
+    record(notification->microseconds, (uint16_t)notification->event_type, MV_TRACE_NOTIFICATION, notification->tag);
+}
+
+void mvTraceCall(uint32_t index, enum MvStatus status, uint64_t start_us, uint64_t end_us) {
+    record(start_us, (uint16_t)index, MV_TRACE_CALL_BEGIN, 0);
+    record(end_us, (uint16_t)index, MV_TRACE_CALL_END, (uint32_t)status);
+}
+
+static uint32_t eventCount(void) {
+    if (trace_events == NULL) return 0;
+    return trace_head > trace_mask ? trace_mask + 1 : trace_head;
+}
+
+uint32_t mvTraceDropped(void) {
+    return trace_head - eventCount();
+}
+
+// Copies whichever part of the stream at `offset` falls in each piece
+// passed in turn.
+struct Export {
+    uint32_t position;
+    uint32_t offset;
+    uint8_t *buffer;
+    uint32_t size;
+    uint32_t copied;
+};
+
+static void exportPiece(struct Export *out, const void *data, uint32_t length) {
+    uint32_t at = out->offset + out->copied;
+    if (out->copied < out->size && at >= out->position && at - out->position < length) {
+        uint32_t skip = at - out->position;
+        uint32_t count = length - skip;
+        if (count > out->size - out->copied) count = out->size - out->copied;
+        memcpy(out->buffer + out->copied, (const uint8_t *)data + skip, count);
+        out->copied += count;
+    }
+    out->position += length;
+}
+
+static struct Export exportStream(uint32_t offset, uint8_t *buffer, uint32_t size) {
+    struct Export out = {0, offset, buffer, size, 0};
+    uint32_t calls = mvSyscallTraceCount();
+    uint32_t events = eventCount();
+    struct TraceHeader header = {TRACE_MAGIC, TRACE_VERSION, calls, trace_name_count, events, mvTraceDropped()};
+    exportPiece(&out, &header, sizeof(header));
+
+    for (uint32_t i = 0; i < calls; ++i) {
+        const char *name = mvSyscallTraceStats(i)->name;
+        exportPiece(&out, name, (uint32_t)strlen(name) + 1);
+    }
+    for (uint32_t i = 0; i < trace_name_count; ++i) {
+        exportPiece(&out, trace_names[i], (uint32_t)strlen(trace_names[i]) + 1);
+    }
+
+    // Oldest first: from the slot after the newest, wrapping.
+    uint32_t oldest = (trace_head - events) & trace_mask;
+    uint32_t first = events < trace_mask + 1 - oldest ? events : trace_mask + 1 - oldest;
+    exportPiece(&out, trace_events + oldest, first * sizeof(struct MvTraceEvent));
+    exportPiece(&out, trace_events, (events - first) * sizeof(struct MvTraceEvent));
+    return out;
+}
+
+uint32_t mvTraceExportSize(void) {
+    return exportStream(0, NULL, 0).position;
+}
+
+uint32_t mvTraceExport(uint32_t offset, uint8_t *buffer, uint32_t size) {
+    return exportStream(offset, buffer, size).copied;
+}